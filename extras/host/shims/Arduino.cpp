@@ -0,0 +1,280 @@
+/*
+ * Arduino.cpp (host shim):
+ *    String, Print, Stream, and time on top of the C library
+ *
+ */
+
+#include <chrono>
+#include <random>
+#include <thread>
+#include "Arduino.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Time and random numbers
+ *
+ *----------------------------------------------------------------------------*/
+
+static std::chrono::steady_clock::time_point boot() {
+  static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  return start;
+}
+
+uint32_t millis() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - boot()).count();
+}
+
+uint32_t micros() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - boot()).count();
+}
+
+void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+// Like the ESP cores' hardware RNG, different on each run unless seeded
+static std::minstd_rand& generator() {
+  static std::minstd_rand g(std::random_device{}());
+  return g;
+}
+
+long random(long howBig) { return howBig > 0 ? (long)(generator()() % (unsigned long)howBig) : 0; }
+long random(long howSmall, long howBig) { return howBig > howSmall ? howSmall + random(howBig - howSmall) : howSmall; }
+void randomSeed(unsigned long seed) { if (seed) generator().seed(seed); }
+
+
+/*------------------------------------------------------------------------------
+ *
+ * String
+ *
+ *----------------------------------------------------------------------------*/
+
+String::String(const char* cstr) { if (cstr) copy(cstr, strlen(cstr)); }
+String::String(const char* cstr, unsigned length) { if (cstr) copy(cstr, length); }
+String::String(const String& str) { copy(str.c_str(), str._length); }
+String::String(String&& str) : _buffer(str._buffer), _capacity(str._capacity), _length(str._length) {
+  str._buffer = nullptr; str._capacity = str._length = 0;
+}
+String::String(char c) { copy(&c, 1); }
+
+static String formatted(const char* format, ...) __attribute__((format(printf, 1, 2)));
+static String formatted(const char* format, ...) {
+  char buf[72];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+  return String(buf);
+}
+
+static String inBase(unsigned long value, unsigned char base, bool negative) {
+  if (base == 10) return formatted(negative ? "-%lu" : "%lu", value);
+  if (base == 16) return formatted("%lx", value);
+  char buf[8 * sizeof(long) + 2];
+  char* p = &buf[sizeof(buf) - 1];
+  *p = 0;
+  do { unsigned d = value % base; *--p = d < 10 ? '0' + d : 'a' + d - 10; value /= base; } while (value);
+  return String(p);
+}
+
+String::String(unsigned char value, unsigned char base) : String(inBase(value, base, false)) { }
+String::String(int value, unsigned char base) : String((long)value, base) { }
+String::String(unsigned int value, unsigned char base) : String(inBase(value, base, false)) { }
+String::String(long value, unsigned char base)
+    : String(base == 10 && value < 0 ? inBase(-(unsigned long)value, base, true) : inBase((unsigned long)value, base, false)) { }
+String::String(unsigned long value, unsigned char base) : String(inBase(value, base, false)) { }
+String::String(float value, unsigned char decimalPlaces) : String(formatted("%.*f", decimalPlaces, (double)value)) { }
+String::String(double value, unsigned char decimalPlaces) : String(formatted("%.*f", decimalPlaces, value)) { }
+
+String& String::operator=(const String& rhs) { return this == &rhs ? *this : copy(rhs.c_str(), rhs._length); }
+
+String& String::operator=(String&& rhs) {
+  if (this != &rhs) {
+    delete[] _buffer;
+    _buffer = rhs._buffer; _capacity = rhs._capacity; _length = rhs._length;
+    rhs._buffer = nullptr; rhs._capacity = rhs._length = 0;
+  }
+  return *this;
+}
+
+String& String::operator=(const char* cstr) { return cstr ? copy(cstr, strlen(cstr)) : copy("", 0); }
+
+bool String::ensure(unsigned capacity) {
+  if (_buffer && capacity <= _capacity) return true;
+  // Like the ESP8266 core, grow to exactly what was asked for
+  char* buffer = new char[capacity + 1];
+  if (_buffer) memcpy(buffer, _buffer, _length + 1);
+  else buffer[0] = 0;
+  delete[] _buffer;
+  _buffer = buffer;
+  _capacity = capacity;
+  return true;
+}
+
+bool String::reserve(unsigned size) { return ensure(size); }
+
+String& String::copy(const char* cstr, unsigned length) {
+  if (length == 0 && !_buffer) return *this;
+  ensure(length);
+  memmove(_buffer, cstr, length);
+  _buffer[length] = 0;
+  _length = length;
+  return *this;
+}
+
+bool String::concat(const char* cstr, unsigned length) {
+  if (length == 0) return true;
+  if (_buffer && cstr >= _buffer && cstr < _buffer + _capacity) {
+    String self(cstr, length);      // Appending (part of) ourselves
+    return concat(self.c_str(), length);
+  }
+  ensure(_length + length);
+  memcpy(_buffer + _length, cstr, length);
+  _length += length;
+  _buffer[_length] = 0;
+  return true;
+}
+
+bool String::startsWith(const String& prefix, unsigned offset) const {
+  return offset + prefix._length <= _length && strncmp(c_str() + offset, prefix.c_str(), prefix._length) == 0;
+}
+
+bool String::endsWith(const String& suffix) const {
+  return suffix._length <= _length && strcmp(c_str() + _length - suffix._length, suffix.c_str()) == 0;
+}
+
+char& String::operator[](unsigned index) {
+  static char dummy;
+  if (index >= _length) { dummy = 0; return dummy; }
+  return _buffer[index];
+}
+
+int String::indexOf(char c, unsigned fromIndex) const {
+  if (fromIndex >= _length) return -1;
+  const char* p = strchr(c_str() + fromIndex, c);
+  return p ? (int)(p - c_str()) : -1;
+}
+
+int String::indexOf(const String& str, unsigned fromIndex) const {
+  if (fromIndex > _length) return -1;
+  const char* p = strstr(c_str() + fromIndex, str.c_str());
+  return p ? (int)(p - c_str()) : -1;
+}
+
+int String::lastIndexOf(char c) const {
+  const char* p = strrchr(c_str(), c);
+  return p ? (int)(p - c_str()) : -1;
+}
+
+String String::substring(unsigned beginIndex, unsigned endIndex) const {
+  if (beginIndex > endIndex) std::swap(beginIndex, endIndex);
+  if (beginIndex >= _length) return String();
+  if (endIndex > _length) endIndex = _length;
+  return String(c_str() + beginIndex, endIndex - beginIndex);
+}
+
+void String::replace(char find, char replace) {
+  for (unsigned i = 0; i < _length; i++) if (_buffer[i] == find) _buffer[i] = replace;
+}
+
+void String::remove(unsigned index, unsigned count) {
+  if (index >= _length) return;
+  if (count > _length - index) count = _length - index;
+  memmove(_buffer + index, _buffer + index + count, _length - index - count + 1);
+  _length -= count;
+}
+
+void String::toLowerCase() { for (unsigned i = 0; i < _length; i++) _buffer[i] = tolower(_buffer[i]); }
+void String::toUpperCase() { for (unsigned i = 0; i < _length; i++) _buffer[i] = toupper(_buffer[i]); }
+
+void String::trim() {
+  unsigned start = 0, end = _length;
+  while (start < end && isspace((unsigned char)_buffer[start])) start++;
+  while (end > start && isspace((unsigned char)_buffer[end - 1])) end--;
+  if (start == 0 && end == _length) return;
+  memmove(_buffer, _buffer + start, end - start);
+  _length = end - start;
+  _buffer[_length] = 0;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Print and Stream
+ *
+ *----------------------------------------------------------------------------*/
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    if (!write(*buffer++)) break;
+    n++;
+  }
+  return n;
+}
+
+size_t Print::printf(const char* format, ...) {
+  char buf[128];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+  if (length < 0) return 0;
+  if ((size_t)length < sizeof(buf)) return write(buf, length);
+  char* big = new char[length + 1];
+  va_start(args, format);
+  vsnprintf(big, length + 1, format, args);
+  va_end(args);
+  size_t n = write(big, length);
+  delete[] big;
+  return n;
+}
+
+size_t Print::print(long value, int base) {
+  if (base == 10) { char buf[24]; return write(buf, snprintf(buf, sizeof(buf), "%ld", value)); }
+  return print((unsigned long)value, base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+  char buf[8 * sizeof(long) + 1];
+  char* p = &buf[sizeof(buf)];
+  if (base < 2) base = 10;
+  do { unsigned d = value % base; *--p = d < 10 ? '0' + d : 'A' + d - 10; value /= base; } while (value);
+  return write(p, &buf[sizeof(buf)] - p);
+}
+
+size_t Print::print(double value, int digits) {
+  if (isnan(value)) return write("nan");
+  if (isinf(value)) return write("inf");
+  char buf[48];
+  return write(buf, snprintf(buf, sizeof(buf), "%.*f", digits, value));
+}
+
+int Stream::timedRead() {
+  uint32_t start = millis();
+  do {
+    int c = read();
+    if (c >= 0) return c;
+    yield();
+  } while (millis() - start < _timeout);
+  return -1;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    int c = timedRead();
+    if (c < 0) break;
+    *buffer++ = (char)c;
+    count++;
+  }
+  return count;
+}
+
+String Stream::readStringUntil(char terminator) {
+  String s;
+  int c;
+  while ((c = timedRead()) >= 0 && c != terminator) s += (char)c;
+  return s;
+}
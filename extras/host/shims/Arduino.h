@@ -0,0 +1,194 @@
+/*
+ * Arduino.h (host shim):
+ *    Just enough of the Arduino core to build the library on a desktop:
+ *    String, Print, Stream, and the timing functions. Behaves like the ESP8266
+ *    core where the library depends on it (e.g. String grows on the heap).
+ *
+ */
+
+#ifndef HostShim_Arduino_h
+#define HostShim_Arduino_h
+
+#include <ctype.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <algorithm>
+#include <functional>
+
+using std::min;
+using std::max;
+
+// ----- Program memory is just memory
+class __FlashStringHelper;
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(PSTR(s)))
+#define FPSTR(p) (reinterpret_cast<const __FlashStringHelper*>(p))
+typedef const char* PGM_P;
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define strlen_P strlen
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define strcasecmp_P strcasecmp
+#define strncasecmp_P strncasecmp
+#define strcpy_P strcpy
+#define memcpy_P memcpy
+
+typedef uint8_t byte;
+#define HEX 16
+#define DEC 10
+#define constrain(amt, low, high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+inline bool isDigit(int c) { return isdigit(c); }
+
+// ----- Time. millis() counts from the first call, like it counts from boot
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+inline void yield() { }
+
+long random(long howBig);
+long random(long howSmall, long howBig);
+void randomSeed(unsigned long seed);
+
+
+class String {
+public:
+  String(const char* cstr = "");
+  String(const char* cstr, unsigned length);
+  String(const String& str);
+  String(String&& str);
+  String(const __FlashStringHelper* str) : String(reinterpret_cast<const char*>(str)) { }
+  explicit String(char c);
+  explicit String(unsigned char value, unsigned char base = 10);
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(float value, unsigned char decimalPlaces = 2);
+  explicit String(double value, unsigned char decimalPlaces = 2);
+  ~String() { delete[] _buffer; }
+
+  String& operator=(const String& rhs);
+  String& operator=(String&& rhs);
+  String& operator=(const char* cstr);
+  String& operator=(const __FlashStringHelper* str) { return *this = reinterpret_cast<const char*>(str); }
+
+  bool reserve(unsigned size);
+  unsigned length() const { return _length; }
+  bool isEmpty() const { return _length == 0; }
+  const char* c_str() const { return _buffer ? _buffer : ""; }
+  char* begin() { return _buffer; }
+  char* end() { return _buffer + _length; }
+  void clear() { _length = 0; if (_buffer) _buffer[0] = 0; }
+
+  bool concat(const String& str) { return concat(str.c_str(), str._length); }
+  bool concat(const char* cstr) { return cstr && concat(cstr, strlen(cstr)); }
+  bool concat(const char* cstr, unsigned length);
+  bool concat(const __FlashStringHelper* str) { return concat(reinterpret_cast<const char*>(str)); }
+  bool concat(char c) { return concat(&c, 1); }
+  bool concat(unsigned char value) { return concat(String(value)); }
+  bool concat(int value) { return concat(String(value)); }
+  bool concat(unsigned int value) { return concat(String(value)); }
+  bool concat(long value) { return concat(String(value)); }
+  bool concat(unsigned long value) { return concat(String(value)); }
+  bool concat(float value) { return concat(String(value)); }
+  bool concat(double value) { return concat(String(value)); }
+  template <typename T> String& operator+=(const T& rhs) { concat(rhs); return *this; }
+
+  int compareTo(const String& s) const { return strcmp(c_str(), s.c_str()); }
+  bool equals(const String& s) const { return _length == s._length && compareTo(s) == 0; }
+  bool equals(const char* cstr) const { return strcmp(c_str(), cstr ? cstr : "") == 0; }
+  bool equalsIgnoreCase(const String& s) const { return _length == s._length && strcasecmp(c_str(), s.c_str()) == 0; }
+  bool operator==(const String& rhs) const { return equals(rhs); }
+  bool operator==(const char* cstr) const { return equals(cstr); }
+  bool operator!=(const String& rhs) const { return !equals(rhs); }
+  bool operator!=(const char* cstr) const { return !equals(cstr); }
+  bool operator<(const String& rhs) const { return compareTo(rhs) < 0; }
+  bool startsWith(const String& prefix) const { return startsWith(prefix, 0); }
+  bool startsWith(const String& prefix, unsigned offset) const;
+  bool endsWith(const String& suffix) const;
+
+  char charAt(unsigned index) const { return index < _length ? _buffer[index] : 0; }
+  void setCharAt(unsigned index, char c) { if (index < _length) _buffer[index] = c; }
+  char operator[](unsigned index) const { return charAt(index); }
+  char& operator[](unsigned index);
+
+  int indexOf(char c, unsigned fromIndex = 0) const;
+  int indexOf(const String& str, unsigned fromIndex = 0) const;
+  int lastIndexOf(char c) const;
+  String substring(unsigned beginIndex) const { return substring(beginIndex, _length); }
+  String substring(unsigned beginIndex, unsigned endIndex) const;
+
+  void replace(char find, char replace);
+  void remove(unsigned index) { remove(index, (unsigned)-1); }
+  void remove(unsigned index, unsigned count);
+  void toLowerCase();
+  void toUpperCase();
+  void trim();
+  long toInt() const { return atol(c_str()); }
+  float toFloat() const { return atof(c_str()); }
+
+private:
+  char* _buffer = nullptr;
+  unsigned _capacity = 0;
+  unsigned _length = 0;
+
+  bool ensure(unsigned capacity);
+  String& copy(const char* cstr, unsigned length);
+};
+
+template <typename T> String operator+(const String& lhs, const T& rhs) { String s(lhs); s += rhs; return s; }
+inline String operator+(const char* lhs, const String& rhs) { String s(lhs); s += rhs; return s; }
+
+
+class Print {
+public:
+  virtual ~Print() { }
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  size_t write(const char* str) { return str ? write((const uint8_t*)str, strlen(str)) : 0; }
+  size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+  virtual int availableForWrite() { return 0; }
+  virtual void flush() { }
+
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+  size_t print(const __FlashStringHelper* str) { return write(reinterpret_cast<const char*>(str)); }
+  size_t print(const String& s) { return write(s.c_str(), s.length()); }
+  size_t print(const char* str) { return write(str); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char value, int base = DEC) { return print((unsigned long)value, base); }
+  size_t print(int value, int base = DEC) { return print((long)value, base); }
+  size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+  size_t print(long value, int base = DEC);
+  size_t print(unsigned long value, int base = DEC);
+  size_t print(double value, int digits = 2);
+
+  size_t println() { return write("\r\n"); }
+  template <typename T> size_t println(const T& value) { size_t n = print(value); return n + println(); }
+  template <typename T> size_t println(const T& value, int format) { size_t n = print(value, format); return n + println(); }
+};
+
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeout) { _timeout = timeout; }
+  size_t readBytes(char* buffer, size_t length);
+  size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+  String readStringUntil(char terminator);
+
+protected:
+  unsigned long _timeout = 1000;
+  int timedRead();
+};
+
+#endif  // HostShim_Arduino_h
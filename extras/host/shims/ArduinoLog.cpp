@@ -0,0 +1,49 @@
+/*
+ * ArduinoLog.cpp (host shim)
+ *
+ */
+
+#include "ArduinoLog.h"
+
+Logging Log;
+
+class StderrPrint : public Print {
+public:
+  size_t write(uint8_t c) override { return fputc(c, stderr) == EOF ? 0 : 1; }
+  size_t write(const uint8_t* buffer, size_t size) override { return fwrite(buffer, 1, size, stderr); }
+};
+
+void Logging::begin(int level, Print* output, bool showLevel) {
+  _level = level;
+  _output = output;
+  _showLevel = showLevel;
+}
+
+void Logging::print(int level, const char* format, ...) {
+  static StderrPrint standardError;
+  static const char levels[] = "SFEWNTV";
+  Print& out = _output ? *_output : standardError;
+  if (_showLevel) { out.print(levels[level]); out.print(F(": ")); }
+
+  va_list args;
+  va_start(args, format);
+  for (const char* p = format; *p; p++) {
+    if (*p != '%' || !p[1]) { out.print(*p); continue; }
+    switch (*++p) {
+      case 's': out.print(va_arg(args, const char*)); break;
+      case 'S': out.print(va_arg(args, const __FlashStringHelper*)); break;
+      case 'c': out.print((char)va_arg(args, int)); break;
+      case 'd': case 'i': out.print(va_arg(args, int)); break;
+      case 'l': out.print(va_arg(args, long)); break;
+      case 'u': out.print(va_arg(args, unsigned long)); break;
+      case 'x': out.print(va_arg(args, unsigned int), HEX); break;
+      case 'X': out.print(F("0x")); out.print(va_arg(args, unsigned int), HEX); break;
+      case 'F': out.print(va_arg(args, double)); break;
+      case 't': out.print(va_arg(args, int) ? 'T' : 'F'); break;
+      case 'T': out.print(va_arg(args, int) ? F("true") : F("false")); break;
+      default: out.print(*p); break;
+    }
+  }
+  va_end(args);
+  out.println();
+}
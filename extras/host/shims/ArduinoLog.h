@@ -0,0 +1,50 @@
+/*
+ * ArduinoLog.h (host shim):
+ *    The Logging interface of ArduinoLog. Messages go to a Print (stderr by
+ *    default) and use ArduinoLog's format specifiers: %s %S %c %d %i %l %u %x
+ *    %X %F %t %T %%.
+ *
+ */
+
+#ifndef HostShim_ArduinoLog_h
+#define HostShim_ArduinoLog_h
+
+#include "Arduino.h"
+
+#define LOG_LEVEL_SILENT  0
+#define LOG_LEVEL_FATAL   1
+#define LOG_LEVEL_ERROR   2
+#define LOG_LEVEL_WARNING 3
+#define LOG_LEVEL_NOTICE  4
+#define LOG_LEVEL_INFO    LOG_LEVEL_NOTICE
+#define LOG_LEVEL_TRACE   5
+#define LOG_LEVEL_VERBOSE 6
+
+class Logging {
+public:
+  // `output` == nullptr logs to stderr
+  void begin(int level, Print* output = nullptr, bool showLevel = true);
+  void setLevel(int level) { _level = level; }
+  int getLevel() const { return _level; }
+
+  template <class T, typename... Args> void fatal(T msg, Args... args) { log(LOG_LEVEL_FATAL, msg, args...); }
+  template <class T, typename... Args> void error(T msg, Args... args) { log(LOG_LEVEL_ERROR, msg, args...); }
+  template <class T, typename... Args> void warning(T msg, Args... args) { log(LOG_LEVEL_WARNING, msg, args...); }
+  template <class T, typename... Args> void notice(T msg, Args... args) { log(LOG_LEVEL_NOTICE, msg, args...); }
+  template <class T, typename... Args> void trace(T msg, Args... args) { log(LOG_LEVEL_TRACE, msg, args...); }
+  template <class T, typename... Args> void verbose(T msg, Args... args) { log(LOG_LEVEL_VERBOSE, msg, args...); }
+
+private:
+  int _level = LOG_LEVEL_WARNING;
+  Print* _output = nullptr;
+  bool _showLevel = true;
+
+  template <class T, typename... Args> void log(int level, T msg, Args... args) {
+    if (level <= _level) print(level, reinterpret_cast<const char*>(msg), args...);
+  }
+  void print(int level, const char* format, ...);
+};
+
+extern Logging Log;
+
+#endif  // HostShim_ArduinoLog_h
@@ -0,0 +1,16 @@
+/*
+ * BPABasics.h (host shim)
+ *
+ */
+
+#ifndef HostShim_BPABasics_h
+#define HostShim_BPABasics_h
+
+#include "Arduino.h"
+
+namespace Basics {
+  // Empty the string and release its buffer
+  inline void resetString(String& s) { s = String(); }
+}
+
+#endif  // HostShim_BPABasics_h
@@ -0,0 +1,79 @@
+/*
+ * FS.cpp (host shim)
+ *
+ */
+
+#include <sys/stat.h>
+#include <errno.h>
+#include "FS.h"
+
+namespace fs {
+
+size_t File::write(const uint8_t* buffer, size_t size) { return _f ? fwrite(buffer, 1, size, _f.get()) : 0; }
+
+int File::available() {
+  if (!_f) return 0;
+  long pos = ftell(_f.get());
+  return pos < 0 ? 0 : (int)(size() - pos);
+}
+
+int File::read() { return _f ? fgetc(_f.get()) : -1; }   // EOF == -1
+
+size_t File::read(uint8_t* buffer, size_t size) { return _f ? fread(buffer, 1, size, _f.get()) : 0; }
+
+int File::peek() {
+  if (!_f) return -1;
+  int c = fgetc(_f.get());
+  if (c != EOF) ungetc(c, _f.get());
+  return c;
+}
+
+bool File::seek(uint32_t pos) { return _f && pos <= size() && fseek(_f.get(), pos, SEEK_SET) == 0; }
+
+size_t File::position() const { return _f ? ftell(_f.get()) : 0; }
+
+size_t File::size() const {
+  if (!_f) return 0;
+  fflush(_f.get());
+  struct stat st;
+  return fstat(fileno(_f.get()), &st) == 0 ? st.st_size : 0;
+}
+
+
+String FS::hostPath(const char* path) {
+  String full = _root;
+  if (path[0] != '/') full += '/';
+  full += path;
+  return full;
+}
+
+File FS::open(const char* path, const char* mode) {
+  // Like LittleFS, create missing parent directories when writing
+  if (mode[0] != 'r') {
+    String full = hostPath(path);
+    for (int slash = full.indexOf('/', _root.length() + 1); slash > 0; slash = full.indexOf('/', slash + 1)) {
+      ::mkdir(full.substring(0, slash).c_str(), 0755);
+    }
+  }
+  String m(mode);
+  if (m.indexOf('b') < 0) m += 'b';
+  FILE* f = fopen(hostPath(path).c_str(), m.c_str());
+  return f ? File(f, path) : File();
+}
+
+bool FS::exists(const char* path) {
+  struct stat st;
+  return stat(hostPath(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char* path) { return ::remove(hostPath(path).c_str()) == 0; }
+
+bool FS::rename(const char* from, const char* to) {
+  return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+
+bool FS::mkdir(const char* path) {
+  return ::mkdir(hostPath(path).c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+}  // namespace fs
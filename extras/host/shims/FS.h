@@ -0,0 +1,70 @@
+/*
+ * FS.h (host shim):
+ *    The Arduino FS API on a directory of the host. A path such as "/jobs/3"
+ *    names <root>/jobs/3, so a file system image copied off a device (or a
+ *    directory written by a host tool) can be read by the library as is.
+ *
+ */
+
+#ifndef HostShim_FS_h
+#define HostShim_FS_h
+
+#include <stdio.h>
+#include <memory>
+#include "Arduino.h"
+
+namespace fs {
+
+class File : public Stream {
+public:
+  File() { }
+  File(FILE* f, const String& name) : _f(f, fclose), _name(name) { }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  size_t read(uint8_t* buffer, size_t size);
+  int peek() override;
+  void flush() override { if (_f) fflush(_f.get()); }
+
+  bool seek(uint32_t pos);
+  size_t position() const;
+  size_t size() const;
+  const char* name() const { return _name.c_str(); }
+  void close() { _f.reset(); }
+  operator bool() const { return _f != nullptr; }
+
+private:
+  std::shared_ptr<FILE> _f;     // Copies refer to the same open file, as on a device
+  String _name;
+};
+
+class FS {
+public:
+  explicit FS(const char* root) : _root(root) { }
+
+  // Modes are those of LittleFS: "r", "r+", "w", "w+", "a", "a+"
+  File open(const char* path, const char* mode);
+  File open(const String& path, const char* mode) { return open(path.c_str(), mode); }
+  bool exists(const char* path);
+  bool exists(const String& path) { return exists(path.c_str()); }
+  bool remove(const char* path);
+  bool remove(const String& path) { return remove(path.c_str()); }
+  bool rename(const char* from, const char* to);
+  bool rename(const String& from, const String& to) { return rename(from.c_str(), to.c_str()); }
+  bool mkdir(const char* path);
+  bool mkdir(const String& path) { return mkdir(path.c_str()); }
+
+private:
+  String _root;
+  String hostPath(const char* path);
+};
+
+}  // namespace fs
+
+using fs::FS;
+using fs::File;
+
+#endif  // HostShim_FS_h
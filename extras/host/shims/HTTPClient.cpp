@@ -0,0 +1,178 @@
+/*
+ * HTTPClient.cpp and JSONService (host shims)
+ *
+ */
+
+#include "HTTPClient.h"
+#include "JSONService.h"
+#include "alloc_count.h"
+
+bool HTTPClient::begin(WiFiClient& client, const String& host, uint16_t port, const String& uri, bool https) {
+  AllocCount::Transport transport;
+  if (https) return false;
+  _client = &client;
+  _host = host;
+  _port = port;
+  _uri = uri;
+  _headers.clear();
+  _size = -1;
+  for (uint8_t i = 0; i < _nCollected; i++) _collected[i].present = false;
+  return true;
+}
+
+void HTTPClient::end() {
+  AllocCount::Transport transport;
+  if (_client) _client->stop();
+  _client = nullptr;
+}
+
+static String base64(const String& in) {
+  static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  String out;
+  const uint8_t* p = (const uint8_t*)in.c_str();
+  for (unsigned i = 0; i < in.length(); i += 3) {
+    uint32_t bits = p[i] << 16;
+    if (i + 1 < in.length()) bits |= p[i + 1] << 8;
+    if (i + 2 < in.length()) bits |= p[i + 2];
+    out += alphabet[(bits >> 18) & 63];
+    out += alphabet[(bits >> 12) & 63];
+    out += i + 1 < in.length() ? alphabet[(bits >> 6) & 63] : '=';
+    out += i + 2 < in.length() ? alphabet[bits & 63] : '=';
+  }
+  return out;
+}
+
+void HTTPClient::setAuthorization(const char* user, const char* password) {
+  AllocCount::Transport transport;
+  String credentials(user);
+  credentials += ':';
+  credentials += password;
+  addHeader(F("Authorization"), String(F("Basic ")) + base64(credentials));
+}
+
+void HTTPClient::addHeader(const String& name, const String& value, bool, bool) {
+  AllocCount::Transport transport;
+  _headers += name;
+  _headers += F(": ");
+  _headers += value;
+  _headers += F("\r\n");
+}
+
+void HTTPClient::collectHeaders(const char* headerKeys[], const size_t headerKeysCount) {
+  AllocCount::Transport transport;
+  _nCollected = std::min(headerKeysCount, (size_t)MaxCollected);
+  for (uint8_t i = 0; i < _nCollected; i++) {
+    _collected[i].key = headerKeys[i];
+    _collected[i].value.clear();
+    _collected[i].present = false;
+  }
+}
+
+bool HTTPClient::readLine(String& line) {
+  AllocCount::Transport transport;
+  line.clear();
+  uint32_t start = millis();
+  while (millis() - start < _timeout) {
+    int c = _client->read();
+    if (c < 0) {
+      if (!_client->connected()) return false;
+      delay(1);
+      continue;
+    }
+    if (c == '\n') { if (line.length() && line[line.length() - 1] == '\r') line.remove(line.length() - 1); return true; }
+    line += (char)c;
+  }
+  return false;
+}
+
+int HTTPClient::GET() {
+  AllocCount::Transport transport;
+  if (!_client) return HTTPC_ERROR_NOT_CONNECTED;
+  if (!_client->connect(_host, _port)) return HTTPC_ERROR_CONNECTION_REFUSED;
+
+  String request(F("GET "));
+  request += _uri;
+  request += _http10 ? F(" HTTP/1.0\r\nHost: ") : F(" HTTP/1.1\r\nHost: ");
+  request += _host;
+  if (_port != 80) { request += ':'; request += _port; }
+  request += F("\r\nUser-Agent: ESP8266HTTPClient\r\nConnection: close\r\n");
+  request += _headers;
+  request += F("\r\n");
+  if (_client->write((const uint8_t*)request.c_str(), request.length()) != request.length()) {
+    return HTTPC_ERROR_SEND_HEADER_FAILED;
+  }
+
+  String line;
+  if (!readLine(line)) return HTTPC_ERROR_READ_TIMEOUT;
+  int space = line.indexOf(' ');
+  int code = space > 0 ? atoi(line.c_str() + space + 1) : 0;
+  if (code <= 0) return HTTPC_ERROR_READ_TIMEOUT;
+
+  while (readLine(line) && line.length()) {
+    int colon = line.indexOf(':');
+    if (colon <= 0) continue;
+    String name = line.substring(0, colon);
+    String value = line.substring(colon + 1);
+    value.trim();
+    if (name.equalsIgnoreCase(F("Content-Length"))) _size = value.toInt();
+    for (uint8_t i = 0; i < _nCollected; i++) {
+      if (name.equalsIgnoreCase(_collected[i].key)) {
+        _collected[i].value = value;
+        _collected[i].present = true;
+      }
+    }
+  }
+  return code;
+}
+
+String HTTPClient::header(const char* name) {
+  AllocCount::Transport transport;
+  for (uint8_t i = 0; i < _nCollected; i++) {
+    if (strcasecmp(_collected[i].key, name) == 0) return _collected[i].value;
+  }
+  return String();
+}
+
+bool HTTPClient::hasHeader(const char* name) {
+  AllocCount::Transport transport;
+  for (uint8_t i = 0; i < _nCollected; i++) {
+    if (strcasecmp(_collected[i].key, name) == 0) return _collected[i].present;
+  }
+  return false;
+}
+
+String HTTPClient::getString() {
+  AllocCount::Transport transport;
+  String body;
+  if (!_client) return body;
+  if (_size > 0) body.reserve(_size);
+  uint32_t start = millis();
+  while ((_size < 0 || (int)body.length() < _size) && millis() - start < _timeout) {
+    int c = _client->read();
+    if (c >= 0) { body += (char)c; continue; }
+    if (!_client->connected()) break;
+    delay(1);
+  }
+  return body;
+}
+
+
+DynamicJsonDocument* JSONService::issueGET(String endpoint, int jsonSize, JsonDocument* filter) {
+  AllocCount::Transport transport;
+  WiFiClient client;
+  HTTPClient http;
+  http.useHTTP10(true);
+  if (!http.begin(client, _details.server, _details.port, endpoint)) return nullptr;
+  if (!_details.apiKeyName.isEmpty()) http.addHeader(_details.apiKeyName, _details.apiKey);
+  if (!_details.user.isEmpty()) http.setAuthorization(_details.user.c_str(), _details.pass.c_str());
+  int httpCode = http.GET();
+  if (httpCode != HTTP_CODE_OK) { http.end(); return nullptr; }
+
+  DynamicJsonDocument* doc = new DynamicJsonDocument(jsonSize);
+  DeserializationError error = filter
+      ? deserializeJson(*doc, *http.getStreamPtr(), DeserializationOption::Filter(*filter))
+      : deserializeJson(*doc, *http.getStreamPtr());
+  http.end();
+  if (error) { delete doc; return nullptr; }
+  return doc;
+}
@@ -0,0 +1,64 @@
+/*
+ * HTTPClient.h (host shim):
+ *    The GET side of the ESP HTTPClient over a WiFiClient. Requests are sent
+ *    as HTTP/1.0 (or 1.1 with "Connection: close") and the body is left in
+ *    the client for the caller to read.
+ *
+ */
+
+#ifndef HostShim_HTTPClient_h
+#define HostShim_HTTPClient_h
+
+#include "WiFi.h"
+
+#define HTTPC_ERROR_CONNECTION_REFUSED  (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED  (-2)
+#define HTTPC_ERROR_NOT_CONNECTED       (-4)
+#define HTTPC_ERROR_READ_TIMEOUT        (-11)
+
+#define HTTP_CODE_OK                  200
+#define HTTP_CODE_NO_CONTENT          204
+#define HTTP_CODE_NOT_MODIFIED        304
+#define HTTP_CODE_UNAUTHORIZED        401
+#define HTTP_CODE_NOT_FOUND           404
+
+class HTTPClient {
+public:
+  bool begin(WiFiClient& client, const String& host, uint16_t port, const String& uri = "/", bool https = false);
+  void end();
+
+  void useHTTP10(bool useHTTP10) { _http10 = useHTTP10; }
+  void setTimeout(uint16_t timeout) { _timeout = timeout; }
+  void setReuse(bool) { }
+  void setAuthorization(const char* user, const char* password);
+  void addHeader(const String& name, const String& value, bool first = false, bool replace = true);
+  void collectHeaders(const char* headerKeys[], const size_t headerKeysCount);
+
+  int GET();
+
+  String header(const char* name);
+  bool hasHeader(const char* name);
+  int getSize() { return _size; }
+  WiFiClient* getStreamPtr() { return _client; }
+  WiFiClient& getStream() { return *_client; }
+  String getString();
+  bool connected() { return _client && _client->connected(); }
+
+private:
+  static constexpr uint8_t MaxCollected = 4;
+
+  WiFiClient* _client = nullptr;
+  String _host;
+  uint16_t _port = 0;
+  String _uri;
+  String _headers;
+  bool _http10 = false;
+  uint16_t _timeout = 5000;
+  int _size = -1;
+  struct { const char* key; String value; bool present; } _collected[MaxCollected];
+  uint8_t _nCollected = 0;
+
+  bool readLine(String& line);
+};
+
+#endif  // HostShim_HTTPClient_h
@@ -0,0 +1,34 @@
+/*
+ * JSONService.h (host shim):
+ *    The WebThing JSONService: GET an endpoint and parse the response into a
+ *    newly allocated document
+ *
+ */
+
+#ifndef HostShim_JSONService_h
+#define HostShim_JSONService_h
+
+#include <ArduinoJson.h>
+#include "Arduino.h"
+
+class ServiceDetails {
+public:
+  String server;
+  int port = 80;
+  String user;
+  String pass;
+  String apiKey;
+  String apiKeyName;
+};
+
+class JSONService {
+public:
+  JSONService(ServiceDetails details) : _details(details) { }
+  // The caller owns the result. nullptr if the request or the parse failed.
+  DynamicJsonDocument* issueGET(String endpoint, int jsonSize, JsonDocument* filter = NULL);
+
+private:
+  ServiceDetails _details;
+};
+
+#endif  // HostShim_JSONService_h
@@ -0,0 +1,20 @@
+/*
+ * Output.h (host shim):
+ *    The formatting helpers the library borrows from the application
+ *
+ */
+
+#ifndef HostShim_Output_h
+#define HostShim_Output_h
+
+#include "Arduino.h"
+#include "TimeLib.h"     // As the WebThing Output.h does
+
+namespace Output {
+  // hh:mm, or hh:mm:ss if `includeSecs`. Hours are zero padded if `zeroPad`.
+  String formattedInterval(uint32_t seconds, bool zeroPad, bool includeSecs);
+  bool using24HourMode();
+  void set24HourMode(bool use24Hour);
+}
+
+#endif  // HostShim_Output_h
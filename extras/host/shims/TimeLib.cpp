@@ -0,0 +1,52 @@
+/*
+ * TimeLib.cpp and Output (host shims)
+ *
+ */
+
+#include "TimeLib.h"
+#include "Output.h"
+
+static long offset = 0;
+
+time_t now() { return time(nullptr) + offset; }
+void adjustTime(long seconds) { offset += seconds; }
+
+static struct tm local(time_t t) {
+  struct tm fields;
+  localtime_r(&t, &fields);
+  return fields;
+}
+
+int hour(time_t t) { return local(t).tm_hour; }
+int hourFormat12(time_t t) { int h = hour(t) % 12; return h ? h : 12; }
+bool isAM(time_t t) { return hour(t) < 12; }
+bool isPM(time_t t) { return !isAM(t); }
+int minute(time_t t) { return local(t).tm_min; }
+int second(time_t t) { return local(t).tm_sec; }
+int day(time_t t) { return local(t).tm_mday; }
+int weekday(time_t t) { return local(t).tm_wday + 1; }
+int month(time_t t) { return local(t).tm_mon + 1; }
+int year(time_t t) { return local(t).tm_year + 1900; }
+
+char* dayShortStr(uint8_t day) {
+  static char names[8][4] = {"Err", "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+  return names[day < 8 ? day : 0];
+}
+
+char* monthShortStr(uint8_t month) {
+  static char names[13][4] = {"Err", "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+  return names[month < 13 ? month : 0];
+}
+
+static bool use24Hour = true;
+
+bool Output::using24HourMode() { return use24Hour; }
+void Output::set24HourMode(bool use24HourMode) { use24Hour = use24HourMode; }
+
+String Output::formattedInterval(uint32_t seconds, bool zeroPad, bool includeSecs) {
+  char buf[16];
+  unsigned h = seconds / 3600, m = (seconds / 60) % 60, s = seconds % 60;
+  if (includeSecs) snprintf(buf, sizeof(buf), zeroPad ? "%02u:%02u:%02u" : "%u:%02u:%02u", h, m, s);
+  else snprintf(buf, sizeof(buf), zeroPad ? "%02u:%02u" : "%u:%02u", h, m);
+  return String(buf);
+}
@@ -0,0 +1,29 @@
+/*
+ * TimeLib.h (host shim):
+ *    The subset of the Time library used here, in terms of the local time of
+ *    the host. now() may be offset to simulate a different time of day.
+ *
+ */
+
+#ifndef HostShim_TimeLib_h
+#define HostShim_TimeLib_h
+
+#include <time.h>
+#include "Arduino.h"
+
+time_t now();
+void adjustTime(long seconds);    // Move now() forward (or back)
+int hour(time_t t);
+int hourFormat12(time_t t);
+bool isAM(time_t t);
+bool isPM(time_t t);
+int minute(time_t t);
+int second(time_t t);
+int day(time_t t);
+int weekday(time_t t);            // 1 == Sunday
+int month(time_t t);
+int year(time_t t);
+char* dayShortStr(uint8_t day);   // 1 == Sunday
+char* monthShortStr(uint8_t month);
+
+#endif  // HostShim_TimeLib_h
@@ -0,0 +1,174 @@
+/*
+ * WiFi.cpp (host shim):
+ *    Name resolution and TCP connections with POSIX sockets
+ *
+ */
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#include "WiFi.h"
+#include "alloc_count.h"
+
+WiFiClass WiFi;
+
+static constexpr int ConnectTimeout = 5000;   // ms
+
+bool IPAddress::fromString(const char* address) {
+  return inet_pton(AF_INET, address, _bytes) == 1;
+}
+
+String IPAddress::toString() const {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _bytes[0], _bytes[1], _bytes[2], _bytes[3]);
+  return String(buf);
+}
+
+int WiFiClass::hostByName(const char* host, IPAddress& result) {
+  AllocCount::Transport transport;
+  if (result.fromString(host)) return 1;
+  struct addrinfo hints = {}, *info;
+  hints.ai_family = AF_INET;
+  if (getaddrinfo(host, nullptr, &hints, &info) != 0) return 0;
+  const uint8_t* a = (const uint8_t*)&((struct sockaddr_in*)info->ai_addr)->sin_addr;
+  result = IPAddress(a[0], a[1], a[2], a[3]);
+  freeaddrinfo(info);
+  return 1;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * WiFiClient
+ *
+ *----------------------------------------------------------------------------*/
+
+static WiFiClient::Responder& responder() {
+  static WiFiClient::Responder r;
+  return r;
+}
+
+void WiFiClient::setResponder(Responder r) { responder() = r; }
+
+int WiFiClient::connect(const char* host, uint16_t port) {
+  AllocCount::Transport transport;
+  stop();
+  if (responder()) {
+    _loopback = true;
+    _host = host;
+    _port = port;
+    return 1;
+  }
+
+  IPAddress ip;
+  if (WiFi.hostByName(host, ip) != 1) return 0;
+  struct sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  inet_pton(AF_INET, ip.toString().c_str(), &address.sin_addr);
+
+  _fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (_fd < 0) return 0;
+  int flags = fcntl(_fd, F_GETFL);
+  fcntl(_fd, F_SETFL, flags | O_NONBLOCK);
+  int result = ::connect(_fd, (struct sockaddr*)&address, sizeof(address));
+  if (result < 0 && errno == EINPROGRESS) {
+    struct pollfd p = {_fd, POLLOUT, 0};
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (poll(&p, 1, ConnectTimeout) == 1 &&
+        getsockopt(_fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0) {
+      result = 0;
+    }
+  }
+  if (result < 0) { stop(); return 0; }
+  fcntl(_fd, F_SETFL, flags);
+  return 1;
+}
+
+void WiFiClient::stop() {
+  AllocCount::Transport transport;
+  if (_fd >= 0) close(_fd);
+  _fd = -1;
+  _rxPos = _rxLength = 0;
+  _peerClosed = false;
+  _loopback = false;
+  _request.clear();
+  _response.clear();
+  _responsePos = 0;
+  _answered = false;
+}
+
+void WiFiClient::setNoDelay(bool noDelay) {
+  AllocCount::Transport transport;
+  int value = noDelay;
+  if (_fd >= 0) setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value));
+}
+
+uint8_t WiFiClient::connected() {
+  AllocCount::Transport transport;
+  if (_loopback) return !_answered || _responsePos < _response.length();
+  if (_fd < 0) return 0;
+  return available() > 0 || !_peerClosed;
+}
+
+size_t WiFiClient::write(const uint8_t* buffer, size_t size) {
+  AllocCount::Transport transport;
+  if (_loopback) { _request.concat((const char*)buffer, size); return size; }
+  if (_fd < 0) return 0;
+  size_t sent = 0;
+  while (sent < size) {
+    ssize_t n = send(_fd, buffer + sent, size - sent, MSG_NOSIGNAL);
+    if (n <= 0) break;
+    sent += n;
+  }
+  return sent;
+}
+
+// Reads whatever has arrived, without waiting. Returns the number of bytes buffered.
+size_t WiFiClient::fill() {
+  AllocCount::Transport transport;
+  if (_loopback) {
+    if (!_answered) {
+      _answered = true;
+      if (!responder()(_host.c_str(), _port, _request, _response)) _response.clear();
+    }
+    return _response.length() - _responsePos;
+  }
+  if (_rxPos < _rxLength || _fd < 0 || _peerClosed) return _rxLength - _rxPos;
+  ssize_t n = recv(_fd, _rx, RxBufferSize, MSG_DONTWAIT);
+  if (n > 0) { _rxPos = 0; _rxLength = n; }
+  else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) _peerClosed = true;
+  return _rxLength - _rxPos;
+}
+
+int WiFiClient::available() { return fill(); }
+
+int WiFiClient::read() {
+  AllocCount::Transport transport;
+  if (!fill()) return -1;
+  if (_loopback) return (uint8_t)_response[_responsePos++];
+  return _rx[_rxPos++];
+}
+
+int WiFiClient::peek() {
+  AllocCount::Transport transport;
+  if (!fill()) return -1;
+  if (_loopback) return (uint8_t)_response[_responsePos];
+  return _rx[_rxPos];
+}
+
+int WiFiClient::read(uint8_t* buffer, size_t size) {
+  AllocCount::Transport transport;
+  size_t n = std::min(size, fill());
+  if (n == 0) return -1;
+  if (_loopback) { memcpy(buffer, _response.c_str() + _responsePos, n); _responsePos += n; }
+  else { memcpy(buffer, _rx + _rxPos, n); _rxPos += n; }
+  return n;
+}
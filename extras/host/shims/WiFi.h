@@ -0,0 +1,86 @@
+/*
+ * WiFi.h (host shim):
+ *    IPAddress, name resolution, and a WiFiClient on top of POSIX sockets.
+ *    A Responder can stand in for the network: connections are then answered
+ *    in-process, which keeps benchmarks free of kernel and scheduling noise.
+ *
+ */
+
+#ifndef HostShim_WiFi_h
+#define HostShim_WiFi_h
+
+#include "Arduino.h"
+
+class IPAddress {
+public:
+  IPAddress() { }
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _bytes{a, b, c, d} { }
+  bool fromString(const char* address);
+  String toString() const;
+  uint8_t operator[](int index) const { return _bytes[index]; }
+  bool operator==(const IPAddress& rhs) const { return memcmp(_bytes, rhs._bytes, 4) == 0; }
+
+private:
+  uint8_t _bytes[4] = {0, 0, 0, 0};
+};
+
+class WiFiClass {
+public:
+  // Returns 1 on success, like the ESP cores
+  int hostByName(const char* host, IPAddress& result);
+};
+
+extern WiFiClass WiFi;
+
+class WiFiClient : public Stream {
+public:
+  // Answers a connection to host:port in-process. `request` is everything the
+  // client wrote; the responder is called once the client starts reading, and
+  // returns false to refuse the connection.
+  typedef std::function<bool(const char* host, uint16_t port, const String& request, String& response)> Responder;
+  static void setResponder(Responder responder);
+
+  WiFiClient() { }
+  ~WiFiClient() { stop(); }
+  WiFiClient(const WiFiClient&) = delete;
+  WiFiClient& operator=(const WiFiClient&) = delete;
+
+  int connect(const char* host, uint16_t port);
+  int connect(const String& host, uint16_t port) { return connect(host.c_str(), port); }
+  int connect(const IPAddress& ip, uint16_t port) { return connect(ip.toString().c_str(), port); }
+  uint8_t connected();
+  void stop();
+  void setNoDelay(bool noDelay);
+  operator bool() { return connected(); }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buffer, size_t size) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int read(uint8_t* buffer, size_t size);
+  int read(char* buffer, size_t size) { return read((uint8_t*)buffer, size); }
+  int peek() override;
+
+private:
+  static constexpr size_t RxBufferSize = 1460;   // One TCP segment, as lwIP would deliver it
+
+  int _fd = -1;
+  uint8_t _rx[RxBufferSize];
+  size_t _rxPos = 0;
+  size_t _rxLength = 0;
+  bool _peerClosed = false;
+
+  // In-process connections
+  bool _loopback = false;
+  String _host;
+  uint16_t _port = 0;
+  String _request;
+  String _response;
+  size_t _responsePos = 0;
+  bool _answered = false;
+
+  size_t fill();
+};
+
+#endif  // HostShim_WiFi_h
@@ -0,0 +1,58 @@
+/*
+ * AllocCount:
+ *    Replaces the global operator new and delete. Each block carries its size
+ *    in a small header so that delete can account for it.
+ *
+ */
+
+#include <stdlib.h>
+#include <new>
+#include "alloc_count.h"
+
+namespace {
+  constexpr size_t Header = 16;     // Keeps the block 16-byte aligned
+  uint64_t allocations = 0;
+  uint64_t transport = 0;
+  int transportDepth = 0;
+  size_t inUse = 0;
+  size_t peak = 0;
+
+  void* allocate(size_t size) {
+    uint8_t* block = (uint8_t*)malloc(size + Header);
+    if (!block) return nullptr;
+    *(size_t*)block = size;
+    allocations++;
+    if (transportDepth) transport++;
+    inUse += size;
+    if (inUse > peak) peak = inUse;
+    return block + Header;
+  }
+
+  void release(void* ptr) {
+    if (!ptr) return;
+    uint8_t* block = (uint8_t*)ptr - Header;
+    inUse -= *(size_t*)block;
+    free(block);
+  }
+}
+
+void AllocCount::mark() { allocations = transport = 0; peak = inUse; }
+AllocCount::Stats AllocCount::read() { return Stats{allocations, transport, inUse, peak}; }
+
+AllocCount::Transport::Transport() { transportDepth++; }
+AllocCount::Transport::~Transport() { transportDepth--; }
+
+void* operator new(size_t size) {
+  void* p = allocate(size);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void operator delete(void* ptr) noexcept { release(ptr); }
+void operator delete[](void* ptr) noexcept { release(ptr); }
+void operator delete(void* ptr, size_t) noexcept { release(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { release(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { release(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { release(ptr); }
@@ -0,0 +1,38 @@
+/*
+ * AllocCount:
+ *    Counts the heap allocations made through operator new (which is where
+ *    String, the JSON documents, and the library's own buffers come from)
+ *    and tracks the bytes in use. Linking alloc_count.o replaces the global
+ *    operator new and delete; it is part of the host build, so that applies
+ *    to every tool.
+ *
+ */
+
+#ifndef AllocCount_h
+#define AllocCount_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace AllocCount {
+  struct Stats {
+    uint64_t allocations;   // Since the last mark()
+    uint64_t transport;     // Of those, the ones made by the network shims
+    size_t inUse;           // Bytes currently allocated
+    size_t peak;            // Most bytes allocated at once since the last mark()
+  };
+
+  // Start a measurement: zero the count and set the peak to what is in use
+  void mark();
+  Stats read();
+
+  // Allocations made while a Transport is in scope are counted as the
+  // network's. The WiFiClient and HTTPClient shims stand in for the ESP
+  // network stack, whose allocations aren't the library's to reduce.
+  struct Transport {
+    Transport();
+    ~Transport();
+  };
+}
+
+#endif  // AllocCount_h
@@ -0,0 +1,597 @@
+/*
+ * ArduinoJson.cpp (host shim):
+ *    The memory pool, collections, parser, and serializer
+ *
+ */
+
+#include <errno.h>
+#include "ArduinoJson.h"
+
+namespace HostJson {
+
+/*------------------------------------------------------------------------------
+ *
+ * The pool and collections
+ *
+ *----------------------------------------------------------------------------*/
+
+Slot* Pool::allocSlot() {
+  size_t start = (_used + 7) & ~(size_t)7;
+  if (start + sizeof(Slot) > _capacity) { _overflowed = true; return nullptr; }
+  _used = start + sizeof(Slot);
+  Slot* slot = (Slot*)(_block + start);
+  slot->next = 0;
+  slot->keyAndType = 0;
+  slot->v.i = 0;
+  return slot;
+}
+
+uint32_t Pool::saveString(const char* s, size_t length) {
+  if (length + 1 > stringSpace()) { _overflowed = true; return 0; }
+  char* copy = stringBuffer();
+  memcpy(copy, s, length);
+  copy[length] = 0;
+  return keepString(length);
+}
+
+static bool isCollection(const Slot* s) {
+  return s && (s->type() == Type::Array || s->type() == Type::Object);
+}
+
+const Slot* findMember(const Pool* pool, const Slot* object, const char* key) {
+  if (!object || object->type() != Type::Object || !key) return nullptr;
+  for (const Slot* s = pool->slot(object->v.c.head); s; s = pool->slot(s->next)) {
+    if (strcmp(pool->string(s->key()), key) == 0) return s;
+  }
+  return nullptr;
+}
+
+const Slot* findElement(const Pool* pool, const Slot* array, size_t index) {
+  if (!array || array->type() != Type::Array) return nullptr;
+  const Slot* s = pool->slot(array->v.c.head);
+  while (s && index--) s = pool->slot(s->next);
+  return s;
+}
+
+size_t collectionSize(const Pool* pool, const Slot* collection) {
+  if (!isCollection(collection)) return 0;
+  size_t n = 0;
+  for (const Slot* s = pool->slot(collection->v.c.head); s; s = pool->slot(s->next)) n++;
+  return n;
+}
+
+Slot* addChild(Pool* pool, Slot* collection, const char* key) {
+  uint32_t keyRef = 0;
+  if (key) {
+    keyRef = pool->saveString(key, strlen(key));
+    if (!keyRef) return nullptr;
+  }
+  Slot* child = pool->allocSlot();
+  if (!child) return nullptr;
+  child->setKey(keyRef);
+  uint32_t ref = pool->ref(child);
+  if (collection->v.c.tail) pool->slot(collection->v.c.tail)->next = ref;
+  else collection->v.c.head = ref;
+  collection->v.c.tail = ref;
+  return child;
+}
+
+bool removeChild(Pool* pool, Slot* collection, const Slot* child) {
+  if (!child) return false;
+  uint32_t ref = pool->ref(child);
+  Slot* previous = nullptr;
+  for (Slot* s = pool->slot(collection->v.c.head); s; previous = s, s = pool->slot(s->next)) {
+    if (s != child) continue;
+    if (previous) previous->next = s->next;
+    else collection->v.c.head = s->next;
+    if (collection->v.c.tail == ref) collection->v.c.tail = previous ? pool->ref(previous) : 0;
+    return true;     // Like the real library, the memory isn't reclaimed
+  }
+  return false;
+}
+
+void setString(Pool* pool, Slot* slot, const char* s) {
+  if (!s) { setNull(slot); return; }
+  uint32_t ref = pool->saveString(s, strlen(s));
+  if (!ref) { setNull(slot); return; }
+  slot->setType(Type::String);
+  slot->v.s = ref;
+}
+
+void copyValue(Pool* pool, Slot* to, const Pool* fromPool, const Slot* from) {
+  if (!from) { setNull(to); return; }
+  switch (from->type()) {
+    case Type::String: setString(pool, to, fromPool->string(from->v.s)); return;
+    case Type::Array:
+    case Type::Object:
+      to->setType(from->type());
+      to->v.c.head = to->v.c.tail = 0;
+      for (const Slot* s = fromPool->slot(from->v.c.head); s; s = fromPool->slot(s->next)) {
+        Slot* child = addChild(pool, to, fromPool->string(s->key()));
+        if (!child) return;
+        copyValue(pool, child, fromPool, s);
+      }
+      return;
+    default:
+      to->setType(from->type());
+      to->v = from->v;
+      return;
+  }
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Serializer
+ *
+ *----------------------------------------------------------------------------*/
+
+static size_t writeString(Print& out, const char* s) {
+  size_t n = out.write('"');
+  for (; *s; s++) {
+    char c = *s;
+    const char* escape = nullptr;
+    switch (c) {
+      case '"': escape = "\\\""; break;
+      case '\\': escape = "\\\\"; break;
+      case '\b': escape = "\\b"; break;
+      case '\f': escape = "\\f"; break;
+      case '\n': escape = "\\n"; break;
+      case '\r': escape = "\\r"; break;
+      case '\t': escape = "\\t"; break;
+    }
+    if (escape) n += out.write(escape);
+    else if ((uint8_t)c < 0x20) n += out.printf("\\u%04x", c);
+    else n += out.write((uint8_t)c);
+  }
+  return n + out.write('"');
+}
+
+static size_t newline(Print& out, bool pretty, int indent) {
+  if (!pretty) return 0;
+  size_t n = out.write("\r\n");
+  for (int i = 0; i < indent; i++) n += out.write("  ");
+  return n;
+}
+
+size_t serialize(const Pool* pool, const Slot* slot, Print& out, bool pretty, int indent) {
+  if (!slot) return out.write("null");
+  char buf[32];
+  switch (slot->type()) {
+    case Type::Null: return out.write("null");
+    case Type::Bool: return out.write(slot->v.b ? "true" : "false");
+    case Type::Int: return out.write(buf, snprintf(buf, sizeof(buf), "%lld", (long long)slot->v.i));
+    case Type::Float:
+      if (isnan(slot->v.f) || isinf(slot->v.f)) return out.write("null");
+      return out.write(buf, snprintf(buf, sizeof(buf), "%.9g", slot->v.f));
+    case Type::String: return writeString(out, pool->string(slot->v.s));
+    case Type::Array:
+    case Type::Object: {
+      bool object = slot->type() == Type::Object;
+      size_t n = out.write(object ? '{' : '[');
+      const Slot* child = pool->slot(slot->v.c.head);
+      if (!child) return n + out.write(object ? '}' : ']');
+      for (; child; child = pool->slot(child->next)) {
+        n += newline(out, pretty, indent + 1);
+        if (object) {
+          n += writeString(out, pool->string(child->key()));
+          n += out.write(pretty ? ": " : ":");
+        }
+        n += serialize(pool, child, out, pretty, indent + 1);
+        if (child->next) n += out.write(',');
+      }
+      n += newline(out, pretty, indent);
+      return n + out.write(object ? '}' : ']');
+    }
+  }
+  return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Parser
+ *
+ *----------------------------------------------------------------------------*/
+
+// Which parts of the input to keep. `all` keeps everything below this point.
+struct FilterNode {
+  const Pool* pool;
+  const Slot* slot;
+  bool all;
+
+  static FilterNode keepAll() { return FilterNode{nullptr, nullptr, true}; }
+
+  bool allowValue() const { return all || (slot && slot->type() == Type::Bool && slot->v.b); }
+  bool allowObject() const { return allowValue() || (slot && slot->type() == Type::Object); }
+  bool allowArray() const { return allowValue() || (slot && slot->type() == Type::Array); }
+  FilterNode member(const char* key) const {
+    if (allowValue()) return keepAll();
+    const Slot* s = findMember(pool, slot, key);
+    if (!s) s = findMember(pool, slot, "*");
+    return FilterNode{pool, s, false};
+  }
+  FilterNode element() const {
+    if (allowValue()) return keepAll();
+    return FilterNode{pool, findElement(pool, slot, 0), false};
+  }
+};
+
+class BufferReader {
+public:
+  BufferReader(const char* input, size_t length) : _p(input), _end(input + length) { }
+  int peek() { return _p < _end && *_p ? (uint8_t)*_p : -1; }
+  void skip() { _p++; }
+
+private:
+  const char* _p;
+  const char* _end;
+};
+
+class StreamReader {
+public:
+  explicit StreamReader(Stream& stream) : _stream(stream) { }
+  int peek() {
+    if (!_valid) {
+      char c;
+      _c = _stream.readBytes(&c, 1) == 1 ? (uint8_t)c : -1;
+      _valid = true;
+    }
+    return _c;
+  }
+  void skip() { _valid = false; }
+
+private:
+  Stream& _stream;
+  int _c = -1;
+  bool _valid = false;
+};
+
+template <typename TReader>
+class Parser {
+public:
+  typedef DeserializationError::Code Code;
+
+  Parser(TReader& reader, Pool* pool, uint8_t nestingLimit)
+      : _in(reader), _pool(pool), _depth(nestingLimit) { }
+
+  Code parse(Slot* root, const FilterNode& filter) {
+    skipSpace();
+    if (_in.peek() < 0) return DeserializationError::EmptyInput;
+    return parseValue(root, filter);
+  }
+
+private:
+  TReader& _in;
+  Pool* _pool;
+  uint8_t _depth;
+
+  void skipSpace() {
+    for (int c = _in.peek(); c == ' ' || c == '\t' || c == '\r' || c == '\n'; c = _in.peek()) _in.skip();
+  }
+
+  bool eat(char expected) {
+    skipSpace();
+    if (_in.peek() != expected) return false;
+    _in.skip();
+    return true;
+  }
+
+  static Code unexpected(int c) { return c < 0 ? DeserializationError::IncompleteInput : DeserializationError::InvalidInput; }
+
+  // `slot` is nullptr if the value is to be skipped
+  Code parseValue(Slot* slot, const FilterNode& filter) {
+    skipSpace();
+    int c = _in.peek();
+    switch (c) {
+      case '{': return parseObject(slot, filter);
+      case '[': return parseArray(slot, filter);
+      case '"':
+      case '\'': {
+        bool keep = slot && filter.allowValue();
+        size_t length;
+        Code code = parseString(keep, length);
+        if (code != DeserializationError::Ok || !keep) return code;
+        slot->setType(Type::String);
+        slot->v.s = _pool->keepString(length);
+        return DeserializationError::Ok;
+      }
+      default:
+        return parseScalar(slot && filter.allowValue() ? slot : nullptr);
+    }
+  }
+
+  Code parseObject(Slot* slot, const FilterNode& filter) {
+    if (_depth == 0) return DeserializationError::TooDeep;
+    _depth--;
+    _in.skip();
+    if (!filter.allowObject()) slot = nullptr;
+    if (slot) { slot->setType(Type::Object); slot->v.c.head = slot->v.c.tail = 0; }
+    Code code = DeserializationError::Ok;
+    if (!eat('}')) {
+      do {
+        skipSpace();
+        // Parse the key into free space; keep it only if the filter wants the member
+        size_t length;
+        int quote = _in.peek();
+        if (quote != '"' && quote != '\'') { code = unexpected(quote); break; }
+        code = parseString(slot != nullptr, length);
+        if (code != DeserializationError::Ok) break;
+        FilterNode memberFilter = slot ? filter.member(_pool->stringBuffer()) : filter;
+        Slot* member = nullptr;
+        if (slot && (memberFilter.all || memberFilter.slot)) {
+          uint32_t keyRef = _pool->keepString(length);
+          member = _pool->allocSlot();
+          if (!member) { code = DeserializationError::NoMemory; break; }
+          member->setKey(keyRef);
+          uint32_t ref = _pool->ref(member);
+          if (slot->v.c.tail) _pool->slot(slot->v.c.tail)->next = ref;
+          else slot->v.c.head = ref;
+          slot->v.c.tail = ref;
+        }
+        if (!eat(':')) { code = unexpected(_in.peek()); break; }
+        code = parseValue(member, memberFilter);
+        if (code != DeserializationError::Ok) break;
+      } while (eat(','));
+      if (code == DeserializationError::Ok && !eat('}')) code = unexpected(_in.peek());
+    }
+    _depth++;
+    return code;
+  }
+
+  Code parseArray(Slot* slot, const FilterNode& filter) {
+    if (_depth == 0) return DeserializationError::TooDeep;
+    _depth--;
+    _in.skip();
+    if (!filter.allowArray()) slot = nullptr;
+    if (slot) { slot->setType(Type::Array); slot->v.c.head = slot->v.c.tail = 0; }
+    FilterNode elementFilter = filter.element();
+    if (!elementFilter.all && !elementFilter.slot) slot = nullptr;
+    Code code = DeserializationError::Ok;
+    if (!eat(']')) {
+      do {
+        Slot* element = nullptr;
+        if (slot) {
+          element = addChild(_pool, slot, nullptr);
+          if (!element) { code = DeserializationError::NoMemory; break; }
+        }
+        code = parseValue(element, elementFilter);
+        if (code != DeserializationError::Ok) break;
+      } while (eat(','));
+      if (code == DeserializationError::Ok && !eat(']')) code = unexpected(_in.peek());
+    }
+    _depth++;
+    return code;
+  }
+
+  // Writes the string (NUL-terminated) to the pool's free space if `keep`
+  Code parseString(bool keep, size_t& length) {
+    int quote = _in.peek();
+    _in.skip();
+    char* out = keep ? _pool->stringBuffer() : nullptr;
+    size_t space = keep ? _pool->stringSpace() : 0;
+    length = 0;
+    for (;;) {
+      int c = _in.peek();
+      if (c < 0) return DeserializationError::IncompleteInput;
+      _in.skip();
+      if (c == quote) break;
+      char utf8[4];
+      size_t n = 1;
+      utf8[0] = (char)c;
+      if (c == '\\') {
+        c = _in.peek();
+        if (c < 0) return DeserializationError::IncompleteInput;
+        _in.skip();
+        switch (c) {
+          case 'b': utf8[0] = '\b'; break;
+          case 'f': utf8[0] = '\f'; break;
+          case 'n': utf8[0] = '\n'; break;
+          case 'r': utf8[0] = '\r'; break;
+          case 't': utf8[0] = '\t'; break;
+          case 'u': {
+            uint32_t codepoint;
+            Code code = parseCodepoint(codepoint);
+            if (code != DeserializationError::Ok) return code;
+            n = encodeUtf8(codepoint, utf8);
+            break;
+          }
+          default: utf8[0] = (char)c; break;
+        }
+      }
+      if (keep) {
+        if (length + n + 1 > space) { _pool->markOverflowed(); return DeserializationError::NoMemory; }
+        memcpy(out + length, utf8, n);
+      }
+      length += n;
+    }
+    if (keep) {
+      if (length + 1 > space) { _pool->markOverflowed(); return DeserializationError::NoMemory; }
+      out[length] = 0;
+    }
+    return DeserializationError::Ok;
+  }
+
+  Code parseHex4(uint16_t& value) {
+    value = 0;
+    for (int i = 0; i < 4; i++) {
+      int c = _in.peek();
+      if (c < 0) return DeserializationError::IncompleteInput;
+      _in.skip();
+      int digit = isdigit(c) ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+      if (digit < 0) return DeserializationError::InvalidInput;
+      value = (value << 4) | digit;
+    }
+    return DeserializationError::Ok;
+  }
+
+  Code parseCodepoint(uint32_t& codepoint) {
+    uint16_t high;
+    Code code = parseHex4(high);
+    if (code != DeserializationError::Ok) return code;
+    codepoint = high;
+    if (high < 0xd800 || high > 0xdbff) return DeserializationError::Ok;
+    // A surrogate pair
+    if (_in.peek() != '\\') return DeserializationError::Ok;
+    _in.skip();
+    if (_in.peek() != 'u') return DeserializationError::InvalidInput;
+    _in.skip();
+    uint16_t low;
+    code = parseHex4(low);
+    if (code != DeserializationError::Ok) return code;
+    codepoint = 0x10000 + ((uint32_t)(high - 0xd800) << 10) + (low - 0xdc00);
+    return DeserializationError::Ok;
+  }
+
+  static size_t encodeUtf8(uint32_t c, char* out) {
+    if (c < 0x80) { out[0] = c; return 1; }
+    if (c < 0x800) { out[0] = 0xc0 | (c >> 6); out[1] = 0x80 | (c & 0x3f); return 2; }
+    if (c < 0x10000) { out[0] = 0xe0 | (c >> 12); out[1] = 0x80 | ((c >> 6) & 0x3f); out[2] = 0x80 | (c & 0x3f); return 3; }
+    out[0] = 0xf0 | (c >> 18); out[1] = 0x80 | ((c >> 12) & 0x3f);
+    out[2] = 0x80 | ((c >> 6) & 0x3f); out[3] = 0x80 | (c & 0x3f);
+    return 4;
+  }
+
+  // Numbers and the literals true, false, and null
+  Code parseScalar(Slot* slot) {
+    char buf[64];
+    size_t n = 0;
+    for (int c = _in.peek(); c >= 0 && (isalnum(c) || c == '+' || c == '-' || c == '.'); c = _in.peek()) {
+      if (n == sizeof(buf) - 1) return DeserializationError::InvalidInput;
+      buf[n++] = (char)c;
+      _in.skip();
+    }
+    buf[n] = 0;
+    if (n == 0) return unexpected(_in.peek());
+
+    if (strcmp(buf, "true") == 0 || strcmp(buf, "false") == 0) {
+      if (slot) { slot->setType(Type::Bool); slot->v.b = buf[0] == 't'; }
+      return DeserializationError::Ok;
+    }
+    if (strcmp(buf, "null") == 0) {
+      if (slot) setNull(slot);
+      return DeserializationError::Ok;
+    }
+
+    char* end;
+    bool integral = strpbrk(buf, ".eE") == nullptr;
+    if (integral) {
+      errno = 0;
+      long long i = strtoll(buf, &end, 10);
+      if (*end == 0 && errno == 0) {
+        if (slot) { slot->setType(Type::Int); slot->v.i = i; }
+        return DeserializationError::Ok;
+      }
+    }
+    double f = strtod(buf, &end);
+    if (*end != 0) return DeserializationError::InvalidInput;
+    if (slot) { slot->setType(Type::Float); slot->v.f = f; }
+    return DeserializationError::Ok;
+  }
+};
+
+template <typename TReader>
+static DeserializationError deserialize(
+    JsonDocument& doc, TReader& reader, const FilterNode& filter, uint8_t nestingLimit)
+{
+  doc.clear();
+  Parser<TReader> parser(reader, &doc.pool(), nestingLimit);
+  DeserializationError::Code code = parser.parse(&doc.root(), filter);
+  if (code == DeserializationError::NoMemory) doc.pool().markOverflowed();
+  return DeserializationError(code);
+}
+
+static FilterNode filterFor(const DeserializationOption::Filter& filter) {
+  JsonVariantConst v = filter.variant();
+  return FilterNode{v.pool(), v.slot(), false};
+}
+
+}  // namespace HostJson
+
+using namespace HostJson;
+
+const char* DeserializationError::c_str() const {
+  static const char* const names[] = {"Ok", "EmptyInput", "IncompleteInput", "InvalidInput", "NoMemory", "TooDeep"};
+  return names[_code];
+}
+
+DeserializationError deserializeJson(
+    JsonDocument& doc, const char* input, size_t inputSize,
+    DeserializationOption::Filter filter, DeserializationOption::NestingLimit limit)
+{
+  BufferReader reader(input, inputSize);
+  return deserialize(doc, reader, filterFor(filter), limit.value());
+}
+
+DeserializationError deserializeJson(
+    JsonDocument& doc, const char* input, size_t inputSize, DeserializationOption::NestingLimit limit)
+{
+  BufferReader reader(input, inputSize);
+  return deserialize(doc, reader, FilterNode::keepAll(), limit.value());
+}
+
+DeserializationError deserializeJson(JsonDocument& doc, Stream& input) {
+  StreamReader reader(input);
+  return deserialize(doc, reader, FilterNode::keepAll(), DeserializationOption::NestingLimit().value());
+}
+
+DeserializationError deserializeJson(JsonDocument& doc, Stream& input, DeserializationOption::Filter filter) {
+  StreamReader reader(input);
+  return deserialize(doc, reader, filterFor(filter), DeserializationOption::NestingLimit().value());
+}
+
+class StringPrint : public Print {
+public:
+  explicit StringPrint(String& s) : _s(s) { }
+  size_t write(uint8_t c) override { _s += (char)c; return 1; }
+  size_t write(const uint8_t* buffer, size_t size) override { _s.concat((const char*)buffer, size); return size; }
+private:
+  String& _s;
+};
+
+class CountingPrint : public Print {
+public:
+  size_t write(uint8_t) override { return 1; }
+  size_t write(const uint8_t*, size_t size) override { return size; }
+};
+
+class BufferPrint : public Print {
+public:
+  BufferPrint(char* buffer, size_t size) : _buffer(buffer), _size(size) { }
+  size_t write(uint8_t c) override {
+    if (_length + 1 >= _size) return 0;
+    _buffer[_length++] = (char)c;
+    _buffer[_length] = 0;
+    return 1;
+  }
+private:
+  char* _buffer;
+  size_t _size;
+  size_t _length = 0;
+};
+
+size_t serializeJson(JsonVariantConst source, Print& out) { return serialize(source.pool(), source.slot(), out, false); }
+size_t serializeJsonPretty(JsonVariantConst source, Print& out) { return serialize(source.pool(), source.slot(), out, true); }
+
+size_t serializeJson(JsonVariantConst source, String& out) {
+  out = "";
+  StringPrint p(out);
+  return serializeJson(source, p);
+}
+
+size_t serializeJsonPretty(JsonVariantConst source, String& out) {
+  out = "";
+  StringPrint p(out);
+  return serializeJsonPretty(source, p);
+}
+
+size_t serializeJson(JsonVariantConst source, char* buffer, size_t size) {
+  if (size) buffer[0] = 0;
+  BufferPrint p(buffer, size);
+  return serializeJson(source, p);
+}
+
+size_t measureJson(JsonVariantConst source) {
+  CountingPrint p;
+  return serializeJson(source, p);
+}
@@ -0,0 +1,541 @@
+/*
+ * ArduinoJson.h (host shim):
+ *    The part of the ArduinoJson 6 API that the library uses: documents with
+ *    a fixed-size memory pool from an allocator, variants, objects, arrays,
+ *    deserializeJson (including filters), and serializeJson.
+ *
+ *    A value takes a 16 byte slot in the pool, as it does on a 32-bit device,
+ *    so the document capacities chosen for the ESP8266 mean the same thing
+ *    here (the real library needs about twice as much on a 64-bit host).
+ *    Strings are copied into the pool; keys are not deduplicated.
+ *
+ *    Differences from the real library, none of which the library relies on:
+ *    - Writing through a missing member creates it only if its parent exists:
+ *      doc["a"] = 1 works, doc["a"]["b"] = 1 does not create "a".
+ *    - Comments in JSON input are not supported
+ *
+ *    Define ARDUINOJSON_DIR in the host Makefile to use the real library.
+ *
+ */
+
+#ifndef HostShim_ArduinoJson_h
+#define HostShim_ArduinoJson_h
+
+#include <new>
+#include <type_traits>
+#include "Arduino.h"
+
+namespace HostJson {
+
+enum class Type : uint8_t { Null, Bool, Int, Float, String, Array, Object };
+
+// A value, and its place in the collection that holds it. Refs are 1 + the
+// offset of the slot or string in the pool, 0 if there is none.
+struct Slot {
+  uint32_t next;
+  uint32_t keyAndType;                // The key's ref in the low 28 bits
+  union {
+    bool b;
+    int64_t i;
+    double f;
+    uint32_t s;
+    struct { uint32_t head, tail; } c;
+  } v;
+
+  Type type() const { return (Type)(keyAndType >> 28); }
+  uint32_t key() const { return keyAndType & 0x0fffffff; }
+  void setType(Type t) { keyAndType = key() | ((uint32_t)t << 28); }
+  void setKey(uint32_t ref) { keyAndType = ref | (keyAndType & 0xf0000000); }
+};
+static_assert(sizeof(Slot) == 16, "A slot must be the same size as on a device");
+
+class Pool {
+public:
+  void init(uint8_t* block, size_t capacity) { _block = block; _capacity = block ? capacity : 0; clear(); }
+  void clear() { _used = 0; _overflowed = false; }
+  uint8_t* block() const { return _block; }
+  size_t capacity() const { return _capacity; }
+  size_t used() const { return _used; }
+  bool overflowed() const { return _overflowed; }
+
+  Slot* allocSlot();
+  uint32_t saveString(const char* s, size_t length);
+  // Strings may be written to the free space and then kept (or abandoned)
+  char* stringBuffer() { return (char*)_block + _used; }
+  size_t stringSpace() const { return _capacity - _used; }
+  uint32_t keepString(size_t length) { uint32_t ref = _used + 1; _used += length + 1; return ref; }
+  void markOverflowed() { _overflowed = true; }
+
+  Slot* slot(uint32_t ref) const { return ref ? (Slot*)(_block + ref - 1) : nullptr; }
+  const char* string(uint32_t ref) const { return ref ? (const char*)_block + ref - 1 : nullptr; }
+  uint32_t ref(const Slot* s) const { return (uint32_t)((const uint8_t*)s - _block) + 1; }
+
+private:
+  uint8_t* _block = nullptr;
+  size_t _capacity = 0;
+  size_t _used = 0;
+  bool _overflowed = false;
+};
+
+// Operations on slots that need the pool
+const Slot* findMember(const Pool* pool, const Slot* object, const char* key);
+const Slot* findElement(const Pool* pool, const Slot* array, size_t index);
+size_t collectionSize(const Pool* pool, const Slot* collection);
+Slot* addChild(Pool* pool, Slot* collection, const char* key);
+bool removeChild(Pool* pool, Slot* collection, const Slot* child);
+void setString(Pool* pool, Slot* slot, const char* s);
+void copyValue(Pool* pool, Slot* to, const Pool* fromPool, const Slot* from);
+size_t serialize(const Pool* pool, const Slot* slot, Print& out, bool pretty, int indent = 0);
+inline void setNull(Slot* slot) { slot->setType(Type::Null); }
+
+template <typename T, typename Enable = void> struct Converter;
+
+template <typename TVariant, typename TSlot>
+class Iterator {
+public:
+  Iterator(const Pool* pool, TSlot* slot) : _pool(pool), _slot(slot) { }
+  TVariant operator*() const { return TVariant(const_cast<Pool*>(_pool), _slot); }
+  Iterator& operator++() { _slot = _pool->slot(_slot->next); return *this; }
+  bool operator!=(const Iterator& rhs) const { return _slot != rhs._slot; }
+
+private:
+  const Pool* _pool;
+  TSlot* _slot;
+};
+
+}  // namespace HostJson
+
+class JsonVariant;
+class JsonObject;
+class JsonArray;
+
+class JsonVariantConst {
+public:
+  JsonVariantConst() { }
+  JsonVariantConst(const HostJson::Pool* pool, const HostJson::Slot* slot) : _pool(pool), _slot(slot) { }
+
+  bool isNull() const { return !_slot || _slot->type() == HostJson::Type::Null; }
+  size_t size() const { return HostJson::collectionSize(_pool, _slot); }
+  template <typename T> T as() const { return HostJson::Converter<T>::fromJson(_pool, _slot); }
+  template <typename T> bool is() const { return HostJson::Converter<T>::checkJson(_slot); }
+  template <typename T> operator T() const { return as<T>(); }
+  // The value, or `fallback` if it isn't a T
+  template <typename T> T operator|(T fallback) const { return is<T>() ? as<T>() : fallback; }
+  const char* operator|(const char* fallback) const { return is<const char*>() ? as<const char*>() : fallback; }
+
+  JsonVariantConst operator[](const char* key) const { return JsonVariantConst(_pool, HostJson::findMember(_pool, _slot, key)); }
+  JsonVariantConst operator[](const String& key) const { return (*this)[key.c_str()]; }
+  JsonVariantConst operator[](const __FlashStringHelper* key) const { return (*this)[reinterpret_cast<const char*>(key)]; }
+  JsonVariantConst operator[](int index) const { return JsonVariantConst(_pool, HostJson::findElement(_pool, _slot, index)); }
+  bool containsKey(const char* key) const { return HostJson::findMember(_pool, _slot, key) != nullptr; }
+
+  typedef HostJson::Iterator<JsonVariantConst, const HostJson::Slot> iterator;
+  iterator begin() const;
+  iterator end() const { return iterator(_pool, nullptr); }
+
+  const HostJson::Pool* pool() const { return _pool; }
+  const HostJson::Slot* slot() const { return _slot; }
+
+protected:
+  const HostJson::Pool* _pool = nullptr;
+  const HostJson::Slot* _slot = nullptr;
+};
+
+class JsonVariant {
+public:
+  JsonVariant() { }
+  JsonVariant(HostJson::Pool* pool, HostJson::Slot* slot) : _pool(pool), _slot(slot) { }
+
+  operator JsonVariantConst() const { return JsonVariantConst(_pool, _slot); }
+  bool isNull() const { return constant().isNull(); }
+  size_t size() const { return constant().size(); }
+  template <typename T> T as() const { return HostJson::Converter<T>::fromJson(_pool, _slot); }
+  template <typename T> bool is() const { return HostJson::Converter<T>::checkJson(_slot); }
+  template <typename T> operator T() const { return as<T>(); }
+  template <typename T> T operator|(T fallback) const { return constant() | fallback; }
+  const char* operator|(const char* fallback) const { return constant() | fallback; }
+
+  // Assigning to a missing member of an object adds it
+  template <typename T> JsonVariant& operator=(const T& value) {
+    HostJson::Slot* slot = resolve();
+    if (slot) HostJson::Converter<typename std::decay<T>::type>::toJson(value, _pool, slot);
+    return *this;
+  }
+  JsonVariant& operator=(const char* value) {
+    HostJson::Slot* slot = resolve();
+    if (slot) HostJson::setString(_pool, slot, value);
+    return *this;
+  }
+  template <typename T> bool set(const T& value) { *this = value; return _slot != nullptr; }
+  template <typename T> T to();
+
+  JsonVariant operator[](const char* key) const;
+  JsonVariant operator[](const String& key) const { return (*this)[key.c_str()]; }
+  JsonVariant operator[](const __FlashStringHelper* key) const { return (*this)[reinterpret_cast<const char*>(key)]; }
+  JsonVariant operator[](int index) const;
+  bool containsKey(const char* key) const { return constant().containsKey(key); }
+  template <typename T> bool add(const T& value);
+  JsonObject createNestedObject();
+  JsonObject createNestedObject(const char* key);
+  JsonArray createNestedArray(const char* key);
+
+  typedef HostJson::Iterator<JsonVariant, HostJson::Slot> iterator;
+  iterator begin() const;
+  iterator end() const { return iterator(_pool, nullptr); }
+
+  HostJson::Pool* pool() const { return _pool; }
+  HostJson::Slot* slot() const { return _slot; }
+
+protected:
+  HostJson::Pool* _pool = nullptr;
+  HostJson::Slot* _slot = nullptr;
+  // A member that doesn't exist yet: created in _parent when assigned to
+  HostJson::Slot* _parent = nullptr;
+  const char* _key = nullptr;
+
+  JsonVariantConst constant() const { return JsonVariantConst(_pool, _slot); }
+  HostJson::Slot* resolve();
+};
+
+class JsonObjectConst : public JsonVariantConst {
+public:
+  JsonObjectConst() { }
+  JsonObjectConst(const HostJson::Pool* pool, const HostJson::Slot* slot)
+      : JsonVariantConst(pool, slot && slot->type() == HostJson::Type::Object ? slot : nullptr) { }
+};
+
+class JsonArrayConst : public JsonVariantConst {
+public:
+  JsonArrayConst() { }
+  JsonArrayConst(const HostJson::Pool* pool, const HostJson::Slot* slot)
+      : JsonVariantConst(pool, slot && slot->type() == HostJson::Type::Array ? slot : nullptr) { }
+};
+
+class JsonObject : public JsonVariant {
+public:
+  JsonObject() { }
+  JsonObject(HostJson::Pool* pool, HostJson::Slot* slot)
+      : JsonVariant(pool, slot && slot->type() == HostJson::Type::Object ? slot : nullptr) { }
+  operator JsonObjectConst() const { return JsonObjectConst(_pool, _slot); }
+  void remove(const char* key) { if (_slot) HostJson::removeChild(_pool, _slot, HostJson::findMember(_pool, _slot, key)); }
+  void remove(const String& key) { remove(key.c_str()); }
+  using JsonVariant::operator=;
+};
+
+class JsonArray : public JsonVariant {
+public:
+  JsonArray() { }
+  JsonArray(HostJson::Pool* pool, HostJson::Slot* slot)
+      : JsonVariant(pool, slot && slot->type() == HostJson::Type::Array ? slot : nullptr) { }
+  operator JsonArrayConst() const { return JsonArrayConst(_pool, _slot); }
+  void remove(size_t index) { if (_slot) HostJson::removeChild(_pool, _slot, HostJson::findElement(_pool, _slot, index)); }
+};
+
+inline JsonVariantConst::iterator JsonVariantConst::begin() const {
+  bool collection = _slot && (_slot->type() == HostJson::Type::Array || _slot->type() == HostJson::Type::Object);
+  return iterator(_pool, collection ? _pool->slot(_slot->v.c.head) : nullptr);
+}
+
+inline JsonVariant::iterator JsonVariant::begin() const {
+  bool collection = _slot && (_slot->type() == HostJson::Type::Array || _slot->type() == HostJson::Type::Object);
+  return iterator(_pool, collection ? _pool->slot(_slot->v.c.head) : nullptr);
+}
+
+inline HostJson::Slot* JsonVariant::resolve() {
+  if (!_slot && _parent) {
+    if (_parent->type() == HostJson::Type::Null) _parent->setType(HostJson::Type::Object), _parent->v.c.head = _parent->v.c.tail = 0;
+    if (_parent->type() == HostJson::Type::Object) _slot = HostJson::addChild(_pool, _parent, _key);
+    _parent = nullptr;
+  }
+  return _slot;
+}
+
+inline JsonVariant JsonVariant::operator[](const char* key) const {
+  JsonVariant member(_pool, const_cast<HostJson::Slot*>(HostJson::findMember(_pool, _slot, key)));
+  if (!member._slot && _slot && (_slot->type() == HostJson::Type::Object || _slot->type() == HostJson::Type::Null)) {
+    member._parent = _slot;
+    member._key = key;
+  }
+  return member;
+}
+
+inline JsonVariant JsonVariant::operator[](int index) const {
+  return JsonVariant(_pool, const_cast<HostJson::Slot*>(HostJson::findElement(_pool, _slot, index)));
+}
+
+template <typename T> T JsonVariant::to() {
+  HostJson::Slot* slot = resolve();
+  if (!slot) return T();
+  HostJson::Converter<T>::makeJson(slot);
+  return T(_pool, slot);
+}
+
+template <typename T> bool JsonVariant::add(const T& value) {
+  HostJson::Slot* slot = resolve();
+  if (!slot) return false;
+  if (slot->type() == HostJson::Type::Null) { slot->setType(HostJson::Type::Array); slot->v.c.head = slot->v.c.tail = 0; }
+  if (slot->type() != HostJson::Type::Array) return false;
+  JsonVariant element(_pool, HostJson::addChild(_pool, slot, nullptr));
+  return element.set(value);
+}
+
+inline JsonObject JsonVariant::createNestedObject() {
+  JsonVariant element;
+  if (add(nullptr)) element = JsonVariant(_pool, _pool->slot(_slot->v.c.tail));
+  return element.to<JsonObject>();
+}
+
+inline JsonObject JsonVariant::createNestedObject(const char* key) { return (*this)[key].to<JsonObject>(); }
+inline JsonArray JsonVariant::createNestedArray(const char* key) { return (*this)[key].to<JsonArray>(); }
+
+
+class JsonDocument {
+public:
+  JsonDocument(const JsonDocument&) = delete;
+  JsonDocument& operator=(const JsonDocument&) = delete;
+
+  void clear() { _pool.clear(); HostJson::setNull(&_root); }
+  size_t capacity() const { return _pool.capacity(); }
+  size_t memoryUsage() const { return _pool.used(); }
+  bool overflowed() const { return _pool.overflowed(); }
+  bool isNull() const { return _root.type() == HostJson::Type::Null; }
+  size_t size() const { return HostJson::collectionSize(&_pool, &_root); }
+
+  template <typename T> T as() const { return HostJson::Converter<T>::fromJson(&_pool, &_root); }
+  template <typename T> T as() { return variant().as<T>(); }
+  template <typename T> bool is() const { return HostJson::Converter<T>::checkJson(&_root); }
+  template <typename T> T to() { clear(); return variant().to<T>(); }
+
+  JsonVariant operator[](const char* key) { return variant()[key]; }
+  JsonVariant operator[](const String& key) { return variant()[key.c_str()]; }
+  JsonVariant operator[](const __FlashStringHelper* key) { return variant()[key]; }
+  JsonVariant operator[](int index) { return variant()[index]; }
+  JsonVariantConst operator[](const char* key) const { return constant()[key]; }
+  JsonVariantConst operator[](const String& key) const { return constant()[key.c_str()]; }
+  JsonVariantConst operator[](const __FlashStringHelper* key) const { return constant()[key]; }
+  JsonVariantConst operator[](int index) const { return constant()[index]; }
+  bool containsKey(const char* key) const { return constant().containsKey(key); }
+  template <typename T> bool add(const T& value) { return variant().add(value); }
+  JsonObject createNestedObject() { return variant().createNestedObject(); }
+  JsonObject createNestedObject(const char* key) { return variant().createNestedObject(key); }
+  JsonArray createNestedArray(const char* key) { return variant().createNestedArray(key); }
+
+  operator JsonVariantConst() const { return constant(); }
+  operator JsonVariant() { return variant(); }
+
+  // Used by the parser
+  HostJson::Pool& pool() { return _pool; }
+  HostJson::Slot& root() { return _root; }
+
+protected:
+  JsonDocument() { _root.next = 0; _root.keyAndType = 0; }
+  HostJson::Pool _pool;
+  HostJson::Slot _root;
+
+  JsonVariant variant() { return JsonVariant(&_pool, &_root); }
+  JsonVariantConst constant() const { return JsonVariantConst(&_pool, &_root); }
+};
+
+// Allocates with operator new so that host tools can count the allocations
+struct DefaultAllocator {
+  void* allocate(size_t size) { return ::operator new(size, std::nothrow); }
+  void deallocate(void* ptr) { ::operator delete(ptr); }
+  void* reallocate(void*, size_t) { return nullptr; }
+};
+
+template <typename TAllocator>
+class BasicJsonDocument : public JsonDocument, private TAllocator {
+public:
+  explicit BasicJsonDocument(size_t capacity, TAllocator allocator = TAllocator()) : TAllocator(allocator) {
+    _pool.init((uint8_t*)this->allocate(capacity), capacity);
+  }
+  ~BasicJsonDocument() { if (_pool.block()) this->deallocate(_pool.block()); }
+};
+
+typedef BasicJsonDocument<DefaultAllocator> DynamicJsonDocument;
+
+template <size_t Capacity>
+class StaticJsonDocument : public JsonDocument {
+public:
+  StaticJsonDocument() { _pool.init(_block, Capacity); }
+
+private:
+  alignas(8) uint8_t _block[Capacity];
+};
+
+
+class DeserializationError {
+public:
+  enum Code { Ok, EmptyInput, IncompleteInput, InvalidInput, NoMemory, TooDeep };
+
+  DeserializationError(Code code = Ok) : _code(code) { }
+  explicit operator bool() const { return _code != Ok; }
+  bool operator==(Code code) const { return _code == code; }
+  bool operator!=(Code code) const { return _code != code; }
+  Code code() const { return _code; }
+  const char* c_str() const;
+  const __FlashStringHelper* f_str() const { return reinterpret_cast<const __FlashStringHelper*>(c_str()); }
+
+private:
+  Code _code;
+};
+
+namespace DeserializationOption {
+  class Filter {
+  public:
+    explicit Filter(JsonVariantConst filter) : _filter(filter) { }
+    explicit Filter(const JsonDocument& filter) : _filter(filter) { }
+    JsonVariantConst variant() const { return _filter; }
+  private:
+    JsonVariantConst _filter;
+  };
+
+  class NestingLimit {
+  public:
+    explicit NestingLimit(uint8_t limit = 10) : _limit(limit) { }
+    uint8_t value() const { return _limit; }
+  private:
+    uint8_t _limit;
+  };
+}
+
+DeserializationError deserializeJson(
+    JsonDocument& doc, const char* input, size_t inputSize,
+    DeserializationOption::Filter filter, DeserializationOption::NestingLimit limit = DeserializationOption::NestingLimit());
+DeserializationError deserializeJson(
+    JsonDocument& doc, const char* input, size_t inputSize,
+    DeserializationOption::NestingLimit limit = DeserializationOption::NestingLimit());
+inline DeserializationError deserializeJson(JsonDocument& doc, const char* input) { return deserializeJson(doc, input, strlen(input)); }
+inline DeserializationError deserializeJson(JsonDocument& doc, const String& input) { return deserializeJson(doc, input.c_str(), input.length()); }
+inline DeserializationError deserializeJson(JsonDocument& doc, const uint8_t* input, size_t inputSize) { return deserializeJson(doc, (const char*)input, inputSize); }
+inline DeserializationError deserializeJson(JsonDocument& doc, const String& input, DeserializationOption::Filter filter) {
+  return deserializeJson(doc, input.c_str(), input.length(), filter);
+}
+// Reads up to the end of the value (or the stream)
+DeserializationError deserializeJson(JsonDocument& doc, Stream& input);
+DeserializationError deserializeJson(JsonDocument& doc, Stream& input, DeserializationOption::Filter filter);
+
+size_t serializeJson(JsonVariantConst source, Print& out);
+size_t serializeJson(JsonVariantConst source, String& out);
+size_t serializeJson(JsonVariantConst source, char* buffer, size_t size);
+size_t serializeJsonPretty(JsonVariantConst source, Print& out);
+size_t serializeJsonPretty(JsonVariantConst source, String& out);
+size_t measureJson(JsonVariantConst source);
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Conversions between slots and C++ types
+ *
+ *----------------------------------------------------------------------------*/
+
+namespace HostJson {
+
+template <typename T>
+struct Converter<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type> {
+  static T fromJson(const Pool*, const Slot* s) {
+    if (!s) return 0;
+    switch (s->type()) {
+      case Type::Int: return (T)s->v.i;
+      case Type::Float: return (T)s->v.f;
+      case Type::Bool: return s->v.b;
+      default: return 0;
+    }
+  }
+  static bool checkJson(const Slot* s) { return s && s->type() == Type::Int; }
+  static void toJson(T value, Pool*, Slot* s) { s->setType(Type::Int); s->v.i = value; }
+};
+
+template <typename T>
+struct Converter<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+  static T fromJson(const Pool*, const Slot* s) {
+    if (!s) return 0;
+    switch (s->type()) {
+      case Type::Int: return (T)s->v.i;
+      case Type::Float: return (T)s->v.f;
+      default: return 0;
+    }
+  }
+  static bool checkJson(const Slot* s) { return s && (s->type() == Type::Int || s->type() == Type::Float); }
+  static void toJson(T value, Pool*, Slot* s) { s->setType(Type::Float); s->v.f = value; }
+};
+
+template <> struct Converter<bool> {
+  static bool fromJson(const Pool*, const Slot* s) {
+    if (!s) return false;
+    switch (s->type()) {
+      case Type::Bool: return s->v.b;
+      case Type::Int: return s->v.i != 0;
+      case Type::Float: return s->v.f != 0;
+      default: return false;
+    }
+  }
+  static bool checkJson(const Slot* s) { return s && s->type() == Type::Bool; }
+  static void toJson(bool value, Pool*, Slot* s) { s->setType(Type::Bool); s->v.b = value; }
+};
+
+template <> struct Converter<const char*> {
+  static const char* fromJson(const Pool* pool, const Slot* s) {
+    return s && s->type() == Type::String ? pool->string(s->v.s) : nullptr;
+  }
+  static bool checkJson(const Slot* s) { return s && s->type() == Type::String; }
+  static void toJson(const char* value, Pool* pool, Slot* s) { setString(pool, s, value); }
+};
+
+template <> struct Converter<char*> {
+  static void toJson(const char* value, Pool* pool, Slot* s) { setString(pool, s, value); }
+};
+
+template <> struct Converter<String> {
+  // Like the real library, anything other than a string comes back serialized
+  static String fromJson(const Pool* pool, const Slot* s) {
+    if (s && s->type() == Type::String) return String(pool->string(s->v.s));
+    String result;
+    serializeJson(JsonVariantConst(pool, s), result);
+    return result;
+  }
+  static bool checkJson(const Slot* s) { return s && s->type() == Type::String; }
+  static void toJson(const String& value, Pool* pool, Slot* s) { setString(pool, s, value.c_str()); }
+};
+
+template <> struct Converter<const __FlashStringHelper*> {
+  static void toJson(const __FlashStringHelper* value, Pool* pool, Slot* s) {
+    setString(pool, s, reinterpret_cast<const char*>(value));
+  }
+};
+
+template <> struct Converter<std::nullptr_t> {
+  static void toJson(std::nullptr_t, Pool*, Slot* s) { setNull(s); }
+};
+
+template <> struct Converter<JsonVariantConst> {
+  static JsonVariantConst fromJson(const Pool* pool, const Slot* s) { return JsonVariantConst(pool, s); }
+  static bool checkJson(const Slot* s) { return s != nullptr; }
+  static void toJson(const JsonVariantConst& value, Pool* pool, Slot* s) { copyValue(pool, s, value.pool(), value.slot()); }
+};
+
+template <> struct Converter<JsonVariant> {
+  static JsonVariant fromJson(const Pool* pool, const Slot* s) { return JsonVariant(const_cast<Pool*>(pool), const_cast<Slot*>(s)); }
+  static bool checkJson(const Slot* s) { return s != nullptr; }
+  static void toJson(const JsonVariant& value, Pool* pool, Slot* s) { copyValue(pool, s, value.pool(), value.slot()); }
+};
+
+template <typename TCollection, Type CollectionType>
+struct CollectionConverter {
+  static TCollection fromJson(const Pool* pool, const Slot* s) {
+    typedef typename std::conditional<std::is_base_of<JsonVariant, TCollection>::value, Pool, const Pool>::type P;
+    typedef typename std::conditional<std::is_base_of<JsonVariant, TCollection>::value, Slot, const Slot>::type S;
+    return TCollection(const_cast<P*>(pool), const_cast<S*>(s));
+  }
+  static bool checkJson(const Slot* s) { return s && s->type() == CollectionType; }
+  static void makeJson(Slot* s) { s->setType(CollectionType); s->v.c.head = s->v.c.tail = 0; }
+};
+
+template <> struct Converter<JsonObject> : CollectionConverter<JsonObject, Type::Object> { };
+template <> struct Converter<JsonObjectConst> : CollectionConverter<JsonObjectConst, Type::Object> { };
+template <> struct Converter<JsonArray> : CollectionConverter<JsonArray, Type::Array> { };
+template <> struct Converter<JsonArrayConst> : CollectionConverter<JsonArrayConst, Type::Array> { };
+
+}  // namespace HostJson
+
+#endif  // HostShim_ArduinoJson_h
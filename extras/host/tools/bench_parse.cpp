@@ -0,0 +1,534 @@
+/*
+ * bench_parse:
+ *    Times the paths that turn printer responses into state, and the one that
+ *    renders the group's state as JSON. Responses are served in-process (see
+ *    WiFiClient::setResponder) so only the library and the shims are measured.
+ *
+ *    For each operation it reports the time (ns/op), the number of heap
+ *    allocations made by the library (allocs/op) and by the network shims
+ *    (transport/op), and the most heap in use at once above what was in use
+ *    before the operation (peak bytes).
+ *
+ *    The "unchanged body" rows serve the same body on every request, which
+ *    ConditionalGet recognizes by its hash without parsing it; the others
+ *    alternate between two bodies, so each one is parsed.
+ *
+ *    The "transport" row is the cost of the shimmed HTTP exchange alone
+ *    (request and response Strings, header parsing). It is part of every
+ *    fetch row, and is not representative of a device.
+ *
+ *    The group rows also compare the JSON from printerInfo() with the binary
+ *    GroupSnapshot from writeSnapshot(): the cost of producing each, of
+ *    reading every printer's state back out of it, and its size, and time a
+ *    gateway's RemotePrintClients reading their printers from a node's
+ *    snapshot.
+ *
+ *    The settings rows compare SettingsStore with keeping the settings as a
+ *    JSON document on flash (through the host FS shim, in a temporary
+ *    directory): the cost of loading them at boot, and the bytes written to
+ *    save them all and to change one printer.
+ *
+ *    The dataSupplier rows resolve every key of a typical template, and
+ *    compare the String, buffer, and batched forms with the original
+ *    implementation (reproduced here) in lookups per second.
+ *
+ *    usage: bench_parse [iterations]
+ *
+ */
+
+#include <chrono>
+#include <functional>
+#include <vector>
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ArduinoLog.h>
+#include <HTTPClient.h>
+#include <JSONService.h>
+#include <Output.h>
+#include <FS.h>
+#include "BPA_Config.h"
+#include "BPA_PrintClient.h"
+#include "BPA_InPlace.h"
+#include "BPA_Arena.h"
+#include "BPA_ConditionalGet.h"
+#include "BPA_PrinterGroup.h"
+#include "BPA_GroupSnapshot.h"
+#include "BPA_RemoteNode.h"
+#include "BPA_SettingsStore.h"
+#include "alloc_count.h"
+
+// The per-request methods are private. Their dependencies are included above,
+// so only the client classes themselves are opened up.
+#define private public
+#include "BPA_OctoClient.h"
+#include "BPA_DuetClient.h"
+#include "BPA_MoonrakerClient.h"
+#undef private
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Canned responses
+ *
+ *----------------------------------------------------------------------------*/
+
+static const char* const OctoJob[] = {
+  R"({"job":{"averagePrintTime":null,"estimatedPrintTime":8811.5,"filament":{"tool0":{"length":3012.4,"volume":7.25}},)"
+  R"("file":{"date":1700000000,"display":"Box (Bottom Facing USB)_0.2mm_PLA_UXL_2h57m.gcode","name":"Box (Bottom Facing USB)_0.2mm_PLA_UXL_2h57m.gcode",)"
+  R"("origin":"local","path":"Box (Bottom Facing USB)_0.2mm_PLA_UXL_2h57m.gcode","size":2473829},"lastPrintTime":null,"user":"pi"},)"
+  R"("progress":{"completion":42.17,"filepos":1043211,"printTime":3712,"printTimeLeft":5099,"printTimeLeftOrigin":"estimate"},"state":"Printing"})",
+  R"({"job":{"averagePrintTime":null,"estimatedPrintTime":8811.5,"filament":{"tool0":{"length":3012.4,"volume":7.25}},)"
+  R"("file":{"date":1700000000,"display":"Box (Bottom Facing USB)_0.2mm_PLA_UXL_2h57m.gcode","name":"Box (Bottom Facing USB)_0.2mm_PLA_UXL_2h57m.gcode",)"
+  R"("origin":"local","path":"Box (Bottom Facing USB)_0.2mm_PLA_UXL_2h57m.gcode","size":2473829},"lastPrintTime":null,"user":"pi"},)"
+  R"("progress":{"completion":42.19,"filepos":1043870,"printTime":3714,"printTimeLeft":5097,"printTimeLeftOrigin":"estimate"},"state":"Printing"})",
+};
+
+static const char* const OctoPrinter[] = {
+  R"({"state":{"error":"","flags":{"cancelling":false,"closedOrError":false,"error":false,"finishing":false,"operational":true,)"
+  R"("paused":false,"pausing":false,"printing":true,"ready":false,"resuming":false,"sdReady":false},"text":"Printing"},)"
+  R"("temperature":{"bed":{"actual":60.1,"offset":0,"target":60.0},"tool0":{"actual":214.8,"offset":0,"target":215.0}}})",
+  R"({"state":{"error":"","flags":{"cancelling":false,"closedOrError":false,"error":false,"finishing":false,"operational":true,)"
+  R"("paused":false,"pausing":false,"printing":true,"ready":false,"resuming":false,"sdReady":false},"text":"Printing"},)"
+  R"("temperature":{"bed":{"actual":59.8,"offset":0,"target":60.0},"tool0":{"actual":215.3,"offset":0,"target":215.0}}})",
+};
+
+static const char* const DuetStatus[] = {
+  R"({"status":"P","coords":{"axesHomed":[1,1,1],"wpl":1,"xyz":[120.5,98.2,12.4],"machine":[120.5,98.2,12.4],"extr":[1523.2]},)"
+  R"("speeds":{"requested":3000.0,"top":3000.0},"currentTool":0,"params":{"atxPower":-1,"fanPercent":[100,0,0],"fanNames":["","",""],)"
+  R"("speedFactor":100.0,"extrFactors":[100.0],"babystep":0.000},"seq":12,"sensors":{"probeValue":0,"fanRPM":[-1,-1]},)"
+  R"("temps":{"bed":{"current":60.1,"active":60.0,"standby":0.0,"state":2,"heater":0},"current":[60.1,214.8,2000.0,2000.0,2000.0,2000.0,2000.0,2000.0],)"
+  R"("state":[2,2,0,0,0,0,0,0],"names":["","","","","","","",""],"tools":{"active":[[215.0]],"standby":[[0.0]]},"extra":[{"name":"*MCU","temp":41.2}]},)"
+  R"("time":5321.0,"currentLayer":62,"currentLayerTime":41.3,"extrRaw":[1523.2],"fractionPrinted":42.2,"filePosition":1043211,)"
+  R"("firstLayerDuration":61.2,"firstLayerHeight":0.20,"printDuration":3750.4,"warmUpDuration":38.1,"timesLeft":{"file":5012.3,"filament":5120.8,"layer":4999.0}})",
+  R"({"status":"P","coords":{"axesHomed":[1,1,1],"wpl":1,"xyz":[121.0,97.6,12.4],"machine":[121.0,97.6,12.4],"extr":[1524.0]},)"
+  R"("speeds":{"requested":3000.0,"top":3000.0},"currentTool":0,"params":{"atxPower":-1,"fanPercent":[100,0,0],"fanNames":["","",""],)"
+  R"("speedFactor":100.0,"extrFactors":[100.0],"babystep":0.000},"seq":12,"sensors":{"probeValue":0,"fanRPM":[-1,-1]},)"
+  R"("temps":{"bed":{"current":59.9,"active":60.0,"standby":0.0,"state":2,"heater":0},"current":[59.9,215.1,2000.0,2000.0,2000.0,2000.0,2000.0,2000.0],)"
+  R"("state":[2,2,0,0,0,0,0,0],"names":["","","","","","","",""],"tools":{"active":[[215.0]],"standby":[[0.0]]},"extra":[{"name":"*MCU","temp":41.3}]},)"
+  R"("time":5323.0,"currentLayer":62,"currentLayerTime":43.3,"extrRaw":[1524.0],"fractionPrinted":42.3,"filePosition":1043870,)"
+  R"("firstLayerDuration":61.2,"firstLayerHeight":0.20,"printDuration":3752.4,"warmUpDuration":38.1,"timesLeft":{"file":5010.3,"filament":5118.8,"layer":4997.0}})",
+};
+
+static const char* const DuetFileInfo[] = {
+  R"({"err":0,"size":2473829,"lastModified":"2023-11-14T22:13:20","height":24.40,"firstLayerHeight":0.20,"layerHeight":0.20,)"
+  R"("printTime":8811,"filament":[3012.4],"printDuration":3750,"fileName":"0:/gcodes/Box (Bottom Facing USB)_0.2mm_PLA_UXL_2h57m.gcode",)"
+  R"("generatedBy":"PrusaSlicer 2.6.1+linux-x64-GTK3","thumbnails":[{"width":32,"height":32,"fmt":"png","offset":312,"size":1440},)"
+  R"({"width":220,"height":124,"fmt":"png","offset":1890,"size":21400}]})",
+  nullptr
+};
+
+static const char* const DuetConnect[] = { R"({"err":0,"sessionTimeout":8000,"boardType":"duetwifi102","apiLevel":1})", nullptr };
+static const char* const DuetDisconnect[] = { R"({"err":0})", nullptr };
+
+struct Endpoint {
+  const char* path;               // Matches any request whose path starts with this
+  const char* const* bodies;      // Served alternately; the second may be nullptr
+  uint32_t served;
+};
+
+static Endpoint endpoints[] = {
+  {"/api/job", OctoJob, 0},
+  {"/api/printer", OctoPrinter, 0},
+  {"/rr_status", DuetStatus, 0},
+  {"/rr_fileinfo", DuetFileInfo, 0},
+  {"/rr_connect", DuetConnect, 0},
+  {"/rr_disconnect", DuetDisconnect, 0},
+};
+
+// When false, every endpoint keeps serving its first body
+static bool alternate = true;
+
+// Served at /snapshot, as a node would serve it to a gateway
+static std::vector<uint8_t> snapshotBody;
+
+static bool respond(const char*, uint16_t, const String& request, String& response) {
+  int start = request.indexOf(' ') + 1;
+  if (request.startsWith("/snapshot", start)) {
+    char header[96];
+    snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\nContent-Length: %u\r\n\r\n", (unsigned)snapshotBody.size());
+    response = header;
+    response.concat((const char*)snapshotBody.data(), snapshotBody.size());
+    return true;
+  }
+  for (Endpoint& e : endpoints) {
+    if (!request.startsWith(e.path, start)) continue;
+    const char* body = e.bodies[alternate && e.bodies[1] ? e.served % 2 : 0];
+    e.served++;
+    char header[96];
+    snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %u\r\n\r\n", (unsigned)strlen(body));
+    response = header;
+    response += body;
+    return true;
+  }
+  response = F("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+  return true;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Measurement
+ *
+ *----------------------------------------------------------------------------*/
+
+static double measure(const char* name, uint32_t iterations, std::function<void()> op) {
+  for (uint32_t i = 0; i < iterations / 10 + 1; i++) op();    // Warm up
+
+  // Allocations and peak memory, one operation at a time
+  uint64_t allocations = 0, transport = 0;
+  size_t peak = 0;
+  for (uint32_t i = 0; i < iterations; i++) {
+    size_t before = AllocCount::read().inUse;
+    AllocCount::mark();
+    op();
+    AllocCount::Stats stats = AllocCount::read();
+    allocations += stats.allocations - stats.transport;
+    transport += stats.transport;
+    if (stats.peak - before > peak) peak = stats.peak - before;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < iterations; i++) op();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  double ns = std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+
+  printf("%-56s %10.0f %10.1f %12.1f %10zu\n",
+      name, ns, (double)allocations / iterations, (double)transport / iterations, peak);
+  return ns;
+}
+
+class NullPrint : public Print {
+public:
+  size_t write(uint8_t) override { return 1; }
+  size_t write(const uint8_t*, size_t size) override { return size; }
+};
+
+class VectorPrint : public Print {
+public:
+  std::vector<uint8_t> bytes;
+  size_t write(uint8_t c) override { bytes.push_back(c); return 1; }
+  size_t write(const uint8_t* buffer, size_t size) override {
+    bytes.insert(bytes.end(), buffer, buffer + size);
+    return size;
+  }
+};
+
+/*------------------------------------------------------------------------------
+ *
+ * dataSupplier as it was originally written: the key is compared against each
+ * name in turn, the subkey is copied into a new String, and each printer's
+ * state is read from its client for every key
+ *
+ *----------------------------------------------------------------------------*/
+
+static void originalPrinterSpecific(
+    PrinterGroup* group, PrinterSettings* settings, const String& key, String& value, int printerIndex)
+{
+  if (printerIndex >= group->numberOfPrinters()) return;
+  PrintClient *p = group->getPrinter(printerIndex);
+  PrinterSettings *ps = &settings[printerIndex];
+  bool active = ps->isActive && p != nullptr;
+
+  if (key.equalsIgnoreCase("name")) {
+    if (!ps->nickname.isEmpty()) { value += ps->nickname; }
+    else if (!ps->server.isEmpty()) { value += ps->server; }
+    else value += "Inactive";
+    return;
+  }
+  if (key.equalsIgnoreCase("pct")) {
+    if (active && p->getState() >= PrintClient::State::Complete) { value += (int)(p->getPctComplete()); }
+    return;
+  }
+  if (key.equalsIgnoreCase("state") || key.equalsIgnoreCase("status")) {
+    if (active) {
+      switch (p->getState()) {
+        case PrintClient::State::Offline: value += F("Offline"); break;
+        case PrintClient::State::Operational: value += F("Online"); break;
+        case PrintClient::State::Complete: value += F("Complete"); break;
+        case PrintClient::State::Printing:
+          value += F("Printing");
+          if (key.equalsIgnoreCase("status")) { value += '|'; value += ((int)p->getPctComplete()); }
+          break;
+      }
+    } else value += F("Unused");
+    return;
+  }
+  if (key.equalsIgnoreCase("next")) {
+    if (active && p->isPrinting()) group->completionTime(value, p->getPrintTimeLeft());
+    return;
+  }
+  if (key.equalsIgnoreCase("remaining")) {
+    if (active && p->getState() == PrintClient::State::Printing) {
+      value = Output::formattedInterval(p->getPrintTimeLeft(), true, true);
+    }
+    return;
+  }
+}
+
+static void originalDataSupplier(PrinterGroup* group, PrinterSettings* settings, const String& key, String& value) {
+  if (key.equalsIgnoreCase("next")) {
+    uint32_t delta;
+    String printer, formattedTime;
+    group->nextCompletion(printer, formattedTime, delta);
+    if (printer.isEmpty()) value += F("No print in progress");
+    else { value += printer; value += ": "; value += formattedTime; }
+    return;
+  }
+  if (isDigit(key[0]) && key[1] == '.') {
+    String subkey = key.substring(2);
+    originalPrinterSpecific(group, settings, subkey, value, (key[0] - '0') - 1);
+  }
+}
+
+static void benchDataSupplier(PrinterGroup* group, PrinterSettings* settings, uint32_t iterations) {
+  // Every printer-specific key for each of the first 8 printers (the most the
+  // original could address), and the group's next completion
+  static const char* Subkeys[] = {"name", "state", "status", "pct", "remaining", "next"};
+  const int nSubkeys = sizeof(Subkeys) / sizeof(Subkeys[0]);
+  int nPrinters = group->numberOfPrinters() < 8 ? group->numberOfPrinters() : 8;
+  std::vector<String> keys;
+  keys.push_back("next");
+  for (int i = 1; i <= nPrinters; i++) {
+    for (int k = 0; k < nSubkeys; k++) keys.push_back(String(i) + "." + Subkeys[k]);
+  }
+  std::vector<const char*> keyPtrs;
+  for (const String& k : keys) keyPtrs.push_back(k.c_str());
+  uint16_t nKeys = keys.size();
+  std::vector<String> values(nKeys);
+  char buf[64];
+  String value;
+
+  char name[64];
+  double ns[4];
+  snprintf(name, sizeof(name), "dataSupplier, original (%u keys)", nKeys);
+  ns[0] = measure(name, iterations, [&]() {
+    for (const String& k : keys) { value = ""; originalDataSupplier(group, settings, k, value); }
+  });
+  snprintf(name, sizeof(name), "dataSupplier(String, String&) (%u keys)", nKeys);
+  ns[1] = measure(name, iterations, [&]() {
+    for (const String& k : keys) { value = ""; group->dataSupplier(k, value); }
+  });
+  snprintf(name, sizeof(name), "dataSupplier(const char*, char*, size_t) (%u keys)", nKeys);
+  ns[2] = measure(name, iterations, [&]() {
+    for (const char* k : keyPtrs) group->dataSupplier(k, buf, sizeof(buf));
+  });
+  snprintf(name, sizeof(name), "dataSupplier, batch of %u keys", nKeys);
+  ns[3] = measure(name, iterations, [&]() {
+    for (String& v : values) v = "";
+    group->dataSupplier(nKeys, keyPtrs.data(), values.data());
+  });
+  printf("  lookups/s: original %.2fM, String %.2fM, buffer %.2fM, batch %.2fM\n",
+      nKeys * 1e3 / ns[0], nKeys * 1e3 / ns[1], nKeys * 1e3 / ns[2], nKeys * 1e3 / ns[3]);
+}
+
+static void benchSettings(uint8_t nPrinters, uint32_t iterations) {
+  char root[] = "/tmp/bench-settings-XXXXXX";
+  if (mkdtemp(root) == nullptr) { perror("mkdtemp"); return; }
+  FS fs(root);
+
+  std::vector<PrinterSettings> settings(nPrinters);
+  for (int i = 0; i < nPrinters; i++) {
+    settings[i].type = (i % 3) ? Type_Octo : Type_Duet;
+    settings[i].apiKey = "0123456789ABCDEF0123456789ABCDEF";
+    settings[i].server = String("printer-") + i + ".local";
+    settings[i].port = 80;
+    settings[i].nickname = String("Printer ") + i;
+    settings[i].isActive = true;
+  }
+
+  // The JSON path: the whole document is rewritten for any change
+  auto saveJSON = [&]() -> size_t {
+    DynamicJsonDocument doc(512 * nPrinters + 256);
+    JsonArray printers = doc.createNestedArray("printers");
+    for (const PrinterSettings& ps : settings) ps.toJSON(printers.createNestedObject());
+    File f = fs.open("/settings.json", "w");
+    size_t written = serializeJson(doc, f);
+    f.close();
+    return written;
+  };
+  SettingsStore store(fs);
+  size_t jsonSave = saveJSON();
+  store.save(settings.data(), nPrinters);
+  uint32_t storeSave = store.bytesWritten();
+  settings[nPrinters / 2].nickname = "Renamed";
+  size_t jsonUpdate = saveJSON();
+  store.update(nPrinters / 2, settings[nPrinters / 2]);
+  uint32_t storeUpdate = store.bytesWritten() - storeSave;
+
+  char name[64];
+  std::vector<PrinterSettings> loaded(nPrinters);
+  snprintf(name, sizeof(name), "load settings from JSON (%u printers)", nPrinters);
+  measure(name, iterations, [&]() {
+    File f = fs.open("/settings.json", "r");
+    DynamicJsonDocument doc(512 * nPrinters + 256);
+    if (deserializeJson(doc, f)) return;
+    uint8_t i = 0;
+    for (JsonObjectConst p : doc["printers"].as<JsonArrayConst>()) {
+      if (i < nPrinters) loaded[i++].fromJSON(p);
+    }
+  });
+  snprintf(name, sizeof(name), "SettingsStore::load (%u)", nPrinters);
+  bool ok = true;
+  measure(name, iterations, [&]() { ok &= store.load(loaded.data(), nPrinters); });
+  if (!ok || loaded[nPrinters / 2].nickname != "Renamed") printf("  SettingsStore didn't read back what was saved\n");
+  printf("  %u printers: bytes written to save all, JSON %zu, SettingsStore %u; to change one, JSON %zu, SettingsStore %u\n",
+      nPrinters, jsonSave, storeSave, jsonUpdate, storeUpdate);
+
+  String command = "rm -rf ";
+  command += root;
+  if (system(command.c_str()) != 0) fprintf(stderr, "Unable to remove %s\n", root);
+}
+
+static void benchGroup(uint8_t nPrinters, uint32_t iterations) {
+  PrinterSettings* settings = new PrinterSettings[nPrinters];
+  for (int i = 0; i < nPrinters; i++) {
+    settings[i].type = Type_Octo;
+    settings[i].server = "localhost";     // Must resolve, or the printer is left inactive
+    settings[i].port = 8000 + i;
+    settings[i].nickname = String("Printer ") + i;
+    settings[i].isActive = true;
+    settings[i].mock = true;
+  }
+  PrinterGroup* group = new PrinterGroup(nPrinters, settings, 60, [](bool) { });
+  group->setMockOptions(1);     // The same mix of jobs every run
+  for (int i = 0; i < nPrinters; i++) group->activatePrinter(i);
+  group->refreshPrinterData(true);
+
+  benchDataSupplier(group, settings, iterations);
+
+  NullPrint sink;
+  char name[64];
+  snprintf(name, sizeof(name), "PrinterGroup::printerInfo (%u printers)", nPrinters);
+  measure(name, iterations, [&]() { group->printerInfo(sink); });
+  String json;
+  snprintf(name, sizeof(name), "PrinterGroup::printerInfo(String&) (%u)", nPrinters);
+  measure(name, iterations, [&]() { group->printerInfo(json); });
+  snprintf(name, sizeof(name), "PrinterGroup::writeSnapshot (%u)", nPrinters);
+  measure(name, iterations, [&]() { group->writeSnapshot(sink); });
+
+  // Read the fields a display shows for each printer back out of each format
+  volatile uint32_t checksum = 0;
+  snprintf(name, sizeof(name), "decode printerInfo JSON (%u)", nPrinters);
+  measure(name, iterations, [&]() {
+    DynamicJsonDocument doc(2 * json.length() + 1024);
+    if (deserializeJson(doc, json)) return;
+    for (JsonObjectConst p : doc.as<JsonArrayConst>()) {
+      const char* printerName = p["name"] | "";
+      const char* file = p["file"] | "";
+      checksum += strlen(printerName) + strlen(file) + (p["pct"] | 0) + (p["remaining"] | 0);
+    }
+  });
+  VectorPrint snapshot;
+  group->writeSnapshot(snapshot);
+  // Checking the CRC is done once per snapshot received; reading the
+  // printers back may be done many times
+  snprintf(name, sizeof(name), "decode GroupSnapshot: check the CRC (%u)", nPrinters);
+  measure(name, iterations, [&]() {
+    GroupSnapshot s(snapshot.bytes.data(), snapshot.bytes.size());
+    checksum += s.valid();
+  });
+  GroupSnapshot decoded(snapshot.bytes.data(), snapshot.bytes.size());
+  if (!decoded.valid()) printf("  the GroupSnapshot is not valid\n");
+  snprintf(name, sizeof(name), "decode GroupSnapshot: read the printers (%u)", nPrinters);
+  measure(name, iterations, [&]() {
+    GroupSnapshot::PrinterView v;
+    for (bool ok = decoded.first(v); ok; ok = decoded.next(v)) {
+      checksum += v.nameLength() + v.fileLength() + v.pct() + v.timeLeft() / 60;
+    }
+  });
+#if BPA_ENABLE_REMOTE
+  // A gateway's pass over the printers of one node: the snapshot is fetched
+  // once, and each printer's record is then looked up
+  snapshotBody = snapshot.bytes;
+  RemoteNode node;
+  node.init("node.bench", 80);
+  std::vector<RemotePrintClient> remotes(nPrinters);
+  for (int i = 0; i < nPrinters; i++) remotes[i].init(&node, i, UINT32_MAX);
+  snprintf(name, sizeof(name), "RemotePrintClient::updateState, every printer (%u)", nPrinters);
+  measure(name, iterations, [&]() { for (RemotePrintClient& r : remotes) r.updateState(); });
+#endif
+  printf("  %u printers: printerInfo is %u bytes, GroupSnapshot is %zu bytes\n",
+      nPrinters, json.length(), snapshot.bytes.size());
+
+  delete group;
+  delete[] settings;
+}
+
+int main(int argc, char** argv) {
+  uint32_t iterations = argc > 1 ? atoi(argv[1]) : 20000;
+  Log.begin(LOG_LEVEL_ERROR);
+  WiFiClient::setResponder(respond);
+
+  printf("%-56s %10s %10s %12s %10s\n", "operation", "ns/op", "allocs/op", "transport/op", "peak bytes");
+
+  measure("transport: GET /api/job and read the body", iterations, []() {
+    WiFiClient client;
+    HTTPClient http;
+    http.useHTTP10(true);
+    http.begin(client, "octopi.bench", 80, "/api/job");
+    if (http.GET() == HTTP_CODE_OK) {
+      uint8_t buf[128];
+      while (client.available()) client.read(buf, sizeof(buf));
+    }
+    http.end();
+  });
+
+#if BPA_ENABLE_OCTO
+  OctoClient octo;
+  octo.init("key", "octopi.bench", 80, "", "");
+  measure("OctoClient::getJobState (changed body)", iterations, [&]() { octo.getJobState(); });
+  measure("OctoClient::getPrinterState", iterations, [&]() { octo.getPrinterState(); });
+  alternate = false;
+  measure("OctoClient::getJobState (unchanged body)", iterations, [&]() { octo.getJobState(); });
+  alternate = true;
+#endif
+
+#if BPA_ENABLE_DUET
+  DuetClient duet;
+  duet.init("duet.bench", 80, "");
+  measure("DuetClient::getRRState (changed body)", iterations, [&]() {
+    duet.getRRState(*DuetClient::pollArena);
+    DuetClient::pollArena->reset();
+  });
+  alternate = false;
+  measure("DuetClient::getRRState (unchanged body)", iterations, [&]() {
+    duet.getRRState(*DuetClient::pollArena);
+    DuetClient::pollArena->reset();
+  });
+  alternate = true;
+  measure("DuetClient::getFileInfo", iterations, [&]() {
+    duet.getFileInfo(*DuetClient::pollArena);
+    DuetClient::pollArena->reset();
+  });
+  measure("DuetClient::updateState (connect, status, disconnect)", iterations, [&]() { duet.updateState(); });
+#endif
+
+#if BPA_ENABLE_MOONRAKER
+  // Moonraker sends notify_proc_stat_update every second, which is skipped
+  // without being parsed, and status updates as fields change
+  MoonrakerClient moonraker;
+  String procStat =
+      "{\"jsonrpc\":\"2.0\",\"method\":\"notify_proc_stat_update\",\"params\":[{\"moonraker_stats\":"
+      "{\"time\":1700000000.123,\"cpu_usage\":2.31,\"memory\":41024,\"mem_units\":\"kB\"},\"cpu_temp\":47.23,"
+      "\"network\":{\"lo\":{\"rx_bytes\":1234567,\"tx_bytes\":1234567,\"bandwidth\":9000.0},"
+      "\"wlan0\":{\"rx_bytes\":7654321,\"tx_bytes\":9876543,\"bandwidth\":52000.0}},"
+      "\"system_cpu_usage\":{\"cpu\":12.5,\"cpu0\":10.1,\"cpu1\":14.2,\"cpu2\":11.0,\"cpu3\":13.7},"
+      "\"system_memory\":{\"total\":3906732,\"available\":3391288,\"used\":515444},\"websocket_connections\":2}]}";
+  String statusUpdate =
+      "{\"jsonrpc\":\"2.0\",\"method\":\"notify_status_update\",\"params\":[{\"print_stats\":"
+      "{\"print_duration\":3751.2,\"filament_used\":2851.7},\"display_status\":{\"progress\":0.4213},"
+      "\"heater_bed\":{\"temperature\":60.02},\"extruder\":{\"temperature\":214.87}},1700000000.123]}";
+  measure("MoonrakerClient::handleMessage (notify_proc_stat_update)", iterations, [&]() {
+    moonraker.handleMessage(procStat);
+  });
+  measure("MoonrakerClient::handleMessage (notify_status_update)", iterations, [&]() {
+    moonraker.handleMessage(statusUpdate);
+  });
+#endif
+
+  benchGroup(8, iterations);
+  benchGroup(64, iterations / 8);
+  benchSettings(8, iterations / 10);
+  benchSettings(64, iterations / 80);
+  return 0;
+}
@@ -0,0 +1,171 @@
+/*
+ * check_alloc:
+ *    Checks that the Duet client's polls, and decompression, stay off the
+ *    heap: once the first poll has allocated the shared arena's block, a
+ *    poll makes no allocations, compressed or not, and leaves nothing
+ *    allocated. A compressed status of BPA_MAX_BODY_SIZE bytes must fit in
+ *    the arena too. Allocations made by the network shims are not counted
+ *    (see AllocCount::Transport). In a build without Duet support, only
+ *    Inflate is checked.
+ *
+ *    Exits with a non-zero status if any check fails.
+ *
+ */
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ArduinoLog.h>
+#include <HTTPClient.h>
+#include <JSONService.h>
+#include "BPA_Config.h"
+#include "BPA_PrintClient.h"
+#include "BPA_InPlace.h"
+#include "BPA_Arena.h"
+#include "BPA_ConditionalGet.h"
+#include "BPA_Inflate.h"
+#include "alloc_count.h"
+
+#define private public
+#include "BPA_DuetClient.h"
+#undef private
+
+
+// The status body below, zlib compressed (with dynamic Huffman codes)
+static const char Status[] =
+  R"({"status":"P","temps":{"bed":{"current":60.1,"active":60.0},"current":[60.1,214.8,2000.0,2000.0,2000.0,2000.0,2000.0,2000.0],)"
+  R"("tools":{"active":[[215.0]]}},"printDuration":3750.4,"warmUpDuration":38.1,"fractionPrinted":42.2,)"
+  R"("timesLeft":{"file":5012.3,"filament":5120.8,"layer":4999.0}})";
+
+static const uint8_t DeflatedStatus[] = {
+  0x78, 0xda, 0x8d, 0x8f, 0x3f, 0x0f, 0x82, 0x30, 0x10, 0xc5, 0xbf, 0xcb, 0xcd, 0x4d, 0xd3, 0x56,
+  0xaa, 0xc0, 0xec, 0xe8, 0xc0, 0xe2, 0x44, 0x18, 0x2a, 0x96, 0xa4, 0x09, 0x2d, 0xa4, 0x1c, 0x1a,
+  0x43, 0xf8, 0xee, 0x5e, 0x9b, 0x18, 0x1d, 0x9d, 0xee, 0xcf, 0xcb, 0xbd, 0xdf, 0xbb, 0x0d, 0x16,
+  0x34, 0xb8, 0x2e, 0x50, 0x43, 0x03, 0x0c, 0xd0, 0xfa, 0x99, 0xfa, 0x0d, 0x6e, 0xf6, 0x9e, 0x4a,
+  0xbf, 0xc6, 0x68, 0x03, 0x42, 0x7d, 0x14, 0x5c, 0x32, 0x30, 0x3d, 0xba, 0x87, 0xcd, 0x93, 0xd8,
+  0xd9, 0x57, 0x6d, 0xb3, 0xac, 0x64, 0xc1, 0x4b, 0xa6, 0x84, 0x20, 0xf5, 0x8f, 0xd2, 0x11, 0x6e,
+  0x9a, 0xc6, 0x8c, 0xfb, 0x18, 0xb7, 0xad, 0x92, 0x9a, 0xa4, 0x6e, 0x27, 0xfb, 0x39, 0xba, 0x80,
+  0xe7, 0x35, 0x1a, 0x74, 0x53, 0x80, 0xfa, 0x70, 0xd2, 0x82, 0x17, 0x0c, 0x9e, 0x26, 0xfa, 0xeb,
+  0xfc, 0xb3, 0x2f, 0x53, 0xb4, 0x21, 0x26, 0x8f, 0x29, 0x34, 0xe9, 0x28, 0x85, 0x2f, 0x14, 0x57,
+  0x44, 0x70, 0xde, 0x2e, 0x17, 0x3b, 0x60, 0xa2, 0x0c, 0x6e, 0x24, 0x86, 0x16, 0x52, 0xf1, 0x03,
+  0x4b, 0x93, 0xf1, 0x39, 0xbe, 0x96, 0x4a, 0x50, 0x72, 0x18, 0xcd, 0xcb, 0x46, 0xba, 0xac, 0xaa,
+  0x8a, 0xfe, 0xdb, 0xdf, 0x55, 0x84, 0x52, 0x7b
+};
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, uint64_t value, uint64_t expected) {
+  printf("%-4s %-60s %llu (expected %llu)\n",
+      ok ? "ok" : "FAIL", what, (unsigned long long)value, (unsigned long long)expected);
+  if (!ok) failures++;
+}
+
+#if BPA_ENABLE_DUET
+
+static bool deflate = false;
+static bool largest = false;      // Serve the status stored (uncompressed) in a body of BPA_MAX_BODY_SIZE
+static uint32_t sequence = 0;     // Makes each status body differ from the last
+
+static bool respond(const char*, uint16_t, const String& request, String& response) {
+  int start = request.indexOf(' ') + 1;
+  response = F("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n");
+  if (!request.startsWith("/rr_status", start)) {
+    response += F("\r\n{\"err\":0}");
+  } else if (largest) {
+    // A zlib stream of one stored block: 2 bytes of header, 5 of block
+    // header, the data, and a 4 byte Adler-32
+    const size_t BodySize = ConditionalGet::MaxBodySize;
+    String data = Status;
+    while (data.length() < BodySize - 11) data += ' ';
+    uint32_t a = 1, b = 0;
+    for (unsigned i = 0; i < data.length(); i++) { a = (a + (uint8_t)data[i]) % 65521; b = (b + a) % 65521; }
+    uint16_t length = data.length();
+    const uint8_t header[] = {0x78, 0x01, 0x01, (uint8_t)length, (uint8_t)(length >> 8),
+                              (uint8_t)~length, (uint8_t)(~length >> 8)};
+    const uint8_t adler[] = {(uint8_t)(b >> 8), (uint8_t)b, (uint8_t)(a >> 8), (uint8_t)a};
+    response += F("Content-Encoding: deflate\r\n\r\n");
+    response.concat((const char*)header, sizeof(header));
+    response += data;
+    response.concat((const char*)adler, sizeof(adler));
+  } else if (deflate) {
+    response += F("Content-Encoding: deflate\r\n\r\n");
+    response.concat((const char*)DeflatedStatus, sizeof(DeflatedStatus));
+  } else {
+    response += F("\r\n");
+    response += Status;
+    response += ' ';
+    response += (unsigned long)sequence++;  // Trailing content after the JSON is ignored by the parser
+  }
+  return true;
+}
+
+// Library allocations made by `polls` polls, after checking that none of them
+// leaves anything allocated
+static uint64_t pollAllocations(DuetClient& duet, int polls) {
+  uint64_t allocations = 0;
+  size_t before = AllocCount::read().inUse;
+  for (int i = 0; i < polls; i++) {
+    AllocCount::mark();
+    duet.updateState();
+    AllocCount::Stats stats = AllocCount::read();
+    allocations += stats.allocations - stats.transport;
+  }
+  check(AllocCount::read().inUse == before, "bytes left allocated after the polls", AllocCount::read().inUse - before, 0);
+  return allocations;
+}
+
+static void checkDuet() {
+  WiFiClient::setResponder(respond);
+  DuetClient duet;
+  duet.init("duet.check", 80, "a-rather-long-password");
+  for (int i = 0; i < 3; i++) duet.updateState();     // Warm up: the client's own Strings reach their size
+  check(duet.getState() == PrintClient::State::Printing, "the status is parsed", (uint64_t)duet.getState(), (uint64_t)PrintClient::State::Printing);
+
+  const int Polls = 20;
+  uint64_t allocations = pollAllocations(duet, Polls);
+  check(allocations == 0, "allocations by 20 polls", allocations, 0);
+
+  deflate = true;
+  duet.updateState();
+  uint32_t decodedBefore = duet.fetchStats.bytesDecoded;
+  allocations = pollAllocations(duet, 1);
+  check(allocations == 0, "allocations by a poll with a deflated status", allocations, 0);
+  uint32_t decoded = duet.fetchStats.bytesDecoded - decodedBefore;
+  check(decoded == strlen(Status) + 2 * strlen("{\"err\":0}"), "bytes decoded by that poll", decoded, strlen(Status) + 2 * strlen("{\"err\":0}"));
+
+  largest = true;
+  duet.rrState.reset();
+  allocations = pollAllocations(duet, 1);
+  check(allocations == 0, "allocations by a poll with the largest compressed status", allocations, 0);
+  check(duet.rrState.status == "P", "the largest compressed status is parsed", duet.rrState.status == "P", 1);
+  check(DuetClient::pollArena->highWater() <= DuetClient::PollArenaSize,
+      "most bytes of the poll arena in use", DuetClient::pollArena->highWater(), DuetClient::PollArenaSize);
+  largest = deflate = false;
+}
+#endif  // BPA_ENABLE_DUET
+
+int main() {
+  Log.begin(LOG_LEVEL_ERROR);
+#if BPA_ENABLE_DUET
+  checkDuet();
+#else
+  printf("Duet is not enabled in this build; checking Inflate only\n");
+#endif
+
+  uint8_t out[512];
+  Arena arena(2048);
+  arena.allocate(1);    // Allocate the arena's block before counting
+  arena.reset();
+  AllocCount::mark();
+  int length = Inflate::decompress(Inflate::Zlib, DeflatedStatus, sizeof(DeflatedStatus), out, sizeof(out), &arena);
+  check(length == (int)strlen(Status) && memcmp(out, Status, length) == 0, "inflated length, with an arena", length, strlen(Status));
+  check(AllocCount::read().allocations == 0, "allocations by Inflate with an arena", AllocCount::read().allocations, 0);
+  check(arena.used() == 0, "arena bytes left in use by Inflate", arena.used(), 0);
+
+  AllocCount::mark();
+  length = Inflate::decompress(Inflate::Zlib, DeflatedStatus, sizeof(DeflatedStatus), out, sizeof(out));
+  check(length == (int)strlen(Status), "inflated length, without an arena", length, strlen(Status));
+  check(AllocCount::read().allocations == 0, "allocations by Inflate without an arena", AllocCount::read().allocations, 0);
+
+  printf("%s\n", failures ? "FAILED" : "passed");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,792 @@
+/*
+ * Emulator:
+ *    A single-threaded server: one listening socket per printer, and a poll()
+ *    loop that reads each request, holds the response for the configured
+ *    latency (plus the time to send it, with a bandwidth), writes it, and
+ *    closes the connection (the clients speak HTTP/1.0).
+ *
+ *    A request for /websocket is upgraded to a Moonraker websocket instead,
+ *    and the connection stays open. It answers printer.objects.subscribe,
+ *    then sends what changed every StatusInterval, and, as Moonraker does,
+ *    messages the client has no use for: notify_proc_stat_update every
+ *    second, and now and then one larger than the client will take. The
+ *    subscription reply is sent in two fragments with a ping between them.
+ *    When the script takes the printer offline, Klipper is what goes away:
+ *    the connection stays up and the client is sent
+ *    notify_klippy_disconnected, then notify_klippy_ready when it is back.
+ *
+ *    Outages come in two kinds. A printer that the script has taken offline
+ *    closes each connection as soon as the request arrives, like a host whose
+ *    server is down. A printer counted in `offline` accepts connections and
+ *    never answers, like a host that has gone away; clients wait out their
+ *    timeout.
+ *
+ */
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <errno.h>
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#include <Arduino.h>
+#include "BPA_MockPrintClient.h"
+#include "emulator.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Printers
+ *
+ *----------------------------------------------------------------------------*/
+
+namespace {
+
+// Scripts cover this much printer time; a run that outlasts it just sees
+// printers finish their jobs and stay idle
+constexpr uint32_t ScriptHorizon = 24 * 3600;
+constexpr uint8_t MaxEvents = 250;
+constexpr size_t WebcamFrameSize = 24 * 1024;
+
+struct Printer {
+  std::vector<MockEvent> script;          // Must outlive `mock`
+  std::unique_ptr<MockPrintClient> mock;
+  bool silent;                            // Accepts connections but never answers
+  int listener = -1;
+};
+
+// Every hour or so the current job is ended and another started a few
+// minutes later. A flaky printer also goes offline every half hour or so,
+// for a few minutes.
+std::vector<MockEvent> makeScript(uint32_t seed, bool flaky) {
+  MockRandom rng;
+  rng.seed(seed);
+  std::vector<MockEvent> jobs, outages, script;
+  for (uint32_t t = rng.range(20*60, 90*60); t < ScriptHorizon; t += rng.range(40*60, 120*60)) {
+    jobs.push_back({t, MockEvent::Complete});
+    jobs.push_back({t + (uint32_t)rng.range(2*60, 10*60), MockEvent::StartJob});
+  }
+  if (flaky) {
+    for (uint32_t t = rng.range(5*60, 40*60); t < ScriptHorizon; t += rng.range(20*60, 60*60)) {
+      outages.push_back({t, MockEvent::GoOffline});
+      outages.push_back({t + (uint32_t)rng.range(2*60, 8*60), MockEvent::GoOnline});
+    }
+  }
+  // Merge the two, which are each sorted
+  size_t j = 0, o = 0;
+  while ((j < jobs.size() || o < outages.size()) && script.size() < MaxEvents) {
+    bool takeJob = o == outages.size() || (j < jobs.size() && jobs[j].at <= outages[o].at);
+    script.push_back(takeJob ? jobs[j++] : outages[o++]);
+  }
+  return script;
+}
+
+uint32_t nameHash(const String& name) {
+  uint32_t hash = 2166136261u;
+  for (unsigned i = 0; i < name.length(); i++) hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+  return hash;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Responses
+ *
+ *----------------------------------------------------------------------------*/
+
+void append(std::string& s, const char* format, ...) __attribute__((format(printf, 2, 3)));
+void append(std::string& s, const char* format, ...) {
+  char buf[512];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+  if (length > 0) s.append(buf, std::min((size_t)length, sizeof(buf) - 1));
+}
+
+void octoJob(MockPrintClient& p, std::string& body) {
+  PrintClient::State state = p.getState();
+  String name = p.getFilename();
+  uint32_t total = p.getElapsedTime() + p.getPrintTimeLeft();
+  uint32_t size = 200000 + nameHash(name) % 4000000;
+  body = "{\"job\":{\"averagePrintTime\":null,";
+  if (name.isEmpty()) {
+    body += "\"estimatedPrintTime\":null,\"filament\":null,\"file\":{\"date\":null,\"display\":null,"
+            "\"name\":null,\"origin\":null,\"path\":null,\"size\":null},";
+  } else {
+    append(body, "\"estimatedPrintTime\":%u,\"filament\":{\"tool0\":{\"length\":%u,\"volume\":0}},",
+        total, p.getFilamentLength());
+    append(body, "\"file\":{\"date\":%u,\"display\":\"%s\",\"name\":\"%s\",\"origin\":\"local\",\"path\":\"%s\",\"size\":%u},",
+        1700000000u + nameHash(name) % 10000000, name.c_str(), name.c_str(), name.c_str(), size);
+  }
+  body += "\"lastPrintTime\":null,\"user\":\"emulator\"},";
+  if (state == PrintClient::State::Printing || state == PrintClient::State::Complete) {
+    float pct = p.getPctComplete();
+    append(body, "\"progress\":{\"completion\":%.2f,\"filepos\":%u,\"printTime\":%u,\"printTimeLeft\":%u,"
+        "\"printTimeLeftOrigin\":\"estimate\"},",
+        pct, (uint32_t)(size * pct / 100), p.getElapsedTime(), p.getPrintTimeLeft());
+  } else {
+    body += "\"progress\":{\"completion\":null,\"filepos\":null,\"printTime\":null,\"printTimeLeft\":null},";
+  }
+  append(body, "\"state\":\"%s\"}", state == PrintClient::State::Printing ? "Printing" : "Operational");
+}
+
+void octoPrinter(MockPrintClient& p, std::string& body) {
+  bool printing = p.getState() == PrintClient::State::Printing;
+  float bedActual, bedTarget, toolActual, toolTarget;
+  p.getBedTemps(bedActual, bedTarget);
+  p.getToolTemps(toolActual, toolTarget);
+  body.clear();
+  append(body, "{\"state\":{\"error\":\"\",\"flags\":{\"cancelling\":false,\"closedOrError\":false,\"error\":false,"
+      "\"finishing\":false,\"operational\":true,\"paused\":false,\"pausing\":false,\"printing\":%s,"
+      "\"ready\":%s,\"resuming\":false,\"sdReady\":false},\"text\":\"%s\"},",
+      printing ? "true" : "false", printing ? "false" : "true", printing ? "Printing" : "Operational");
+  append(body, "\"temperature\":{\"bed\":{\"actual\":%.2f,\"offset\":0,\"target\":%.1f},"
+      "\"tool0\":{\"actual\":%.2f,\"offset\":0,\"target\":%.1f}}}",
+      bedActual, bedTarget, toolActual, toolTarget);
+}
+
+void rrStatus(MockPrintClient& p, std::string& body) {
+  bool printing = p.getState() == PrintClient::State::Printing;
+  float bedActual, bedTarget, toolActual, toolTarget;
+  p.getBedTemps(bedActual, bedTarget);
+  p.getToolTemps(toolActual, toolTarget);
+  uint32_t left = printing ? p.getPrintTimeLeft() : 0;
+  body.clear();
+  append(body, "{\"status\":\"%c\",\"coords\":{\"axesHomed\":[1,1,1],\"xyz\":[120.0,100.0,%.2f]},",
+      printing ? 'P' : 'I', printing ? p.getPctComplete() / 4 : 0.0f);
+  append(body, "\"temps\":{\"bed\":{\"current\":%.1f,\"active\":%.1f,\"standby\":0.0,\"state\":2,\"heater\":0},"
+      "\"current\":[%.1f,%.1f,2000.0,2000.0,2000.0,2000.0,2000.0,2000.0],\"state\":[2,2,0,0,0,0,0,0],"
+      "\"tools\":{\"active\":[[%.1f]],\"standby\":[[0.0]]}},",
+      bedActual, bedTarget, bedActual, toolActual, toolTarget);
+  if (printing) {
+    append(body, "\"fractionPrinted\":%.1f,\"printDuration\":%u.0,\"warmUpDuration\":0.0,"
+        "\"timesLeft\":{\"file\":%u.0,\"filament\":%u.0,\"layer\":%u.0}}",
+        p.getPctComplete(), p.getElapsedTime(), left, left, left);
+  } else {
+    body += "\"fractionPrinted\":0.0,\"printDuration\":0.0,\"warmUpDuration\":0.0}";
+  }
+}
+
+void rrFileInfo(MockPrintClient& p, std::string& body) {
+  String name = p.getFilename();
+  body.clear();
+  if (name.isEmpty() || p.getState() != PrintClient::State::Printing) { body = "{\"err\":1}"; return; }
+  append(body, "{\"err\":0,\"size\":%u,\"lastModified\":\"2024-01-01T00:00:00\",\"height\":20.0,"
+      "\"firstLayerHeight\":0.2,\"layerHeight\":0.2,\"printTime\":%u,\"filament\":[%u],",
+      200000 + nameHash(name) % 4000000, p.getElapsedTime() + p.getPrintTimeLeft(), p.getFilamentLength());
+  append(body, "\"fileName\":\"0:/gcodes/%s\",\"generatedBy\":\"emulator\"}", name.c_str());
+}
+
+// A stand-in webcam frame: JPEG's start and end markers around a line that
+// names the printer and the path it was fetched from, padded to a frame's size
+void webcamFrame(uint16_t i, const std::string& path, std::string& body) {
+  body = "\xff\xd8";
+  append(body, "emulator printer %u %s\n", i, path.c_str());
+  body.resize(WebcamFrameSize - 2, '.');
+  body += "\xff\xd9";
+}
+
+// `body` compressed as gzip or zlib (what HTTP calls deflate)
+std::string compress(const std::string& body, bool gzip) {
+  z_stream z = {};
+  // 15 bits of window; 16 more asks for a gzip wrapper instead of zlib's
+  if (deflateInit2(&z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, gzip ? 15 + 16 : 15, 8, Z_DEFAULT_STRATEGY) != Z_OK) return "";
+  std::string out(deflateBound(&z, body.size()) + 32, '\0');
+  z.next_in = (Bytef*)body.data();
+  z.avail_in = body.size();
+  z.next_out = (Bytef*)&out[0];
+  z.avail_out = out.size();
+  bool ok = deflate(&z, Z_FINISH) == Z_STREAM_END;
+  out.resize(ok ? z.total_out : 0);
+  deflateEnd(&z);
+  return out;
+}
+
+// The response to printer i's request for `path`, or false if the connection
+// should just be closed. `encoding` is "gzip", "deflate", or nullptr to send
+// the body as is.
+bool respond(MockPrintClient& p, uint16_t i, const std::string& path, const char* encoding, std::string& response) {
+  p.updateState();
+  if (p.getState() == PrintClient::State::Offline) return false;
+
+  std::string body;
+  auto is = [&](const char* prefix) { return path.compare(0, strlen(prefix), prefix) == 0; };
+  if (is("/webcam")) {
+    // Images are sent as they are
+    webcamFrame(i, path, body);
+    response.clear();
+    append(response, "HTTP/1.1 200 OK\r\nContent-Type: image/jpeg\r\nContent-Length: %zu\r\n"
+        "Connection: close\r\n\r\n", body.size());
+    response += body;
+    return true;
+  }
+  if (is("/api/job")) octoJob(p, body);
+  else if (is("/api/printer")) octoPrinter(p, body);
+  else if (is("/rr_connect")) body = "{\"err\":0,\"sessionTimeout\":8000,\"boardType\":\"emulator\"}";
+  else if (is("/rr_disconnect")) body = "{\"err\":0}";
+  else if (is("/rr_status")) rrStatus(p, body);
+  else if (is("/rr_fileinfo")) rrFileInfo(p, body);
+  else {
+    response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    return true;
+  }
+  if (encoding) body = compress(body, strcmp(encoding, "gzip") == 0);
+  response.clear();
+  append(response, "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %zu\r\n", body.size());
+  if (encoding) append(response, "Content-Encoding: %s\r\n", encoding);
+  response += "Connection: close\r\n\r\n";
+  response += body;
+  return true;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Connections
+ *
+ *----------------------------------------------------------------------------*/
+
+// The fields a MoonrakerClient subscribes to, in the order they are sent
+constexpr int NStatusFields = 9;
+const char* const StatusFields[NStatusFields][2] = {
+  {"print_stats", "state"}, {"print_stats", "filename"}, {"print_stats", "print_duration"},
+  {"print_stats", "filament_used"}, {"display_status", "progress"},
+  {"heater_bed", "temperature"}, {"heater_bed", "target"},
+  {"extruder", "temperature"}, {"extruder", "target"}
+};
+
+struct Connection {
+  int fd;
+  uint16_t printer;
+  std::string request;
+  std::string response;
+  size_t sent = 0;
+  uint32_t respondAt = 0;
+  bool ready = false;       // The response is waiting to be written
+  bool closing = false;
+
+  // ----- Once upgraded to a websocket
+  bool websocket = false;
+  bool closeWhenSent = false;
+  bool klippyReady = false;             // As last announced to the client
+  bool subscribed = false;
+  std::string frames;                   // Received, not yet parsed into frames
+  std::string message;                  // A fragmented message being reassembled
+  std::string status[NStatusFields];    // Each field's JSON, as last sent
+  uint32_t nextStatus = 0, nextProcStat = 0, nextPing = 0, nextLarge = 0;
+};
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Moonraker
+ *
+ *----------------------------------------------------------------------------*/
+
+constexpr uint32_t StatusInterval = 250;       // ms; Moonraker batches changes like this
+constexpr uint32_t ProcStatInterval = 1000;
+constexpr uint32_t PingInterval = 5000;
+constexpr uint32_t LargeInterval = 10000;
+constexpr size_t LargeMessageSize = 6000;     // More than WebSocket::MaxMessageSize
+
+uint32_t rol(uint32_t x, int n) { return (x << n) | (x >> (32 - n)); }
+
+// SHA-1, which the handshake's Sec-WebSocket-Accept is made from
+void sha1(const std::string& data, uint8_t digest[20]) {
+  uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+  std::string m = data;
+  uint64_t bits = (uint64_t)data.size() * 8;
+  m += (char)0x80;
+  while (m.size() % 64 != 56) m += (char)0;
+  for (int i = 7; i >= 0; i--) m += (char)(bits >> (i * 8));
+  for (size_t chunk = 0; chunk < m.size(); chunk += 64) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+      const uint8_t* b = (const uint8_t*)&m[chunk + 4 * i];
+      w[i] = (uint32_t)b[0] << 24 | (uint32_t)b[1] << 16 | (uint32_t)b[2] << 8 | b[3];
+    }
+    for (int i = 16; i < 80; i++) w[i] = rol(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+      uint32_t f, k;
+      if (i < 20) { f = (b & c) | (~b & d); k = 0x5A827999; }
+      else if (i < 40) { f = b ^ c ^ d; k = 0x6ED9EBA1; }
+      else if (i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+      else { f = b ^ c ^ d; k = 0xCA62C1D6; }
+      uint32_t t = rol(a, 5) + f + e + k + w[i];
+      e = d; d = c; c = rol(b, 30); b = a; a = t;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+  }
+  for (int i = 0; i < 20; i++) digest[i] = h[i / 4] >> (24 - 8 * (i % 4));
+}
+
+std::string base64(const uint8_t* data, size_t length) {
+  static const char Digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  for (size_t i = 0; i < length; i += 3) {
+    uint32_t v = data[i] << 16 | (i + 1 < length ? data[i + 1] << 8 : 0) | (i + 2 < length ? data[i + 2] : 0);
+    out += Digits[(v >> 18) & 63];
+    out += Digits[(v >> 12) & 63];
+    out += (i + 1 < length) ? Digits[(v >> 6) & 63] : '=';
+    out += (i + 2 < length) ? Digits[v & 63] : '=';
+  }
+  return out;
+}
+
+// The value of a request header, or "" if it is missing. Names are compared
+// without regard to case.
+std::string header(const std::string& request, const char* name) {
+  size_t nameLength = strlen(name);
+  for (size_t line = request.find("\r\n"); line != std::string::npos; line = request.find("\r\n", line + 2)) {
+    size_t start = line + 2;
+    if (strncasecmp(request.c_str() + start, name, nameLength) != 0 || request[start + nameLength] != ':') continue;
+    start += nameLength + 1;
+    while (request[start] == ' ') start++;
+    return request.substr(start, request.find("\r\n", start) - start);
+  }
+  return "";
+}
+
+// Where the value of `"key":` starts in a JSON message, or npos
+size_t findValue(const std::string& json, const char* key) {
+  std::string quoted = std::string("\"") + key + "\"";
+  size_t p = json.find(quoted);
+  if (p == std::string::npos) return p;
+  p += quoted.size();
+  while (p < json.size() && (json[p] == ' ' || json[p] == ':')) p++;
+  return p;
+}
+
+// Server frames are not masked
+void appendFrame(std::string& out, uint8_t opcode, bool fin, const std::string& payload) {
+  out += (char)((fin ? 0x80 : 0) | opcode);
+  size_t length = payload.size();
+  if (length < 126) {
+    out += (char)length;
+  } else if (length <= 0xffff) {
+    out += (char)126;
+    out += (char)(length >> 8);
+    out += (char)length;
+  } else {
+    out += (char)127;
+    for (int i = 7; i >= 0; i--) out += (char)((uint64_t)length >> (i * 8));
+  }
+  out += payload;
+}
+
+void moonrakerStatus(MockPrintClient& p, std::string values[NStatusFields]) {
+  const char* state = "standby";
+  if (p.getState() == PrintClient::State::Printing) state = "printing";
+  else if (p.getState() == PrintClient::State::Complete) state = "complete";
+  float bedActual, bedTarget, toolActual, toolTarget;
+  p.getBedTemps(bedActual, bedTarget);
+  p.getToolTemps(toolActual, toolTarget);
+  for (int i = 0; i < NStatusFields; i++) values[i].clear();
+  append(values[0], "\"%s\"", state);
+  append(values[1], "\"%s\"", p.getFilename().c_str());
+  append(values[2], "%u.0", p.getElapsedTime());
+  append(values[3], "%u.0", p.getFilamentLength());
+  append(values[4], "%.4f", p.getPctComplete() / 100);
+  append(values[5], "%.2f", bedActual);
+  append(values[6], "%.1f", bedTarget);
+  append(values[7], "%.2f", toolActual);
+  append(values[8], "%.1f", toolTarget);
+}
+
+// The status object holding each field whose value differs from `last`, which
+// is then updated. Returns "" if nothing changed.
+std::string statusChanges(const std::string values[NStatusFields], std::string last[NStatusFields]) {
+  std::string status;
+  const char* object = nullptr;
+  for (int i = 0; i < NStatusFields; i++) {
+    if (values[i] == last[i]) continue;
+    last[i] = values[i];
+    if (object != StatusFields[i][0]) {
+      status += object ? "}," : "{";
+      object = StatusFields[i][0];
+      append(status, "\"%s\":{", object);
+    } else {
+      status += ',';
+    }
+    append(status, "\"%s\":%s", StatusFields[i][1], values[i].c_str());
+  }
+  if (object) status += "}}";
+  return status;
+}
+
+void queueText(Connection& c, const std::string& message) { appendFrame(c.response, 0x1, true, message); }
+
+void queueProcStat(Connection& c, std::minstd_rand& rng) {
+  float t = millis() / 1000.0f;
+  std::string m = "{\"jsonrpc\":\"2.0\",\"method\":\"notify_proc_stat_update\",\"params\":[{";
+  append(m, "\"moonraker_stats\":{\"time\":%.3f,\"cpu_usage\":%.2f,\"memory\":%u,\"mem_units\":\"kB\"},"
+      "\"cpu_temp\":%.2f,", t, 1.5f + rng() % 300 / 100.0f, 41000 + (unsigned)(rng() % 200), 45.0f + rng() % 500 / 100.0f);
+  append(m, "\"network\":{\"lo\":{\"rx_bytes\":%u,\"tx_bytes\":%u,\"bandwidth\":%.2f},"
+      "\"wlan0\":{\"rx_bytes\":%u,\"tx_bytes\":%u,\"bandwidth\":%.2f}},",
+      (unsigned)(t * 9000), (unsigned)(t * 9000), 9000.0f, (unsigned)(t * 31000), (unsigned)(t * 52000), 52000.0f);
+  append(m, "\"system_cpu_usage\":{\"cpu\":%.2f,\"cpu0\":%.2f,\"cpu1\":%.2f,\"cpu2\":%.2f,\"cpu3\":%.2f},"
+      "\"system_memory\":{\"total\":3906732,\"available\":%u,\"used\":%u},\"websocket_connections\":1}]}",
+      rng() % 2000 / 100.0f, rng() % 2000 / 100.0f, rng() % 2000 / 100.0f, rng() % 2000 / 100.0f,
+      rng() % 2000 / 100.0f, 3391288 - (unsigned)(rng() % 1000), 515444 + (unsigned)(rng() % 1000));
+  queueText(c, m);
+}
+
+void handleRpc(Connection& c, MockPrintClient& p, const std::string& request, bool verbose) {
+  size_t idAt = findValue(request, "id");
+  long id = (idAt == std::string::npos) ? 0 : atol(request.c_str() + idAt);
+  size_t methodAt = findValue(request, "method");
+  std::string method;
+  if (methodAt != std::string::npos && request[methodAt] == '"') {
+    method = request.substr(methodAt + 1, request.find('"', methodAt + 1) - methodAt - 1);
+  }
+  if (verbose) fprintf(stderr, "emulator: %u websocket %s\n", c.printer, method.c_str());
+
+  std::string reply = "{\"jsonrpc\":\"2.0\",";
+  if (method != "printer.objects.subscribe") {
+    reply += "\"error\":{\"code\":-32601,\"message\":\"Method not found\"}";
+  } else if (!c.klippyReady) {
+    reply += "\"error\":{\"code\":503,\"message\":\"Klippy Disconnected\"}";
+  } else {
+    // The current value of every field
+    std::string values[NStatusFields];
+    moonrakerStatus(p, values);
+    for (int i = 0; i < NStatusFields; i++) c.status[i].clear();
+    append(reply, "\"result\":{\"eventtime\":%.3f,\"status\":", millis() / 1000.0f);
+    reply += statusChanges(values, c.status);
+    reply += '}';
+    c.subscribed = true;
+  }
+  append(reply, ",\"id\":%ld}", id);
+
+  // In two fragments, with a ping in the middle
+  size_t half = reply.size() / 2;
+  appendFrame(c.response, 0x1, false, reply.substr(0, half));
+  appendFrame(c.response, 0x9, true, "emulator");
+  appendFrame(c.response, 0x0, true, reply.substr(half));
+}
+
+// Parse and act on each complete frame the client has sent
+void readFrames(Connection& c, MockPrintClient& p, bool verbose) {
+  while (!c.closeWhenSent) {
+    const uint8_t* b = (const uint8_t*)c.frames.data();
+    size_t available = c.frames.size();
+    if (available < 2) return;
+    bool fin = b[0] & 0x80;
+    uint8_t opcode = b[0] & 0x0f;
+    uint64_t length = b[1] & 0x7f;
+    size_t pos = 2;
+    if (length >= 126) {
+      size_t extLength = (length == 126) ? 2 : 8;
+      if (available < pos + extLength) return;
+      length = 0;
+      for (size_t i = 0; i < extLength; i++) length = (length << 8) | b[pos + i];
+      pos += extLength;
+    }
+    if (!(b[1] & 0x80)) { c.closing = true; return; }     // Frames from a client must be masked
+    if (available < pos + 4 + length) return;
+    const uint8_t* mask = b + pos;
+    pos += 4;
+    std::string payload(length, '\0');
+    for (size_t i = 0; i < length; i++) payload[i] = b[pos + i] ^ mask[i & 3];
+    c.frames.erase(0, pos + length);
+
+    switch (opcode) {
+      case 0x8: appendFrame(c.response, 0x8, true, ""); c.closeWhenSent = true; break;
+      case 0x9: appendFrame(c.response, 0xA, true, payload); break;
+      case 0x0:
+      case 0x1:
+        c.message += payload;
+        if (fin) { handleRpc(c, p, c.message, verbose); c.message.clear(); }
+        break;
+      default: break;     // Pongs, and binary messages, which Moonraker doesn't take
+    }
+  }
+}
+
+// Send whatever has come due: changes in the printer's status, and the other
+// notifications
+void tickWebSocket(Connection& c, MockPrintClient& p, uint32_t now, std::minstd_rand& rng) {
+  if ((int32_t)(now - c.nextStatus) >= 0) {
+    c.nextStatus = now + StatusInterval;
+    p.updateState();
+    bool ready = p.getState() != PrintClient::State::Offline;
+    if (ready != c.klippyReady) {
+      c.klippyReady = ready;
+      c.subscribed = false;
+      std::string m = "{\"jsonrpc\":\"2.0\",\"method\":\"";
+      m += ready ? "notify_klippy_ready" : "notify_klippy_disconnected";
+      m += "\"}";
+      queueText(c, m);
+    } else if (c.subscribed) {
+      std::string values[NStatusFields];
+      moonrakerStatus(p, values);
+      std::string changes = statusChanges(values, c.status);
+      if (!changes.empty()) {
+        std::string m = "{\"jsonrpc\":\"2.0\",\"method\":\"notify_status_update\",\"params\":[";
+        m += changes;
+        append(m, ",%.3f]}", millis() / 1000.0f);
+        queueText(c, m);
+      }
+    }
+  }
+  if ((int32_t)(now - c.nextProcStat) >= 0) {
+    c.nextProcStat = now + ProcStatInterval;
+    queueProcStat(c, rng);
+  }
+  if ((int32_t)(now - c.nextPing) >= 0) {
+    c.nextPing = now + PingInterval;
+    appendFrame(c.response, 0x9, true, "emulator");
+  }
+  if ((int32_t)(now - c.nextLarge) >= 0) {
+    c.nextLarge = now + LargeInterval;
+    std::string m = "{\"jsonrpc\":\"2.0\",\"method\":\"notify_gcode_response\",\"params\":[\"// ";
+    m.append(LargeMessageSize, 'x');
+    m += "\"]}";
+    queueText(c, m);
+  }
+}
+
+// Answer the upgrade request with its handshake, or return false if it isn't one
+bool upgrade(Connection& c, MockPrintClient& p, size_t headerEnd, uint32_t now) {
+  std::string key = header(c.request, "Sec-WebSocket-Key");
+  if (key.empty() || strcasecmp(header(c.request, "Upgrade").c_str(), "websocket") != 0) return false;
+  uint8_t digest[20];
+  sha1(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11", digest);
+  c.response = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+               "Sec-WebSocket-Accept: " + base64(digest, sizeof(digest)) + "\r\n\r\n";
+  c.websocket = true;
+  c.frames = c.request.substr(headerEnd + 4);
+  c.request.clear();
+  p.updateState();
+  c.klippyReady = p.getState() != PrintClient::State::Offline;
+  c.nextStatus = now + StatusInterval;
+  c.nextProcStat = now + ProcStatInterval;
+  c.nextPing = now + PingInterval;
+  c.nextLarge = now + LargeInterval;
+  return true;
+}
+
+uint32_t responseDelay(const EmulatorConfig& config, std::minstd_rand& rng) {
+  return config.latency + (config.jitter ? rng() % (config.jitter + 1) : 0);
+}
+
+// How long `bytes` take to send at the configured bandwidth
+uint32_t transmitTime(const EmulatorConfig& config, size_t bytes) {
+  return config.bandwidth ? (uint64_t)bytes * 1000 / config.bandwidth : 0;
+}
+
+// The encoding printer `i` answers a request with, given its Accept-Encoding
+const char* chooseEncoding(const EmulatorConfig& config, uint16_t i, const std::string& accepted) {
+  if (!config.compress) return nullptr;
+  bool gzip = strcasestr(accepted.c_str(), "gzip"), deflate = strcasestr(accepted.c_str(), "deflate");
+  if (gzip && (i % 2 == 0 || !deflate)) return "gzip";
+  return deflate ? "deflate" : nullptr;
+}
+
+void serviceWebSocket(
+    Connection& c, MockPrintClient& p, short revents, uint32_t now,
+    const EmulatorConfig& config, std::minstd_rand& rng)
+{
+  if (revents & POLLIN) {
+    char buf[1024];
+    ssize_t n = read(c.fd, buf, sizeof(buf));
+    if (n <= 0) { c.closing = true; return; }
+    c.frames.append(buf, n);
+    // Replies wait out the latency, unless something is ahead of them already
+    bool idle = c.response.empty();
+    readFrames(c, p, config.verbose);
+    if (idle && !c.response.empty()) c.respondAt = now + responseDelay(config, rng);
+  }
+  if (!c.closeWhenSent) tickWebSocket(c, p, now, rng);
+  if (revents & POLLOUT) {
+    ssize_t n = write(c.fd, c.response.data() + c.sent, c.response.size() - c.sent);
+    if (n < 0) { if (errno != EAGAIN) c.closing = true; return; }
+    c.sent += n;
+    if (c.sent == c.response.size()) {
+      c.response.clear();
+      c.sent = 0;
+      if (c.closeWhenSent) c.closing = true;
+    }
+  }
+  c.ready = !c.response.empty();
+}
+
+int listenOn(const char* address, uint16_t port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return -1;
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if (inet_pton(AF_INET, address, &addr.sin_addr) != 1 ||
+      bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 64) != 0) {
+    fprintf(stderr, "emulator: unable to listen on %s:%u: %s\n", address, port, strerror(errno));
+    close(fd);
+    return -1;
+  }
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  return fd;
+}
+
+}  // namespace
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Public functions
+ *
+ *----------------------------------------------------------------------------*/
+
+void emulatorAddress(uint16_t i, char* address, size_t size) {
+  snprintf(address, size, "127.0.%u.%u", 1 + i / 254, 1 + i % 254);
+}
+
+bool runEmulator(const EmulatorConfig& config) {
+  uint32_t start = millis();
+  uint32_t speed = config.speed;
+  MockClock clock = [start, speed]() { return (millis() - start) * speed; };
+
+  std::vector<Printer> printers(config.printers);
+  for (uint16_t i = 0; i < config.printers; i++) {
+    Printer& p = printers[i];
+    MockRandom rng;
+    rng.seed(config.seed * 7919 + i);
+    p.silent = i >= config.printers - config.offline;
+    p.script = makeScript(rng.next(), (uint32_t)rng.range(0, 100) < config.flaky);
+    p.mock.reset(new MockPrintClient(config.seed + i, clock, p.script.data(), p.script.size()));
+    char address[16];
+    if (config.portPerPrinter) p.listener = listenOn(config.address, config.port + i);
+    else { emulatorAddress(i, address, sizeof(address)); p.listener = listenOn(address, config.port); }
+    if (p.listener < 0) return false;
+  }
+
+  std::minstd_rand rng(config.seed);
+  std::vector<Connection> connections;
+  std::vector<struct pollfd> fds;
+  while (true) {
+    uint32_t now = millis();
+    int timeout = 1000;
+    fds.clear();
+    for (Printer& p : printers) fds.push_back({p.listener, POLLIN, 0});
+    for (Connection& c : connections) {
+      short events = POLLIN;    // A request, or the client closing a silent connection
+      if (c.ready) {
+        int32_t wait = (int32_t)(c.respondAt - now);
+        if (wait <= 0) events = c.websocket ? (POLLIN | POLLOUT) : POLLOUT;
+        else if (wait < timeout) timeout = wait;
+      }
+      if (c.websocket) {
+        // The other timers are checked at each status tick
+        int32_t wait = (int32_t)(c.nextStatus - now);
+        timeout = std::max(0, std::min(timeout, wait));
+      }
+      fds.push_back({c.fd, events, 0});
+    }
+    if (poll(fds.data(), fds.size(), timeout) < 0 && errno != EINTR) return false;
+    now = millis();
+
+    // Service the existing connections first, since accepting changes the list
+    for (size_t k = 0; k < connections.size(); k++) {
+      Connection& c = connections[k];
+      short revents = fds[printers.size() + k].revents;
+      if (revents & (POLLERR | POLLHUP | POLLNVAL)) { c.closing = true; continue; }
+      if (c.websocket) {
+        serviceWebSocket(c, *printers[c.printer].mock, revents, now, config, rng);
+        continue;
+      }
+      if (revents & POLLIN) {
+        char buf[1024];
+        ssize_t n = read(c.fd, buf, sizeof(buf));
+        if (n <= 0) { c.closing = true; continue; }
+        if (c.ready || printers[c.printer].silent) continue;
+        c.request.append(buf, n);
+        size_t end = c.request.find("\r\n\r\n");
+        if (end == std::string::npos) continue;
+        size_t pathStart = c.request.find(' ') + 1;
+        std::string path = c.request.substr(pathStart, c.request.find(' ', pathStart) - pathStart);
+        bool lost = config.loss && rng() % 100 < config.loss;
+        MockPrintClient& mock = *printers[c.printer].mock;
+        bool upgraded = !lost && path == "/websocket" && upgrade(c, mock, end, now);
+        const char* encoding = chooseEncoding(config, c.printer, header(c.request, "Accept-Encoding"));
+        if (!upgraded && (lost || !respond(mock, c.printer, path, encoding, c.response))) {
+          if (config.verbose) fprintf(stderr, "emulator: %u %s: %s\n", c.printer, path.c_str(), lost ? "lost" : "offline");
+          c.closing = true;
+          continue;
+        }
+        if (config.verbose) {
+          fprintf(stderr, "emulator: %u %s%s%s\n", c.printer, path.c_str(),
+              encoding && !upgraded ? " " : "", encoding && !upgraded ? encoding : "");
+        }
+        c.ready = true;
+        c.respondAt = now + responseDelay(config, rng) + transmitTime(config, c.response.size());
+      } else if (revents & POLLOUT) {
+        ssize_t n = write(c.fd, c.response.data() + c.sent, c.response.size() - c.sent);
+        if (n < 0) { if (errno != EAGAIN) c.closing = true; continue; }
+        c.sent += n;
+        if (c.sent == c.response.size()) c.closing = true;
+      }
+    }
+    for (size_t k = connections.size(); k-- > 0; ) {
+      if (!connections[k].closing) continue;
+      close(connections[k].fd);
+      connections.erase(connections.begin() + k);
+    }
+
+    for (uint16_t i = 0; i < printers.size(); i++) {
+      if (!(fds[i].revents & POLLIN)) continue;
+      int fd;
+      while ((fd = accept(printers[i].listener, nullptr, nullptr)) >= 0) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        Connection c;
+        c.fd = fd;
+        c.printer = i;
+        connections.push_back(std::move(c));
+      }
+    }
+  }
+}
+
+const char* const EmulatorUsage =
+  "  --printers N        Number of printers (8)\n"
+  "  --latency MS        Delay before each response (20)\n"
+  "  --jitter MS         Up to this much more delay (10)\n"
+  "  --loss PCT          Percent of requests answered by closing the connection (0)\n"
+  "  --offline N         The last N printers accept connections but never answer (0)\n"
+  "  --flaky PCT         Percent of printers scripted to go offline now and then (10)\n"
+  "  --speed X           Printer time runs X times faster than real time (60)\n"
+  "  --seed N            Seed for the printers' jobs and scripts (1)\n"
+  "  --no-compress       Send bodies uncompressed, whatever the client accepts\n"
+  "  --bandwidth B       Send each response at B bytes/s (unlimited)\n"
+  "  --port N            Port to listen on (8080)\n";
+
+bool parseEmulatorOption(EmulatorConfig& config, int argc, char** argv, int* i) {
+  const char* option = argv[*i];
+  if (strcmp(option, "--verbose") == 0) { config.verbose = true; return true; }
+  if (strcmp(option, "--no-compress") == 0) { config.compress = false; return true; }
+  if (*i + 1 >= argc) return false;
+  long value = atol(argv[*i + 1]);
+  if (strcmp(option, "--printers") == 0) config.printers = value;
+  else if (strcmp(option, "--latency") == 0) config.latency = value;
+  else if (strcmp(option, "--jitter") == 0) config.jitter = value;
+  else if (strcmp(option, "--loss") == 0) config.loss = value;
+  else if (strcmp(option, "--offline") == 0) config.offline = value;
+  else if (strcmp(option, "--flaky") == 0) config.flaky = value;
+  else if (strcmp(option, "--speed") == 0) config.speed = value;
+  else if (strcmp(option, "--seed") == 0) config.seed = value;
+  else if (strcmp(option, "--port") == 0) config.port = value;
+  else if (strcmp(option, "--bandwidth") == 0) config.bandwidth = value;
+  else return false;
+  (*i)++;
+  return true;
+}
@@ -0,0 +1,60 @@
+/*
+ * Emulator:
+ *    Stands in for a farm of OctoPrint, Duet, and Moonraker printers. Each
+ *    printer is a MockPrintClient, running a script of jobs and outages on a
+ *    clock that can be sped up, and answers the requests the OctoPrint and
+ *    Duet clients make (/api/job, /api/printer, /rr_connect, /rr_status,
+ *    /rr_fileinfo, /rr_disconnect) with its state, and the Moonraker
+ *    client's websocket (/websocket). Every printer answers every protocol,
+ *    and serves a webcam frame at any path under /webcam.
+ *    Bodies are compressed for clients that accept it: even-numbered
+ *    printers send gzip and odd-numbered ones deflate (zlib), if accepted.
+ *
+ *    Printers listen either on their own loopback address (127.0.1.1,
+ *    127.0.1.2, ...; Linux routes all of 127/8 to the loopback interface) or
+ *    on consecutive ports of one address, which is what a device on the
+ *    network needs.
+ *
+ */
+
+#ifndef Emulator_h
+#define Emulator_h
+
+#include <stdint.h>
+
+struct EmulatorConfig {
+  uint16_t printers = 8;
+  // Printers listen on `address`:port if portPerPrinter, else on
+  // 127.0.1.(i+1):port
+  bool portPerPrinter = false;
+  const char* address = "0.0.0.0";
+  uint16_t port = 8080;
+
+  uint32_t latency = 20;      // ms before each response...
+  uint32_t jitter = 10;       // ...plus up to this much more
+  uint8_t loss = 0;           // Percent of requests answered by closing the connection
+  uint16_t offline = 0;       // The last `offline` printers never answer
+  uint8_t flaky = 10;         // Percent of printers whose script takes them offline for a while
+  uint32_t speed = 60;        // Printer time passes this many times faster than real time
+  uint32_t seed = 1;
+  bool compress = true;       // Compress bodies for clients that accept gzip or deflate
+  uint32_t bandwidth = 0;     // Bytes/s each response is sent at, or 0 for as fast as possible
+  bool verbose = false;       // Log each request to stderr
+};
+
+// The address of printer `i` when each printer has its own address
+void emulatorAddress(uint16_t i, char* address, size_t size);
+
+// Serve requests until the process is killed. Returns false if a listener
+// can't be set up.
+bool runEmulator(const EmulatorConfig& config);
+
+// Parse the emulator's command line options (--printers N, --latency MS,
+// ...) into `config`. `argv[*i]` is the option; its value, if any, is
+// consumed. Returns false if it isn't an emulator option.
+bool parseEmulatorOption(EmulatorConfig& config, int argc, char** argv, int* i);
+
+// One line per emulator option, for a usage message
+extern const char* const EmulatorUsage;
+
+#endif  // Emulator_h
@@ -0,0 +1,95 @@
+/*
+ * eventlog_dump:
+ *    Decodes the output of EventLog::write() (see BPA_EventLog.h), one line
+ *    per event, oldest first. Reads the file named on the command line, or
+ *    standard input. Times are the device's millis(), shown as seconds.
+ *
+ *    usage: eventlog_dump [--printer N] [FILE]
+ *
+ */
+
+#include <stdlib.h>
+#include <vector>
+#include <Arduino.h>
+#include "BPA_EventLog.h"
+#include "BPA_JobLog.h"
+#include "BPA_Crc32.h"
+
+static const char* stateName(unsigned state) {
+  static const char* names[] = {"Offline", "Operational", "Complete", "Printing"};
+  return state < 4 ? names[state] : "?";
+}
+
+static uint32_t u32(const uint8_t* p) {
+  return p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void printEvent(const uint8_t* p) {
+  EventLog::Event e;
+  e.time = u32(p);
+  e.printer = p[4];
+  e.id = p[5];
+  e.a = p[6] | (p[7] << 8);
+  e.b = u32(p + 8);
+  e.c = u32(p + 12);
+
+  printf("%10.3f  %3u  ", e.time / 1000.0, e.printer);
+  switch (e.id) {
+    case EventLog::Event_Poll:
+      printf("poll      %-11s %3u%%  %5u ms  %us left\n", stateName(e.a & 0xff), e.a >> 8, e.b, e.c);
+      break;
+    case EventLog::Event_StateChange:
+      printf("state     %s -> %s\n", stateName(e.a & 0xff), stateName(e.a >> 8));
+      break;
+    case EventLog::Event_JobEnd:
+      printf("job end   %-9s  %us  %umm\n", e.a == JobLog::Completed ? "completed" : "failed", e.b, e.c);
+      break;
+    default:
+      printf("event %u   a=%u b=%u c=%u\n", e.id, e.a, e.b, e.c);
+      break;
+  }
+}
+
+int main(int argc, char** argv) {
+  int onlyPrinter = -1;
+  const char* path = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--printer") == 0 && i + 1 < argc) onlyPrinter = atoi(argv[++i]);
+    else if (path == nullptr && argv[i][0] != '-') path = argv[i];
+    else { fprintf(stderr, "usage: %s [--printer N] [FILE]\n", argv[0]); return 2; }
+  }
+
+  FILE* in = path ? fopen(path, "rb") : stdin;
+  if (in == nullptr) { perror(path); return 1; }
+  std::vector<uint8_t> data;
+  uint8_t buf[4096];
+  for (size_t n; (n = fread(buf, 1, sizeof(buf), in)) > 0; ) data.insert(data.end(), buf, buf + n);
+  if (in != stdin) fclose(in);
+
+  const size_t HeaderSize = 8, TrailerSize = 4;
+  if (data.size() < HeaderSize + TrailerSize || memcmp(data.data(), "BPE", 3) != 0) {
+    fprintf(stderr, "Not an EventLog dump (%zu bytes)\n", data.size());
+    return 1;
+  }
+  if (data[3] != EventLog::Version) {
+    fprintf(stderr, "EventLog version %u; this tool reads version %u\n", data[3], EventLog::Version);
+    return 1;
+  }
+  uint16_t nEvents = data[4] | (data[5] << 8);
+  size_t expected = HeaderSize + nEvents * sizeof(EventLog::Event) + TrailerSize;
+  if (data.size() != expected) {
+    fprintf(stderr, "The dump is %zu bytes; %u events need %zu\n", data.size(), nEvents, expected);
+    return 1;
+  }
+  if (u32(&data[expected - TrailerSize]) != Crc32::of(data.data(), expected - TrailerSize)) {
+    fprintf(stderr, "CRC mismatch; the dump is corrupted\n");
+    return 1;
+  }
+
+  printf("%u events\n\n%10s  %3s  %s\n", nEvents, "time (s)", "#", "event");
+  for (uint16_t i = 0; i < nEvents; i++) {
+    const uint8_t* p = &data[HeaderSize + i * sizeof(EventLog::Event)];
+    if (onlyPrinter < 0 || p[4] == onlyPrinter) printEvent(p);
+  }
+  return 0;
+}
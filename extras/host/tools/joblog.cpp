@@ -0,0 +1,165 @@
+/*
+ * joblog:
+ *    Reads a JobLog (see BPA_JobLog.h) copied off a device, and benchmarks
+ *    the log with a large number of records.
+ *
+ *    read:   Lists every valid record from oldest to newest, then the jobs
+ *            per printer in the last few days (counted back from the newest
+ *            record, since the device's clock isn't known here). ROOT is the
+ *            directory holding the copy of the device's file system.
+ *    bench:  Appends N records to a new log in a temporary directory, then
+ *            times reopening it, visiting every record, and counting jobs
+ *            per printer.
+ *
+ *    usage: joblog read ROOT [--dir D] [--segments N] [--records N] [--days D]
+ *           joblog bench [--jobs N]
+ *
+ */
+
+#include <stdlib.h>
+#include <time.h>
+#include <chrono>
+#include <functional>
+#include <Arduino.h>
+#include <ArduinoLog.h>
+#include <FS.h>
+#include "BPA_JobLog.h"
+
+static const char* Usage =
+  "usage: %s read ROOT [options]   List the log under ROOT (a copy of the device's file system)\n"
+  "         --dir D          The log's directory (/jobs)\n"
+  "         --segments N     Segments the log was created with (8)\n"
+  "         --records N      Records per segment it was created with (64)\n"
+  "         --days D         Count jobs per printer over the last D days (7)\n"
+  "       %s bench [--jobs N]  Time a log holding N jobs (100000)\n";
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static const char* formatTime(uint32_t t, char* buf, size_t size) {
+  time_t tt = t;
+  strftime(buf, size, "%Y-%m-%d %H:%M:%S", gmtime(&tt));
+  return buf;
+}
+
+static int readLog(const char* root, const char* dir, uint8_t segments, uint16_t records, uint32_t days) {
+  FS fs(root);
+  if (!fs.exists(dir)) { fprintf(stderr, "No log at %s%s\n", root, dir); return 1; }
+  JobLog log(fs, dir, segments, records);
+  if (!log.begin()) { fprintf(stderr, "Unable to open the log at %s%s\n", root, dir); return 1; }
+
+  uint32_t count = 0, newest = 0;
+  char start[24], end[24];
+  printf("%-19s  %-19s %7s %9s %10s %-9s %s\n",
+      "start", "end", "printer", "duration", "filament", "outcome", "file");
+  log.forEach([&](const JobLog::Record& r) {
+    printf("%-19s  %-19s %7u %8us %8umm %-9s %s\n",
+        formatTime(r.start, start, sizeof(start)), formatTime(r.end, end, sizeof(end)),
+        r.printer, r.duration, r.filament,
+        r.outcome == JobLog::Completed ? "completed" : "failed", r.file);
+    if (r.end > newest) newest = r.end;
+    count++;
+    return true;
+  });
+  printf("%u records\n", count);
+  if (count == 0) return 0;
+
+  uint16_t perPrinter[256];
+  uint32_t since = newest - days * 24 * 3600;
+  log.countSince(since, perPrinter, 255);
+  printf("\njobs per printer since %s\n", formatTime(since, start, sizeof(start)));
+  for (int i = 0; i < 255; i++) {
+    if (perPrinter[i]) printf("  printer %3d: %u\n", i, perPrinter[i]);
+  }
+  return 0;
+}
+
+static int benchLog(uint32_t jobs) {
+  char root[] = "/tmp/joblog-XXXXXX";
+  if (mkdtemp(root) == nullptr) { perror("mkdtemp"); return 1; }
+  FS fs(root);
+
+  // Enough segments of a size that holds every job, plus one to rotate into
+  const uint8_t Segments = 16;
+  const uint16_t PerSegment = (jobs + Segments - 2) / (Segments - 1);
+  String file;
+  {
+    JobLog log(fs, "/jobs", Segments, PerSegment);
+    log.begin();
+    auto start = std::chrono::steady_clock::now();
+    uint32_t t = 1700000000;
+    for (uint32_t i = 0; i < jobs; i++) {
+      file = "job-";
+      file += i;
+      file += ".gcode";
+      uint32_t duration = 600 + (i * 7919) % 36000;
+      if (!log.append(i % 32, file, t, t + duration, duration, duration / 2,
+              (i % 10) ? JobLog::Completed : JobLog::Failed)) {
+        fprintf(stderr, "append %u failed\n", i);
+        return 1;
+      }
+      t += duration / 4;
+    }
+    double elapsed = secondsSince(start);
+    printf("append       %8u records %9.3f s %10.2f us/record\n", jobs, elapsed, elapsed * 1e6 / jobs);
+  }
+
+  JobLog log(fs, "/jobs", Segments, PerSegment);
+  auto start = std::chrono::steady_clock::now();
+  log.begin();
+  printf("begin        %8s         %9.3f s\n", "", secondsSince(start));
+
+  uint32_t visited = 0;
+  uint64_t filament = 0;
+  start = std::chrono::steady_clock::now();
+  log.forEach([&](const JobLog::Record& r) { visited++; filament += r.filament; return true; });
+  double elapsed = secondsSince(start);
+  printf("forEach      %8u records %9.3f s %10.2f us/record\n", visited, elapsed, elapsed * 1e6 / visited);
+
+  uint16_t perPrinter[32];
+  start = std::chrono::steady_clock::now();
+  log.countSince(0, perPrinter, 32);
+  elapsed = secondsSince(start);
+  uint32_t counted = 0;
+  for (int i = 0; i < 32; i++) counted += perPrinter[i];
+  printf("countSince   %8u records %9.3f s %10.2f us/record\n", counted, elapsed, elapsed * 1e6 / counted);
+
+  bool ok = (visited == jobs && counted == jobs);
+  printf("%u segments of %u records, %zu bytes per record: %s\n",
+      Segments, PerSegment, sizeof(JobLog::Record), ok ? "every record read back" : "RECORDS MISSING");
+
+  String command = "rm -rf ";
+  command += root;
+  if (system(command.c_str()) != 0) fprintf(stderr, "Unable to remove %s\n", root);
+  return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+  Log.begin(LOG_LEVEL_WARNING);
+  if (argc >= 3 && strcmp(argv[1], "read") == 0) {
+    const char* dir = "/jobs";
+    uint32_t segments = JobLog::DefaultSegments, records = JobLog::DefaultRecordsPerSegment, days = 7;
+    for (int i = 3; i + 1 < argc; i += 2) {
+      if (strcmp(argv[i], "--dir") == 0) dir = argv[i + 1];
+      else if (strcmp(argv[i], "--segments") == 0) segments = atol(argv[i + 1]);
+      else if (strcmp(argv[i], "--records") == 0) records = atol(argv[i + 1]);
+      else if (strcmp(argv[i], "--days") == 0) days = atol(argv[i + 1]);
+      else { fprintf(stderr, Usage, argv[0], argv[0]); return 2; }
+    }
+    if (segments < 2 || segments > 255 || records == 0 || records > 65535) {
+      fprintf(stderr, "--segments must be 2 to 255 and --records 1 to 65535\n");
+      return 2;
+    }
+    return readLog(argv[2], dir, segments, records, days);
+  }
+  if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+    uint32_t jobs = 100000;
+    if (argc == 4 && strcmp(argv[2], "--jobs") == 0) jobs = atol(argv[3]);
+    else if (argc != 2) { fprintf(stderr, Usage, argv[0], argv[0]); return 2; }
+    if (jobs == 0 || jobs > 15 * 65535) { fprintf(stderr, "--jobs must be 1 to %u\n", 15 * 65535); return 2; }
+    return benchLog(jobs);
+  }
+  fprintf(stderr, Usage, argv[0], argv[0]);
+  return 2;
+}
@@ -0,0 +1,701 @@
+/*
+ * load_test:
+ *    Runs a PrinterGroup against a farm of emulated printers (see emulator.h)
+ *    for a while, calling refreshPrinterData() the way a device's loop()
+ *    would, and reports:
+ *      o requests/sec made to the printers
+ *      o the wall time of each refresh pass that polled something
+ *      o per printer: polls, poll time, and how stale its data got
+ *
+ *    The emulator runs in a child process, with each printer on its own
+ *    loopback address so that the group doesn't treat them as one host.
+ *
+ *    With --nodes K it tests federation instead (see PrinterGroup::setShard
+ *    and setFederation). K nodes, each a PrinterGroup in its own process
+ *    serving its snapshot at http://127.0.0.1:(9000+k)/snapshot, split the
+ *    printers between them, and a gateway group reads every printer from
+ *    them. It checks that each printer is polled by exactly one node, the
+ *    one nodeForPrinter() names, and that the gateway gets data for every
+ *    printer. It then does the same with K+1 nodes and checks that the only
+ *    printers that changed nodes are the ones the new node took over.
+ *
+ *    With --websocket it checks MoonrakerClient against the emulator's
+ *    Moonraker websocket instead. Each printer is also read over OctoPrint's
+ *    API as a reference. It checks that every client completes the handshake
+ *    and subscribes, that its state matches the reference throughout the run
+ *    (Klipper going away and coming back included, with --flaky), and that
+ *    every client sees the emulator restart and reconnects.
+ *
+ *    With --snapshots it checks PrinterGroup's webcam snapshot proxy against
+ *    the emulator's webcams: that each printer's frame is fetched from the
+ *    path its type is configured with, once for all of its viewers, and that
+ *    one serviceSnapshots() call fetches for no more than one printer, so a
+ *    silent printer (--offline) holds it up for one timeout at most.
+ *
+ *    With --compression it polls the farm twice, first with the emulator
+ *    sending bodies as they are and then compressed, and compares the body
+ *    bytes received per request (what goes over the air), the mean poll time,
+ *    and the wall time of the refresh passes. --bandwidth makes the emulator
+ *    take the time a slow link would to send each response.
+ *
+ *    usage: load_test [--duration S] [--interval S] [--duet PCT] [--moonraker PCT]
+ *                     [--nodes K | --websocket | --compression | --snapshots]
+ *                     [emulator options]
+ *
+ */
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <errno.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include <Arduino.h>
+#include <ArduinoLog.h>
+#include "BPA_Config.h"
+#include "BPA_PrinterGroup.h"
+#include "BPA_RemoteNode.h"
+#include "BPA_OctoClient.h"
+#include "BPA_MoonrakerClient.h"
+#include "emulator.h"
+
+static const char* stateName(PrintClient::State state) {
+  static const char* names[] = {"Offline", "Operational", "Complete", "Printing"};
+  return names[state];
+}
+
+static const char* typeName(const String& type) {
+  if (type == Type_Duet) return "Duet";
+  if (type == Type_Moonraker) return "Moon";
+  return "Octo";
+}
+
+// Printers are given types in the proportions asked for, spread through the
+// farm; the rest are OctoPrint
+static PrinterSettings* makeSettings(const EmulatorConfig& config, uint8_t duetPct, uint8_t moonrakerPct = 0) {
+  uint8_t n = config.printers;
+  PrinterSettings* settings = new PrinterSettings[n];
+  for (int i = 0; i < n; i++) {
+    char address[16];
+    emulatorAddress(i, address, sizeof(address));
+    uint8_t slot = (i * 61) % 100;
+    settings[i].type = (slot < duetPct) ? Type_Duet : (slot < duetPct + moonrakerPct) ? Type_Moonraker : Type_Octo;
+    settings[i].server = address;
+    settings[i].port = config.port;
+    settings[i].apiKey = "emulator";
+    settings[i].nickname = String("Printer ") + i;
+    settings[i].isActive = true;
+  }
+  return settings;
+}
+
+class VectorPrint : public Print {
+public:
+  std::vector<uint8_t> bytes;
+  size_t write(uint8_t c) override { bytes.push_back(c); return 1; }
+  size_t write(const uint8_t* buffer, size_t size) override {
+    bytes.insert(bytes.end(), buffer, buffer + size);
+    return size;
+  }
+};
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Federation
+ *
+ *----------------------------------------------------------------------------*/
+
+#if BPA_ENABLE_REMOTE
+
+static constexpr uint16_t NodeBasePort = 9000;
+
+// Node `self` of `nNodes`: polls its share of the printers and answers every
+// request with its snapshot, until it is killed
+static void runNode(const EmulatorConfig& config, uint8_t duetPct, uint32_t interval, uint8_t self, uint8_t nNodes) {
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(NodeBasePort + self);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(listener, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 16) != 0) {
+    fprintf(stderr, "node %u: unable to listen on port %u: %s\n", self, NodeBasePort + self, strerror(errno));
+    _exit(1);
+  }
+  fcntl(listener, F_SETFL, fcntl(listener, F_GETFL) | O_NONBLOCK);
+
+  uint8_t n = config.printers;
+  PrinterSettings* settings = makeSettings(config, duetPct);
+  PrinterGroup group(n, settings, interval, nullptr);
+  group.setShard(self, nNodes);
+  for (int i = 0; i < n; i++) group.activatePrinter(i);
+  group.refreshPrinterData(true);
+  while (true) {
+    group.refreshPrinterData(false);
+    int fd;
+    while ((fd = accept(listener, nullptr, nullptr)) >= 0) {
+      // The gateway's request is small and arrives at once; read it and answer
+      char request[1024];
+      struct timeval timeout = {1, 0};
+      setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+      if (read(fd, request, sizeof(request)) > 0) {
+        VectorPrint snapshot;
+        group.writeSnapshot(snapshot);
+        char header[96];
+        int length = snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\n"
+            "Connection: close\r\n\r\n", snapshot.bytes.size());
+        if (write(fd, header, length) == length) {
+          if (write(fd, snapshot.bytes.data(), snapshot.bytes.size()) < 0) { }
+        }
+      }
+      close(fd);
+    }
+    delay(10);
+  }
+}
+
+// Runs nNodes nodes and a gateway for `duration` seconds. Fills in which node
+// each printer's record was active on (-1 if none, -2 if more than one), and
+// returns the number of failed checks.
+static int runFederation(
+    const EmulatorConfig& config, uint8_t duetPct, uint32_t interval, uint32_t duration,
+    uint8_t nNodes, std::vector<int>& polledBy)
+{
+  std::vector<pid_t> nodes;
+  for (uint8_t k = 0; k < nNodes; k++) {
+    pid_t pid = fork();
+    if (pid == 0) { runNode(config, duetPct, interval, k, nNodes); _exit(0); }
+    nodes.push_back(pid);
+  }
+  delay(200);
+
+  uint8_t n = config.printers;
+  PrinterSettings* settings = makeSettings(config, duetPct);
+  RemoteNode* remotes = new RemoteNode[nNodes];
+  for (uint8_t k = 0; k < nNodes; k++) remotes[k].init("127.0.0.1", NodeBasePort + k);
+  PrinterGroup* gateway = new PrinterGroup(n, settings, interval, nullptr);
+  gateway->setFederation(remotes, nNodes);
+  for (int i = 0; i < n; i++) gateway->activatePrinter(i);
+
+  uint32_t start = millis();
+  gateway->refreshPrinterData(true);
+  while (millis() - start < duration * 1000) {
+    gateway->refreshPrinterData(false);
+    delay(10);
+  }
+
+  int failures = 0;
+  std::vector<uint8_t> perNode(nNodes, 0);
+  polledBy.assign(n, -1);
+  for (uint8_t k = 0; k < nNodes; k++) {
+    remotes[k].refresh(0);
+    const GroupSnapshot& snapshot = remotes[k].snapshot();
+    if (!snapshot.valid() || snapshot.numberOfPrinters() != n) {
+      printf("FAIL node %u: no valid snapshot of %u printers\n", k, n);
+      failures++;
+      continue;
+    }
+    GroupSnapshot::PrinterView v;
+    int i = 0;
+    for (bool ok = snapshot.first(v); ok; ok = snapshot.next(v), i++) {
+      if (!v.active()) continue;
+      polledBy[i] = (polledBy[i] == -1) ? k : -2;
+      perNode[k]++;
+    }
+  }
+  for (pid_t pid : nodes) kill(pid, SIGTERM);
+  for (pid_t pid : nodes) waitpid(pid, nullptr, 0);
+
+  printf("%u nodes: printers polled by each:", nNodes);
+  for (uint8_t k = 0; k < nNodes; k++) printf(" %u", perNode[k]);
+  printf("\n");
+  int unseen = 0;
+  for (int i = 0; i < n; i++) {
+    int expected = PrinterGroup::nodeForPrinter(settings[i], nNodes);
+    if (polledBy[i] != expected) {
+      printf("FAIL printer %d: polled by %s, expected node %d\n", i,
+          polledBy[i] == -1 ? "no node" : polledBy[i] == -2 ? "more than one node" : String(polledBy[i]).c_str(),
+          expected);
+      failures++;
+    }
+    if (gateway->getStaleness(i) == UINT32_MAX) {
+      printf("FAIL printer %d: the gateway never got its state\n", i);
+      unseen++;
+    }
+  }
+  failures += unseen;
+  printf("%-4s every printer polled by exactly one node, the one nodeForPrinter() names\n",
+      failures - unseen ? "FAIL" : "ok");
+  printf("%-4s the gateway got the state of every printer\n", unseen ? "FAIL" : "ok");
+
+  delete gateway;
+  delete[] remotes;
+  delete[] settings;
+  return failures;
+}
+
+static int testFederation(const EmulatorConfig& config, uint8_t duetPct, uint32_t interval, uint32_t duration, uint8_t nNodes) {
+  std::vector<int> before, after;
+  int failures = runFederation(config, duetPct, interval, duration, nNodes, before);
+  printf("\n");
+  failures += runFederation(config, duetPct, interval, duration, nNodes + 1, after);
+
+  int moved = 0, misplaced = 0;
+  for (size_t i = 0; i < before.size(); i++) {
+    if (before[i] == after[i]) continue;
+    moved++;
+    if (after[i] != nNodes) misplaced++;
+  }
+  printf("%-4s adding node %u moved %d of %zu printers, all of them to the new node\n",
+      misplaced ? "FAIL" : "ok", nNodes, moved, before.size());
+  failures += misplaced;
+  return failures;
+}
+
+#endif  // BPA_ENABLE_REMOTE
+
+
+// Run the emulator in a child process. Returns its pid, or -1 if it failed
+// to start.
+static pid_t startEmulator(const EmulatorConfig& config) {
+  pid_t emulator = fork();
+  if (emulator == 0) _exit(runEmulator(config) ? 0 : 1);
+  delay(200);   // Let the listeners come up
+  if (waitpid(emulator, nullptr, WNOHANG) != 0) return -1;
+  return emulator;
+}
+
+static void stopEmulator(pid_t emulator) {
+  kill(emulator, SIGTERM);
+  waitpid(emulator, nullptr, 0);
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Moonraker
+ *
+ *----------------------------------------------------------------------------*/
+
+#if BPA_ENABLE_MOONRAKER && BPA_ENABLE_OCTO
+
+// MoonrakerClient tries to reconnect this often, plus some slack
+static constexpr uint32_t ReconnectWait = 35 * 1000L;
+// Long enough for the emulator to send any change (it does so every 250 ms)
+static constexpr uint32_t SettleTime = 600;
+
+struct Farm {
+  uint8_t n;
+  MoonrakerClient* moonraker;
+  OctoClient* reference;            // The same printers, read over OctoPrint's API
+  uint32_t seen[4] = {0, 0, 0, 0};  // Samples that matched, by state
+};
+
+static bool sameState(MoonrakerClient& m, OctoClient& o) {
+  if (m.getState() != o.getState()) return false;
+  if (m.getState() != PrintClient::State::Printing) return true;
+  return m.getFilename() == o.getFilename() && fabsf(m.getPctComplete() - o.getPctComplete()) <= 2.0f;
+}
+
+static void printMismatch(Farm& farm, int i) {
+  MoonrakerClient& m = farm.moonraker[i];
+  OctoClient& o = farm.reference[i];
+  printf("FAIL printer %d: Moonraker says %s %.1f%% %s, OctoPrint says %s %.1f%% %s\n", i,
+      stateName(m.getState()), m.getPctComplete(), m.getFilename().c_str(),
+      stateName(o.getState()), o.getPctComplete(), o.getFilename().c_str());
+}
+
+// Update every client and compare each with its reference. A printer that
+// differs may just be mid-change, so it is compared again once the change has
+// had time to arrive. Returns the number that still differ.
+static int compareFarm(Farm& farm, bool report) {
+  std::vector<int> differ;
+  for (int i = 0; i < farm.n; i++) {
+    farm.moonraker[i].updateState();
+    farm.reference[i].updateState();
+    if (sameState(farm.moonraker[i], farm.reference[i])) farm.seen[farm.moonraker[i].getState()]++;
+    else differ.push_back(i);
+  }
+  if (differ.empty()) return 0;
+  delay(SettleTime);
+  int failures = 0;
+  for (int i : differ) {
+    farm.moonraker[i].updateState();
+    farm.reference[i].updateState();
+    if (sameState(farm.moonraker[i], farm.reference[i])) { farm.seen[farm.moonraker[i].getState()]++; continue; }
+    if (report) printMismatch(farm, i);
+    failures++;
+  }
+  return failures;
+}
+
+static int testWebSocket(const EmulatorConfig& config, uint32_t duration, pid_t& emulator) {
+  Farm farm;
+  farm.n = config.printers;
+  farm.moonraker = new MoonrakerClient[farm.n];
+  farm.reference = new OctoClient[farm.n];
+  for (int i = 0; i < farm.n; i++) {
+    char address[16];
+    emulatorAddress(i, address, sizeof(address));
+    farm.moonraker[i].init(address, config.port, "emulator");
+    farm.reference[i].init("emulator", address, config.port, "", "");
+  }
+
+  // The handshake and subscription happen in each client's first update
+  uint32_t start = millis();
+  int failures = compareFarm(farm, true);
+  printf("%-4s %u clients connected and subscribed in %u ms; states match\n",
+      failures ? "FAIL" : "ok", farm.n, millis() - start);
+
+  // Updates arrive as they happen, among messages the client skips
+  uint32_t samples = 0, mismatched = 0;
+  start = millis();
+  while (millis() - start < duration * 1000) {
+    mismatched += compareFarm(farm, true);
+    samples++;
+    delay(1000);
+  }
+  printf("%-4s %u samples of %u printers matched OctoPrint: %u printing, %u complete, %u idle, %u offline\n",
+      mismatched ? "FAIL" : "ok", samples, farm.n,
+      farm.seen[PrintClient::State::Printing], farm.seen[PrintClient::State::Complete],
+      farm.seen[PrintClient::State::Operational], farm.seen[PrintClient::State::Offline]);
+  failures += mismatched;
+
+  // Restart the emulator; every connection is dropped
+  stopEmulator(emulator);
+  int stillOnline = 0;
+  for (int i = 0; i < farm.n; i++) {
+    farm.moonraker[i].updateState();
+    if (farm.moonraker[i].getState() != PrintClient::State::Offline) stillOnline++;
+  }
+  printf("%-4s every client went offline with the emulator\n", stillOnline ? "FAIL" : "ok");
+  failures += stillOnline;
+  emulator = startEmulator(config);
+  if (emulator < 0) { printf("FAIL the emulator didn't restart\n"); return failures + 1; }
+
+  start = millis();
+  int differ;
+  while ((differ = compareFarm(farm, false)) && millis() - start < ReconnectWait) delay(500);
+  if (differ) compareFarm(farm, true);
+  printf("%-4s every client reconnected and matched OctoPrint again, in %.1f s\n",
+      differ ? "FAIL" : "ok", (millis() - start) / 1000.0);
+  failures += differ;
+
+  delete[] farm.moonraker;
+  delete[] farm.reference;
+  return failures;
+}
+
+#endif  // BPA_ENABLE_MOONRAKER && BPA_ENABLE_OCTO
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Webcam snapshots
+ *
+ *----------------------------------------------------------------------------*/
+
+static constexpr uint8_t ViewersPerPrinter = 2;
+
+// Whether `viewer` was sent a complete frame from printer i, fetched at `path`
+static bool gotFrame(const VectorPrint& viewer, int i, const char* path) {
+  std::string response(viewer.bytes.begin(), viewer.bytes.end());
+  size_t bodyStart = response.find("\r\n\r\n");
+  size_t length = response.find("Content-Length: ");
+  if (response.compare(0, 12, "HTTP/1.1 200") != 0 || bodyStart == std::string::npos || length == std::string::npos) return false;
+  if (response.size() - bodyStart - 4 != strtoul(response.c_str() + length + 16, nullptr, 10)) return false;
+  char line[128];
+  snprintf(line, sizeof(line), "\xff\xd8" "emulator printer %d %s\n", i, path);
+  return response.compare(bodyStart + 4, strlen(line), line) == 0;
+}
+
+// Check that each printer's frame is fetched from where its type says, once
+// for all of its viewers, and that one serviceSnapshots() call fetches for
+// one printer at most
+static int testSnapshots(const EmulatorConfig& config) {
+  uint8_t n = config.printers;
+  std::unique_ptr<PrinterSettings[]> settings(makeSettings(config, 34, 33));
+  PrinterGroup group(n, settings.get(), 10, nullptr);
+  group.setSnapshotInterval(60 * 1000L);
+  // The emulator can't take port 80, where Moonraker's frames come from by default
+  group.setSnapshotSource(Type_Moonraker, "/webcam/mainsail", config.port);
+  auto pathFor = [](const String& type) {
+    return type == Type_Octo ? "/webcam/?action=snapshot" : type == Type_Duet ? "/webcam/duet" : "/webcam/mainsail";
+  };
+  int failures = 0;
+
+  // Duet printers have no webcam until one is configured
+  VectorPrint refused;
+  int duets = 0, accepted = 0;
+  for (int i = 0; i < n; i++) {
+    if (settings[i].type != Type_Duet) continue;
+    duets++;
+    if (group.requestSnapshot(i, refused)) { accepted++; group.cancelSnapshot(refused); }
+  }
+  printf("%-4s requests for the %d Duet printers refused while they have no webcam\n", accepted ? "FAIL" : "ok", duets);
+  failures += accepted;
+  group.setSnapshotSource(Type_Duet, "/webcam/duet");
+
+  std::vector<VectorPrint> viewers(n * ViewersPerPrinter);
+  int queued = 0;
+  for (int k = 0; k < n * ViewersPerPrinter; k++) {
+    if (group.requestSnapshot(k % n, viewers[k])) queued++;
+  }
+  int served = 0, calls = 0, overfetched = 0;
+  uint32_t longest = 0;
+  while (served < queued) {
+    uint32_t fetches = group.snapshotFetches(), start = millis();
+    if (!group.serviceSnapshots()) break;
+    longest = std::max(longest, millis() - start);
+    if (group.snapshotFetches() - fetches != 1) overfetched++;
+    calls++;
+    served = 0;
+    for (VectorPrint& v : viewers) if (!v.bytes.empty()) served++;
+  }
+  printf("%-4s %d viewers queued (at most %u) and answered, by %d serviceSnapshots() calls of one fetch each\n",
+      served == queued && !overfetched ? "ok" : "FAIL", queued, PrinterGroup::MaxSnapshotViewers, calls);
+  printf("%-4s the longest call took %u ms\n", longest < 5500 ? "ok" : "FAIL", longest);
+  failures += (served != queued) + overfetched + (longest >= 5500);
+
+  int wrong = 0, fetched = 0;
+  for (int k = 0; k < n * ViewersPerPrinter; k++) {
+    int i = k % n;
+    if (viewers[k].bytes.empty()) continue;
+    if (k < n) fetched++;
+    bool silent = i >= n - config.offline;
+    bool ok = silent ? memcmp(viewers[k].bytes.data(), "HTTP/1.1 502", 12) == 0
+                     : gotFrame(viewers[k], i, pathFor(settings[i].type));
+    if (!ok) {
+      printf("     viewer %d of printer %d (%s): %.*s\n", k / n, i, typeName(settings[i].type),
+          (int)std::min<size_t>(40, viewers[k].bytes.size()), viewers[k].bytes.data());
+      wrong++;
+    }
+  }
+  printf("%-4s every viewer got its printer's frame from the path for its type%s\n",
+      wrong ? "FAIL" : "ok", config.offline ? ", or a 502 from a silent printer" : "");
+  printf("%-4s %u frames fetched for %d printers\n",
+      group.snapshotFetches() == (uint32_t)fetched ? "ok" : "FAIL", group.snapshotFetches(), fetched);
+  failures += wrong + (group.snapshotFetches() != (uint32_t)fetched);
+
+  // A printer whose frame was just fetched isn't due again until the interval passes
+  VectorPrint early;
+  group.requestSnapshot(0, early);
+  bool waited = !group.serviceSnapshots() && early.bytes.empty();
+  group.cancelSnapshot(early);
+  printf("%-4s a second request within the interval waits\n", waited ? "ok" : "FAIL");
+  failures += !waited;
+  return failures;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * A farm of printers polled by one group
+ *
+ *----------------------------------------------------------------------------*/
+
+struct FarmTotals {
+  uint32_t elapsed = 0;             // ms
+  uint64_t requests = 0;
+  uint64_t bytesReceived = 0;       // Response bodies as sent, possibly compressed
+  uint64_t bytesDecoded = 0;        // Response bodies after decompression
+  uint64_t polls = 0;
+  uint64_t pollMillis = 0;
+  std::vector<uint32_t> passes;     // Wall time of each pass that polled something, sorted
+};
+
+// Poll the emulated farm for `duration` seconds, then stop the emulator.
+// With `report`, print the totals and a line per printer.
+static FarmTotals runFarm(const EmulatorConfig& config, uint8_t duetPct, uint8_t moonrakerPct,
+    uint32_t interval, uint32_t duration, pid_t emulator, bool report)
+{
+  FarmTotals totals;
+  uint8_t n = config.printers;
+  std::unique_ptr<PrinterSettings[]> settings(makeSettings(config, duetPct, moonrakerPct));
+  PrinterGroup group(n, settings.get(), interval, nullptr);
+  for (int i = 0; i < n; i++) group.activatePrinter(i);
+
+  std::vector<uint32_t>& passes = totals.passes;
+  std::vector<uint32_t> maxStaleness(n, 0);
+  std::vector<uint64_t> totalStaleness(n, 0);
+  uint32_t samples = 0;
+
+  uint32_t start = millis();
+  group.refreshPrinterData(true);       // As a device does at startup
+  passes.push_back(millis() - start);
+  while (millis() - start < duration * 1000) {
+    uint32_t polls = 0;
+    for (int i = 0; i < n; i++) polls += group.getPollStats(i).polls;
+    uint32_t passStart = millis();
+    group.refreshPrinterData(false);
+    uint32_t elapsed = millis() - passStart;
+    for (int i = 0; i < n; i++) polls -= group.getPollStats(i).polls;
+    if (polls) passes.push_back(elapsed);
+
+    for (int i = 0; i < n; i++) {
+      uint32_t staleness = group.getStaleness(i);
+      if (staleness == UINT32_MAX) staleness = millis() - start;   // Never updated
+      maxStaleness[i] = std::max(maxStaleness[i], staleness);
+      totalStaleness[i] += staleness;
+    }
+    samples++;
+    delay(10);
+  }
+  uint32_t elapsed = totals.elapsed = millis() - start;
+  stopEmulator(emulator);
+
+  for (int i = 0; i < n; i++) {
+    const PrintClient::FetchStats& fetch = group.getPrinter(i)->fetchStats;
+    totals.requests += fetch.requests;
+    totals.bytesReceived += fetch.bytesReceived;
+    totals.bytesDecoded += fetch.bytesDecoded;
+    totals.polls += group.getPollStats(i).polls;
+    totals.pollMillis += group.getPollStats(i).totalMillis;
+  }
+  std::sort(passes.begin(), passes.end());
+  if (!report) return totals;
+
+  uint64_t requests = totals.requests;
+  uint64_t passTotal = 0;
+  for (uint32_t p : passes) passTotal += p;
+  printf("%u printers (%u%% Duet, %u%% Moonraker), latency %u+%u ms, loss %u%%, %u offline, %u%% flaky, %us at %ux\n",
+      n, duetPct, moonrakerPct, config.latency, config.jitter, config.loss, config.offline, config.flaky, duration, config.speed);
+  printf("requests:       %llu (%.1f/s)\n", (unsigned long long)requests, requests * 1000.0 / elapsed);
+  printf("bodies:         %llu bytes received, %llu decoded\n",
+      (unsigned long long)totals.bytesReceived, (unsigned long long)totals.bytesDecoded);
+  printf("refresh passes: %zu, wall time mean %llu ms, median %u ms, max %u ms\n",
+      passes.size(), (unsigned long long)(passTotal / passes.size()), passes[passes.size() / 2], passes.back());
+  printf("\n%-12s %-6s %-12s %6s %9s %9s %11s %11s\n",
+      "printer", "type", "state", "polls", "mean ms", "max ms", "stale mean", "stale max");
+  for (int i = 0; i < n; i++) {
+    const PrinterGroup::PollStats& stats = group.getPollStats(i);
+    printf("%-12s %-6s %-12s %6u %9u %9u %10.1fs %10.1fs\n",
+        settings[i].nickname.c_str(), typeName(settings[i].type),
+        stateName(group.getPrinter(i)->getState()), stats.polls,
+        stats.polls ? stats.totalMillis / stats.polls : 0, stats.maxMillis,
+        totalStaleness[i] / 1000.0 / samples, maxStaleness[i] / 1000.0);
+  }
+  return totals;
+}
+
+// The same farm polled with bodies sent as is and compressed
+static void printComparison(const EmulatorConfig& config, uint8_t duetPct, uint8_t moonrakerPct,
+    uint32_t duration, const FarmTotals& plain, const FarmTotals& compressed)
+{
+  auto perRequest = [](uint64_t bytes, uint64_t requests) { return requests ? (double)bytes / requests : 0.0; };
+  auto meanPoll = [](const FarmTotals& t) { return t.polls ? (double)t.pollMillis / t.polls : 0.0; };
+  auto meanPass = [](const FarmTotals& t) {
+    uint64_t total = 0;
+    for (uint32_t p : t.passes) total += p;
+    return (double)total / t.passes.size();
+  };
+  auto change = [](double before, double after) { return before ? (after - before) * 100 / before : 0.0; };
+  double plainBytes = perRequest(plain.bytesReceived, plain.requests);
+  double compressedBytes = perRequest(compressed.bytesReceived, compressed.requests);
+
+  printf("%u printers (%u%% Duet, %u%% Moonraker), latency %u+%u ms, bandwidth %u B/s, %us each way at %ux\n",
+      config.printers, duetPct, moonrakerPct, config.latency, config.jitter, config.bandwidth, duration, config.speed);
+  printf("\n%-24s %12s %12s %9s\n", "", "identity", "compressed", "change");
+  printf("%-24s %12llu %12llu\n", "requests",
+      (unsigned long long)plain.requests, (unsigned long long)compressed.requests);
+  printf("%-24s %12.0f %12.0f %8.1f%%\n", "body bytes/request", plainBytes, compressedBytes,
+      change(plainBytes, compressedBytes));
+  printf("%-24s %12.0f %12.0f\n", "decoded bytes/request",
+      perRequest(plain.bytesDecoded, plain.requests), perRequest(compressed.bytesDecoded, compressed.requests));
+  printf("%-24s %12.1f %12.1f %8.1f%%\n", "poll mean ms", meanPoll(plain), meanPoll(compressed),
+      change(meanPoll(plain), meanPoll(compressed)));
+  printf("%-24s %12.1f %12.1f %8.1f%%\n", "refresh pass mean ms", meanPass(plain), meanPass(compressed),
+      change(meanPass(plain), meanPass(compressed)));
+  printf("%-24s %12u %12u\n", "refresh pass max ms", plain.passes.back(), compressed.passes.back());
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * main
+ *
+ *----------------------------------------------------------------------------*/
+
+int main(int argc, char** argv) {
+  EmulatorConfig config;
+  uint32_t duration = 60;       // Seconds
+  uint32_t interval = 10;       // The group's refresh interval for printing printers
+  uint8_t duetPct = 50;
+  uint8_t moonrakerPct = 0;
+  uint8_t nNodes = 0;
+  bool websocket = false;
+  bool compression = false;
+  bool snapshots = false;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) duration = atol(argv[++i]);
+    else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) interval = atol(argv[++i]);
+    else if (strcmp(argv[i], "--duet") == 0 && i + 1 < argc) duetPct = atol(argv[++i]);
+    else if (strcmp(argv[i], "--moonraker") == 0 && i + 1 < argc) moonrakerPct = atol(argv[++i]);
+    else if (strcmp(argv[i], "--nodes") == 0 && i + 1 < argc) nNodes = atol(argv[++i]);
+    else if (strcmp(argv[i], "--websocket") == 0) websocket = true;
+    else if (strcmp(argv[i], "--compression") == 0) compression = true;
+    else if (strcmp(argv[i], "--snapshots") == 0) snapshots = true;
+    else if (!parseEmulatorOption(config, argc, argv, &i)) {
+      fprintf(stderr, "usage: %s [options]\n"
+          "  --duration S        How long to run (60), each time with --nodes\n"
+          "  --interval S        The group's refresh interval (10)\n"
+          "  --duet PCT          Percent of printers polled as Duets (50)\n"
+          "  --moonraker PCT     Percent read through Moonraker; the rest are OctoPrint (0)\n"
+          "  --nodes K           Test federation with K and then K+1 nodes and a gateway\n"
+          "  --websocket         Test the Moonraker client against the emulator's websocket\n"
+          "  --compression       Run twice, with bodies sent as is and compressed, and compare\n"
+          "  --snapshots         Test the webcam snapshot proxy against the emulator's webcams\n"
+          "  --verbose           Log each request the emulator serves\n%s", argv[0], EmulatorUsage);
+      return 2;
+    }
+  }
+  if (config.printers == 0 || config.printers > 255) { fprintf(stderr, "--printers must be 1 to 255\n"); return 2; }
+  if (nNodes > 16) { fprintf(stderr, "--nodes must be 0 to 16\n"); return 2; }
+  if (duetPct + moonrakerPct > 100) { fprintf(stderr, "--duet and --moonraker add up to more than 100\n"); return 2; }
+
+  if (compression) config.compress = false;     // The first run sends bodies as they are
+  pid_t emulator = startEmulator(config);
+  if (emulator < 0) { fprintf(stderr, "The emulator failed to start\n"); return 1; }
+
+  Log.begin(LOG_LEVEL_ERROR);
+  if (nNodes || websocket || snapshots) {
+    int failures = 1;
+    if (snapshots) {
+      failures = testSnapshots(config);
+    } else if (nNodes) {
+#if BPA_ENABLE_REMOTE
+      failures = testFederation(config, duetPct, interval, duration, nNodes);
+#else
+      fprintf(stderr, "Federation is not enabled in this build\n");
+#endif
+    } else {
+#if BPA_ENABLE_MOONRAKER && BPA_ENABLE_OCTO
+      failures = testWebSocket(config, duration, emulator);
+#else
+      fprintf(stderr, "Moonraker and OctoPrint must both be enabled in this build\n");
+#endif
+    }
+    if (emulator > 0) stopEmulator(emulator);
+    printf("%s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+  }
+
+  if (compression) {
+    FarmTotals plain = runFarm(config, duetPct, moonrakerPct, interval, duration, emulator, false);
+    config.compress = true;
+    if ((emulator = startEmulator(config)) < 0) { fprintf(stderr, "The emulator failed to restart\n"); return 1; }
+    FarmTotals compressed = runFarm(config, duetPct, moonrakerPct, interval, duration, emulator, false);
+    printComparison(config, duetPct, moonrakerPct, duration, plain, compressed);
+    return 0;
+  }
+  runFarm(config, duetPct, moonrakerPct, interval, duration, emulator, true);
+  return 0;
+}
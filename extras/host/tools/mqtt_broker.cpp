@@ -0,0 +1,272 @@
+/*
+ * MqttBroker:
+ *    One thread polls the listener and every client. Packets are handled as
+ *    soon as they are complete; a client that sends something malformed is
+ *    disconnected.
+ *
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <Arduino.h>
+#include "mqtt_broker.h"
+
+namespace {
+
+enum PacketType : uint8_t {
+  Packet_Connect = 0x10, Packet_ConnAck = 0x20, Packet_Publish = 0x30,
+  Packet_Subscribe = 0x80, Packet_SubAck = 0x90,
+  Packet_PingReq = 0xC0, Packet_PingResp = 0xD0, Packet_Disconnect = 0xE0
+};
+
+// Whether `topic` matches the subscription `filter`
+bool matches(const std::string& filter, const std::string& topic) {
+  size_t f = 0, t = 0;
+  while (f < filter.size()) {
+    if (filter[f] == '#') return true;
+    if (filter[f] == '+') {
+      while (t < topic.size() && topic[t] != '/') t++;
+      f++;
+    } else {
+      if (t >= topic.size() || filter[f] != topic[t]) return false;
+      f++;
+      t++;
+    }
+  }
+  return t == topic.size();
+}
+
+void appendString(std::string& out, const std::string& s) {
+  out += (char)(s.size() >> 8);
+  out += (char)s.size();
+  out += s;
+}
+
+// Read a length-prefixed string at `pos`. Returns false if it overruns `end`.
+bool readString(const std::string& in, size_t& pos, size_t end, std::string& s) {
+  if (pos + 2 > end) return false;
+  size_t length = ((uint8_t)in[pos] << 8) | (uint8_t)in[pos + 1];
+  if (pos + 2 + length > end) return false;
+  s = in.substr(pos + 2, length);
+  pos += 2 + length;
+  return true;
+}
+
+}  // namespace
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Public methods
+ *
+ *----------------------------------------------------------------------------*/
+
+uint16_t MqttBroker::start() {
+  _listener = socket(AF_INET, SOCK_STREAM, 0);
+  if (_listener < 0) return 0;
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addrLength = sizeof(addr);
+  if (bind(_listener, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(_listener, 8) != 0 ||
+      getsockname(_listener, (struct sockaddr*)&addr, &addrLength) != 0) {
+    close(_listener);
+    _listener = -1;
+    return 0;
+  }
+  _running = true;
+  _thread = std::thread(&MqttBroker::run, this);
+  return ntohs(addr.sin_port);
+}
+
+void MqttBroker::stop() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_running) return;
+    _running = false;
+  }
+  _thread.join();
+  for (Client& c : _clients) close(c.fd);
+  _clients.clear();
+  close(_listener);
+  _listener = -1;
+}
+
+void MqttBroker::publish(const std::string& topic, const std::string& payload, bool retain) {
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (retain) {
+    if (payload.empty()) _retained.erase(topic);
+    else _retained[topic] = payload;
+  }
+  for (Client& c : _clients) {
+    if (!c.connected) continue;
+    for (const std::string& filter : c.filters) {
+      if (matches(filter, topic)) { sendPublish(c, topic, payload, false); break; }
+    }
+  }
+}
+
+void MqttBroker::dropClients() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  for (Client& c : _clients) close(c.fd);
+  _clients.clear();
+}
+
+MqttBroker::Stats MqttBroker::stats() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _stats;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Private methods
+ *
+ *----------------------------------------------------------------------------*/
+
+void MqttBroker::run() {
+  std::vector<struct pollfd> fds;
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (!_running) return;
+      fds.clear();
+      fds.push_back({_listener, POLLIN, 0});
+      for (Client& c : _clients) fds.push_back({c.fd, POLLIN, 0});
+    }
+    poll(fds.data(), fds.size(), 20);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    // dropClients() may have run while we were polling, so match by fd
+    for (Client& c : _clients) {
+      short revents = 0;
+      for (size_t k = 1; k < fds.size(); k++) if (fds[k].fd == c.fd) revents = fds[k].revents;
+      if (revents & (POLLIN | POLLHUP | POLLERR)) {
+        char buf[4096];
+        ssize_t n = read(c.fd, buf, sizeof(buf));
+        if (n <= 0) { c.closing = true; continue; }
+        c.in.append(buf, n);
+        c.lastHeard = millis();
+        handlePackets(c);
+      }
+      if (c.connected && c.keepAlive && millis() - c.lastHeard > c.keepAlive * 1500L) {
+        _stats.timeouts++;
+        c.closing = true;
+      }
+    }
+    for (size_t k = _clients.size(); k-- > 0; ) {
+      if (!_clients[k].closing) continue;
+      close(_clients[k].fd);
+      _clients.erase(_clients.begin() + k);
+    }
+
+    if (fds[0].revents & POLLIN) {
+      int fd = accept(_listener, nullptr, nullptr);
+      if (fd >= 0) {
+        Client c;
+        c.fd = fd;
+        c.lastHeard = millis();
+        _clients.push_back(std::move(c));
+      }
+    }
+  }
+}
+
+void MqttBroker::handlePackets(Client& c) {
+  while (!c.closing) {
+    // The fixed header: the type and flags, then the remaining length
+    if (c.in.size() < 2) return;
+    size_t length = 0, pos = 1;
+    for (int shift = 0; ; shift += 7) {
+      if (pos >= c.in.size()) return;
+      if (shift > 21) { c.closing = true; return; }
+      uint8_t byte = c.in[pos++];
+      length |= (size_t)(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) break;
+    }
+    if (c.in.size() < pos + length) return;
+    uint8_t type = c.in[0];
+    size_t end = pos + length;
+
+    if (!c.connected && (type & 0xf0) != Packet_Connect) { c.closing = true; return; }
+    switch (type & 0xf0) {
+      case Packet_Connect: {
+        std::string protocol, clientID;
+        bool ok = !c.connected && readString(c.in, pos, end, protocol) && protocol == "MQTT" &&
+                  pos + 4 <= end && c.in[pos] == 4;
+        if (ok) {
+          c.keepAlive = ((uint8_t)c.in[pos + 2] << 8) | (uint8_t)c.in[pos + 3];
+          pos += 4;                                 // The level, flags, and keep-alive
+          ok = readString(c.in, pos, end, clientID);
+        }
+        if (!ok) { c.closing = true; return; }
+        c.connected = true;
+        _stats.connects++;
+        _stats.keepAlive = c.keepAlive;
+        _stats.clientID = clientID;
+        send(c, Packet_ConnAck, std::string("\0\0", 2));
+        break;
+      }
+      case Packet_Subscribe: {
+        if (pos + 2 > end) { c.closing = true; return; }
+        std::string ack = c.in.substr(pos, 2);      // The packet ID
+        std::vector<std::string> added;
+        pos += 2;
+        while (pos < end) {
+          // Each filter is followed by the QoS asked for
+          std::string filter;
+          if (!readString(c.in, pos, end, filter) || pos++ >= end) { c.closing = true; return; }
+          c.filters.push_back(filter);
+          added.push_back(filter);
+          ack += (char)0;                           // Granted at QoS 0
+        }
+        _stats.subscriptions += added.size();
+        send(c, Packet_SubAck, ack);
+        for (auto& retained : _retained) {
+          for (const std::string& filter : added) {
+            if (matches(filter, retained.first)) { sendPublish(c, retained.first, retained.second, true); break; }
+          }
+        }
+        break;
+      }
+      case Packet_PingReq:
+        _stats.pings++;
+        send(c, Packet_PingResp, "");
+        break;
+      case Packet_Disconnect:
+        c.closing = true;
+        break;
+      default:
+        break;      // A client's PUBLISH goes nowhere
+    }
+    c.in.erase(0, end);
+  }
+}
+
+void MqttBroker::send(Client& c, uint8_t type, const std::string& body) {
+  std::string packet(1, (char)type);
+  size_t remaining = body.size();
+  do {
+    uint8_t byte = remaining & 0x7f;
+    remaining >>= 7;
+    if (remaining) byte |= 0x80;
+    packet += (char)byte;
+  } while (remaining);
+  packet += body;
+  for (size_t sent = 0; sent < packet.size(); ) {
+    ssize_t n = ::send(c.fd, packet.data() + sent, packet.size() - sent, MSG_NOSIGNAL);
+    if (n <= 0) { c.closing = true; return; }
+    sent += n;
+  }
+}
+
+void MqttBroker::sendPublish(Client& c, const std::string& topic, const std::string& payload, bool retain) {
+  std::string body;
+  appendString(body, topic);
+  body += payload;
+  send(c, Packet_Publish | (retain ? 1 : 0), body);
+  _stats.delivered++;
+}
@@ -0,0 +1,79 @@
+/*
+ * MqttBroker:
+ *    Stands in for an MQTT 3.1.1 broker, enough to test MqttFeed against.
+ *    It serves QoS 0 only: CONNECT, SUBSCRIBE (with + and # wildcards),
+ *    PUBLISH, PINGREQ, and DISCONNECT. It keeps the last retained message of
+ *    each topic and sends the matching ones to every new subscription, and
+ *    drops a client it hasn't heard from in 1.5 keep-alive periods, as a
+ *    real broker does.
+ *
+ *    It serves from its own thread, so a client can block waiting for it.
+ *    Every method may be called from any other thread.
+ *
+ */
+
+#ifndef MqttBroker_h
+#define MqttBroker_h
+
+#include <stdint.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class MqttBroker {
+public:
+  struct Stats {
+    uint32_t connects = 0;          // CONNECTs accepted
+    uint32_t subscriptions = 0;     // Topic filters subscribed to
+    uint32_t pings = 0;             // PINGREQs answered
+    uint32_t timeouts = 0;          // Clients dropped for missing the keep-alive
+    uint32_t delivered = 0;         // PUBLISHes sent to clients
+    uint16_t keepAlive = 0;         // From the last CONNECT
+    std::string clientID;           // From the last CONNECT
+  };
+
+  MqttBroker() { }
+  ~MqttBroker() { stop(); }
+  MqttBroker(const MqttBroker&) = delete;
+  MqttBroker& operator=(const MqttBroker&) = delete;
+
+  // Listen on 127.0.0.1, on a port the system picks. Returns the port, or 0
+  // if the broker couldn't start.
+  uint16_t start();
+  void stop();
+
+  // Send to every client subscribed to `topic`, and if `retain`, keep it
+  // for later subscriptions (an empty retained payload clears the topic)
+  void publish(const std::string& topic, const std::string& payload, bool retain);
+  // Close every client's connection, as a broker restart would
+  void dropClients();
+  Stats stats();
+
+private:
+  struct Client {
+    int fd;
+    std::string in;                 // Received, not yet a whole packet
+    std::vector<std::string> filters;
+    uint16_t keepAlive = 0;
+    uint32_t lastHeard = 0;
+    bool connected = false;         // CONNECT has been accepted
+    bool closing = false;
+  };
+
+  std::mutex _mutex;
+  std::thread _thread;
+  bool _running = false;
+  int _listener = -1;
+  std::vector<Client> _clients;
+  std::map<std::string, std::string> _retained;
+  Stats _stats;
+
+  void run();
+  void handlePackets(Client& c);
+  void send(Client& c, uint8_t type, const std::string& body);
+  void sendPublish(Client& c, const std::string& topic, const std::string& payload, bool retain);
+};
+
+#endif  // MqttBroker_h
@@ -0,0 +1,154 @@
+/*
+ * mqtt_check:
+ *    Checks MqttFeed and MqttPrintClient against a stand-in broker (see
+ *    mqtt_broker.h) over real sockets:
+ *      o CONNECT is accepted and every topic the client needs is subscribed
+ *      o retained messages restore a printer's state on subscribing, and
+ *        again after the broker drops the connection
+ *      o a message larger than MqttFeed::MaxPacketSize is skipped, and the
+ *        connection and the messages after it are unaffected
+ *      o pings keep the connection open past the keep-alive, and the broker
+ *        drops a client that stops sending them
+ *
+ *    Exits with a non-zero status if any check fails.
+ *
+ */
+
+#include <functional>
+#include <string>
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ArduinoLog.h>
+#include "BPA_Config.h"
+#include "BPA_PrintClient.h"
+#include "BPA_OctoClient.h"
+#include "mqtt_broker.h"
+
+// The keep-alive and the time of the last connection attempt are private
+#define private public
+#include "BPA_MqttFeed.h"
+#undef private
+
+#if BPA_ENABLE_MQTT
+
+static const char* const Base = "octoPrint/";
+static const uint16_t KeepAlive = 2;      // Seconds; far shorter than a device would use
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, uint64_t value, uint64_t expected) {
+  printf("%-4s %-60s %llu (expected %llu)\n",
+      ok ? "ok" : "FAIL", what, (unsigned long long)value, (unsigned long long)expected);
+  if (!ok) failures++;
+}
+
+// What the OctoPrint-MQTT plugin publishes on progress/printing
+static std::string progress(float completion, bool printing) {
+  char buf[512];
+  snprintf(buf, sizeof(buf),
+      R"({"progress":%d,"printer_data":{"state":{"text":"%s","flags":{"printing":%s}},)"
+      R"("job":{"file":{"name":"cube.gcode","path":"cube.gcode","origin":"local","size":123456,"date":1700000000},)"
+      R"("estimatedPrintTime":3600,"filament":{"tool0":{"length":2500}}},)"
+      R"("progress":{"completion":%.1f,"filepos":%d,"printTime":%d,"printTimeLeft":%d}}})",
+      (int)completion, printing ? "Printing" : "Operational", printing ? "true" : "false",
+      completion, (int)(123456 * completion / 100), (int)(36 * completion), (int)(36 * (100 - completion)));
+  return buf;
+}
+
+static std::string temperature(float actual, float target) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), R"({"actual":%.1f,"target":%.1f})", actual, target);
+  return buf;
+}
+
+// Call updateState() as a PrinterGroup would, until `done` or `timeout` ms pass
+static bool updateUntil(MqttPrintClient& client, uint32_t timeout, std::function<bool()> done) {
+  uint32_t start = millis();
+  do {
+    client.updateState();
+    if (done()) return true;
+    delay(10);
+  } while (millis() - start < timeout);
+  return false;
+}
+
+int main() {
+  Log.begin(LOG_LEVEL_ERROR);
+  MqttBroker broker;
+  uint16_t port = broker.start();
+  if (port == 0) { printf("FAIL the broker didn't start\n"); return 1; }
+
+  // The plugin's retained will message and last progress
+  broker.publish(std::string(Base) + "mqtt", "connected", true);
+  broker.publish(std::string(Base) + "progress/printing", progress(42, true), true);
+  broker.publish(std::string(Base) + "temperature/bed", temperature(60.1, 60), true);
+
+  MqttFeed feed;
+  feed.init("127.0.0.1", port, "mqtt-check");
+  feed._keepAlive = KeepAlive;
+  MqttPrintClient client;
+  client.init(&feed, Base);
+
+  // ----- CONNECT, SUBSCRIBE, and the retained state
+  bool printing = updateUntil(client, 2000, [&]() { return client.getState() == PrintClient::State::Printing; });
+  MqttBroker::Stats stats = broker.stats();
+  check(stats.connects == 1 && stats.clientID == "mqtt-check", "CONNECT accepted, with the client's ID", stats.connects, 1);
+  check(stats.keepAlive == KeepAlive, "keep-alive in the CONNECT", stats.keepAlive, KeepAlive);
+  check(stats.subscriptions == 4, "topic filters in the SUBSCRIBE", stats.subscriptions, 4);
+  check(printing, "the retained messages make the printer Printing", client.getState(), PrintClient::State::Printing);
+  check((int)client.getPctComplete() == 42, "percent complete from the retained progress", (int)client.getPctComplete(), 42);
+  float bedActual, bedTarget;
+  client.getBedTemps(bedActual, bedTarget);
+  check(bedTarget == 60, "bed target from the retained temperature", (uint64_t)bedTarget, 60);
+
+  // ----- A message too large for the client, then one it can take
+  uint32_t messages = feed.messagesReceived();
+  std::string huge = R"({"name":")" + std::string(MqttFeed::MaxPacketSize + 500, 'x') + R"("})";
+  broker.publish(std::string(Base) + "event/Huge", huge, false);
+  broker.publish(std::string(Base) + "temperature/bed", temperature(59.5, 0), false);
+  bool applied = updateUntil(client, 2000, [&]() { client.getBedTemps(bedActual, bedTarget); return bedTarget == 0; });
+  check(applied, "a message after an oversized one is applied", applied, 1);
+  check(feed.messagesReceived() - messages == 1, "messages dispatched (the oversized one is skipped)",
+      feed.messagesReceived() - messages, 1);
+  check(feed.connected() && feed.reconnects() == 0, "still connected, without reconnecting", feed.reconnects(), 0);
+
+  // ----- Pings keep the connection open past 1.5 keep-alive periods
+  uint32_t pings = broker.stats().pings;
+  updateUntil(client, KeepAlive * 2500, []() { return false; });
+  stats = broker.stats();
+  check(stats.pings - pings >= 2, "PINGREQs answered over 2.5 keep-alive periods", stats.pings - pings, 2);
+  check(stats.timeouts == 0 && feed.connected(), "connections dropped for missing the keep-alive", stats.timeouts, 0);
+
+  // ----- The broker drops the connection; the printer's state moves on
+  // while the client is away, and the retained messages bring it up to date
+  broker.dropClients();
+  broker.publish(std::string(Base) + "progress/printing", progress(75, true), true);
+  bool noticed = updateUntil(client, 2000, [&]() { return !feed.connected(); });
+  check(noticed && client.getState() == PrintClient::State::Offline, "the printer is Offline while disconnected",
+      client.getState(), PrintClient::State::Offline);
+  feed._lastConnectAttempt = millis() - MqttFeed::ReconnectInterval;    // Rather than waiting it out
+  bool caughtUp = updateUntil(client, 2000, [&]() { return (int)client.getPctComplete() == 75; });
+  stats = broker.stats();
+  check(feed.reconnects() == 1 && stats.connects == 2, "reconnected once", feed.reconnects(), 1);
+  check(stats.subscriptions == 8, "topic filters subscribed to again", stats.subscriptions, 8);
+  check(caughtUp && client.getState() == PrintClient::State::Printing,
+      "the retained progress, published while away, is replayed", (int)client.getPctComplete(), 75);
+
+  // ----- A client that stops calling loop() stops pinging, and is dropped
+  delay(KeepAlive * 1500 + 500);
+  stats = broker.stats();
+  check(stats.timeouts == 1, "the broker drops a client that stops pinging", stats.timeouts, 1);
+
+  broker.stop();
+  printf("%s\n", failures ? "FAILED" : "passed");
+  return failures ? 1 : 0;
+}
+
+#else
+
+int main() {
+  printf("MQTT is not enabled in this build\n");
+  return 0;
+}
+
+#endif  // BPA_ENABLE_MQTT
@@ -0,0 +1,41 @@
+/*
+ * printer_emulator:
+ *    Serves a farm of emulated OctoPrint/Duet/Moonraker printers (see
+ *    emulator.h) so that a device, or anything else, can be pointed at them.
+ *    Printer i listens on port + i of the given address, or with --loopback
+ *    on 127.0.1.(i+1):port, which is what load_test uses.
+ *
+ *    usage: printer_emulator [--address A] [--loopback] [emulator options]
+ *
+ */
+
+#include <Arduino.h>
+#include "emulator.h"
+
+int main(int argc, char** argv) {
+  EmulatorConfig config;
+  config.portPerPrinter = true;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--address") == 0 && i + 1 < argc) config.address = argv[++i];
+    else if (strcmp(argv[i], "--loopback") == 0) config.portPerPrinter = false;
+    else if (!parseEmulatorOption(config, argc, argv, &i)) {
+      fprintf(stderr, "usage: %s [options]\n"
+          "  --address A         Address to listen on (0.0.0.0)\n"
+          "  --loopback          Give each printer its own loopback address instead of a port\n"
+          "  --verbose           Log each request\n%s", argv[0], EmulatorUsage);
+      return 2;
+    }
+  }
+
+  if (config.portPerPrinter) {
+    printf("Emulating %u printers on %s, ports %u to %u\n",
+        config.printers, config.address, config.port, config.port + config.printers - 1);
+  } else {
+    char first[16], last[16];
+    emulatorAddress(0, first, sizeof(first));
+    emulatorAddress(config.printers - 1, last, sizeof(last));
+    printf("Emulating %u printers on %s to %s, port %u\n", config.printers, first, last, config.port);
+  }
+  fflush(stdout);
+  return runEmulator(config) ? 0 : 1;
+}
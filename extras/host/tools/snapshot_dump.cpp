@@ -0,0 +1,69 @@
+/*
+ * snapshot_dump:
+ *    Decodes a GroupSnapshot (see BPA_GroupSnapshot.h), as served by a
+ *    node's PrinterGroup::writeSnapshot(), and lists each printer in it.
+ *    Reads the file named on the command line, or standard input, so it can
+ *    be used as, e.g.:
+ *
+ *      curl -s http://node.local/snapshot | snapshot_dump
+ *
+ *    usage: snapshot_dump [FILE]
+ *
+ */
+
+#include <time.h>
+#include <vector>
+#include <Arduino.h>
+#include "BPA_GroupSnapshot.h"
+
+static const char* stateName(PrintClient::State state) {
+  static const char* names[] = {"Offline", "Operational", "Complete", "Printing"};
+  return (state <= PrintClient::State::Printing) ? names[state] : "?";
+}
+
+int main(int argc, char** argv) {
+  if (argc > 2) { fprintf(stderr, "usage: %s [FILE]\n", argv[0]); return 2; }
+  FILE* in = (argc == 2) ? fopen(argv[1], "rb") : stdin;
+  if (in == nullptr) { perror(argv[1]); return 1; }
+  std::vector<uint8_t> data;
+  uint8_t buf[4096];
+  for (size_t n; (n = fread(buf, 1, sizeof(buf), in)) > 0; ) data.insert(data.end(), buf, buf + n);
+  if (in != stdin) fclose(in);
+
+  GroupSnapshot snapshot(data.data(), data.size());
+  if (!snapshot.valid()) {
+    if (data.size() >= 4 && memcmp(data.data(), "BPG", 3) == 0 && data[3] != GroupSnapshot::Version) {
+      fprintf(stderr, "Snapshot version %u; this tool reads version %u\n", data[3], GroupSnapshot::Version);
+    } else {
+      fprintf(stderr, "Not a valid snapshot (%zu bytes; bad magic, truncated, or CRC mismatch)\n", data.size());
+    }
+    return 1;
+  }
+
+  time_t t = snapshot.time();
+  char when[24];
+  strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", gmtime(&t));
+  printf("%u printers at %s UTC, %zu bytes\n\n", snapshot.numberOfPrinters(), when, data.size());
+  printf("%3s %-20s %-11s %4s %9s %9s %13s %13s  %s\n",
+      "#", "name", "state", "pct", "elapsed", "left", "bed", "tool", "file");
+
+  GroupSnapshot::PrinterView v;
+  int i = 0;
+  for (bool ok = snapshot.first(v); ok; ok = snapshot.next(v), i++) {
+    if (!v.active()) {
+      printf("%3d %-20.*s (inactive)\n", i, v.nameLength(), v.name());
+      continue;
+    }
+    char bed[16], tool[16];
+    snprintf(bed, sizeof(bed), "%.1f/%.1f", v.bedActual(), v.bedTarget());
+    snprintf(tool, sizeof(tool), "%.1f/%.1f", v.toolActual(), v.toolTarget());
+    printf("%3d %-20.*s %-11s %3u%% %8us %8us %13s %13s  %.*s\n",
+        i, v.nameLength(), v.name(), stateName(v.state()), v.pct(), v.elapsed(), v.timeLeft(),
+        bed, tool, v.fileLength(), v.file());
+  }
+  if (i != snapshot.numberOfPrinters()) {
+    fprintf(stderr, "Only %d of %u printers could be read\n", i, snapshot.numberOfPrinters());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,54 @@
+/*
+ * Arena:
+ *    A bump allocator for short-lived data
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <new>
+#include <string.h>
+//                                  Third Party Libraries
+#include <ArduinoLog.h>
+//                                  Local Includes
+#include "BPA_Arena.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+// Enough for any type an ArduinoJson pool or a string might hold
+static constexpr size_t Alignment = 8;
+
+void* Arena::allocate(size_t size) {
+  if (!_block) {
+    _block = new (std::nothrow) uint8_t[_capacity];
+    if (!_block) { Log.warning(F("Arena: unable to allocate %d bytes"), _capacity); return nullptr; }
+  }
+  size_t start = (_used + Alignment - 1) & ~(Alignment - 1);
+  if (start > _capacity || size > _capacity - start) {
+    Log.warning(F("Arena: unable to allocate %d bytes (%d of %d in use)"), size, _used, _capacity);
+    return nullptr;
+  }
+  _last = start;
+  _used = start + size;
+  if (_used > _highWater) _highWater = _used;
+  return _block + start;
+}
+
+void* Arena::resize(void* ptr, size_t size) {
+  if (!ptr) return allocate(size);
+  size_t offset = (uint8_t*)ptr - _block;
+  if (offset != _last || size > _capacity - offset) return nullptr;
+  _used = offset + size;
+  if (_used > _highWater) _highWater = _used;
+  return ptr;
+}
+
+char* Arena::concat(const char* a, const char* b) {
+  size_t aLength = strlen(a);
+  size_t bLength = strlen(b);
+  char* s = (char*)allocate(aLength + bLength + 1);
+  if (!s) return nullptr;
+  memcpy(s, a, aLength);
+  memcpy(s + aLength, b, bLength + 1);
+  return s;
+}
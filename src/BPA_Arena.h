@@ -0,0 +1,76 @@
+#ifndef BPA_Arena_h
+#define BPA_Arena_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <stddef.h>
+#include <stdint.h>
+//                                  Third Party Libraries
+#include <ArduinoJson.h>
+//                                  Local Includes
+//--------------- End:    Includes ---------------------------------------------
+
+
+/*
+ * Arena:
+ *    A block of memory that is handed out by bumping a pointer and given back
+ *    all at once. It is meant for the temporaries of one poll: everything is
+ *    allocated as the poll runs and released by reset() when it is done.
+ *    Nothing is freed individually, so anything that must outlive the poll
+ *    has to be copied out. The block itself is allocated once, by the first
+ *    allocate() after construction.
+ */
+class Arena {
+public:
+  // A position that can be returned to, releasing what was allocated since
+  typedef size_t Mark;
+
+  explicit Arena(size_t capacity) : _capacity(capacity) { }
+  ~Arena() { delete[] _block; }
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  // Returns nullptr if the arena is full
+  void* allocate(size_t size);
+  // Grow or shrink the most recent allocation in place. Returns nullptr for
+  // any other allocation, or if there isn't room.
+  void* resize(void* ptr, size_t size);
+  // A NUL-terminated copy of the concatenation of a and b
+  char* concat(const char* a, const char* b);
+
+  Mark mark() const { return _used; }
+  void rewind(Mark mark) { if (mark < _used) { _used = mark; _last = NoAllocation; } }
+  void reset() { _used = 0; _last = NoAllocation; }
+
+  size_t capacity() const { return _capacity; }
+  size_t used() const { return _used; }
+  size_t highWater() const { return _highWater; }   // Most ever in use at once
+
+private:
+  static constexpr size_t NoAllocation = (size_t)-1;
+
+  uint8_t* _block = nullptr;
+  size_t _capacity;
+  size_t _used = 0;
+  size_t _last = NoAllocation;  // Offset of the most recent allocation
+  size_t _highWater = 0;
+};
+
+/*
+ * ArenaAllocator:
+ *    Lets an ArduinoJson document take its memory pool from an Arena, e.g.
+ *    ArenaJsonDocument doc(2048, &arena). The pool is released when the arena
+ *    is, not when the document is destroyed.
+ */
+struct ArenaAllocator {
+  ArenaAllocator(Arena* arena = nullptr) : arena(arena) { }
+  void* allocate(size_t size) { return arena ? arena->allocate(size) : nullptr; }
+  void deallocate(void*) { }
+  void* reallocate(void* ptr, size_t size) { return arena ? arena->resize(ptr, size) : nullptr; }
+
+  Arena* arena;
+};
+
+typedef BasicJsonDocument<ArenaAllocator> ArenaJsonDocument;
+
+#endif  // BPA_Arena_h
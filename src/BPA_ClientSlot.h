@@ -0,0 +1,211 @@
+#ifndef BPA_ClientSlot_h
+#define BPA_ClientSlot_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <new>
+#include <utility>
+//                                  Third Party Libraries
+#include <ArduinoLog.h>
+//                                  Local Includes
+#include "BPA_Config.h"
+#include "BPA_PrintClient.h"
+#if BPA_ENABLE_OCTO
+  #include "BPA_OctoClient.h"
+#endif
+#if BPA_ENABLE_DUET
+  #include "BPA_DuetClient.h"
+#endif
+#if BPA_ENABLE_MOONRAKER
+  #include "BPA_MoonrakerClient.h"
+#endif
+#if BPA_ENABLE_MQTT
+  #include "BPA_MqttFeed.h"
+#endif
+#if BPA_ENABLE_MOCK
+  #include "BPA_MockPrintClient.h"
+#endif
+#if BPA_ENABLE_REMOTE
+  #include "BPA_RemoteNode.h"
+#endif
+//--------------- End:    Includes ---------------------------------------------
+
+
+/*
+ * ClientSlot:
+ *    Holds any one kind of PrintClient. PrinterGroup keeps one slot per
+ *    printer in a single array. The getters dispatch with a switch on the
+ *    kind to the (final) client class, so the calls are direct and can be
+ *    inlined rather than going through the vtable.
+ *
+ *    By default the client is allocated with new when it is emplaced, so an
+ *    unused slot costs a pointer and a kind. With BPA_INPLACE_CLIENTS (see
+ *    BPA_Config.h) the client is constructed inside the slot instead, which
+ *    saves the allocations but makes every slot as large as the largest
+ *    enabled client type.
+ */
+
+// Expand to the arguments only if the corresponding client type is enabled
+#if BPA_ENABLE_OCTO
+  #define BPA_IF_OCTO(...) __VA_ARGS__
+#else
+  #define BPA_IF_OCTO(...)
+#endif
+#if BPA_ENABLE_DUET
+  #define BPA_IF_DUET(...) __VA_ARGS__
+#else
+  #define BPA_IF_DUET(...)
+#endif
+#if BPA_ENABLE_MOONRAKER
+  #define BPA_IF_MOONRAKER(...) __VA_ARGS__
+#else
+  #define BPA_IF_MOONRAKER(...)
+#endif
+#if BPA_ENABLE_MQTT
+  #define BPA_IF_MQTT(...) __VA_ARGS__
+#else
+  #define BPA_IF_MQTT(...)
+#endif
+#if BPA_ENABLE_MOCK
+  #define BPA_IF_MOCK(...) __VA_ARGS__
+#else
+  #define BPA_IF_MOCK(...)
+#endif
+#if BPA_ENABLE_REMOTE
+  #define BPA_IF_REMOTE(...) __VA_ARGS__
+#else
+  #define BPA_IF_REMOTE(...)
+#endif
+
+// Call a member on whichever client the slot holds. Calling it on an empty
+// slot is a bug in the caller; it is logged and returns a default value.
+#define BPA_SLOT_DISPATCH(...)                                          \
+  switch (_kind) {                                                      \
+    BPA_IF_OCTO(case Kind::Octo: return as<OctoClient>()->__VA_ARGS__;) \
+    BPA_IF_DUET(case Kind::Duet: return as<DuetClient>()->__VA_ARGS__;) \
+    BPA_IF_MOONRAKER(case Kind::Moonraker: return as<MoonrakerClient>()->__VA_ARGS__;) \
+    BPA_IF_MQTT(case Kind::Mqtt: return as<MqttPrintClient>()->__VA_ARGS__;) \
+    BPA_IF_MOCK(case Kind::Mock: return as<MockPrintClient>()->__VA_ARGS__;) \
+    BPA_IF_REMOTE(case Kind::Remote: return as<RemotePrintClient>()->__VA_ARGS__;) \
+    default: break;                                                     \
+  }                                                                     \
+  Log.warning(F("ClientSlot: %s called on an empty slot"), __func__); \
+  return decltype(_client->__VA_ARGS__)();
+
+class ClientSlot {
+public:
+  enum class Kind : uint8_t {Empty, Octo, Duet, Mock, Remote, Moonraker, Mqtt};
+
+  ClientSlot() { }
+  ~ClientSlot() { reset(); }
+  ClientSlot(const ClientSlot&) = delete;
+  ClientSlot& operator=(const ClientSlot&) = delete;
+
+  // ----- Construct a client in the slot, replacing any existing one
+#if BPA_ENABLE_OCTO
+  OctoClient& emplaceOcto() { return emplace<OctoClient>(Kind::Octo); }
+#endif
+#if BPA_ENABLE_DUET
+  DuetClient& emplaceDuet() { return emplace<DuetClient>(Kind::Duet); }
+#endif
+#if BPA_ENABLE_MOONRAKER
+  MoonrakerClient& emplaceMoonraker() { return emplace<MoonrakerClient>(Kind::Moonraker); }
+#endif
+#if BPA_ENABLE_MQTT
+  MqttPrintClient& emplaceMqtt() { return emplace<MqttPrintClient>(Kind::Mqtt); }
+#endif
+#if BPA_ENABLE_MOCK
+  template<typename... Args>
+  MockPrintClient& emplaceMock(Args&&... args) {
+    return emplace<MockPrintClient>(Kind::Mock, std::forward<Args>(args)...);
+  }
+#endif
+#if BPA_ENABLE_REMOTE
+  RemotePrintClient& emplaceRemote() { return emplace<RemotePrintClient>(Kind::Remote); }
+#endif
+
+  // PrintClient has no virtual destructor, so the client is destroyed as its
+  // own class
+  void reset() {
+    switch (_kind) {
+      BPA_IF_OCTO(case Kind::Octo:     destroy<OctoClient>(); break;)
+      BPA_IF_DUET(case Kind::Duet:     destroy<DuetClient>(); break;)
+      BPA_IF_MOONRAKER(case Kind::Moonraker: destroy<MoonrakerClient>(); break;)
+      BPA_IF_MQTT(case Kind::Mqtt:     destroy<MqttPrintClient>(); break;)
+      BPA_IF_MOCK(case Kind::Mock:     destroy<MockPrintClient>(); break;)
+      BPA_IF_REMOTE(case Kind::Remote: destroy<RemotePrintClient>(); break;)
+      default: break;
+    }
+    _client = nullptr;
+    _kind = Kind::Empty;
+  }
+
+  Kind kind() const { return _kind; }
+  // The client as a PrintClient, or nullptr if the slot is empty
+  PrintClient* client() { return _client; }
+
+  // ----- The PrintClient interface. The slot should not be empty.
+  void updateState() { BPA_SLOT_DISPATCH(updateState()) }
+  void acknowledgeCompletion() { BPA_SLOT_DISPATCH(acknowledgeCompletion()) }
+  void dumpToLog() { BPA_SLOT_DISPATCH(dumpToLog()) }
+  bool isPrinting() { BPA_SLOT_DISPATCH(isPrinting()) }
+  PrintClient::State getState() { BPA_SLOT_DISPATCH(getState()) }
+  float getPctComplete() { BPA_SLOT_DISPATCH(getPctComplete()) }
+  uint32_t getPrintTimeLeft() { BPA_SLOT_DISPATCH(getPrintTimeLeft()) }
+  uint32_t getElapsedTime() { BPA_SLOT_DISPATCH(getElapsedTime()) }
+  uint32_t getFilamentLength() { BPA_SLOT_DISPATCH(getFilamentLength()) }
+  String getFilename() { BPA_SLOT_DISPATCH(getFilename()) }
+  void getBedTemps(float &actual, float &target) { actual = target = 0; BPA_SLOT_DISPATCH(getBedTemps(actual, target)) }
+  void getToolTemps(float &actual, float &target) { actual = target = 0; BPA_SLOT_DISPATCH(getToolTemps(actual, target)) }
+
+private:
+  Kind _kind = Kind::Empty;
+  PrintClient* _client = nullptr;   // Into _u if BPA_INPLACE_CLIENTS, else on the heap
+#if BPA_INPLACE_CLIENTS
+  union Clients {
+    Clients() { }
+    ~Clients() { }
+    BPA_IF_OCTO(OctoClient octo;)
+    BPA_IF_DUET(DuetClient duet;)
+    BPA_IF_MOONRAKER(MoonrakerClient moonraker;)
+    BPA_IF_MQTT(MqttPrintClient mqtt;)
+    BPA_IF_MOCK(MockPrintClient mock;)
+    BPA_IF_REMOTE(RemotePrintClient remote;)
+  } _u;
+#endif
+
+  template<typename T>
+  T* as() { return static_cast<T*>(_client); }
+
+  template<typename T, typename... Args>
+  T& emplace(Kind kind, Args&&... args) {
+    reset();
+#if BPA_INPLACE_CLIENTS
+    T* t = new (&_u) T(std::forward<Args>(args)...);
+#else
+    T* t = new T(std::forward<Args>(args)...);
+#endif
+    _client = t;
+    _kind = kind;
+    return *t;
+  }
+
+  template<typename T>
+  void destroy() {
+#if BPA_INPLACE_CLIENTS
+    as<T>()->~T();
+#else
+    delete as<T>();
+#endif
+  }
+};
+
+#undef BPA_SLOT_DISPATCH
+#undef BPA_IF_OCTO
+#undef BPA_IF_DUET
+#undef BPA_IF_MOONRAKER
+#undef BPA_IF_MQTT
+#undef BPA_IF_MOCK
+#undef BPA_IF_REMOTE
+
+#endif  // BPA_ClientSlot_h
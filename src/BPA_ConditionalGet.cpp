@@ -0,0 +1,267 @@
+/*
+ * ConditionalGet:
+ *    Poll a JSON endpoint, skipping the parse when nothing has changed
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#if defined(ESP8266)
+  #include <ESP8266HTTPClient.h>
+#else
+  #include <HTTPClient.h>
+#endif
+//                                  Third Party Libraries
+#include <ArduinoLog.h>
+//                                  Local Includes
+#include "BPA_ConditionalGet.h"
+#include "BPA_Inflate.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+// Buffers for one request: taken from an arena if there is one, otherwise
+// from the heap. Either way they are released when the Scratch goes away.
+class Scratch {
+public:
+  Scratch(Arena* arena) : _arena(arena), _mark(arena ? arena->mark() : 0) { }
+  ~Scratch() {
+    if (_arena) _arena->rewind(_mark);
+    for (uint8_t i = 0; i < _nBuffers; i++) delete[] _buffers[i];
+  }
+
+  uint8_t* allocate(size_t size) {
+    if (_arena) return (uint8_t*)_arena->allocate(size);
+    if (_nBuffers == MaxBuffers) return nullptr;
+    return (_buffers[_nBuffers++] = new (std::nothrow) uint8_t[size]);
+  }
+
+private:
+  static constexpr uint8_t MaxBuffers = 2;    // The body and, if it is compressed, its inflated copy
+  Arena* _arena;
+  Arena::Mark _mark;
+  uint8_t* _buffers[MaxBuffers] = {};
+  uint8_t _nBuffers = 0;
+};
+
+
+// FNV-1a, never 0, since 0 means there is no previous body
+static constexpr uint32_t HashSeed = 2166136261u;
+static inline uint32_t hashByte(uint32_t hash, uint8_t c) { return (hash ^ c) * 16777619u; }
+static inline uint32_t finalHash(uint32_t hash) { return hash ? hash : 1; }
+
+// A body too large to buffer: replays the part that was read into a buffer,
+// then passes the rest through from the connection, hashing it all on the
+// way to the parser
+class HashingStream : public Stream {
+public:
+  HashingStream(const uint8_t* prefix, size_t prefixLength, Stream& in)
+      : _prefix(prefix), _prefixLength(prefixLength), _in(in) { }
+
+  int available() override { return (_prefixLength - _pos) + _in.available(); }
+  int read() override {
+    int c = (_pos < _prefixLength) ? _prefix[_pos++] : _in.read();
+    if (c >= 0) { _hash = hashByte(_hash, c); _length++; }
+    return c;
+  }
+  int peek() override { return (_pos < _prefixLength) ? _prefix[_pos] : _in.peek(); }
+  size_t write(uint8_t) override { return 0; }
+
+  uint32_t hash() const { return finalHash(_hash); }
+  size_t length() const { return _length; }
+
+private:
+  const uint8_t* _prefix;
+  size_t _prefixLength;
+  size_t _pos = 0;
+  Stream& _in;
+  uint32_t _hash = HashSeed;
+  size_t _length = 0;
+};
+
+// Ends the request however get() returns
+class EndOnReturn {
+public:
+  EndOnReturn(HTTPClient& http) : _http(http) { }
+  ~EndOnReturn() { _http.end(); }
+private:
+  HTTPClient& _http;
+};
+
+
+ConditionalGet::Result ConditionalGet::get(
+    const ServiceDetails& details, const char* endpoint,
+    JsonDocument& doc, PrintClient::FetchStats& stats, Arena* arena)
+{
+  constexpr uint32_t Timeout = 5000;
+  // HTTPClient takes Strings. These keep their buffers from one request to
+  // the next, so once they have grown a request allocates nothing for them.
+  static String uri;
+  static const String IfNoneMatch(F("If-None-Match"));
+  static const String AcceptEncoding(F("Accept-Encoding"));
+  static const String Encodings(F("gzip, deflate"));
+
+  WiFiClient client;
+  HTTPClient http;
+  http.useHTTP10(true);
+  http.setTimeout(Timeout);
+  uri = endpoint;
+  if (!http.begin(client, details.server, details.port, uri)) { reset(); return Failed; }
+  EndOnReturn ending(http);
+  if (!details.apiKeyName.isEmpty()) http.addHeader(details.apiKeyName, details.apiKey);
+  if (!details.user.isEmpty()) http.setAuthorization(details.user.c_str(), details.pass.c_str());
+  if (!_etag.isEmpty()) http.addHeader(IfNoneMatch, _etag);
+  http.addHeader(AcceptEncoding, Encodings);
+  const char* headers[] = {"ETag", "Content-Encoding"};
+  http.collectHeaders(headers, 2);
+
+  stats.requests++;
+  int httpCode = http.GET();
+  if (httpCode == HTTP_CODE_NOT_MODIFIED && _bodyHash) {
+    stats.notModified++;
+    return Unchanged;
+  }
+  if (httpCode != HTTP_CODE_OK) {
+    Log.warning(F("GET %s failed: %d"), endpoint, httpCode);
+    reset();
+    return Failed;
+  }
+  int size = http.getSize();      // -1 if the server didn't say
+  _etag = http.header("ETag");
+  String encoding = http.header("Content-Encoding");
+  WiFiClient* stream = http.getStreamPtr();
+
+  if (encoding.isEmpty() || strcasecmp(encoding.c_str(), "identity") == 0) {
+    // Read the body into a buffer and hash it, so that an unchanged body
+    // isn't parsed at all
+    Scratch scratch(arena);
+    size_t capacity = (size >= 0 && size < (int)MaxBodySize) ? size : MaxBodySize;
+    uint8_t* buffer = scratch.allocate(capacity);
+    if (!buffer) capacity = 0;
+    size_t length = 0;
+    uint32_t start = millis();
+    while ((size < 0 || length < (size_t)size) && (millis() - start) < Timeout) {
+      size_t available = stream->available();
+      if (!available) {
+        if (!http.connected()) break;
+        delay(1);
+        continue;
+      }
+      if (length == capacity) break;
+      int n = stream->read(buffer + length, min(available, capacity - length));
+      if (n > 0) length += n;
+    }
+    bool overflow = (length == capacity) &&
+        ((size < 0) ? (stream->available() || http.connected()) : length < (size_t)size);
+
+    if (!overflow) {
+      stats.bytesReceived += length;
+      stats.bytesDecoded += length;
+      uint32_t hash = HashSeed;
+      for (size_t i = 0; i < length; i++) hash = hashByte(hash, buffer[i]);
+      hash = finalHash(hash);
+      if (hash == _bodyHash) {
+        stats.unchanged++;
+        return Unchanged;
+      }
+      DeserializationError error = deserializeJson(doc, (const char*)buffer, length);
+      if (error) {
+        Log.warning(F("GET %s: unable to parse response: %s"), endpoint, error.c_str());
+        reset();
+        return Failed;
+      }
+      _bodyHash = hash;
+      return Changed;
+    }
+
+    // Larger than the buffer (or there was no room for one): parse what was
+    // read followed by the rest of the connection, hashing it on the way
+    HashingStream body(buffer, length, *stream);
+    body.setTimeout(Timeout);
+    DeserializationError error = deserializeJson(doc, body);
+    if (error) {
+      Log.warning(F("GET %s: unable to parse response: %s"), endpoint, error.c_str());
+      reset();
+      return Failed;
+    }
+    // The parser stops at the end of the JSON value; hash whatever follows
+    start = millis();
+    while ((http.connected() || stream->available()) && (size < 0 || body.length() < (size_t)size) &&
+           (millis() - start) < Timeout) {
+      if (body.read() < 0) delay(1);
+    }
+    stats.bytesReceived += body.length();
+    stats.bytesDecoded += body.length();
+    if (body.hash() == _bodyHash) {
+      stats.unchanged++;
+      return Unchanged;
+    }
+    _bodyHash = body.hash();
+    return Changed;
+  }
+
+  // A compressed body has to be read whole and inflated into a buffer of the
+  // same bound before it can be hashed and parsed
+  if (size > (int)MaxBodySize) {
+    Log.warning(F("GET %s: response too large (%d)"), endpoint, size);
+    reset();
+    return Failed;
+  }
+  Scratch scratch(arena);
+  size_t capacity = (size > 0) ? size : MaxBodySize;
+  uint8_t* body = scratch.allocate(capacity);
+  uint8_t* inflated = body ? scratch.allocate(MaxBodySize) : nullptr;
+  if (!inflated) {
+    Log.warning(F("GET %s: no room for response"), endpoint);
+    reset();
+    return Failed;
+  }
+  size_t length = 0;
+  uint32_t start = millis();
+  while ((http.connected() || stream->available()) && (size < 0 || length < capacity) && (millis() - start) < Timeout) {
+    size_t available = stream->available();
+    if (!available) { delay(1); continue; }
+    if (length == capacity) {
+      Log.warning(F("GET %s: response too large"), endpoint);
+      reset();
+      return Failed;
+    }
+    int n = stream->read(body + length, min(available, capacity - length));
+    if (n > 0) length += n;
+  }
+  stats.bytesReceived += length;
+
+  int inflatedLength = Inflate::decompress(
+      Inflate::formatFor(encoding, body, length), body, length, inflated, MaxBodySize, arena);
+  if (inflatedLength < 0) {
+    Log.warning(F("GET %s: unable to decode %s response"), endpoint, encoding.c_str());
+    reset();
+    return Failed;
+  }
+  stats.bytesDecoded += inflatedLength;
+
+  uint32_t hash = HashSeed;
+  for (int i = 0; i < inflatedLength; i++) hash = hashByte(hash, inflated[i]);
+  hash = finalHash(hash);
+
+  if (hash == _bodyHash) {
+    stats.unchanged++;
+    return Unchanged;
+  }
+  DeserializationError error = deserializeJson(doc, (const char*)inflated, inflatedLength);
+  if (error) {
+    Log.warning(F("GET %s: unable to parse response: %s"), endpoint, error.c_str());
+    reset();
+    return Failed;
+  }
+  _bodyHash = hash;
+  return Changed;
+}
+
+bool ConditionalGet::fetch(
+    const ServiceDetails& details, const char* endpoint,
+    JsonDocument& doc, PrintClient::FetchStats& stats, Arena* arena)
+{
+  // With no previous response there's nothing to compare against
+  ConditionalGet request;
+  return request.get(details, endpoint, doc, stats, arena) == Changed;
+}
@@ -0,0 +1,54 @@
+#ifndef BPA_ConditionalGet_h
+#define BPA_ConditionalGet_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+//                                  Third Party Libraries
+#include <ArduinoJson.h>
+#include <JSONService.h>
+//                                  Local Includes
+#include "BPA_Config.h"
+#include "BPA_PrintClient.h"
+#include "BPA_Arena.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+/*
+ * A GET of one JSON endpoint that is polled repeatedly. If the server sent an
+ * ETag last time, the request carries If-None-Match and a 304 answer means
+ * nothing changed. Otherwise the body is hashed, and if it is identical to
+ * the previous body the caller can keep the values it extracted last time.
+ *
+ * The body is read into a buffer of up to BPA_MAX_BODY_SIZE (see
+ * BPA_Config.h) and hashed, and parsed only if it changed. A body compressed
+ * with gzip or deflate is inflated into a second buffer of the same bound
+ * first. An uncompressed body too large for its buffer is parsed from the
+ * buffer and then the connection, and hashed on the way. The buffers are
+ * released before get() returns; they come from `arena` if one is given,
+ * else from the heap.
+ */
+class ConditionalGet {
+public:
+  enum Result {Failed, Unchanged, Changed};
+  static constexpr size_t MaxBodySize = BPA_MAX_BODY_SIZE;
+
+  // When Changed is returned `doc` has been filled in; when Unchanged is
+  // returned it may or may not have been (it is only when the body was too
+  // large to buffer). Counts the request in `stats`.
+  Result get(
+      const ServiceDetails& details, const char* endpoint,
+      JsonDocument& doc, PrintClient::FetchStats& stats, Arena* arena = nullptr);
+  // A plain GET of an endpoint whose response is always wanted. Returns
+  // true if `doc` was filled in.
+  static bool fetch(
+      const ServiceDetails& details, const char* endpoint,
+      JsonDocument& doc, PrintClient::FetchStats& stats, Arena* arena = nullptr);
+  // Forget the previous response, so the next one is parsed
+  void reset() { _etag = ""; _bodyHash = 0; }
+
+private:
+  String _etag;
+  uint32_t _bodyHash = 0;     // 0 if there is no previous body
+};
+
+#endif  // BPA_ConditionalGet_h
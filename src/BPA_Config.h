@@ -0,0 +1,67 @@
+#ifndef BPA_Config_h
+#define BPA_Config_h
+
+/*
+ * Compile-time selection of the features built into the library. Everything
+ * is enabled by default. A firmware that needs less can turn features off with
+ * build flags, for example in platformio.ini:
+ *
+ *    build_flags = -DBPA_ENABLE_DUET=0 -DBPA_ENABLE_MOCK=0 -DBPA_ENABLE_REMOTE=0
+ *
+ * A disabled client type is not compiled into the firmware at all. Printers configured with a disabled type are
+ * reported and left inactive by PrinterGroup::activatePrinter().
+ *
+ * The flags must be the same for every file in the build, so set them as
+ * build flags rather than with #define in a sketch.
+ */
+
+#ifndef BPA_ENABLE_OCTO
+  #define BPA_ENABLE_OCTO 1     // OctoClient
+#endif
+
+#ifndef BPA_ENABLE_DUET
+  #define BPA_ENABLE_DUET 1     // DuetClient
+#endif
+
+#ifndef BPA_ENABLE_MOONRAKER
+  #define BPA_ENABLE_MOONRAKER 1  // MoonrakerClient (Klipper)
+#endif
+
+#ifndef BPA_ENABLE_MQTT
+  #define BPA_ENABLE_MQTT 1     // MqttFeed and MqttPrintClient (OctoPrint-MQTT)
+#endif
+
+#ifndef BPA_ENABLE_MOCK
+  #define BPA_ENABLE_MOCK 1     // MockPrintClient
+#endif
+
+#ifndef BPA_ENABLE_REMOTE
+  #define BPA_ENABLE_REMOTE 1   // RemoteNode and PrinterGroup::setFederation()
+#endif
+
+// Construct each printer's client inside PrinterGroup's array of slots rather
+// than allocating it. That saves an allocation per printer, but every slot is
+// then the size of the largest enabled client type, so it only pays off when
+// most printers are active and of the larger types.
+#ifndef BPA_INPLACE_CLIENTS
+  #define BPA_INPLACE_CLIENTS 0
+#endif
+
+// The largest response body ConditionalGet buffers to compare with the last
+// one, and the largest compressed body it will accept or inflate one to. A
+// poll briefly needs this much for an uncompressed response, or twice this
+// for a compressed one. Larger uncompressed responses are still parsed, but
+// always, as they arrive.
+#ifndef BPA_MAX_BODY_SIZE
+  #define BPA_MAX_BODY_SIZE 4096
+#endif
+
+// The most detailed level of logging compiled into the library, using the
+// ArduinoLog levels (LOG_LEVEL_SILENT = 0 ... LOG_LEVEL_VERBOSE = 6). Below
+// LOG_LEVEL_VERBOSE, the dumpToLog() functions compile to nothing, removing
+// their format strings from flash and their calls from the refresh path.
+#ifndef BPA_LOG_LEVEL
+  #define BPA_LOG_LEVEL 6
+#endif
+
+#endif  // BPA_Config_h
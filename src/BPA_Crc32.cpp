@@ -0,0 +1,29 @@
+/*
+ * Crc32:
+ *    The zlib CRC-32
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+//                                  Third Party Libraries
+//                                  Local Includes
+#include "BPA_Crc32.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+// The CRC of each 4 bit value
+static const uint32_t NibbleTable[16] = {
+  0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+  0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+void Crc32::update(const uint8_t* data, size_t length) {
+  uint32_t crc = _crc;
+  while (length--) {
+    crc ^= *data++;
+    crc = (crc >> 4) ^ NibbleTable[crc & 0x0F];
+    crc = (crc >> 4) ^ NibbleTable[crc & 0x0F];
+  }
+  _crc = crc;
+}
@@ -0,0 +1,56 @@
+#ifndef BPA_Crc32_h
+#define BPA_Crc32_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <stddef.h>
+#include <stdint.h>
+#include <Arduino.h>
+//                                  Third Party Libraries
+//                                  Local Includes
+//--------------- End:    Includes ---------------------------------------------
+
+
+/*
+ * Crc32:
+ *    The CRC-32 used by zlib/gzip (reflected, polynomial 0xEDB88320). It is
+ *    computed four bits at a time from a 64 byte table, rather than a byte at
+ *    a time from the usual 1KB one. Data can be fed in pieces with update(),
+ *    or checked in one go with Crc32::of().
+ */
+class Crc32 {
+public:
+  void update(const uint8_t* data, size_t length);
+  uint32_t value() const { return ~_crc; }
+
+  static uint32_t of(const uint8_t* data, size_t length) {
+    Crc32 crc;
+    crc.update(data, length);
+    return crc.value();
+  }
+
+private:
+  uint32_t _crc = 0xFFFFFFFF;
+};
+
+// A Print that passes everything through to another one, keeping the CRC of
+// what went by, so an encoder can append a checksum to its output as it
+// streams it
+class Crc32Print : public Print {
+public:
+  explicit Crc32Print(Print& out) : _out(out) { }
+
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* buffer, size_t size) override {
+    _crc.update(buffer, size);
+    return _out.write(buffer, size);
+  }
+
+  uint32_t crc() const { return _crc.value(); }
+
+private:
+  Print& _out;
+  Crc32 _crc;
+};
+
+#endif  // BPA_Crc32_h
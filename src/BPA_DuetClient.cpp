@@ -1,285 +1,406 @@
-/*
- * DuetClient:
- *    A simple client to get information from (not control) Duet3D controllers 
- *                    
- * TO DO:
- *
- * COMPLETE:
- *
- */
-
-
-//--------------- Begin:  Includes ---------------------------------------------
-//                                  Core Libraries
-//                                  Third Party Libraries
-#include <ArduinoLog.h>
-//                                  Local Includes
-#include "BPA_DuetClient.h"
-//--------------- End:    Includes ---------------------------------------------
-
-
-/*------------------------------------------------------------------------------
- *
- * Public Methods
- *
- *----------------------------------------------------------------------------*/
-
-// ----- Constructors and initialization
-
-void DuetClient::init(String server, int port, String pass) {
-  details.server = server;
-  details.port = port;
-  details.pass = pass;
-  details.apiKey = "";
-  details.apiKeyName = "";
-  if (service) delete service;
-  service = new JSONService(details);
-  rrState.reset();
-  fileInfo.reset();
-}
-
-// ----- Interrogate the Printer
-
-void DuetClient::updateState() {
-  if (connect()) {
-    PrintClient::State oldState = printerState;  // Let's see if this changes...
-    getRRState();                       // Refresh the RepRap State
-    updateDerivedValues();
-    if ((oldState < Printing && printerState == Printing) ||
-        (printerState == Printing && fileInfo.err)) {
-      // We don't have file info for the file that's printing!!
-      // Get it and recompute the derived values.
-      getFileInfo();
-      updateDerivedValues();
-    }
-    disconnect();
-  } else {
-    printerState = PrintClient::State::Offline;
-  }
-}
-
-// ----- Getters
-
-DuetClient::State DuetClient::getState() { return printerState; }
-
-bool DuetClient::isPrinting() { return printerState == PrintClient::State::Printing; }
-
-float DuetClient::getPctComplete() {
-  if (printerState == Offline || printerState == Operational) return 0.0f;
-  if (printerState == Complete) return 100.0f;
-  // Assert(printerState == Printing)
-  if (printTimeEstimate == 0) return 0.0f;
-  return (elapsed*100.0f)/((float)printTimeEstimate);
-}
-
-uint32_t DuetClient::getPrintTimeLeft() {
-  if (printerState == Printing) return printTimeEstimate - elapsed;
-  // Assert(printerState == Offline | Operational | Complete)
-  return 0;
-}
-
-uint32_t DuetClient::getElapsedTime() {
-  if (printerState == Offline || printerState == Operational) return 0;
-  // Assert(printerState == Complete | Printing)
-  return elapsed;
-}
-
-String DuetClient::getFilename() {
-  if (printerState == Offline || printerState == Operational) return "No File";
-  // Assert(printerState == Complete | Printing)
-  return fileInfo.name;
-}
-
-void DuetClient::getBedTemps(float &actual, float &target) {
-  if (printerState == Offline) { actual = target = 0.0f; return; }
-  actual = rrState.bedTemp.actual;
-  target = rrState.bedTemp.target;
-}
-
-void DuetClient::getToolTemps(float &actual, float &target) {
-  if (printerState == Offline) { actual = target = 0.0f; return; }
-  actual = rrState.toolTemp.actual;
-  target = rrState.toolTemp.target;
-}
-
-// ----- Public Utility Methods
-
-void DuetClient::acknowledgeCompletion() {
-  if (printerState == Complete) {
-    printerState = Operational;
-  }
-}
-
-static const char *_PrintStateNames[] = {"Offline", "Operational", "Complete", "Printing"};
-
-void DuetClient::dumpToLog() {
-  Log.verbose(F("----- Derived Values -----"));
-  Log.verbose(F("  printerState: %s"), _PrintStateNames[printerState]);
-  Log.verbose(F("  printTimeEstimate: %d"), printTimeEstimate);
-  Log.verbose(F("  elapsed: %F"), elapsed);
-  fileInfo.dumpToLog();
-  rrState.dumpToLog();
-}
-
-/*------------------------------------------------------------------------------
- *
- * Private methods
- *
- *----------------------------------------------------------------------------*/
-
-bool DuetClient::connect() {
-  constexpr uint32_t RRConnectJSONSize = 128;
-  String RRConnectEndpoint = "/rr_connect?password=";
-
-  RRConnectEndpoint += (details.pass.isEmpty()) ? "reprap" : details.pass;
-  DynamicJsonDocument *root = service->issueGET(RRConnectEndpoint, RRConnectJSONSize);
-  if (!root) {
-    Log.warning(F("issueGET failed for RRConnect (%s)"), RRConnectEndpoint.c_str());
-    return false;
-  }
-  // serializeJsonPretty(*root, Serial); Serial.println();
-
-  int err = (*root)["err"];
-  delete root;
-
-  if (err) { Log.warning(F("rr_connect error: %d"), err); return false; }
-  return true;
-}
-
-bool DuetClient::disconnect() {
-  constexpr uint32_t RRDisonnectJSONSize = 128;
-  constexpr const char* RRDisconnectEndpoint = "/rr_disconnect";
-
-  DynamicJsonDocument *root = service->issueGET(RRDisconnectEndpoint, RRDisonnectJSONSize);
-  if (!root) {
-    Log.warning(F("issueGET failed for RRDisconnect"));
-    return false;
-  }
-  // serializeJsonPretty(*root, Serial); Serial.println();
-
-  int err = (*root)["err"];
-  delete root;
-
-  if (err) { Log.warning(F("rr_disconnect error: %d"), err); return false; }
-  return true;
-}
-
-void DuetClient::getRRState() {
-  constexpr const char* RRStateEndpoint = "/rr_status?type=3";
-  constexpr uint32_t RRStateJSONSize = 3000;
-
-  DynamicJsonDocument *root = service->issueGET(RRStateEndpoint, RRStateJSONSize);
-  if (!root) {
-    Log.warning(F("issueGET failed for RRState"));
-    rrState.reset();
-    return;
-  }
-  //serializeJsonPretty(*root, Serial); Serial.println();
-
-  rrState.status = (*root)["status"].as<String>();
-
-  rrState.warmupDuration = (*root)["warmUpDuration"];
-  rrState.printDuration = (*root)["printDuration"];
-  rrState.remaining[0] = (*root)["timesLeft"]["file"];
-  rrState.remaining[1] = (*root)["timesLeft"]["filament"];
-  rrState.remaining[2] = (*root)["timesLeft"]["layer"];
-
-  rrState.toolTemp.actual = (*root)["temps"]["current"][1];
-  rrState.toolTemp.target = (*root)["temps"]["tools"]["active"][0][0];
-  rrState.bedTemp.actual  = (*root)["temps"]["bed"]["current"];
-  rrState.bedTemp.target  = (*root)["temps"]["bed"]["active"];
-
-  timeOfLastUpdate = millis();
-  delete root;
-}
-
-void DuetClient::getFileInfo() {
-  constexpr const char* FileInfoEndpoint = "/rr_fileinfo";
-  constexpr uint32_t FileInfoJSONSize = 1024;
-
-  DynamicJsonDocument *root = service->issueGET(FileInfoEndpoint, FileInfoJSONSize);
-  if (!root) {
-    Log.warning(F("issueGET failed for FileInfo"));
-    fileInfo.reset();
-    return;
-  }
-  // serializeJsonPretty(*root, Serial); Serial.println();
-
-  fileInfo.err = (*root)["err"];
-  if (fileInfo.err) {
-    // We may have an error because the previous job has completed and there
-    // is no new file. In that case, leave the data intact so it can continue
-    // to be used. If it is a "normal" error, clear out the fileInfo and return;
-    int savedErr = fileInfo.err;
-    if (printerState != PrintClient::State::Complete) { fileInfo.reset(); fileInfo.err = savedErr; }
-    timeOfLastUpdate = millis();
-    delete root;
-    return;
-  }
-
-  fileInfo.name = (*root)["fileName"].as<String>();
-  int index = fileInfo.name.lastIndexOf('/');
-  if (index != -1) { fileInfo.name.remove(0, index+1); }
-
-  fileInfo.size = (*root)["size"];
-  fileInfo.generatedBy = (*root)["generatedBy"].as<String>();
-  fileInfo.lastModified = (*root)["lastModified"].as<String>();
-  fileInfo.height = (*root)["height"];
-  fileInfo.printTime = (*root)["printTime"];
-
-  fileInfo.filament = 0;
-  JsonArray filaments = (*root)["filament"];
-  for (JsonVariant value : filaments) {
-    uint32_t thisFilament = value;
-    fileInfo.filament += thisFilament;
-  }
-
-  fileInfo.firstLayerHeight = (*root)["firstLayerHeight"];
-  fileInfo.layerHeight = (*root)["layerHeight"];
-
-  timeOfLastUpdate = millis();
-  delete root;
-}
-
-void DuetClient::updateDerivedValues() {
-  // Update printerState
-  if (rrState.status.isEmpty()) { printerState = Offline; }
-  else {
-    char s = rrState.status[0];
-    switch (s) {
-      case 'D':
-      case 'S':
-      case 'R':
-      case 'P':
-      case 'M':
-        printerState = Printing;
-        break;
-      default:
-        if (printerState == Printing) {
-          // We've transitioned from printing to not-printing
-          // In this case we call the print complete
-          printerState = Complete;
-          printTimeEstimate = elapsed; // Force it to be 100% complete.
-        } else if (printerState != Complete) { printerState = Operational; }
-        break;
-    }
-  }
-
-  if (printerState == Printing) {
-    // Update derived values that are relevant to active prints
-    elapsed = rrState.printDuration - rrState.warmupDuration;
-    // Ensure that printTimeEstimate >= elapsed
-    if (elapsed < fileInfo.printTime) { printTimeEstimate = fileInfo.printTime; }
-    else {
-      // We've already been printing longer than the estimated time based on the slicer
-      // so start looking at the other estimates and use one of those. Use the smallest
-      // non-zero value of the {file,filament,layer} estimates.
-      float newPTE = 60;  // Add a minute if there are no non-zero values
-      for (int i = 0; i < 3; i++) {
-        float timeLeft = rrState.remaining[i];
-        if ((timeLeft > 0.5) && (timeLeft < newPTE)) newPTE = timeLeft;
-      }
-      printTimeEstimate = elapsed + newPTE;
-    }
-  }
-}
+/*
+ * DuetClient:
+ *    A simple client to get information from (not control) Duet3D controllers 
+ *                    
+ * TO DO:
+ *
+ * COMPLETE:
+ *
+ */
+
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+//                                  Third Party Libraries
+#include <ArduinoLog.h>
+//                                  Local Includes
+#include "BPA_Config.h"
+#include "BPA_DuetClient.h"
+//--------------- End:    Includes ---------------------------------------------
+
+#if BPA_ENABLE_DUET
+
+
+// Decodes base64 text as it is written and passes the bytes along
+class Base64Print : public Print {
+public:
+  Base64Print(Print& out) : _out(out) { }
+
+  size_t write(uint8_t c) {
+    int value;
+    if (c >= 'A' && c <= 'Z') value = c - 'A';
+    else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+    else if (c >= '0' && c <= '9') value = c - '0' + 52;
+    else if (c == '+') value = 62;
+    else if (c == '/') value = 63;
+    else return 1;    // Padding or whitespace
+    _bits = (_bits << 6) | value;
+    _nBits += 6;
+    if (_nBits >= 8) {
+      _nBits -= 8;
+      _out.write((uint8_t)(_bits >> _nBits));
+    }
+    return 1;
+  }
+
+private:
+  Print& _out;
+  uint32_t _bits = 0;
+  uint8_t _nBits = 0;
+};
+
+Arena*   DuetClient::pollArena = nullptr;
+uint16_t DuetClient::nClients = 0;
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Public Methods
+ *
+ *----------------------------------------------------------------------------*/
+
+// ----- Constructors and initialization
+
+DuetClient::DuetClient() {
+  if (nClients++ == 0) pollArena = new Arena(PollArenaSize);
+}
+
+DuetClient::~DuetClient() {
+  if (--nClients == 0) { delete pollArena; pollArena = nullptr; }
+}
+
+void DuetClient::init(String server, int port, String pass) {
+  details.server = server;
+  details.port = port;
+  details.pass = pass;
+  details.apiKey = "";
+  details.apiKeyName = "";
+  service.emplace(details);
+  rrState.reset();
+  fileInfo.reset();
+  statusRequest.reset();
+}
+
+// ----- Interrogate the Printer
+
+void DuetClient::updateState() {
+  Arena& arena = *pollArena;
+  arena.reset();
+  bool connected = connect(arena);
+  arena.reset();
+  if (connected) {
+    PrintClient::State oldState = printerState;  // Let's see if this changes...
+    getRRState(arena);                  // Refresh the RepRap State
+    arena.reset();
+    updateDerivedValues();
+    if ((oldState < Printing && printerState == Printing) ||
+        (printerState == Printing && fileInfo.err)) {
+      // We don't have file info for the file that's printing!!
+      // Get it and recompute the derived values.
+      getFileInfo(arena);
+      arena.reset();
+      updateDerivedValues();
+    }
+    disconnect(arena);
+    arena.reset();
+  } else {
+    printerState = PrintClient::State::Offline;
+  }
+}
+
+// ----- Thumbnails
+
+String DuetClient::getThumbnailKey() {
+  if (fileInfo.path.isEmpty() || fileInfo.thumbnailOffset == 0) return String();
+  String key = fileInfo.path;
+  key += '@';
+  key += fileInfo.lastModified;
+  return key;
+}
+
+bool DuetClient::streamThumbnail(Print& out) {
+  constexpr uint32_t ThumbnailJSONSize = 2048;
+  constexpr uint16_t MaxChunks = 256;
+
+  uint32_t offset = fileInfo.thumbnailOffset;
+  Arena& arena = *pollArena;
+  arena.reset();
+  bool connected = offset && connect(arena);
+  arena.reset();
+  if (!connected) return false;
+
+  // The firmware returns the thumbnail embedded in the gcode a chunk at a
+  // time, base64 encoded. Decode each chunk straight into `out`.
+  Base64Print decoder(out);
+  String name = urlEncode(fileInfo.path);
+  for (uint16_t chunk = 0; offset && chunk < MaxChunks; chunk++) {
+    String endpoint = "/rr_thumbnail?name=";
+    endpoint += name;
+    endpoint += "&offset=";
+    endpoint += offset;
+    DynamicJsonDocument *root = service->issueGET(endpoint, ThumbnailJSONSize);
+    if (!root) { Log.warning(F("issueGET failed for thumbnail")); break; }
+    int err = (*root)["err"];
+    const char* data = (*root)["data"];
+    offset = err ? 0 : (*root)["next"];
+    if (data) decoder.print(data);
+    delete root;
+    if (err || !data) { offset = 1; break; }    // Mark as incomplete
+  }
+  disconnect(arena);
+  arena.reset();
+  return offset == 0;
+}
+
+// ----- Getters
+
+DuetClient::State DuetClient::getState() { return printerState; }
+
+bool DuetClient::isPrinting() { return printerState == PrintClient::State::Printing; }
+
+float DuetClient::getPctComplete() {
+  if (printerState == Offline || printerState == Operational) return 0.0f;
+  if (printerState == Complete) return 100.0f;
+  // Assert(printerState == Printing)
+  if (printTimeEstimate == 0) return 0.0f;
+  return (elapsed*100.0f)/((float)printTimeEstimate);
+}
+
+uint32_t DuetClient::getPrintTimeLeft() {
+  if (printerState == Printing) return printTimeEstimate - elapsed;
+  // Assert(printerState == Offline | Operational | Complete)
+  return 0;
+}
+
+uint32_t DuetClient::getElapsedTime() {
+  if (printerState == Offline || printerState == Operational) return 0;
+  // Assert(printerState == Complete | Printing)
+  return elapsed;
+}
+
+uint32_t DuetClient::getFilamentLength() {
+  if (printerState == Offline || printerState == Operational) return 0;
+  // Assert(printerState == Complete | Printing)
+  return fileInfo.filament;
+}
+
+String DuetClient::getFilename() {
+  if (printerState == Offline || printerState == Operational) return "No File";
+  // Assert(printerState == Complete | Printing)
+  return fileInfo.name;
+}
+
+void DuetClient::getBedTemps(float &actual, float &target) {
+  if (printerState == Offline) { actual = target = 0.0f; return; }
+  actual = rrState.bedTemp.actual;
+  target = rrState.bedTemp.target;
+}
+
+void DuetClient::getToolTemps(float &actual, float &target) {
+  if (printerState == Offline) { actual = target = 0.0f; return; }
+  actual = rrState.toolTemp.actual;
+  target = rrState.toolTemp.target;
+}
+
+// ----- Public Utility Methods
+
+void DuetClient::acknowledgeCompletion() {
+  if (printerState == Complete) {
+    printerState = Operational;
+  }
+}
+
+#if BPA_LOG_LEVEL >= LOG_LEVEL_VERBOSE
+static const char *_PrintStateNames[] = {"Offline", "Operational", "Complete", "Printing"};
+
+void DuetClient::dumpToLog() {
+  Log.verbose(F("----- Derived Values -----"));
+  Log.verbose(F("  printerState: %s"), _PrintStateNames[printerState]);
+  Log.verbose(F("  printTimeEstimate: %d"), printTimeEstimate);
+  Log.verbose(F("  elapsed: %F"), elapsed);
+  fileInfo.dumpToLog();
+  rrState.dumpToLog();
+}
+#else
+void DuetClient::dumpToLog() { }
+#endif
+
+/*------------------------------------------------------------------------------
+ *
+ * Private methods
+ *
+ *----------------------------------------------------------------------------*/
+
+bool DuetClient::connect(Arena& arena) {
+  constexpr uint32_t RRConnectJSONSize = 128;
+  constexpr const char* RRConnectEndpoint = "/rr_connect?password=";
+
+  const char* endpoint = arena.concat(RRConnectEndpoint, details.pass.isEmpty() ? "reprap" : details.pass.c_str());
+  ArenaJsonDocument doc(RRConnectJSONSize, &arena);
+  if (!endpoint || !ConditionalGet::fetch(details, endpoint, doc, fetchStats, &arena)) {
+    Log.warning(F("GET failed for RRConnect (%s)"), details.server.c_str());
+    return false;
+  }
+  // serializeJsonPretty(doc, Serial); Serial.println();
+
+  int err = doc["err"];
+
+  if (err) { Log.warning(F("rr_connect error: %d"), err); return false; }
+  return true;
+}
+
+bool DuetClient::disconnect(Arena& arena) {
+  constexpr uint32_t RRDisonnectJSONSize = 128;
+  constexpr const char* RRDisconnectEndpoint = "/rr_disconnect";
+
+  ArenaJsonDocument doc(RRDisonnectJSONSize, &arena);
+  if (!ConditionalGet::fetch(details, RRDisconnectEndpoint, doc, fetchStats, &arena)) {
+    Log.warning(F("GET failed for RRDisconnect"));
+    return false;
+  }
+  // serializeJsonPretty(doc, Serial); Serial.println();
+
+  int err = doc["err"];
+
+  if (err) { Log.warning(F("rr_disconnect error: %d"), err); return false; }
+  return true;
+}
+
+void DuetClient::getRRState(Arena& arena) {
+  constexpr const char* RRStateEndpoint = "/rr_status?type=3";
+
+  // An idle printer reports the same status every time; skip the parse if so
+  ArenaJsonDocument doc(RRStateJSONSize, &arena);
+  switch (statusRequest.get(details, RRStateEndpoint, doc, fetchStats, &arena)) {
+    case ConditionalGet::Failed:
+      Log.warning(F("GET failed for RRState"));
+      rrState.reset();
+      return;
+    case ConditionalGet::Unchanged:
+      timeOfLastUpdate = millis();
+      return;
+    case ConditionalGet::Changed:
+      break;
+  }
+  //serializeJsonPretty(doc, Serial); Serial.println();
+
+  rrState.status = doc["status"] | "";
+
+  rrState.warmupDuration = doc["warmUpDuration"];
+  rrState.printDuration = doc["printDuration"];
+  rrState.remaining[0] = doc["timesLeft"]["file"];
+  rrState.remaining[1] = doc["timesLeft"]["filament"];
+  rrState.remaining[2] = doc["timesLeft"]["layer"];
+
+  rrState.toolTemp.actual = doc["temps"]["current"][1];
+  rrState.toolTemp.target = doc["temps"]["tools"]["active"][0][0];
+  rrState.bedTemp.actual  = doc["temps"]["bed"]["current"];
+  rrState.bedTemp.target  = doc["temps"]["bed"]["active"];
+
+  timeOfLastUpdate = millis();
+}
+
+void DuetClient::getFileInfo(Arena& arena) {
+  constexpr const char* FileInfoEndpoint = "/rr_fileinfo";
+
+  ArenaJsonDocument doc(FileInfoJSONSize, &arena);
+  if (!ConditionalGet::fetch(details, FileInfoEndpoint, doc, fetchStats, &arena)) {
+    Log.warning(F("GET failed for FileInfo"));
+    fileInfo.reset();
+    return;
+  }
+  // serializeJsonPretty(doc, Serial); Serial.println();
+
+  fileInfo.err = doc["err"];
+  if (fileInfo.err) {
+    // We may have an error because the previous job has completed and there
+    // is no new file. In that case, leave the data intact so it can continue
+    // to be used. If it is a "normal" error, clear out the fileInfo and return;
+    int savedErr = fileInfo.err;
+    if (printerState != PrintClient::State::Complete) { fileInfo.reset(); fileInfo.err = savedErr; }
+    timeOfLastUpdate = millis();
+    return;
+  }
+
+  // Copy the strings straight out of the document; the Strings keep their
+  // buffers from one file to the next
+  const char* path = doc["fileName"] | "";
+  const char* slash = strrchr(path, '/');
+  fileInfo.path = path;
+  fileInfo.name = slash ? slash + 1 : path;
+
+  fileInfo.size = doc["size"];
+  fileInfo.generatedBy = doc["generatedBy"] | "";
+  fileInfo.lastModified = doc["lastModified"] | "";
+  fileInfo.height = doc["height"];
+  fileInfo.printTime = doc["printTime"];
+
+  fileInfo.filament = 0;
+  JsonArray filaments = doc["filament"];
+  for (JsonVariant value : filaments) {
+    uint32_t thisFilament = value;
+    fileInfo.filament += thisFilament;
+  }
+
+  fileInfo.firstLayerHeight = doc["firstLayerHeight"];
+  fileInfo.layerHeight = doc["layerHeight"];
+
+  // Use the largest of the thumbnails embedded by the slicer
+  fileInfo.thumbnailOffset = 0;
+  uint16_t thumbnailWidth = 0;
+  JsonArray thumbnails = doc["thumbnails"];
+  for (JsonObject thumbnail : thumbnails) {
+    uint16_t width = thumbnail["width"];
+    if (width > thumbnailWidth) {
+      thumbnailWidth = width;
+      fileInfo.thumbnailOffset = thumbnail["offset"];
+    }
+  }
+
+  timeOfLastUpdate = millis();
+}
+
+void DuetClient::updateDerivedValues() {
+  // Update printerState
+  if (rrState.status.isEmpty()) { printerState = Offline; }
+  else {
+    char s = rrState.status[0];
+    switch (s) {
+      case 'D':
+      case 'S':
+      case 'R':
+      case 'P':
+      case 'M':
+        printerState = Printing;
+        break;
+      default:
+        if (printerState == Printing) {
+          // We've transitioned from printing to not-printing
+          // In this case we call the print complete
+          printerState = Complete;
+          printTimeEstimate = elapsed; // Force it to be 100% complete.
+        } else if (printerState != Complete) { printerState = Operational; }
+        break;
+    }
+  }
+
+  if (printerState == Printing) {
+    // Update derived values that are relevant to active prints
+    elapsed = rrState.printDuration - rrState.warmupDuration;
+    // Ensure that printTimeEstimate >= elapsed
+    if (elapsed < fileInfo.printTime) { printTimeEstimate = fileInfo.printTime; }
+    else {
+      // We've already been printing longer than the estimated time based on the slicer
+      // so start looking at the other estimates and use one of those. Use the smallest
+      // non-zero value of the {file,filament,layer} estimates.
+      float newPTE = 60;  // Add a minute if there are no non-zero values
+      for (int i = 0; i < 3; i++) {
+        float timeLeft = rrState.remaining[i];
+        if ((timeLeft > 0.5) && (timeLeft < newPTE)) newPTE = timeLeft;
+      }
+      printTimeEstimate = elapsed + newPTE;
+    }
+  }
+}
+
+#endif  // BPA_ENABLE_DUET
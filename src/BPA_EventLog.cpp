@@ -0,0 +1,53 @@
+/*
+ * EventLog:
+ *    A ring buffer of binary events for logging without formatting on the
+ *    device.
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+//                                  Third Party Libraries
+//                                  Local Includes
+#include "BPA_EventLog.h"
+#include "BPA_Crc32.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+EventLog::EventLog(uint16_t capacity) {
+  _capacity = capacity ? capacity : 1;
+  _events = new Event[_capacity];
+}
+
+EventLog::~EventLog() {
+  delete[] _events;
+}
+
+void EventLog::record(uint8_t printer, EventID id, uint16_t a, uint32_t b, uint32_t c) {
+  Event& e = _events[_next];
+  e.time = millis();
+  e.printer = printer;
+  e.id = id;
+  e.a = a;
+  e.b = b;
+  e.c = c;
+  _next = (_next + 1) % _capacity;
+  if (_count < _capacity) _count++;
+}
+
+void EventLog::write(Print& output) const {
+  Crc32Print out(output);
+  uint8_t header[8] = {'B', 'P', 'E', Version, (uint8_t)_count, (uint8_t)(_count >> 8), 0, 0};
+  out.write(header, sizeof(header));
+  uint16_t first = (_next + _capacity - _count) % _capacity;
+  // The oldest events are at [first, end), then [0, _next)
+  if (first + _count <= _capacity) {
+    out.write((const uint8_t*)&_events[first], _count * sizeof(Event));
+  } else {
+    out.write((const uint8_t*)&_events[first], (_capacity - first) * sizeof(Event));
+    out.write((const uint8_t*)&_events[0], _next * sizeof(Event));
+  }
+  uint32_t crc = out.crc();
+  uint8_t trailer[4] = {(uint8_t)crc, (uint8_t)(crc >> 8), (uint8_t)(crc >> 16), (uint8_t)(crc >> 24)};
+  output.write(trailer, sizeof(trailer));
+}
@@ -0,0 +1,65 @@
+#ifndef BPA_EventLog_h
+#define BPA_EventLog_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <Arduino.h>
+//                                  Third Party Libraries
+//                                  Local Includes
+//--------------- End:    Includes ---------------------------------------------
+
+
+/*
+ * A fixed-size ring buffer of small binary events. Recording an event copies
+ * 16 bytes; nothing is formatted on the device. The buffer can be written out
+ * (e.g. to a web request or a file) and decoded elsewhere, for example with
+ * extras/host/tools/eventlog_dump.
+ *
+ * Layout of write() output (all values little-endian):
+ *   Header (8 bytes)
+ *     char[3]  magic = "BPE"
+ *     uint8    version
+ *     uint16   nEvents
+ *     uint16   reserved
+ *   Then nEvents Events (below), oldest first
+ *   Trailer
+ *     uint32   crc           CRC-32 (see BPA_Crc32.h) of everything before it
+ *
+ * Version 1 had no trailer.
+ */
+class EventLog {
+public:
+  static constexpr uint8_t Version = 2;
+
+  enum EventID : uint8_t {
+    Event_Poll = 1,         // a: state | pct << 8,  b: poll time (ms),  c: time left (sec)
+    Event_StateChange = 2,  // a: old state | new state << 8
+    Event_JobEnd = 3,       // a: JobLog::Outcome,   b: duration (sec),  c: filament (mm)
+  };
+
+  struct __attribute__((packed)) Event {
+    uint32_t time;          // millis()
+    uint8_t  printer;       // Index of the printer within its PrinterGroup
+    uint8_t  id;            // An EventID
+    uint16_t a;
+    uint32_t b;
+    uint32_t c;
+  };
+  static_assert(sizeof(Event) == 16, "EventLog::Event must stay 16 bytes");
+
+  EventLog(uint16_t capacity);
+  ~EventLog();
+
+  void record(uint8_t printer, EventID id, uint16_t a, uint32_t b = 0, uint32_t c = 0);
+  uint16_t size() const { return _count; }
+  void clear() { _count = 0; _next = 0; }
+  void write(Print& out) const;
+
+private:
+  Event* _events;
+  uint16_t _capacity;
+  uint16_t _count = 0;
+  uint16_t _next = 0;
+};
+
+#endif  // BPA_EventLog_h
@@ -0,0 +1,139 @@
+/*
+ * GroupSnapshot:
+ *    Encode and decode a compact binary snapshot of the state of a group
+ *    of printers.
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+//                                  Third Party Libraries
+//                                  Local Includes
+#include "BPA_GroupSnapshot.h"
+#include "BPA_Crc32.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+static void writeU32(Print& out, uint32_t v) {
+  uint8_t b[4] = {(uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24)};
+  out.write(b, 4);
+}
+
+static void writeTemp(Print& out, float t) {
+  int16_t v = (int16_t)(t * 10.0f + (t < 0 ? -0.5f : 0.5f));
+  uint8_t b[2] = {(uint8_t)v, (uint8_t)(v >> 8)};
+  out.write(b, 2);
+}
+
+static void writeString(Print& out, const String& s) {
+  uint8_t length = min(s.length(), (unsigned int)UINT8_MAX);
+  out.write(length);
+  out.write((const uint8_t*)s.c_str(), length);
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Encoding
+ *
+ *----------------------------------------------------------------------------*/
+
+void GroupSnapshot::writeHeader(Print& out, uint32_t time, uint8_t nPrinters) {
+  uint8_t header[4] = {'B', 'P', 'G', Version};
+  out.write(header, 4);
+  writeU32(out, time);
+  uint8_t rest[4] = {nPrinters, 0, 0, 0};
+  out.write(rest, 4);
+}
+
+void GroupSnapshot::writePrinter(
+    Print& out, const Printer& p, const String& name, const String& file)
+{
+  uint8_t head[4] = {(uint8_t)(p.active ? Flag_Active : 0), (uint8_t)p.state, p.pct, 0};
+  out.write(head, 4);
+  writeU32(out, p.elapsed);
+  writeU32(out, p.timeLeft);
+  writeTemp(out, p.bedActual);
+  writeTemp(out, p.bedTarget);
+  writeTemp(out, p.toolActual);
+  writeTemp(out, p.toolTarget);
+  writeString(out, name);
+  writeString(out, file);
+}
+
+void GroupSnapshot::writeTrailer(Print& out, uint32_t crc) {
+  writeU32(out, crc);
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Decoding
+ *
+ *----------------------------------------------------------------------------*/
+
+GroupSnapshot::GroupSnapshot(const uint8_t* data, size_t length) {
+  _data = data;
+  _valid = (length >= HeaderSize + TrailerSize) &&
+           data[0] == 'B' && data[1] == 'P' && data[2] == 'G' && data[3] == Version;
+  // The records end where the trailer starts
+  _length = _valid ? length - TrailerSize : 0;
+  if (_valid) {
+    const uint8_t* t = data + _length;
+    uint32_t crc = t[0] | (t[1] << 8) | ((uint32_t)t[2] << 16) | ((uint32_t)t[3] << 24);
+    _valid = (crc == Crc32::of(data, _length));
+  }
+}
+
+uint32_t GroupSnapshot::time() const {
+  if (!_valid) return 0;
+  return _data[4] | (_data[5] << 8) | ((uint32_t)_data[6] << 16) | ((uint32_t)_data[7] << 24);
+}
+
+bool GroupSnapshot::first(PrinterView& view) const {
+  if (!_valid || numberOfPrinters() == 0) return false;
+  view._index = 0;
+  return viewAt(_data + HeaderSize, view);
+}
+
+bool GroupSnapshot::next(PrinterView& view) const {
+  if (view._rec == nullptr || view._index + 1 >= numberOfPrinters()) return false;
+  view._index++;
+  return viewAt(view._rec + view._size, view);
+}
+
+bool GroupSnapshot::printer(uint8_t index, PrinterView& view) const {
+  if (index >= numberOfPrinters()) return false;
+  bool ok = first(view);
+  while (ok && index--) ok = next(view);
+  return ok;
+}
+
+bool GroupSnapshot::index(uint16_t* offsets) const {
+  if (!_valid || _length > UINT16_MAX) return false;
+  PrinterView v;
+  int i = 0;
+  for (bool ok = first(v); ok; ok = next(v)) offsets[i++] = v._rec - _data;
+  return i == numberOfPrinters();
+}
+
+bool GroupSnapshot::printerAt(uint8_t index, const uint16_t* offsets, PrinterView& view) const {
+  if (index >= numberOfPrinters()) return false;
+  view._index = index;
+  return viewAt(_data + offsets[index], view);
+}
+
+// Set up `view` to refer to the record at `rec`, checking that the whole record
+// lies within the buffer
+bool GroupSnapshot::viewAt(const uint8_t* rec, PrinterView& view) const {
+  const uint8_t* end = _data + _length;
+  view._rec = nullptr;
+  if (rec + FixedRecordSize + 1 > end) return false;
+  const uint8_t* fileLength = rec + FixedRecordSize + 1 + rec[FixedRecordSize];
+  if (fileLength + 1 > end) return false;
+  const uint8_t* recEnd = fileLength + 1 + *fileLength;
+  if (recEnd > end) return false;
+  view._rec = rec;
+  view._size = recEnd - rec;
+  return true;
+}
@@ -0,0 +1,132 @@
+#ifndef BPA_GroupSnapshot_h
+#define BPA_GroupSnapshot_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <Arduino.h>
+//                                  Third Party Libraries
+//                                  Local Includes
+#include "BPA_PrintClient.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+/*
+ * A compact binary encoding of the state of a PrinterGroup, for sending to
+ * other devices. It is much smaller, and much cheaper to produce and consume,
+ * than the JSON from PrinterGroup::printerInfo().
+ *
+ * Layout (version 2, all multi-byte values little-endian):
+ *   Header (12 bytes)
+ *     char[3]  magic = "BPG"
+ *     uint8    version
+ *     uint32   time          Epoch seconds at which the snapshot was taken
+ *     uint8    nPrinters
+ *     uint8[3] reserved
+ *   Then nPrinters records, each:
+ *     uint8    flags         Bit 0: printer is active
+ *     uint8    state         A PrintClient::State
+ *     uint8    pct           0-100
+ *     uint8    reserved
+ *     uint32   elapsed       Seconds
+ *     uint32   timeLeft      Seconds
+ *     int16    bedActual     Tenths of a degree C
+ *     int16    bedTarget
+ *     int16    toolActual
+ *     int16    toolTarget
+ *     uint8    nameLength, followed by that many bytes of name (no NUL)
+ *     uint8    fileLength, followed by that many bytes of file name (no NUL)
+ *   Trailer
+ *     uint32   crc           CRC-32 (see BPA_Crc32.h) of everything before it
+ *
+ * Version 1 had no trailer. A snapshot that fails the CRC is not valid.
+ */
+class GroupSnapshot {
+public:
+  static constexpr uint8_t Version = 2;
+  static constexpr size_t HeaderSize = 12;
+  static constexpr size_t TrailerSize = 4;
+  static constexpr size_t FixedRecordSize = 20;   // Excludes the two strings
+
+  enum Flags : uint8_t {Flag_Active = 0x01};
+
+  struct Printer {
+    bool active;
+    PrintClient::State state;
+    uint8_t pct;
+    uint32_t elapsed;
+    uint32_t timeLeft;
+    float bedActual, bedTarget;
+    float toolActual, toolTarget;
+  };
+
+  // ----- Encoding
+  // Write the header and the records through a Crc32Print, then the trailer
+  // with its crc() to the underlying output
+  static void writeHeader(Print& out, uint32_t time, uint8_t nPrinters);
+  static void writePrinter(Print& out, const Printer& p, const String& name, const String& file);
+  static void writeTrailer(Print& out, uint32_t crc);
+
+  // ----- Decoding
+  // A read-only view of one printer's record. Nothing is copied; accessors read
+  // directly from the snapshot's buffer, which must outlive the view.
+  class PrinterView {
+  public:
+    bool active() const { return _rec[0] & Flag_Active; }
+    PrintClient::State state() const { return (PrintClient::State)_rec[1]; }
+    uint8_t pct() const { return _rec[2]; }
+    uint32_t elapsed() const { return u32(4); }
+    uint32_t timeLeft() const { return u32(8); }
+    float bedActual() const { return i16(12) / 10.0f; }
+    float bedTarget() const { return i16(14) / 10.0f; }
+    float toolActual() const { return i16(16) / 10.0f; }
+    float toolTarget() const { return i16(18) / 10.0f; }
+    // Strings are not NUL terminated; use the lengths
+    const char* name() const { return (const char*)&_rec[FixedRecordSize+1]; }
+    uint8_t nameLength() const { return _rec[FixedRecordSize]; }
+    const char* file() const { return (const char*)&_rec[fileOffset()+1]; }
+    uint8_t fileLength() const { return _rec[fileOffset()]; }
+
+  private:
+    friend class GroupSnapshot;
+    const uint8_t* _rec = nullptr;
+    size_t _size = 0;
+    uint8_t _index = 0;
+
+    size_t fileOffset() const { return FixedRecordSize + 1 + nameLength(); }
+    uint32_t u32(size_t o) const {
+      return _rec[o] | (_rec[o+1] << 8) | ((uint32_t)_rec[o+2] << 16) | ((uint32_t)_rec[o+3] << 24);
+    }
+    int16_t i16(size_t o) const { return (int16_t)(_rec[o] | (_rec[o+1] << 8)); }
+  };
+
+  // Wrap an encoded snapshot, checking its CRC. The data is not copied and
+  // must outlive this object.
+  GroupSnapshot(const uint8_t* data, size_t length);
+
+  bool valid() const { return _valid; }
+  uint32_t time() const;
+  uint8_t numberOfPrinters() const { return _valid ? _data[8] : 0; }
+
+  // Walk the records in order:
+  //   GroupSnapshot::PrinterView v;
+  //   for (bool ok = s.first(v); ok; ok = s.next(v)) { ... }
+  bool first(PrinterView& view) const;
+  bool next(PrinterView& view) const;
+  // Find a specific printer's record (walks the records before it)
+  bool printer(uint8_t index, PrinterView& view) const;
+
+  // To look records up repeatedly, record where each one starts with index()
+  // (`offsets` needs room for numberOfPrinters() entries; returns false if a
+  // record is truncated), then find them with printerAt()
+  bool index(uint16_t* offsets) const;
+  bool printerAt(uint8_t index, const uint16_t* offsets, PrinterView& view) const;
+
+private:
+  const uint8_t* _data;
+  size_t _length;
+  bool _valid;
+
+  bool viewAt(const uint8_t* rec, PrinterView& view) const;
+};
+
+#endif  // BPA_GroupSnapshot_h
@@ -0,0 +1,52 @@
+#ifndef BPA_InPlace_h
+#define BPA_InPlace_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <new>
+#include <utility>
+//                                  Third Party Libraries
+//                                  Local Includes
+//--------------- End:    Includes ---------------------------------------------
+
+
+/*
+ * InPlace:
+ *    Storage for an optional T inside its owner, constructed on demand.
+ *    This is like a pointer to a T that was allocated with `new`, but
+ *    without the separate heap allocation.
+ */
+template<typename T>
+class InPlace {
+public:
+  InPlace() { }
+  ~InPlace() { reset(); }
+  InPlace(const InPlace&) = delete;
+  InPlace& operator=(const InPlace&) = delete;
+
+  // Construct a T from args, replacing any existing one
+  template<typename... Args>
+  T& emplace(Args&&... args) {
+    reset();
+    T* t = new (_storage) T(std::forward<Args>(args)...);
+    _constructed = true;
+    return *t;
+  }
+
+  void reset() {
+    if (_constructed) get()->~T();
+    _constructed = false;
+  }
+
+  explicit operator bool() const { return _constructed; }
+  T* operator->() { return get(); }
+  T& operator*() { return *get(); }
+
+private:
+  alignas(T) unsigned char _storage[sizeof(T)];
+  bool _constructed = false;
+
+  T* get() { return reinterpret_cast<T*>(_storage); }
+};
+
+#endif  // BPA_InPlace_h
@@ -0,0 +1,308 @@
+/*
+ * Inflate:
+ *    Decompress gzip, zlib, and raw deflate data into a bounded buffer.
+ *    The decoder follows the structure of Mark Adler's puff.c.
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <new>
+//                                  Third Party Libraries
+//                                  Local Includes
+#include "BPA_Inflate.h"
+#include "BPA_Crc32.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+namespace {
+
+constexpr int MaxBits = 15;           // Longest Huffman code
+constexpr int MaxLitLengths = 288;
+constexpr int MaxDistances = 30;
+
+const uint16_t LengthBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t LengthExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t DistanceBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+const uint8_t DistanceExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// A canonical Huffman code: the number of codes of each length, and the
+// symbols ordered by code
+struct Huffman {
+  uint16_t count[MaxBits+1];
+  uint16_t symbol[MaxLitLengths];
+};
+
+class Decoder {
+public:
+  Decoder(const uint8_t* in, size_t inLength, uint8_t* out, size_t outSize)
+      : _in(in), _inLength(inLength), _out(out), _outSize(outSize) { }
+
+  // Decode every block. Returns false if the data is invalid or doesn't fit.
+  bool run() {
+    bool last;
+    do {
+      last = bits(1);
+      uint32_t type = bits(2);
+      bool ok;
+      switch (type) {
+        case 0: ok = stored(); break;
+        case 1: ok = fixed(); break;
+        case 2: ok = dynamic(); break;
+        default: ok = false;
+      }
+      if (!ok || _error) return false;
+    } while (!last);
+    return true;
+  }
+
+  size_t inUsed() const { return _inPos; }       // After the final block, rounded up to a byte
+  size_t outLength() const { return _outPos; }
+
+private:
+  const uint8_t* _in;
+  size_t _inLength;
+  size_t _inPos = 0;
+  uint8_t* _out;
+  size_t _outSize;
+  size_t _outPos = 0;
+  uint32_t _bitBuf = 0;
+  int _bitCount = 0;
+  bool _error = false;
+  Huffman _litLen;
+  Huffman _dist;
+
+  uint32_t bits(int need) {
+    uint32_t val = _bitBuf;
+    while (_bitCount < need) {
+      if (_inPos == _inLength) { _error = true; return 0; }
+      val |= (uint32_t)_in[_inPos++] << _bitCount;
+      _bitCount += 8;
+    }
+    _bitBuf = val >> need;
+    _bitCount -= need;
+    return val & ((1UL << need) - 1);
+  }
+
+  bool stored() {
+    _bitBuf = 0;                // Discard the rest of the current byte
+    _bitCount = 0;
+    if (_inPos + 4 > _inLength) return false;
+    uint16_t len = _in[_inPos] | (_in[_inPos+1] << 8);
+    uint16_t nlen = _in[_inPos+2] | (_in[_inPos+3] << 8);
+    _inPos += 4;
+    if (len != (uint16_t)~nlen) return false;
+    if (_inPos + len > _inLength || _outPos + len > _outSize) return false;
+    memcpy(_out + _outPos, _in + _inPos, len);
+    _inPos += len;
+    _outPos += len;
+    return true;
+  }
+
+  int decode(const Huffman& h) {
+    int code = 0, first = 0, index = 0;
+    for (int len = 1; len <= MaxBits; len++) {
+      code |= bits(1);
+      if (_error) return -1;
+      int count = h.count[len];
+      if (code - count < first) return h.symbol[index + (code - first)];
+      index += count;
+      first = (first + count) << 1;
+      code <<= 1;
+    }
+    return -1;                  // Ran out of codes
+  }
+
+  // Returns false if the lengths describe an over-subscribed code
+  static bool build(Huffman& h, const uint8_t* length, int n) {
+    memset(h.count, 0, sizeof(h.count));
+    for (int s = 0; s < n; s++) h.count[length[s]]++;
+    if (h.count[0] == n) return true;   // No codes; decode() will fail if used
+
+    int left = 1;
+    for (int len = 1; len <= MaxBits; len++) {
+      left <<= 1;
+      left -= h.count[len];
+      if (left < 0) return false;
+    }
+
+    uint16_t offset[MaxBits+1];
+    offset[1] = 0;
+    for (int len = 1; len < MaxBits; len++) offset[len+1] = offset[len] + h.count[len];
+    for (int s = 0; s < n; s++) {
+      if (length[s]) h.symbol[offset[length[s]]++] = s;
+    }
+    return true;
+  }
+
+  bool codes() {
+    for (;;) {
+      int symbol = decode(_litLen);
+      if (symbol < 0) return false;
+      if (symbol < 256) {
+        if (_outPos == _outSize) return false;
+        _out[_outPos++] = symbol;
+      } else if (symbol == 256) {
+        return true;
+      } else {
+        symbol -= 257;
+        if (symbol >= 29) return false;
+        size_t len = LengthBase[symbol] + bits(LengthExtra[symbol]);
+        symbol = decode(_dist);
+        if (symbol < 0 || symbol >= MaxDistances) return false;
+        size_t dist = DistanceBase[symbol] + bits(DistanceExtra[symbol]);
+        if (_error || dist > _outPos || _outPos + len > _outSize) return false;
+        // Byte by byte, since the source may overlap what is being written
+        while (len--) {
+          _out[_outPos] = _out[_outPos - dist];
+          _outPos++;
+        }
+      }
+    }
+  }
+
+  bool fixed() {
+    uint8_t length[MaxLitLengths];
+    int s = 0;
+    for (; s < 144; s++) length[s] = 8;
+    for (; s < 256; s++) length[s] = 9;
+    for (; s < 280; s++) length[s] = 7;
+    for (; s < MaxLitLengths; s++) length[s] = 8;
+    build(_litLen, length, MaxLitLengths);
+    for (s = 0; s < MaxDistances; s++) length[s] = 5;
+    build(_dist, length, MaxDistances);
+    return codes();
+  }
+
+  bool dynamic() {
+    static const uint8_t Order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+    uint8_t length[MaxLitLengths + MaxDistances];
+
+    int nLen = bits(5) + 257;
+    int nDist = bits(5) + 1;
+    int nCode = bits(4) + 4;
+    if (_error || nLen > MaxLitLengths || nDist > MaxDistances) return false;
+
+    // The code lengths of the code lengths
+    int s = 0;
+    for (; s < nCode; s++) length[Order[s]] = bits(3);
+    for (; s < 19; s++) length[Order[s]] = 0;
+    if (_error || !build(_litLen, length, 19)) return false;
+
+    // The code lengths of the literal/length and distance codes
+    for (s = 0; s < nLen + nDist; ) {
+      int symbol = decode(_litLen);
+      if (symbol < 0) return false;
+      if (symbol < 16) {
+        length[s++] = symbol;
+        continue;
+      }
+      uint8_t len = 0;
+      int repeat;
+      if (symbol == 16) {
+        if (s == 0) return false;
+        len = length[s-1];
+        repeat = 3 + bits(2);
+      } else if (symbol == 17) {
+        repeat = 3 + bits(3);
+      } else {
+        repeat = 11 + bits(7);
+      }
+      if (_error || s + repeat > nLen + nDist) return false;
+      while (repeat--) length[s++] = len;
+    }
+    if (length[256] == 0) return false;   // No end-of-block code
+
+    return build(_litLen, length, nLen) && build(_dist, length + nLen, nDist) && codes();
+  }
+};
+
+uint32_t adler32(const uint8_t* data, size_t length) {
+  uint32_t a = 1, b = 0;
+  while (length--) {
+    a = (a + *data++) % 65521;
+    b = (b + a) % 65521;
+  }
+  return (b << 16) | a;
+}
+
+// Allowing for the arena's alignment padding
+static_assert(sizeof(Decoder) + 8 <= Inflate::ArenaSize, "Inflate::ArenaSize is too small for the decoder");
+
+}  // namespace
+
+
+int Inflate::decompress(
+    Format format, const uint8_t* in, size_t inLength, uint8_t* out, size_t outSize,
+    Arena* arena)
+{
+  size_t start = 0;
+  if (format == Gzip) {
+    enum Flags : uint8_t {FHCRC = 0x02, FEXTRA = 0x04, FNAME = 0x08, FCOMMENT = 0x10};
+    if (inLength < 18 || in[0] != 0x1f || in[1] != 0x8b || in[2] != 8) return -1;
+    uint8_t flags = in[3];
+    start = 10;
+    if (flags & FEXTRA) {
+      if (start + 2 > inLength) return -1;
+      start += 2 + (in[start] | (in[start+1] << 8));
+    }
+    if (flags & FNAME) { while (start < inLength && in[start]) start++; start++; }
+    if (flags & FCOMMENT) { while (start < inLength && in[start]) start++; start++; }
+    if (flags & FHCRC) start += 2;
+    if (start >= inLength) return -1;
+  } else if (format == Zlib) {
+    if (inLength < 6 || (in[0] & 0x0f) != 8 || ((in[0] << 8) | in[1]) % 31 != 0 || (in[1] & 0x20)) return -1;
+    start = 2;
+  }
+
+  bool ok;
+  size_t end;
+  int length;
+  Arena::Mark mark = arena ? arena->mark() : 0;
+  void* room = arena ? arena->allocate(sizeof(Decoder)) : nullptr;
+  if (room) {
+    Decoder* decoder = new (room) Decoder(in + start, inLength - start, out, outSize);
+    ok = decoder->run();
+    end = start + decoder->inUsed();
+    length = decoder->outLength();
+    decoder->~Decoder();
+    arena->rewind(mark);
+  } else {
+    Decoder decoder(in + start, inLength - start, out, outSize);
+    ok = decoder.run();
+    end = start + decoder.inUsed();
+    length = decoder.outLength();
+  }
+  if (!ok) return -1;
+
+  // Check the trailer
+  if (format == Gzip) {
+    if (end + 8 > inLength) return -1;
+    const uint8_t* t = in + end;
+    uint32_t crc = t[0] | (t[1] << 8) | (t[2] << 16) | ((uint32_t)t[3] << 24);
+    uint32_t size = t[4] | (t[5] << 8) | (t[6] << 16) | ((uint32_t)t[7] << 24);
+    if (size != (uint32_t)length || crc != Crc32::of(out, length)) return -1;
+  } else if (format == Zlib) {
+    if (end + 4 > inLength) return -1;
+    const uint8_t* t = in + end;
+    uint32_t adler = ((uint32_t)t[0] << 24) | (t[1] << 16) | (t[2] << 8) | t[3];
+    if (adler != adler32(out, length)) return -1;
+  }
+  return length;
+}
+
+Inflate::Format Inflate::formatFor(const String& contentEncoding, const uint8_t* in, size_t inLength) {
+  // strcasecmp rather than equalsIgnoreCase(), which would make a String of each literal
+  const char* encoding = contentEncoding.c_str();
+  if (strcasecmp(encoding, "gzip") == 0 || strcasecmp(encoding, "x-gzip") == 0) return Gzip;
+  bool zlibHeader = inLength >= 2 && (in[0] & 0x0f) == 8 && ((in[0] << 8) | in[1]) % 31 == 0;
+  return zlibHeader ? Zlib : Raw;
+}
@@ -0,0 +1,37 @@
+#ifndef BPA_Inflate_h
+#define BPA_Inflate_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <Arduino.h>
+//                                  Third Party Libraries
+//                                  Local Includes
+#include "BPA_Arena.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+/*
+ * Decompress a complete DEFLATE stream (RFC 1951), optionally wrapped as gzip
+ * (RFC 1952) or zlib (RFC 1950), as sent with Content-Encoding gzip or
+ * deflate. Back-references are resolved against the output itself, so no
+ * separate window is needed; the output buffer bounds the memory used.
+ */
+class Inflate {
+public:
+  enum Format {Raw, Zlib, Gzip};
+  // The most decompress() takes from an arena at once
+  static constexpr size_t ArenaSize = 1344;
+
+  // Returns the decompressed length, or -1 if the input is invalid, fails its
+  // checksum, or decompresses to more than `outSize` bytes. The decoder's
+  // Huffman tables (about 1.2 KB) are taken from `arena` and given back
+  // before returning; without an arena they are on the stack.
+  static int decompress(
+      Format format, const uint8_t* in, size_t inLength, uint8_t* out, size_t outSize,
+      Arena* arena = nullptr);
+  // The format of a body sent with the given Content-Encoding. "deflate" is
+  // meant to be zlib-wrapped, but some servers send raw deflate.
+  static Format formatFor(const String& contentEncoding, const uint8_t* in, size_t inLength);
+};
+
+#endif  // BPA_Inflate_h
@@ -0,0 +1,168 @@
+/*
+ * JobLog:
+ *    A compact, append-only log of completed print jobs kept on flash
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+//                                  Third Party Libraries
+#include <ArduinoLog.h>
+//                                  Local Includes
+#include "BPA_JobLog.h"
+#include "BPA_Crc32.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Constructors and Public methods
+ *
+ *----------------------------------------------------------------------------*/
+
+JobLog::JobLog(FS& fs, const char* dir, uint8_t nSegments, uint16_t recordsPerSegment) :
+    _fs(fs), _dir(dir), _nSegments(nSegments < 2 ? 2 : nSegments),
+    _recordsPerSegment(recordsPerSegment ? recordsPerSegment : 1) { }
+
+bool JobLog::begin() {
+  if (!_fs.exists(_dir)) _fs.mkdir(_dir.c_str());
+
+  // Find the newest segment; that's the one we'll append to
+  bool found = false;
+  SegmentHeader header;
+  for (int s = 0; s < _nSegments; s++) {
+    if (!readHeader(s, header)) continue;
+    if (!found || (int32_t)(header.seq - _activeSeq) > 0) {
+      _active = s;
+      _activeSeq = header.seq;
+      found = true;
+    }
+  }
+
+  if (!found) {
+    _ready = startSegment(0, 0);
+    return _ready;
+  }
+
+  File f = _fs.open(segmentPath(_active), "r");
+  size_t dataSize = f.size() - sizeof(SegmentHeader);
+  f.close();
+  _activeCount = dataSize / sizeof(Record);
+  if (dataSize % sizeof(Record)) {
+    // A write was interrupted. Don't append after a partial record; move on.
+    Log.warning(F("JobLog: segment %d has a partial record"), _active);
+    _activeCount = _recordsPerSegment;
+  }
+  _ready = true;
+  return true;
+}
+
+bool JobLog::append(
+    uint8_t printer, const String& file, uint32_t start, uint32_t end,
+    uint32_t duration, uint32_t filament, Outcome outcome)
+{
+  if (!_ready) return false;
+
+  if (_activeCount >= _recordsPerSegment) {
+    uint8_t next = (_active + 1) % _nSegments;
+    if (!startSegment(next, _activeSeq + 1)) return false;
+  }
+
+  Record r;
+  memset(&r, 0, sizeof(r));
+  r.magic = RecordMagic;
+  r.version = RecordVersion;
+  r.printer = printer;
+  r.start = start;
+  r.end = end;
+  r.duration = duration;
+  r.filament = filament;
+  r.outcome = outcome;
+  strncpy(r.file, file.c_str(), sizeof(r.file) - 1);
+  r.crc = Crc32::of((const uint8_t*)&r, offsetof(Record, crc));
+
+  File f = _fs.open(segmentPath(_active), "a");
+  if (!f) { Log.warning(F("JobLog: unable to open segment %d"), _active); return false; }
+  size_t written = f.write((const uint8_t*)&r, sizeof(r));
+  f.close();
+  if (written != sizeof(r)) {
+    Log.warning(F("JobLog: short write to segment %d"), _active);
+    _activeCount = _recordsPerSegment;   // Don't append after a partial record
+    return false;
+  }
+  _activeCount++;
+  return true;
+}
+
+void JobLog::forEach(std::function<bool(const Record&)> visitor) {
+  if (!_ready) return;
+
+  // The oldest segment is the one after the active one, wrapping around
+  for (int i = 1; i <= _nSegments; i++) {
+    uint8_t s = (_active + i) % _nSegments;
+    SegmentHeader header;
+    if (!readHeader(s, header)) continue;
+    if (_activeSeq - header.seq >= _nSegments) continue;  // Stale segment
+
+    File f = _fs.open(segmentPath(s), "r");
+    if (!f) continue;
+    f.seek(sizeof(SegmentHeader));
+    Record r;
+    while (f.read((uint8_t*)&r, sizeof(r)) == sizeof(r)) {
+      if (r.magic != RecordMagic || r.version != RecordVersion ||
+          r.crc != Crc32::of((const uint8_t*)&r, offsetof(Record, crc))) {
+        continue;
+      }
+      r.file[sizeof(r.file)-1] = '\0';
+      if (!visitor(r)) { f.close(); return; }
+    }
+    f.close();
+  }
+}
+
+void JobLog::countSince(uint32_t since, uint16_t* counts, uint8_t nPrinters) {
+  for (int i = 0; i < nPrinters; i++) counts[i] = 0;
+  forEach([since, counts, nPrinters](const Record& r) {
+    if (r.end >= since && r.printer < nPrinters) counts[r.printer]++;
+    return true;
+  });
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Private methods
+ *
+ *----------------------------------------------------------------------------*/
+
+String JobLog::segmentPath(uint8_t segment) {
+  String path = _dir;
+  path += '/';
+  path += segment;
+  path += ".log";
+  return path;
+}
+
+bool JobLog::readHeader(uint8_t segment, SegmentHeader& header) {
+  String path = segmentPath(segment);
+  if (!_fs.exists(path)) return false;
+  File f = _fs.open(path, "r");
+  if (!f) return false;
+  bool valid = (f.read((uint8_t*)&header, sizeof(header)) == sizeof(header)) &&
+               (header.magic == SegmentMagic);
+  f.close();
+  return valid;
+}
+
+bool JobLog::startSegment(uint8_t segment, uint32_t seq) {
+  File f = _fs.open(segmentPath(segment), "w");
+  if (!f) { Log.warning(F("JobLog: unable to create segment %d"), segment); return false; }
+  SegmentHeader header = {SegmentMagic, seq};
+  bool ok = f.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+  f.close();
+  if (!ok) return false;
+  _active = segment;
+  _activeSeq = seq;
+  _activeCount = 0;
+  return true;
+}
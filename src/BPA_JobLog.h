@@ -0,0 +1,96 @@
+#ifndef BPA_JobLog_h
+#define BPA_JobLog_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <FS.h>
+//                                  Third Party Libraries
+//                                  Local Includes
+//--------------- End:    Includes ---------------------------------------------
+
+
+/*
+ * An append-only journal of finished print jobs. Records have a fixed size and
+ * carry their own CRC. They are written into a small ring of segment files
+ * (<dir>/0.log .. <dir>/N.log). Each segment starts with a header holding a
+ * sequence number, so the oldest and newest segments can be found at startup
+ * without listing the directory. Segments are only ever appended to. When the
+ * newest one fills, the oldest one is deleted and reused. Nothing is rewritten
+ * in place.
+ *
+ * Layout of a segment (all values little-endian):
+ *   SegmentHeader { uint32 magic = 'BPAJ', uint32 seq }
+ *   Record[0..recordsPerSegment-1]
+ *
+ * The number and size of the segments are given to the constructor, and a
+ * log must always be opened with the ones it was written with. The defaults
+ * suit a device; extras/host/tools/joblog reads a log copied off one.
+ */
+class JobLog {
+public:
+  // ----- Types
+  enum Outcome : uint8_t {Completed, Failed};
+
+  struct __attribute__((packed)) Record {
+    uint16_t magic;                 // RecordMagic
+    uint8_t  version;               // RecordVersion
+    uint8_t  printer;               // Index of the printer within its PrinterGroup
+    uint32_t start;                 // Start of the job (epoch seconds)
+    uint32_t end;                   // End of the job (epoch seconds)
+    uint32_t duration;              // Print time (seconds)
+    uint32_t filament;              // Filament used (mm)
+    uint8_t  outcome;               // An Outcome
+    uint8_t  reserved[3];
+    char     file[64];              // Name of the printed file, NUL terminated (may be truncated)
+    uint32_t crc;                   // CRC-32 of all preceding bytes
+  };
+
+  static constexpr uint16_t RecordMagic = 0x4C4A;   // "JL"
+  static constexpr uint8_t  RecordVersion = 1;
+  static constexpr uint32_t SegmentMagic = 0x4A415042; // "BPAJ"
+  static constexpr uint8_t  DefaultSegments = 8;
+  static constexpr uint16_t DefaultRecordsPerSegment = 64;  // ~6KB per segment, 512 jobs in all
+
+  // ----- Constructors and initialization
+  // The log keeps between (nSegments-1) * recordsPerSegment and
+  // nSegments * recordsPerSegment of the most recent jobs. nSegments must be
+  // at least 2.
+  JobLog(
+      FS& fs, const char* dir = "/jobs", uint8_t nSegments = DefaultSegments,
+      uint16_t recordsPerSegment = DefaultRecordsPerSegment);
+  bool begin();
+
+  // ----- Writing
+  bool append(
+      uint8_t printer, const String& file, uint32_t start, uint32_t end,
+      uint32_t duration, uint32_t filament, Outcome outcome);
+
+  // ----- Reading
+  // Visit every valid record from oldest to newest. Return false from the
+  // callback to stop early.
+  void forEach(std::function<bool(const Record&)> visitor);
+  // Count jobs that ended at or after `since`, per printer. `counts` must
+  // have room for `nPrinters` entries.
+  void countSince(uint32_t since, uint16_t* counts, uint8_t nPrinters);
+
+private:
+  struct __attribute__((packed)) SegmentHeader {
+    uint32_t magic;
+    uint32_t seq;
+  };
+
+  FS& _fs;
+  String _dir;
+  uint8_t  _nSegments;
+  uint16_t _recordsPerSegment;
+  uint8_t  _active = 0;             // Segment currently being appended to
+  uint32_t _activeSeq = 0;
+  uint16_t _activeCount = 0;        // Records in the active segment
+  bool _ready = false;
+
+  String segmentPath(uint8_t segment);
+  bool readHeader(uint8_t segment, SegmentHeader& header);
+  bool startSegment(uint8_t segment, uint32_t seq);
+};
+
+#endif  // BPA_JobLog_h
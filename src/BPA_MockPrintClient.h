@@ -11,41 +11,93 @@ static const char *names[N_Names] = {
 };
 static constexpr float RoomTemp = 21.1f;
 
-class MockState {
+// A small per-instance PRNG (xorshift32) so that a mock's behavior depends only
+// on its seed and not on anything else that happens to be calling random()
+class MockRandom {
 public:
-  void init() {
-    randomSeed(millis());
+  void seed(uint32_t s) { _state = s ? s : 0x9E3779B9; }
+  uint32_t next() {
+    _state ^= _state << 13;
+    _state ^= _state >> 17;
+    _state ^= _state << 5;
+    return _state;
+  }
+  // Same contract as Arduino's random(lo, hi): lo <= result < hi
+  long range(long lo, long hi) {
+    if (hi <= lo) return lo;
+    return lo + (long)(next() % (uint32_t)(hi - lo));
+  }
+
+private:
+  uint32_t _state = 0x9E3779B9;
+};
 
-    if (random(0, 20) == 5) {   // A 1-in-20 chance the printer is idle
+// A source of time in milliseconds. By default this is millis(), but a mock may
+// be driven by a MockVirtualClock to simulate hours of printing in an instant.
+using MockClock = std::function<uint32_t()>;
+
+class MockVirtualClock {
+public:
+  uint32_t now = 0;
+  void advance(uint32_t ms) { now += ms; }
+  MockClock clock() { return [this]() { return now; }; }
+};
+
+// A scripted event. `at` is measured in seconds from the time the mock was created.
+struct MockEvent {
+  enum Action {StartJob, Pause, Resume, Complete, Fail, GoOffline, GoOnline};
+  uint32_t at;
+  Action action;
+};
+
+class MockState {
+public:
+  void init(MockRandom& rng) {
+    if (rng.range(0, 20) == 5) {   // A 1-in-20 chance the printer is idle
       setIdle();
       return;
     }
+    startJob(rng);
+    elapsed = rng.range(0, totalPrintTime/2);
+  }
 
+  void startJob(MockRandom& rng) {
     state = PrintClient::State::Printing;
-    fileName = names[random(0, N_Names)];
+    fileName = names[rng.range(0, N_Names)];
 
     uint16_t minutes;
-    uint16_t timeRegion = random(0, 100);
-    if (timeRegion < 40) minutes = random(10, 60);        // 40% of jobs are 10-59 minutes
-    else if (timeRegion < 70) minutes = random(60, 120);  // 30% of jobs are 1-2   hours
-    else if (timeRegion < 90) minutes = random(120, 300); // 20% of jobs are 2-5   hours
-    else minutes = random(300, 12*60);                    // 10% of jobs are 5-12  hours
-    // minutes = random(1, 10);   // Short times for quick tests
+    uint16_t timeRegion = rng.range(0, 100);
+    if (timeRegion < 40) minutes = rng.range(10, 60);        // 40% of jobs are 10-59 minutes
+    else if (timeRegion < 70) minutes = rng.range(60, 120);  // 30% of jobs are 1-2   hours
+    else if (timeRegion < 90) minutes = rng.range(120, 300); // 20% of jobs are 2-5   hours
+    else minutes = rng.range(300, 12*60);                    // 10% of jobs are 5-12  hours
+    // minutes = rng.range(1, 10);   // Short times for quick tests
     // minutes = 1;                  // Very short times for very quick tests
     totalPrintTime = minutes * 60;
+    filamentLength = totalPrintTime / 2;  // Roughly 0.5mm/sec
 
-    elapsed = random(0, totalPrintTime/2);
+    elapsed = 0;
+    paused = false;
     bedTarget = 210;
-    bedActual = bedTarget + ((float)random(-100, 101))/100;
+    bedActual = bedTarget + ((float)rng.range(-100, 101))/100;
     toolTarget = 60;
-    toolActual = toolTarget + ((float)random(-100, 101))/100;
+    toolActual = toolTarget + ((float)rng.range(-100, 101))/100;
+  }
+
+  void fail() {
+    // Leave the file and elapsed time as they were when the print stopped
+    state = PrintClient::State::Operational;
+    paused = false;
+    bedTarget = toolTarget = 0.0;
   }
 
   void setIdle() {
     state = PrintClient::State::Operational;
     fileName = "";
     totalPrintTime = 0;
+    filamentLength = 0;
     elapsed = 0;
+    paused = false;
     bedTarget = toolTarget = 0.0;
     bedActual = toolActual = RoomTemp;
   }
@@ -53,33 +105,58 @@ public:
   PrintClient::State state;
   String fileName;
   uint32_t totalPrintTime;
+  uint32_t filamentLength;
   uint32_t elapsed;
+  bool paused;
   float bedTarget, bedActual;
   float toolTarget, toolActual;
 };
 
-class MockPrintClient : public PrintClient {
+class MockPrintClient final : public PrintClient {
 public:
-  MockPrintClient() {
-    ms.init();
-    timeOfLastUpdate = millis();
+  // A mock with a random job that progresses in real time
+  MockPrintClient() : MockPrintClient(millis()) { }
+
+  // A reproducible mock: the same seed, clock, and script always produce the
+  // same sequence of states. `script` must be sorted by time and must outlive
+  // the mock.
+  MockPrintClient(
+      uint32_t seed, MockClock clock = nullptr,
+      const MockEvent* script = nullptr, uint8_t nEvents = 0)
+  {
+    _clock = clock ? clock : MockClock(millis);
+    _script = script;
+    _nEvents = nEvents;
+    rng.seed(seed);
+    ms.init(rng);
+    _created = _lastTick = timeOfLastUpdate = _clock();
   }
 
   // ----- Interrogate the Printer
   void updateState() {
-    uint32_t curTime = millis();
-    uint32_t secsSinceUpdate = (curTime - timeOfLastUpdate)/1000L;
+    uint32_t curTime = _clock();
+    // Only whole seconds are consumed so no time is lost to rounding
+    uint32_t secsSinceUpdate = (curTime - _lastTick)/1000L;
+    uint32_t secs = (_lastTick - _created)/1000L;   // Since creation, as of the last tick
+    _lastTick += secsSinceUpdate * 1000L;
     timeOfLastUpdate = curTime;
 
+    // Each scripted event happens at its own time: the time up to it passes
+    // in the state before it. An offline printer keeps printing; we just
+    // can't see it.
+    uint32_t now = secs + secsSinceUpdate;
+    while (_nextEvent < _nEvents && _script[_nextEvent].at <= now) {
+      uint32_t at = max(_script[_nextEvent].at, secs);
+      advance(at - secs);
+      secs = at;
+      applyEvent(_script[_nextEvent++]);
+    }
+    advance(now - secs);
+
     if (ms.state == PrintClient::State::Printing) {
-      ms.elapsed += secsSinceUpdate;
-      if (ms.elapsed >= ms.totalPrintTime) {
-        ms.elapsed = ms.totalPrintTime;
-        ms.state = PrintClient::State::Complete;
-      } else {
-        ms.bedActual = ms.bedTarget + ((float)random(-100, 101))/100;
-        ms.toolActual = ms.toolTarget + ((float)random(-100, 101))/100;
-      }
+      if (ms.paused) return;
+      ms.bedActual = ms.bedTarget + ((float)rng.range(-100, 101))/100;
+      ms.toolActual = ms.toolTarget + ((float)rng.range(-100, 101))/100;
     } else if (ms.state == PrintClient::State::Complete) {
       // Drop the actual temps
       ms.bedActual -= 0.4f;  if (ms.bedActual  < RoomTemp) ms.bedActual  = RoomTemp;
@@ -93,21 +170,24 @@ public:
   void dumpToLog() { }
 
   // ----- Getters
-  bool isPrinting() { return (ms.state == PrintClient::State::Printing); }
-  State getState() { return ms.state; }
-  float getPctComplete() { 
-    if (ms.state == Offline || ms.state == Operational) return 0.0f;
-    if (ms.state == Complete) return 100.0f;
+  bool isPrinting() { return (getState() == PrintClient::State::Printing); }
+  State getState() { return _offline ? PrintClient::State::Offline : ms.state; }
+  float getPctComplete() {
+    State state = getState();
+    if (state == Offline || state == Operational) return 0.0f;
+    if (state == Complete) return 100.0f;
     // Assert(printerState == Printing)
     return (ms.elapsed*100.0f)/((float)ms.totalPrintTime);
   }
   uint32_t getPrintTimeLeft() {
-    if (ms.state == Offline || ms.state == Operational) return 0.0f;
-    if (ms.state == Complete) return 0;
+    State state = getState();
+    if (state == Offline || state == Operational) return 0.0f;
+    if (state == Complete) return 0;
     // Assert(printerState == Printing)
     return ms.totalPrintTime - ms.elapsed;
   }
   uint32_t getElapsedTime() { return ms.elapsed; }
+  uint32_t getFilamentLength() { return ms.filamentLength; }
   String getFilename() { return ms.fileName; }
   void getBedTemps(float &actual, float &target) {
     actual = ms.bedActual;
@@ -120,4 +200,39 @@ public:
 
 private:
   MockState ms;
+  MockRandom rng;
+  MockClock _clock;
+  uint32_t _created;
+  uint32_t _lastTick;
+  const MockEvent* _script;
+  uint8_t _nEvents;
+  uint8_t _nextEvent = 0;
+  bool _offline = false;
+
+  // Let `secs` of printing pass in the current state
+  void advance(uint32_t secs) {
+    if (ms.state != PrintClient::State::Printing || ms.paused) return;
+    ms.elapsed += secs;
+    if (ms.elapsed >= ms.totalPrintTime) {
+      ms.elapsed = ms.totalPrintTime;
+      ms.state = PrintClient::State::Complete;
+    }
+  }
+
+  void applyEvent(const MockEvent& event) {
+    switch (event.action) {
+      case MockEvent::StartJob: ms.startJob(rng); break;
+      case MockEvent::Pause: ms.paused = true; break;
+      case MockEvent::Resume: ms.paused = false; break;
+      case MockEvent::Complete:
+        if (ms.state == PrintClient::State::Printing) {
+          ms.elapsed = ms.totalPrintTime;
+          ms.state = PrintClient::State::Complete;
+        }
+        break;
+      case MockEvent::Fail: ms.fail(); break;
+      case MockEvent::GoOffline: _offline = true; break;
+      case MockEvent::GoOnline: _offline = false; break;
+    }
+  }
 };
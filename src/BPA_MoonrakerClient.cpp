@@ -0,0 +1,213 @@
+/*
+ * MoonrakerClient:
+ *    A client to get information from (not control) Klipper printers via
+ *    Moonraker's websocket API
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+//                                  Third Party Libraries
+//                                  Local Includes
+#include "BPA_MoonrakerClient.h"
+//--------------- End:    Includes ---------------------------------------------
+
+#if BPA_ENABLE_MOONRAKER
+
+
+// Set a field only if the update includes it; Moonraker omits unchanged fields
+static void updateField(float& field, JsonVariantConst value) {
+  if (!value.isNull()) field = value.as<float>();
+}
+
+static void updateField(String& field, JsonVariantConst value) {
+  if (!value.isNull()) field = value.as<String>();
+}
+
+// The value of a message's "method", found without parsing the message.
+// Moonraker puts it ahead of "params", so the first "method" key is the
+// top-level one. Returns nullptr if there is none, as in a reply.
+static const char* peekMethod(const String& message, size_t& length) {
+  const char* p = strstr(message.c_str(), "\"method\"");
+  if (!p) return nullptr;
+  p += 8;
+  while (*p == ' ') p++;
+  if (*p++ != ':') return nullptr;
+  while (*p == ' ') p++;
+  if (*p++ != '"') return nullptr;
+  const char* end = strchr(p, '"');
+  if (!end) return nullptr;
+  length = end - p;
+  return p;
+}
+
+// The notifications handleMessage() acts on
+static bool isHandledMethod(const char* method, size_t length) {
+  static const char* const Handled[] = {
+    "notify_status_update", "notify_klippy_ready", "notify_klippy_shutdown", "notify_klippy_disconnected"
+  };
+  for (const char* name : Handled) {
+    if (strlen(name) == length && strncmp(name, method, length) == 0) return true;
+  }
+  return false;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Constructors and Public methods
+ *
+ *----------------------------------------------------------------------------*/
+
+void MoonrakerClient::init(String server, int port, String apiKey) {
+  this->server = server;
+  this->port = port;
+  this->apiKey = apiKey;
+  socket.close();
+  subscribed = false;
+  klippyReady = false;
+  lastConnectAttempt = 0;
+  resetState();
+}
+
+void MoonrakerClient::updateState() {
+  if (!socket.connected()) {
+    subscribed = false;
+    klippyReady = false;
+    if (lastConnectAttempt && (millis() - lastConnectAttempt) < ReconnectInterval) return;
+    lastConnectAttempt = millis();
+    String headers;
+    if (!apiKey.isEmpty()) headers = "X-Api-Key: " + apiKey + "\r\n";
+    if (!socket.connect(server, port, "/websocket", headers)) {
+      resetState();
+      return;
+    }
+  }
+  if (!subscribed && !subscribe()) return;
+
+  // Apply every update that has arrived since the last call
+  String message;
+  while (socket.receive(message)) handleMessage(message);
+  if (socket.connected()) timeOfLastUpdate = millis();
+}
+
+MoonrakerClient::State MoonrakerClient::getState() {
+  if (!klippyReady || !socket.connected()) return State::Offline;
+  if (printState == "printing" || printState == "paused") return State::Printing;
+  if (printState == "complete") return completionAcknowledged ? State::Operational : State::Complete;
+  return State::Operational;          // standby, cancelled, error
+}
+
+uint32_t MoonrakerClient::getPrintTimeLeft() {
+  // Moonraker doesn't estimate this; extrapolate from progress so far
+  if (progress <= 0.0f || printDuration <= 0.0f) return 0;
+  return (uint32_t)(printDuration / progress - printDuration);
+}
+
+void MoonrakerClient::acknowledgeCompletion() {
+  completionAcknowledged = true;
+}
+
+void MoonrakerClient::dumpToLog() {
+#if BPA_LOG_LEVEL >= LOG_LEVEL_VERBOSE
+  Log.verbose(F("----- Moonraker: %s, ready = %T -----"), printState.c_str(), klippyReady);
+  Log.verbose(F("  fileName: %s"), fileName.c_str());
+  Log.verbose(F("  progress: %F"), progress);
+  Log.verbose(F("  printDuration: %F (sec)"), printDuration);
+  Log.verbose(F("  filamentUsed: %F (mm)"), filamentUsed);
+  Log.verbose(F("  Bed Temp: %F / %F (C)"), bedActual, bedTarget);
+  Log.verbose(F("  Tool Temp: %F / %F (C)"), toolActual, toolTarget);
+  Log.verbose(F("----------"));
+#endif
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Private methods
+ *
+ *----------------------------------------------------------------------------*/
+
+bool MoonrakerClient::subscribe() {
+  String request =
+      "{\"jsonrpc\":\"2.0\",\"method\":\"printer.objects.subscribe\",\"params\":{\"objects\":{"
+      "\"print_stats\":[\"state\",\"filename\",\"print_duration\",\"filament_used\"],"
+      "\"display_status\":[\"progress\"],"
+      "\"heater_bed\":[\"temperature\",\"target\"],"
+      "\"extruder\":[\"temperature\",\"target\"]}},\"id\":";
+  request += ++requestId;
+  request += '}';
+  if (!socket.sendText(request)) return false;
+
+  // The reply carries the current value of every field. Notifications that
+  // arrive before it are applied as usual.
+  uint32_t start = millis();
+  String message;
+  while ((millis() - start) < SubscribeTimeout) {
+    if (!socket.receive(message, SubscribeTimeout - (millis() - start))) break;
+    if (handleMessage(message)) return subscribed;
+  }
+  Log.warning(F("Moonraker: no reply to subscription from %s"), server.c_str());
+  return false;
+}
+
+// Returns true if the message is the reply to the current subscription request
+bool MoonrakerClient::handleMessage(const String& message) {
+  // Moonraker also sends notifications that don't matter here, some of them
+  // often (notify_proc_stat_update, every second). Skip them unparsed.
+  size_t methodLength;
+  const char* peeked = peekMethod(message, methodLength);
+  if (peeked && !isHandledMethod(peeked, methodLength)) return false;
+
+  DynamicJsonDocument doc(MessageJSONSize);
+  if (deserializeJson(doc, message.c_str(), message.length())) {
+    Log.warning(F("Moonraker: unable to parse message from %s"), server.c_str());
+    return false;
+  }
+
+  const char* method = doc["method"] | "";
+  if (strcmp(method, "notify_status_update") == 0) {
+    applyStatus(doc["params"][0]);
+  } else if (strcmp(method, "notify_klippy_ready") == 0) {
+    subscribed = false;               // Klipper restarted; subscribe again
+  } else if (strcmp(method, "notify_klippy_shutdown") == 0 ||
+             strcmp(method, "notify_klippy_disconnected") == 0) {
+    klippyReady = false;
+    subscribed = false;
+  } else if ((doc["id"] | -1) == (int)requestId) {
+    if (doc["result"].isNull()) {
+      const char* error = doc["error"]["message"] | "unknown error";
+      Log.warning(F("Moonraker: subscription failed on %s: %s"), server.c_str(), error);
+      klippyReady = false;
+    } else {
+      klippyReady = true;
+      subscribed = true;
+      applyStatus(doc["result"]["status"]);
+    }
+    return true;
+  }
+  return false;
+}
+
+void MoonrakerClient::applyStatus(JsonObjectConst status) {
+  JsonObjectConst stats = status["print_stats"];
+  updateField(printState, stats["state"]);
+  updateField(fileName, stats["filename"]);
+  updateField(printDuration, stats["print_duration"]);
+  updateField(filamentUsed, stats["filament_used"]);
+  updateField(progress, status["display_status"]["progress"]);
+  updateField(bedActual, status["heater_bed"]["temperature"]);
+  updateField(bedTarget, status["heater_bed"]["target"]);
+  updateField(toolActual, status["extruder"]["temperature"]);
+  updateField(toolTarget, status["extruder"]["target"]);
+  if (printState != "complete") completionAcknowledged = false;
+}
+
+void MoonrakerClient::resetState() {
+  printState = "";
+  fileName = "";
+  printDuration = filamentUsed = progress = 0;
+  bedActual = bedTarget = toolActual = toolTarget = 0;
+}
+
+#endif  // BPA_ENABLE_MOONRAKER
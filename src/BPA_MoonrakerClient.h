@@ -0,0 +1,75 @@
+#ifndef BPA_MoonrakerClient_h
+#define BPA_MoonrakerClient_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+//                                  Third Party Libraries
+#include <ArduinoJson.h>
+#include <ArduinoLog.h>
+//                                  Local Includes
+#include "BPA_Config.h"
+#include "BPA_PrintClient.h"
+#include "BPA_WebSocket.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+/*
+ * A client for Klipper printers through Moonraker. Rather than polling, it
+ * keeps a websocket open and subscribes to print_stats, display_status,
+ * heater_bed, and extruder. Moonraker then sends only the fields that
+ * changed; updateState() applies whatever has arrived since the last call.
+ */
+class MoonrakerClient final : public PrintClient {
+public:
+  // ----- Constructors and initialization
+  void init(String server, int port, String apiKey);
+
+  // ----- Interrogate the printer
+  void updateState();
+
+  // ----- Utility Functions
+  void acknowledgeCompletion();
+  void dumpToLog();
+
+  // ----- Getters
+  bool isPrinting() { return getState() == State::Printing; }
+  State getState();
+  float getPctComplete() { return progress * 100.0f; }
+  uint32_t getPrintTimeLeft();
+  uint32_t getElapsedTime() { return (uint32_t)printDuration; }
+  uint32_t getFilamentLength() { return (uint32_t)filamentUsed; }
+  String getFilename() { return fileName; }
+  void getBedTemps(float &actual, float &target) { actual = bedActual; target = bedTarget; }
+  void getToolTemps(float &actual, float &target) { actual = toolActual; target = toolTarget; }
+
+private:
+  static constexpr uint32_t ReconnectInterval = 30 * 1000L;
+  static constexpr uint32_t SubscribeTimeout = 5000;
+  static constexpr uint32_t MessageJSONSize = 2048;
+
+  String    server;
+  int       port;
+  String    apiKey;
+  WebSocket socket;
+  bool      subscribed = false;
+  bool      klippyReady = false;
+  uint32_t  lastConnectAttempt = 0;
+  uint16_t  requestId = 0;
+
+  // ----- State from the printer
+  String    printState;             // print_stats.state: standby, printing, paused, complete, ...
+  String    fileName;
+  float     printDuration = 0;      // Seconds spent printing, excluding pauses
+  float     filamentUsed = 0;       // mm
+  float     progress = 0;           // 0.0-1.0
+  float     bedActual = 0, bedTarget = 0;
+  float     toolActual = 0, toolTarget = 0;
+  bool      completionAcknowledged = false;
+
+  bool subscribe();
+  bool handleMessage(const String& message);
+  void applyStatus(JsonObjectConst status);
+  void resetState();
+};
+
+#endif  // BPA_MoonrakerClient_h
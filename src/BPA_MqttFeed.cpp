@@ -0,0 +1,353 @@
+/*
+ * MqttFeed, MqttPrintClient:
+ *    Follow printers through the messages they publish to an MQTT broker
+ *    rather than by polling them.
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+//                                  Third Party Libraries
+#include <ArduinoJson.h>
+#include <ArduinoLog.h>
+//                                  Local Includes
+#include "BPA_Config.h"
+#include "BPA_MqttFeed.h"
+//--------------- End:    Includes ---------------------------------------------
+
+#if BPA_ENABLE_MQTT
+
+// MQTT control packet types (the high nibble of the first byte)
+enum PacketType : uint8_t {
+  Packet_Connect = 0x10, Packet_ConnAck = 0x20, Packet_Publish = 0x30,
+  Packet_Subscribe = 0x82, Packet_SubAck = 0x90,
+  Packet_PingReq = 0xC0, Packet_PingResp = 0xD0
+};
+
+// Topics under each printer's base topic
+static const char* const Subscriptions[] = {"mqtt", "progress/printing", "temperature/+", "event/+"};
+
+// Append a length-prefixed string. Returns false if it doesn't fit.
+static bool appendString(uint8_t* buf, size_t& pos, const String& s) {
+  if (pos + 2 + s.length() > MqttFeed::MaxPacketSize) return false;
+  buf[pos++] = s.length() >> 8;
+  buf[pos++] = s.length() & 0xff;
+  memcpy(buf + pos, s.c_str(), s.length());
+  pos += s.length();
+  return true;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * MqttFeed
+ *
+ *----------------------------------------------------------------------------*/
+
+void MqttFeed::init(const String& broker, int port, const String& clientID, const String& user, const String& pass) {
+  _broker = broker;
+  _port = port;
+  _clientID = clientID;
+  _user = user;
+  _pass = pass;
+  if (!_packet) _packet = new uint8_t[MaxPacketSize];
+  _client.stop();
+  _open = false;
+  _attempted = false;
+}
+
+MqttFeed::~MqttFeed() {
+  for (MqttPrintClient* c = _clients; c; c = c->next) c->feed = nullptr;
+  delete[] _packet;
+}
+
+void MqttFeed::loop() {
+  if (!_packet) return;
+  if (!connected()) {
+    if (_attempted && (millis() - _lastConnectAttempt) < ReconnectInterval) return;
+    bool reconnecting = _attempted;
+    _attempted = true;
+    _lastConnectAttempt = millis();
+    if (!connect()) return;
+    if (reconnecting) _reconnects++;
+  }
+
+  while (_client.available()) {
+    uint8_t type;
+    size_t length;
+    if (!readPacket(type, length)) {
+      Log.warning(F("MqttFeed: lost connection to %s"), _broker.c_str());
+      _client.stop();
+      _open = false;
+      return;
+    }
+    if ((type & 0xf0) == Packet_Publish) dispatch(length);
+    // SUBACK and PINGRESP need no action; QoS 0 messages need no reply
+  }
+
+  if ((millis() - _lastSent) >= (_keepAlive * 1000L) / 2) sendPacket(Packet_PingReq, nullptr, 0);
+}
+
+void MqttFeed::setKeepAlive(uint32_t seconds) {
+  if (seconds > MaxKeepAlive) {
+    Log.warning(F("MqttFeed: keep-alive capped at %d seconds; call loop() more often than that"), MaxKeepAlive);
+    seconds = MaxKeepAlive;
+  }
+  _keepAlive = max(seconds, (uint32_t)DefaultKeepAlive);
+}
+
+bool MqttFeed::connected() {
+  if (_open && !_client.connected()) _open = false;
+  return _open;
+}
+
+void MqttFeed::add(MqttPrintClient* client) {
+  client->next = _clients;
+  _clients = client;
+  if (connected()) subscribe(client);
+}
+
+void MqttFeed::remove(MqttPrintClient* client) {
+  for (MqttPrintClient** c = &_clients; *c; c = &(*c)->next) {
+    if (*c == client) { *c = client->next; break; }
+  }
+  client->next = nullptr;
+}
+
+bool MqttFeed::connect() {
+  _client.stop();
+  _open = false;
+  if (!_client.connect(_broker.c_str(), _port)) {
+    Log.warning(F("MqttFeed: unable to connect to %s:%d"), _broker.c_str(), _port);
+    return false;
+  }
+
+  size_t pos = 0;
+  uint8_t flags = 0x02;                           // Clean session
+  if (!_user.isEmpty()) flags |= 0x80;
+  if (!_pass.isEmpty()) flags |= 0x40;
+  const uint8_t header[] = {0, 4, 'M', 'Q', 'T', 'T', 4, flags, (uint8_t)(_keepAlive >> 8), (uint8_t)(_keepAlive & 0xff)};
+  memcpy(_packet, header, sizeof(header));
+  pos = sizeof(header);
+  bool fits = appendString(_packet, pos, _clientID);
+  if (fits && !_user.isEmpty()) fits = appendString(_packet, pos, _user);
+  if (fits && !_pass.isEmpty()) fits = appendString(_packet, pos, _pass);
+  if (!fits || !sendPacket(Packet_Connect, _packet, pos)) { _client.stop(); return false; }
+
+  uint8_t type;
+  size_t length;
+  uint32_t start = millis();
+  while (!_client.available() && _client.connected() && (millis() - start) < Timeout) delay(1);
+  if (!readPacket(type, length) || type != Packet_ConnAck || length != 2 || _packet[1] != 0) {
+    Log.warning(F("MqttFeed: connection refused by %s"), _broker.c_str());
+    _client.stop();
+    return false;
+  }
+  _open = true;
+
+  // A clean session starts with no subscriptions
+  for (MqttPrintClient* c = _clients; c; c = c->next) subscribe(c);
+  return true;
+}
+
+bool MqttFeed::subscribe(MqttPrintClient* client) {
+  size_t pos = 0;
+  if (++_packetID == 0) _packetID = 1;
+  _packet[pos++] = _packetID >> 8;
+  _packet[pos++] = _packetID & 0xff;
+  for (const char* suffix : Subscriptions) {
+    if (!appendString(_packet, pos, client->baseTopic + suffix) || pos == MaxPacketSize) return false;
+    _packet[pos++] = 0;                           // QoS 0
+  }
+  return sendPacket(Packet_Subscribe, _packet, pos);
+}
+
+// Read one packet into _packet. A packet that is too large is read and
+// discarded, and returned as type 0.
+bool MqttFeed::readPacket(uint8_t& type, size_t& length) {
+  uint8_t byte;
+  if (!readFully(&type, 1)) return false;
+  length = 0;
+  for (int shift = 0; ; shift += 7) {
+    if (shift > 21 || !readFully(&byte, 1)) return false;
+    length |= (size_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) break;
+  }
+  if (length <= MaxPacketSize) return readFully(_packet, length);
+
+  Log.warning(F("MqttFeed: skipped a message of %d bytes"), length);
+  for (size_t n; length; length -= n) {
+    n = (length < MaxPacketSize) ? length : MaxPacketSize;
+    if (!readFully(_packet, n)) return false;
+  }
+  type = 0;
+  return true;
+}
+
+// Hand a PUBLISH in _packet to the client whose base topic it falls under
+void MqttFeed::dispatch(size_t length) {
+  if (length < 2) return;
+  size_t topicLength = (_packet[0] << 8) | _packet[1];
+  if (2 + topicLength > length) return;
+  String topic;
+  topic.concat((const char*)_packet + 2, topicLength);
+  char* payload = (char*)_packet + 2 + topicLength;   // We only subscribe at QoS 0, so no packet ID
+  size_t payloadLength = length - 2 - topicLength;
+
+  _messages++;
+  for (MqttPrintClient* c = _clients; c; c = c->next) {
+    if (topic.startsWith(c->baseTopic)) {
+      c->handleMessage(topic.c_str() + c->baseTopic.length(), payload, payloadLength);
+    }
+  }
+}
+
+bool MqttFeed::sendPacket(uint8_t type, const uint8_t* body, size_t length) {
+  uint8_t header[5];
+  size_t headerLength = 0;
+  header[headerLength++] = type;
+  size_t remaining = length;
+  do {
+    uint8_t byte = remaining & 0x7f;
+    remaining >>= 7;
+    if (remaining) byte |= 0x80;
+    header[headerLength++] = byte;
+  } while (remaining);
+  _lastSent = millis();
+  return _client.write(header, headerLength) == headerLength &&
+         (length == 0 || _client.write(body, length) == length);
+}
+
+bool MqttFeed::readFully(uint8_t* buf, size_t length) {
+  uint32_t start = millis();
+  while (length) {
+    if (_client.available()) {
+      int n = _client.read(buf, length);
+      if (n <= 0) continue;
+      buf += n;
+      length -= n;
+    } else if (!_client.connected() || (millis() - start) >= Timeout) {
+      return false;
+    } else {
+      delay(1);
+    }
+  }
+  return true;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * MqttPrintClient
+ *
+ *----------------------------------------------------------------------------*/
+
+MqttPrintClient::~MqttPrintClient() {
+  if (feed) feed->remove(this);
+}
+
+void MqttPrintClient::init(MqttFeed* feed, const String& baseTopic) {
+  if (this->feed) this->feed->remove(this);
+  this->feed = feed;
+  this->baseTopic = baseTopic;
+  if (!this->baseTopic.endsWith("/")) this->baseTopic += '/';
+  jobState.reset();
+  printerState.reset();
+  serverConnected = false;
+  feed->add(this);
+}
+
+void MqttPrintClient::updateState() {
+  if (!feed) return;
+  feed->loop();
+  // Everything the broker has sent is applied, so the state is current
+  if (feed->connected()) timeOfLastUpdate = millis();
+}
+
+MqttPrintClient::State MqttPrintClient::getState() {
+  if (!feed || !feed->connected() || !serverConnected) return State::Offline;
+  if (printerState.isPrinting) return State::Printing;
+  // An idle server publishes nothing about its state until it changes, so
+  // a connected server is assumed to be operational until we hear otherwise
+  if (jobState.state == "Operational" || jobState.state.isEmpty()) {
+    if (completionAcknowledged || jobState.progress.completion <= 99) return State::Operational;
+    return State::Complete;
+  }
+  return State::Offline;
+}
+
+// Messages may be retained ones sent by the broker when we (re)subscribe.
+// They are applied like any other; the plugin's retained will message
+// ("mqtt") says whether the server is still connected.
+void MqttPrintClient::handleMessage(const char* topic, char* payload, size_t length) {
+  if (strcmp(topic, "mqtt") == 0) {
+    serverConnected = (length == 9 && strncmp(payload, "connected", 9) == 0);
+    if (!serverConnected) { jobState.reset(); printerState.reset(); }
+    return;
+  }
+
+  // Parse in place: strings in the document point into the payload
+  DynamicJsonDocument doc(MessageJSONSize);
+  if (deserializeJson(doc, payload, length)) {
+    Log.warning(F("MqttPrintClient: unable to parse %s%s"), baseTopic.c_str(), topic);
+    return;
+  }
+
+  if (strcmp(topic, "progress/printing") == 0) {
+    JsonObjectConst data = doc["printer_data"];
+    if (data.isNull()) {
+      // The plugin is configured to send only the percentage
+      jobState.progress.completion = doc["progress"];
+      return;
+    }
+    jobState.valid = true;
+    const char* state = data["state"]["text"];
+    if (state) jobState.state = state;
+    printerState.isPrinting = data["state"]["flags"]["printing"];
+    jobState.file.name = data["job"]["file"]["name"] | "";
+    jobState.file.path = data["job"]["file"]["path"] | "";
+    jobState.file.origin = data["job"]["file"]["origin"] | "local";
+    jobState.file.size = data["job"]["file"]["size"];
+    jobState.file.date = data["job"]["file"]["date"];
+    jobState.averagePrintTime = data["job"]["averagePrintTime"];
+    jobState.estimatedPrintTime = data["job"]["estimatedPrintTime"];
+    jobState.lastPrintTime = data["job"]["lastPrintTime"];
+    jobState.filamentLength = data["job"]["filament"]["tool0"]["length"];
+    jobState.progress.filepos = data["progress"]["filepos"];
+    jobState.progress.printTime = data["progress"]["printTime"];
+    jobState.progress.printTimeLeft = data["progress"]["printTimeLeft"];
+    jobState.progress.completion = data["progress"]["completion"];
+  } else if (strncmp(topic, "temperature/", 12) == 0) {
+    const char* heater = topic + 12;
+    printerState.valid = true;
+    if (strcmp(heater, "tool0") == 0) {
+      printerState.toolTemp.actual = doc["actual"];
+      printerState.toolTemp.target = doc["target"];
+    } else if (strcmp(heater, "bed") == 0) {
+      printerState.bedTemp.actual = doc["actual"];
+      printerState.bedTemp.target = doc["target"];
+    }
+  } else if (strncmp(topic, "event/", 6) == 0) {
+    const char* event = topic + 6;
+    if (strcmp(event, "PrinterStateChanged") == 0) {
+      const char* state = doc["state_string"];
+      const char* id = doc["state_id"] | "";
+      if (state) jobState.state = state;
+      printerState.isPrinting = (strcmp(id, "PRINTING") == 0);
+    } else if (strcmp(event, "PrintStarted") == 0) {
+      jobState.file.name = doc["name"] | "";
+      jobState.file.path = doc["path"] | "";
+      jobState.file.origin = doc["origin"] | "local";
+      jobState.file.size = doc["size"];
+      jobState.progress.completion = 0;
+      jobState.progress.printTime = 0;
+    } else if (strcmp(event, "PrintDone") == 0) {
+      jobState.progress.completion = 100;
+      jobState.progress.printTimeLeft = 0;
+      jobState.progress.printTime = doc["time"];
+    }
+  }
+  if (completionAcknowledged && jobState.state != "Operational") completionAcknowledged = false;
+}
+
+#endif  // BPA_ENABLE_MQTT
@@ -0,0 +1,132 @@
+#ifndef BPA_MqttFeed_h
+#define BPA_MqttFeed_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#if defined(ESP8266)
+  #include <ESP8266WiFi.h>
+#else
+  #include <WiFi.h>
+#endif
+//                                  Third Party Libraries
+//                                  Local Includes
+#include "BPA_PrintClient.h"
+#include "BPA_OctoClient.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+class MqttPrintClient;
+
+/*
+ * MqttFeed:
+ *    One connection to an MQTT broker (MQTT 3.1.1, QoS 0) shared by every
+ *    MqttPrintClient. Messages are read by loop() and handed to the client
+ *    whose base topic they are under. If the connection drops, loop()
+ *    reconnects and subscribes again; the broker then resends retained
+ *    messages, which restores each printer's last known state.
+ */
+class MqttFeed {
+public:
+  static constexpr size_t MaxPacketSize = 2048;   // Larger messages are skipped
+  static constexpr uint16_t DefaultKeepAlive = 60;  // Seconds
+  static constexpr uint16_t MaxKeepAlive = 30 * 60;
+
+  void init(const String& broker, int port, const String& clientID,
+            const String& user = String(), const String& pass = String());
+  ~MqttFeed();
+
+  // Read and dispatch every waiting message, reconnecting first if needed.
+  // Called by MqttPrintClient::updateState(), and may also be called from
+  // the sketch's loop() to keep state current between refreshes.
+  void loop();
+  // The broker drops a connection it hasn't heard from in 1.5 keep-alive
+  // periods, and pings are only sent by loop(), so the keep-alive must be
+  // longer than the time between calls. PrinterGroup::setMqttFeed() sets it
+  // to twice the group's refresh interval, capped at MaxKeepAlive. Takes
+  // effect at the next connection.
+  void setKeepAlive(uint32_t seconds);
+  uint16_t keepAlive() const { return _keepAlive; }
+  bool connected();
+  uint32_t messagesReceived() const { return _messages; }
+  uint32_t reconnects() const { return _reconnects; }
+
+private:
+  friend class MqttPrintClient;
+  static constexpr uint32_t ReconnectInterval = 10 * 1000L;
+  static constexpr uint32_t Timeout = 5000;
+
+  String _broker;
+  int _port;
+  String _clientID, _user, _pass;
+  WiFiClient _client;
+  bool _open = false;
+  uint32_t _lastConnectAttempt = 0;
+  bool _attempted = false;
+  uint32_t _lastSent = 0;
+  uint16_t _keepAlive = DefaultKeepAlive;
+  uint16_t _packetID = 0;
+  uint8_t* _packet = nullptr;     // MaxPacketSize bytes
+  uint32_t _messages = 0;
+  uint32_t _reconnects = 0;
+  MqttPrintClient* _clients = nullptr;  // Linked through MqttPrintClient::next
+
+  void add(MqttPrintClient* client);
+  void remove(MqttPrintClient* client);
+  bool connect();
+  bool subscribe(MqttPrintClient* client);
+  bool readPacket(uint8_t& type, size_t& length);
+  void dispatch(size_t length);
+  bool sendPacket(uint8_t type, const uint8_t* body, size_t length);
+  bool readFully(uint8_t* buf, size_t length);
+};
+
+/*
+ * MqttPrintClient:
+ *    A PrintClient for an OctoPrint server that publishes its state with the
+ *    OctoPrint-MQTT plugin. Nothing is polled: the state is updated from the
+ *    progress, temperature, and event messages under the printer's base topic
+ *    (the plugin's "Base Topic", e.g. "octoPrint/"), and is kept in the same
+ *    JobState and PrinterState that OctoClient uses.
+ */
+class MqttPrintClient final : public PrintClient {
+public:
+  ~MqttPrintClient();
+
+  // ----- Constructors and initialization
+  void init(MqttFeed* feed, const String& baseTopic);
+
+  // ----- Interrogate the Printer
+  void updateState();
+
+  // ----- Utility Functions
+  void acknowledgeCompletion() { completionAcknowledged = true; }
+  void dumpToLog() { jobState.dumpToLog();  printerState.dumpToLog(); }
+
+  // ----- Getters
+  bool isPrinting() { return getState() == State::Printing; }
+  State getState();
+  float getPctComplete() { return jobState.progress.completion; }
+  uint32_t getPrintTimeLeft() { return jobState.progress.printTimeLeft; }
+  uint32_t getElapsedTime() { return jobState.progress.printTime; }
+  uint32_t getFilamentLength() { return jobState.filamentLength; }
+  String getFilename() { return jobState.file.name; }
+  void getBedTemps(float &actual, float &target) { actual = printerState.bedTemp.actual; target = printerState.bedTemp.target; }
+  void getToolTemps(float &actual, float &target) { actual = printerState.toolTemp.actual; target = printerState.toolTemp.target; }
+
+private:
+  friend class MqttFeed;
+  static constexpr uint32_t MessageJSONSize = 2048;
+
+  MqttFeed*     feed = nullptr;
+  MqttPrintClient* next = nullptr;
+  String        baseTopic;
+  JobState      jobState;
+  PrinterState  printerState;
+  bool          serverConnected = false;  // As reported by the plugin's will topic
+  bool          completionAcknowledged = false;
+
+  // `topic` is relative to the base topic. `payload` is parsed in place.
+  void handleMessage(const char* topic, char* payload, size_t length);
+};
+
+#endif  // BPA_MqttFeed_h
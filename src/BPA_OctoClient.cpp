@@ -13,12 +13,20 @@
 
 //--------------- Begin:  Includes ---------------------------------------------
 //                                  Core Libraries
+#if defined(ESP8266)
+  #include <ESP8266HTTPClient.h>
+#else
+  #include <HTTPClient.h>
+#endif
 //                                  Third Party Libraries
 #include <ArduinoLog.h>
 //                                  Local Includes
+#include "BPA_Config.h"
 #include "BPA_OctoClient.h"
 //--------------- End:    Includes ---------------------------------------------
 
+#if BPA_ENABLE_OCTO
+
 
 /*------------------------------------------------------------------------------
  *
@@ -34,10 +42,11 @@ void OctoClient::init(
   details.pass = pass;
   details.apiKey = apiKey;
   details.apiKeyName = "X-Api-Key";
-  if (service) delete service;
-  service = new JSONService(details);
+  service.emplace(details);
   jobState.reset();
   printerState.reset();
+  jobRequest.reset();
+  printerRequest.reset();
 }
 
 void OctoClient::updateState() {
@@ -59,6 +68,70 @@ void OctoClient::acknowledgeCompletion() {
   completionAcknowledged = true;
 }
 
+// ----- Thumbnails
+
+String OctoClient::getThumbnailKey() {
+  if (jobState.file.path.isEmpty()) return String();
+  String key = jobState.file.origin;
+  key += '/';
+  key += jobState.file.path;
+  key += '@';
+  key += jobState.file.date;
+  return key;
+}
+
+bool OctoClient::streamThumbnail(Print& out) {
+  constexpr uint32_t FileInfoJSONSize = 512;
+  constexpr uint32_t Timeout = 10000;
+
+  if (jobState.file.path.isEmpty()) return false;
+
+  // A thumbnail plugin (e.g. PrusaSlicer Thumbnails) adds the URL of the
+  // thumbnail it extracted to the file's metadata. Ask for just that.
+  String endpoint = "/api/files/";
+  endpoint += jobState.file.origin;
+  endpoint += '/';
+  endpoint += urlEncode(jobState.file.path);
+  StaticJsonDocument<32> filter;
+  filter["thumbnail"] = true;
+  DynamicJsonDocument *root = service->issueGET(endpoint, FileInfoJSONSize, &filter);
+  if (!root) return false;
+  const char* thumbnail = (*root)["thumbnail"];
+  String path = "/";
+  if (thumbnail) path += thumbnail;
+  delete root;
+  if (!thumbnail) return false;
+
+  // The image itself isn't JSON; copy it to `out` a small piece at a time
+  WiFiClient client;
+  HTTPClient http;
+  http.useHTTP10(true);
+  http.setTimeout(Timeout);
+  if (!http.begin(client, details.server, details.port, path)) return false;
+  http.addHeader(details.apiKeyName, details.apiKey);
+  int httpCode = http.GET();
+  if (httpCode != HTTP_CODE_OK) {
+    Log.warning(F("Thumbnail GET %s failed: %d"), path.c_str(), httpCode);
+    http.end();
+    return false;
+  }
+
+  int size = http.getSize();      // -1 if the server didn't say
+  int remaining = size;
+  WiFiClient* stream = http.getStreamPtr();
+  uint8_t buf[128];
+  uint32_t start = millis();
+  while ((http.connected() || stream->available()) && remaining != 0 && (millis() - start) < Timeout) {
+    size_t available = stream->available();
+    if (!available) { delay(1); continue; }
+    size_t n = stream->readBytes(buf, min(available, sizeof(buf)));
+    out.write(buf, n);
+    if (remaining > 0) remaining -= n;
+  }
+  http.end();
+  return size < 0 || remaining == 0;
+}
+
 /*------------------------------------------------------------------------------
  *
  * Private methods
@@ -69,56 +142,69 @@ void OctoClient::getJobState() {
   constexpr const char* JobStateEndpoint = "/api/job";
   constexpr uint32_t JobStateJSONSize = 1024; // from https://arduinojson.org/v6/assistant/
 
-  DynamicJsonDocument *root = service->issueGET(JobStateEndpoint, JobStateJSONSize);
-  if (!root) {
-    Log.warning(F("issueGET failed, giving up"));
-    jobState.reset();
-    return;
+  // The job is polled often and usually hasn't changed; skip the parse if so
+  DynamicJsonDocument doc(JobStateJSONSize);
+  switch (jobRequest.get(details, JobStateEndpoint, doc, fetchStats)) {
+    case ConditionalGet::Failed:
+      Log.warning(F("GET %s failed, giving up"), JobStateEndpoint);
+      jobState.reset();
+      return;
+    case ConditionalGet::Unchanged:
+      timeOfLastUpdate = millis();
+      return;
+    case ConditionalGet::Changed:
+      break;
   }
-  //serializeJsonPretty(*root, Serial); Serial.println();
+  //serializeJsonPretty(doc, Serial); Serial.println();
 
   jobState.valid = true;
-  jobState.state = (*root)["state"].as<String>();
-  jobState.file.name = (*root)["job"]["file"]["name"].as<String>();
-  jobState.file.size = (*root)["job"]["file"]["size"];
-
-  jobState.averagePrintTime = (*root)["job"]["averagePrintTime"];
-  jobState.estimatedPrintTime = (*root)["job"]["estimatedPrintTime"];
-  jobState.lastPrintTime = (*root)["job"]["lastPrintTime"];
-  jobState.filamentLength = (*root)["job"]["filament"]["tool0"]["length"];
-
-  jobState.progress.filepos = (*root)["progress"]["filepos"];
-  jobState.progress.printTime = (*root)["progress"]["printTime"];
-  jobState.progress.printTimeLeft = (*root)["progress"]["printTimeLeft"];
+  jobState.state = doc["state"].as<String>();
+  jobState.file.name = doc["job"]["file"]["name"].as<String>();
+  jobState.file.path = doc["job"]["file"]["path"] | "";
+  jobState.file.origin = doc["job"]["file"]["origin"] | "local";
+  jobState.file.size = doc["job"]["file"]["size"];
+  jobState.file.date = doc["job"]["file"]["date"];
+
+  jobState.averagePrintTime = doc["job"]["averagePrintTime"];
+  jobState.estimatedPrintTime = doc["job"]["estimatedPrintTime"];
+  jobState.lastPrintTime = doc["job"]["lastPrintTime"];
+  jobState.filamentLength = doc["job"]["filament"]["tool0"]["length"];
+
+  jobState.progress.filepos = doc["progress"]["filepos"];
+  jobState.progress.printTime = doc["progress"]["printTime"];
+  jobState.progress.printTimeLeft = doc["progress"]["printTimeLeft"];
   if (completionAcknowledged && jobState.state != "Operational") completionAcknowledged = false;
-  jobState.progress.completion = (*root)["progress"]["completion"];
+  jobState.progress.completion = doc["progress"]["completion"];
 
   timeOfLastUpdate = millis();
-  delete root;
 }
 
 void OctoClient::getPrinterState() {
   constexpr const char* PrinterStateEndpoint = "/api/printer?exclude=sd,history";
   constexpr uint32_t PrinterStateJSONSize = 1024; // from https://arduinojson.org/v6/assistant/
 
-  DynamicJsonDocument *root = service->issueGET(PrinterStateEndpoint, PrinterStateJSONSize);
-  if (!root) {
-    Log.warning(F("issueGET failed, giving up"));
-    printerState.reset();
-    return;
+  DynamicJsonDocument doc(PrinterStateJSONSize);
+  switch (printerRequest.get(details, PrinterStateEndpoint, doc, fetchStats)) {
+    case ConditionalGet::Failed:
+      Log.warning(F("GET %s failed, giving up"), PrinterStateEndpoint);
+      printerState.reset();
+      return;
+    case ConditionalGet::Unchanged:
+      timeOfLastUpdate = millis();
+      return;
+    case ConditionalGet::Changed:
+      break;
   }
-  // serializeJsonPretty(root, Serial); Serial.println();
+  // serializeJsonPretty(doc, Serial); Serial.println();
 
   printerState.valid = true;
-  printerState.isPrinting = (*root)["state"]["flags"]["printing"];
-  printerState.toolTemp.actual = (*root)["temperature"]["tool0"]["actual"];
-  printerState.toolTemp.target =(*root)["temperature"]["tool0"]["target"];
-  printerState.bedTemp.actual = (*root)["temperature"]["bed"]["actual"];
-  printerState.bedTemp.target = (*root)["temperature"]["bed"]["target"];
+  printerState.isPrinting = doc["state"]["flags"]["printing"];
+  printerState.toolTemp.actual = doc["temperature"]["tool0"]["actual"];
+  printerState.toolTemp.target =doc["temperature"]["tool0"]["target"];
+  printerState.bedTemp.actual = doc["temperature"]["bed"]["actual"];
+  printerState.bedTemp.target = doc["temperature"]["bed"]["target"];
 
   timeOfLastUpdate = millis();
-  delete root;
 }
 
-
-
+#endif  // BPA_ENABLE_OCTO
@@ -9,7 +9,10 @@
 #include <ArduinoLog.h>
 #include <JSONService.h>
 //                                  Local Includes
+#include "BPA_Config.h"
 #include "BPA_PrintClient.h"
+#include "BPA_InPlace.h"
+#include "BPA_ConditionalGet.h"
 //--------------- End:    Includes ---------------------------------------------
 
 
@@ -20,7 +23,10 @@ public:
   String state;                     // State of the job
   struct {
     String    name;                 // Name of the file being printed
+    String    path;                 // Path of the file within its origin
+    String    origin;               // "local" or "sdcard"
     uint32_t  size;                 // Size of the file being printed
+    uint32_t  date;                 // Modification time of the file (epoch seconds)
   } file;
   uint32_t averagePrintTime;
   uint32_t estimatedPrintTime;
@@ -37,7 +43,10 @@ public:
     valid = false;
     state = "";
     file.name = "";
+    file.path = "";
+    file.origin = "";
     file.size = 0;
+    file.date = 0;
     averagePrintTime = 0;
     estimatedPrintTime = 0;
     lastPrintTime = 0;
@@ -49,6 +58,7 @@ public:
   }
 
   void dumpToLog() {
+#if BPA_LOG_LEVEL >= LOG_LEVEL_VERBOSE
     if (!valid) Log.verbose(F("----- Job State: Values have not been set"));
     else {
       Log.verbose(F("----- Job State: %s -----"), state.c_str());
@@ -68,6 +78,7 @@ public:
       Log.verbose(F("  Completion: %F"), progress.completion);
       Log.verbose(F("----------"));
     }
+#endif
   }
 };
 
@@ -97,6 +108,7 @@ public:
   }
 
   void dumpToLog() {
+#if BPA_LOG_LEVEL >= LOG_LEVEL_VERBOSE
     if (!valid) Log.verbose(F("Printer State: Values have not been set"));
     else {
       Log.verbose(F("----- Printer State: printing = %T"), isPrinting);
@@ -106,11 +118,12 @@ public:
       Log.verbose(F("  Tool Target Temp: %F (C)"), bedTemp.target);
       Log.verbose(F("----------"));
     }
+#endif
   }
 };
 
 
-class OctoClient : public PrintClient {
+class OctoClient final : public PrintClient {
 public:
   // ----- Constructors and initialization
   void init(String apiKey, String server, int port, String user, String pass);
@@ -128,15 +141,22 @@ public:
   float getPctComplete() { return jobState.progress.completion; }
   uint32_t getPrintTimeLeft() { return jobState.progress.printTimeLeft; }
   uint32_t getElapsedTime() { return jobState.progress.printTime; }
+  uint32_t getFilamentLength() { return jobState.filamentLength; }
   String getFilename() { return jobState.file.name; }
   void getBedTemps(float &actual, float &target) { actual = printerState.bedTemp.actual; target = printerState.bedTemp.target; }
   void getToolTemps(float &actual, float &target) { actual = printerState.toolTemp.actual; target = printerState.toolTemp.target; }
 
+  // ----- Thumbnails
+  String getThumbnailKey();
+  bool streamThumbnail(Print& out);
+
 private:
   ServiceDetails  details;
-  JSONService     *service = NULL;
+  InPlace<JSONService> service;
   JobState      jobState;
   PrinterState  printerState;
+  ConditionalGet jobRequest;
+  ConditionalGet printerRequest;
   bool          completionAcknowledged = false;
   
   void getJobState();
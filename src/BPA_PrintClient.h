@@ -10,8 +10,19 @@ public:
     // Complete means that although we aren't printing now, we did finish a print.
     // And Printing is the most active since activity is occuring now.
 
+  // How many requests a client made to its printer, and how many of them
+  // could skip parsing because nothing had changed
+  struct FetchStats {
+    uint32_t requests;
+    uint32_t notModified;   // The server answered 304 to a conditional request
+    uint32_t unchanged;     // The body was identical to the previous one
+    uint32_t bytesReceived; // Body bytes as sent, possibly compressed
+    uint32_t bytesDecoded;  // Body bytes after decompression
+  };
+
   // ----- State
   uint32_t      timeOfLastUpdate = 0;
+  FetchStats    fetchStats = {0, 0, 0, 0, 0};
 
   // ----- Interrogate the Printer
   virtual void updateState() = 0;
@@ -26,9 +37,36 @@ public:
   virtual float getPctComplete() = 0;
   virtual uint32_t getPrintTimeLeft() = 0;
   virtual uint32_t getElapsedTime() = 0;
+  virtual uint32_t getFilamentLength() = 0;
   virtual String getFilename() = 0;
   virtual void getBedTemps(float &actual, float &target) = 0;
   virtual void getToolTemps(float &actual, float &target) = 0;
+
+  // ----- Thumbnails (optional)
+  // A key identifying the thumbnail of the current file: it changes when the
+  // file or its modification time changes. Empty if there is no thumbnail.
+  virtual String getThumbnailKey() { return String(); }
+  // Write the thumbnail image of the current file to `out` as it arrives from
+  // the printer. Returns false if there is none or it could not be fetched.
+  virtual bool streamThumbnail(Print& out) { return false; }
+
+protected:
+  // Escape a file name for use in a URL
+  static String urlEncode(const String& s) {
+    static const char Hex[] = "0123456789ABCDEF";
+    String encoded;
+    encoded.reserve(s.length());
+    for (const char* c = s.c_str(); *c; c++) {
+      if (isalnum(*c) || *c == '-' || *c == '_' || *c == '.' || *c == '~' || *c == '/') {
+        encoded += *c;
+      } else {
+        encoded += '%';
+        encoded += Hex[(uint8_t)*c >> 4];
+        encoded += Hex[*c & 0xf];
+      }
+    }
+    return encoded;
+  }
 };
 
 #endif  // BPA_PrintClient_h
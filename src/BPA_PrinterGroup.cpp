@@ -9,24 +9,113 @@
 
 //--------------- Begin:  Includes ---------------------------------------------
 //                                  Core Libraries
-#include <Wire.h>
 #if defined(ESP8266)
   #include <ESP8266WiFi.h>
-#elif defined(ESP32)
-  #include <WiFi.h>
+  #include <ESP8266HTTPClient.h>
 #else
-  #error "Must be an ESP8266 or ESP32"
+  // ESP32, or a host build that supplies its own WiFi.hostByName()
+  #include <WiFi.h>
+  #include <HTTPClient.h>
 #endif
 //                                  Third Party Libraries
+#include <ArduinoLog.h>
 #include <Output.h>
 //                                  Local Includes
-#include "BPA_OctoClient.h"
-#include "BPA_MockPrintClient.h"
-#include "BPA_DuetClient.h"
+#include "BPA_ClientSlot.h"
+#include "BPA_Crc32.h"
+#include "BPA_GroupSnapshot.h"
 #include "BPA_PrinterGroup.h"
 //--------------- End:    Includes ---------------------------------------------
 
 
+// A Print that writes into a fixed-size buffer, always keeping it NUL terminated.
+// Output that doesn't fit is dropped.
+class BufferPrint : public Print {
+public:
+  BufferPrint(char* buf, size_t size) : _buf(buf), _size(size) { if (_size) _buf[0] = '\0'; }
+
+  size_t write(uint8_t c) {
+    if (_length + 1 >= _size) return 0;
+    _buf[_length++] = c;
+    _buf[_length] = '\0';
+    return 1;
+  }
+
+  size_t length() const { return _length; }
+
+private:
+  char* _buf;
+  size_t _size;
+  size_t _length = 0;
+};
+
+// A Print that appends to a String
+class StringPrint : public Print {
+public:
+  StringPrint(String& s) : _s(s) { }
+  size_t write(uint8_t c) { _s += (char)c; return 1; }
+  size_t write(const uint8_t *buffer, size_t size) {
+    _s.concat((const char*)buffer, size);
+    return size;
+  }
+
+private:
+  String& _s;
+};
+
+// Collects output into a small buffer and passes it along in chunks, so that
+// writing to a network client doesn't send a packet per character
+class BufferedPrint : public Print {
+public:
+  BufferedPrint(Print& out) : _out(out) { }
+  ~BufferedPrint() { flush(); }
+
+  size_t write(uint8_t c) {
+    if (_length == sizeof(_buf)) flush();
+    _buf[_length++] = c;
+    return 1;
+  }
+  void flush() {
+    if (_length) _out.write(_buf, _length);
+    _length = 0;
+  }
+
+private:
+  Print& _out;
+  uint8_t _buf[128];
+  size_t _length = 0;
+};
+
+// Escapes characters as required inside a JSON string and passes them along
+class JSONStringPrint : public Print {
+public:
+  JSONStringPrint(Print& out) : _out(out) { }
+
+  size_t write(uint8_t c) {
+    switch (c) {
+      case '"':  _out.print(F("\\\"")); break;
+      case '\\': _out.print(F("\\\\")); break;
+      case '\n': _out.print(F("\\n")); break;
+      case '\r': _out.print(F("\\r")); break;
+      case '\t': _out.print(F("\\t")); break;
+      default:
+        if (c < 0x20) {
+          static const char Hex[] = "0123456789abcdef";
+          _out.print(F("\\u00"));
+          _out.print(Hex[c >> 4]);
+          _out.print(Hex[c & 0xf]);
+        } else {
+          _out.write(c);
+        }
+    }
+    return 1;
+  }
+
+private:
+  Print& _out;
+};
+
+
 PrinterGroup::PrinterGroup(
       uint8_t nPrintersInGroup, PrinterSettings* ps,
       uint32_t refreshInterval, std::function<void(bool)> busyCallback)
@@ -35,24 +124,68 @@ PrinterGroup::PrinterGroup(
   _ps = ps;
   _refreshInterval = refreshInterval;
   _busyCallback = busyCallback;
+  _etagNonce = random(0x7fffffff);    // The ESP cores draw on the hardware RNG
 
   _lastUpdateTime = new uint32_t[_nPrintersInGroup];
   _printer = new PrintClient*[_nPrintersInGroup];
+  _slots = new ClientSlot[_nPrintersInGroup];
   _printerIPs = new String[nPrintersInGroup];
+  _history = new PrinterHistory[nPrintersInGroup];
+  _lastState = new PrintClient::State[nPrintersInGroup];
+  _jobStart = new uint32_t[nPrintersInGroup];
+  _pollStats = new PollStats[nPrintersInGroup];
+  _snapshots = new PrinterSnapshot[nPrintersInGroup];
+  _rendered = new RenderedPrinter[nPrintersInGroup];
+  _streamed = new StreamedValues[nPrintersInGroup];
+  _owner = new uint8_t[nPrintersInGroup];
+  _hostOf = new uint8_t[nPrintersInGroup];
+  _hostLastPoll = new uint32_t[nPrintersInGroup];
+  _snapshotFetched = new uint32_t[nPrintersInGroup];
+  resetPollStats();
   for (int i = 0; i < _nPrintersInGroup; i++) {
     _lastUpdateTime[i] = 0;
     _printer[i] = nullptr;
+    _lastState[i] = PrintClient::State::Offline;
+    _jobStart[i] = 0;
+    _owner[i] = i;
+    _hostOf[i] = i;
+    _hostLastPoll[i] = 0;
+    _snapshotFetched[i] = 0;
+    _snapshots[i].batch = 0;
+    _rendered[i].version = 0;
+    memset(&_streamed[i], 0, sizeof(StreamedValues));
     Basics::resetString(_printerIPs[i]);
   }
 }
 
+void PrinterGroup::setMqttFeed(MqttFeed* feed) {
+  _mqttFeed = feed;
+#if BPA_ENABLE_MQTT
+  // MQTT printers are read, and the feed pinged, once per refresh interval
+  if (feed) feed->setKeepAlive(2 * _refreshInterval);
+#endif
+}
+
+void PrinterGroup::setMockOptions(
+    uint32_t seed, std::function<uint32_t()> clock, const MockEvent* script, uint8_t nEvents)
+{
+  _mockSeeded = true;
+  _mockSeed = seed;
+  _mockClock = clock;
+  _mockScript = script;
+  _mockEvents = nEvents;
+}
+
 void PrinterGroup::refreshPrinterData(bool force) {
+  uint32_t refreshStart = millis();
+  bool polledAny = false;
   for (int i = 0; i < _nPrintersInGroup; i++) {
-    if (_ps[i].isActive) {
+    // A printer that shares another's endpoint is updated when its owner is polled
+    if (isActive(i) && _owner[i] == i) {
       uint32_t threshold = UINT32_MAX;
       // Randomize the refresh times a little so we aren't do all the updates
       // at once which can cause the UI to become unresponsive
-      switch (_printer[i]->getState()) {
+      switch (slot(i).getState()) {
         case PrintClient::State::Offline:
           threshold = (random(5*60, 10*60) * 1000L);  // 5 to 10 minutes
           break;
@@ -64,20 +197,90 @@ void PrinterGroup::refreshPrinterData(bool force) {
           threshold = (_refreshInterval * 1000L);  // Caller-specified interval
           break;
       }
+      // A federated printer is polled by its node, and Moonraker and MQTT
+      // printers push their state; reading any of them is cheap, and the
+      // pushed updates queue up until they are read
+      ClientSlot::Kind kind = slot(i).kind();
+      if (_nNodes || kind == ClientSlot::Kind::Moonraker || kind == ClientSlot::Kind::Mqtt) {
+        threshold = (_refreshInterval * 1000L);
+      }
       if (force || ((millis() -  _lastUpdateTime[i])) > threshold) {
+        // Don't hit one host with back-to-back polls for each of its
+        // printers; leave the rest for a later call
+        uint32_t& hostLastPoll = _hostLastPoll[_hostOf[i]];
+        if (!force && hostLastPoll && (millis() - hostLastPoll) < MinHostPollInterval) continue;
+
         if (_busyCallback) _busyCallback(true);
-        _printer[i]->updateState();
+        PrintClient::State before = slot(i).getState();
+        uint32_t pollStart = millis();
+        slot(i).updateState();
         _lastUpdateTime[i] = millis();
-        _printer[i]->dumpToLog();
+        hostLastPoll = _lastUpdateTime[i];
+        notePoll(i, _lastUpdateTime[i] - pollStart);
+        if (_eventLog) logPoll(i, before, _lastUpdateTime[i] - pollStart);
+        polledAny = true;
+        // Printers that share this one's client are the same machine, so its
+        // jobs are logged once, under the owner
+        trackJob(i);
+        for (int j = 0; j < _nPrintersInGroup; j++) {
+          if (_owner[j] != i || !isActive(j)) continue;
+          _lastUpdateTime[j] = _lastUpdateTime[i];
+          recordHistory(j);
+          checkForChanges(j, true);
+          checkForDeltas(j);
+        }
+#if BPA_LOG_LEVEL >= LOG_LEVEL_VERBOSE
+        if (Log.getLevel() >= LOG_LEVEL_VERBOSE) slot(i).dumpToLog();
+#endif
       }
     }
   }
+  if (polledAny) _lastRefreshMillis = millis() - refreshStart;
   if (_busyCallback) _busyCallback(false);
 }
 
 void PrinterGroup::activatePrinter(int i) {
   PrinterSettings *ps = &_ps[i];
   if (!ps->isActive) return;
+  if (_nNodes == 0 && !ownsPrinter(i)) return;  // Another node in the shard polls it
+
+  if (_printer[i] != NULL) {
+    Log.warning(F("Trying to activate a printer this is already active: %s"), ps->server.c_str());
+    return;
+  }
+
+#if BPA_ENABLE_REMOTE
+  if (_nNodes) {
+    // Gateway: get the printer's state from the node that polls it. The nodes
+    // share our settings, so the printer has the same index there.
+    uint8_t node = nodeForPrinter(*ps, _nNodes);
+    Log.verbose(F("Setting up a RemotePrintClient for %s on node %d"), ps->server.c_str(), node);
+    _slots[i].emplaceRemote().init(&_nodes[node], i, _refreshInterval * 1000L);
+    _printer[i] = _slots[i].client();
+    bumpVersion(i);
+    return;
+  }
+#endif
+
+  if (ps->type.equals(Type_OctoMQTT) && !ps->mock) {
+#if BPA_ENABLE_MQTT
+    // The printer's state is pushed through the group's MQTT feed; there is
+    // no address to resolve
+    if (_mqttFeed == nullptr) {
+      Log.warning(F("No MQTT feed for %s"), ps->server.c_str());
+      ps->isActive = false;
+      return;
+    }
+    Log.verbose(F("Setting up an MqttPrintClient for %s"), ps->server.c_str());
+    _slots[i].emplaceMqtt().init(_mqttFeed, ps->server);
+    _printer[i] = _slots[i].client();
+    bumpVersion(i);
+#else
+    Log.warning(F("MQTT is not enabled in this build: %s"), ps->server.c_str());
+    ps->isActive = false;
+#endif
+    return;
+  }
 
   cachePrinterIP(i);
   if (_printerIPs[i].isEmpty()) {
@@ -86,31 +289,142 @@ void PrinterGroup::activatePrinter(int i) {
     return;
   }
 
-  if (_printer[i] != NULL) {
-    Log.warning(F("Trying to activate a printer this is already active: %s"), ps->server.c_str());
+  // If another printer is already polling the same endpoint, share its client
+  for (int j = 0; j < _nPrintersInGroup; j++) {
+    if (j == i || _owner[j] != j || !isActive(j) || !sameEndpoint(j, i)) continue;
+    Log.verbose(F("%s shares a client with printer %d"), ps->server.c_str(), j);
+    _printer[i] = _printer[j];
+    _owner[i] = j;
+    bumpVersion(i);
     return;
   }
 
   if (ps->mock) {
+#if BPA_ENABLE_MOCK
     Log.verbose(
         "Setting up a MockPrintClient of type %s for %s",
         ps->type.c_str(), ps->server.c_str());
-    MockPrintClient *mc = new MockPrintClient();
-    _printer[i] = mc;
+    if (_mockSeeded) _slots[i].emplaceMock(_mockSeed + i, _mockClock, _mockScript, _mockEvents);
+    else _slots[i].emplaceMock();
+    _printer[i] = _slots[i].client();
+#else
+    Log.warning(F("Mock printers are not enabled in this build: %s"), ps->server.c_str());
+    ps->isActive = false;
+#endif
   } else if (ps->type.equals(Type_Octo)) {
+#if BPA_ENABLE_OCTO
     Log.verbose(F("Setting up an OctoClient for %s: "), ps->server.c_str());
-    OctoClient *oc = new OctoClient();
-    oc->init(ps->apiKey, _printerIPs[i], ps->port, ps->user, ps->pass);
-    _printer[i] = oc;
+    _slots[i].emplaceOcto().init(ps->apiKey, _printerIPs[i], ps->port, ps->user, ps->pass);
+    _printer[i] = _slots[i].client();
+#else
+    Log.warning(F("OctoPrint is not enabled in this build: %s"), ps->server.c_str());
+    ps->isActive = false;
+#endif
   } else if (ps->type.equals(Type_Duet)) {
+#if BPA_ENABLE_DUET
     Log.verbose(F("Setting up an DuetClient for %s: "), ps->server.c_str());
-    DuetClient *dc = new DuetClient();
-    dc->init(_printerIPs[i], ps->port, ps->pass);
-    _printer[i] = dc;
+    _slots[i].emplaceDuet().init(_printerIPs[i], ps->port, ps->pass);
+    _printer[i] = _slots[i].client();
+#else
+    Log.warning(F("Duet3D is not enabled in this build: %s"), ps->server.c_str());
+    ps->isActive = false;
+#endif
+  } else if (ps->type.equals(Type_Moonraker)) {
+#if BPA_ENABLE_MOONRAKER
+    Log.verbose(F("Setting up a MoonrakerClient for %s: "), ps->server.c_str());
+    _slots[i].emplaceMoonraker().init(_printerIPs[i], ps->port, ps->apiKey);
+    _printer[i] = _slots[i].client();
+#else
+    Log.warning(F("Moonraker is not enabled in this build: %s"), ps->server.c_str());
+    ps->isActive = false;
+#endif
   } else {
     Log.warning(F("Bad printer type: %s"), ps->type.c_str());
     ps->isActive = false;
   }
+  bumpVersion(i);
+}
+
+void PrinterGroup::applySettings(const PrinterSettings* settings) {
+  // Decide which printers need a new client: those whose endpoint, credentials,
+  // or active state changed, and any printer sharing a client with one of them
+  bool* rebuild = new bool[_nPrintersInGroup];
+  for (int i = 0; i < _nPrintersInGroup; i++) {
+    const PrinterSettings& from = _ps[i];
+    const PrinterSettings& to = settings[i];
+    rebuild[i] =
+        from.isActive != to.isActive || from.mock != to.mock || from.type != to.type ||
+        !from.server.equalsIgnoreCase(to.server) || from.port != to.port ||
+        from.apiKey != to.apiKey || from.user != to.user || from.pass != to.pass;
+  }
+  for (int i = 0; i < _nPrintersInGroup; i++) {
+    if (rebuild[_owner[i]]) rebuild[i] = true;
+  }
+
+  // Release the old clients; sharers first so no one points at a released slot
+  for (int pass = 0; pass < 2; pass++) {
+    for (int i = 0; i < _nPrintersInGroup; i++) {
+      bool isSharer = _owner[i] != i;
+      if (rebuild[i] && isSharer == (pass == 0)) deactivatePrinter(i);
+    }
+  }
+
+  for (int i = 0; i < _nPrintersInGroup; i++) {
+    if (!rebuild[i]) {
+      // Only cosmetic settings changed. The client keeps its state.
+      if (_ps[i].nickname != settings[i].nickname) {
+        _ps[i].nickname = settings[i].nickname;
+        bumpVersion(i);
+      }
+      continue;
+    }
+    bool sameServer = _ps[i].server.equalsIgnoreCase(settings[i].server);
+    _ps[i] = settings[i];
+    if (!sameServer) Basics::resetString(_printerIPs[i]);
+  }
+  for (int i = 0; i < _nPrintersInGroup; i++) {
+    if (rebuild[i]) activatePrinter(i);
+  }
+  delete[] rebuild;
+}
+
+void PrinterGroup::setShard(uint8_t self, uint8_t nNodes) {
+  _shard = self;
+  _nShards = nNodes ? nNodes : 1;
+}
+
+void PrinterGroup::setFederation(RemoteNode* nodes, uint8_t nNodes) {
+#if BPA_ENABLE_REMOTE
+  _nodes = nodes;
+  _nNodes = nodes ? nNodes : 0;
+#else
+  Log.warning(F("Federation is not enabled in this build"));
+#endif
+}
+
+// Rendezvous (highest random weight) hashing: each node scores the printer and
+// the highest score wins. The assignment depends only on the printer and the
+// number of nodes, so every node and the gateway agree on it without talking
+// to each other. Adding a node only moves the printers that the new node wins.
+uint8_t PrinterGroup::nodeForPrinter(const PrinterSettings& ps, uint8_t nNodes) {
+  uint32_t key = 2166136261u;   // FNV-1a of server:port
+  for (const char* c = ps.server.c_str(); *c; c++) key = (key ^ (uint8_t)*c) * 16777619u;
+  key = (key ^ (uint32_t)ps.port) * 16777619u;
+
+  uint8_t best = 0;
+  uint32_t bestScore = 0;
+  for (uint8_t n = 0; n < nNodes; n++) {
+    uint32_t h = key ^ ((n + 1) * 0x9e3779b9u);   // Mix in the node (murmur3 finalizer)
+    h ^= h >> 16; h *= 0x85ebca6bu;
+    h ^= h >> 13; h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    if (n == 0 || h > bestScore) { best = n; bestScore = h; }
+  }
+  return best;
+}
+
+bool PrinterGroup::ownsPrinter(uint8_t whichPrinter) {
+  return _nShards <= 1 || nodeForPrinter(_ps[whichPrinter], _nShards) == _shard;
 }
 
 PrintClient* PrinterGroup::getPrinter(uint8_t whichPrinter) {
@@ -126,27 +440,29 @@ String PrinterGroup::getDisplayName(uint8_t whichPrinter) {
   return displayName;
 }
 
-bool PrinterGroup::nextCompletion(uint8_t& whichPrinter, String &formattedTime, uint32_t &delta) {
-  uint32_t minCompletion = UINT32_MAX;
-  int printerWithNextCompletion;
+uint32_t PrinterGroup::getStaleness(uint8_t whichPrinter) {
+  PrintClient* p = _printer[whichPrinter];
+  if (p == nullptr || p->timeOfLastUpdate == 0) return UINT32_MAX;
+  return millis() - p->timeOfLastUpdate;
+}
+
+void PrinterGroup::resetPollStats() {
   for (int i = 0; i < _nPrintersInGroup; i++) {
-    if (!_ps[i].isActive) continue;
-    if (_printer[i]->getState() == PrintClient::State::Printing) {
-      uint32_t thisCompletion = _printer[i]->getPrintTimeLeft();
-      if (thisCompletion < minCompletion) {
-        minCompletion = thisCompletion;
-        printerWithNextCompletion = i;
-      }
-    }
+    _pollStats[i].polls = 0;
+    _pollStats[i].totalMillis = 0;
+    _pollStats[i].lastMillis = 0;
+    _pollStats[i].maxMillis = 0;
   }
+  _lastRefreshMillis = 0;
+}
 
-  if (minCompletion != UINT32_MAX) {
-    whichPrinter = printerWithNextCompletion;
-    delta = minCompletion;
-    completionTime(formattedTime, delta);
-    return true;
-  }
-  return false;
+bool PrinterGroup::nextCompletion(uint8_t& whichPrinter, String &formattedTime, uint32_t &delta) {
+  int printerWithNextCompletion = nextCompletingPrinter(delta);
+  if (printerWithNextCompletion < 0) return false;
+
+  whichPrinter = printerWithNextCompletion;
+  completionTime(formattedTime, delta);
+  return true;
 }
 
 void PrinterGroup::nextCompletion(String &printer, String &formattedTime, uint32_t &delta) {
@@ -162,54 +478,184 @@ void PrinterGroup::nextCompletion(String &printer, String &formattedTime, uint32
 }
 
 void PrinterGroup::dataSupplier(const String& key, String& value) {
-  // Map printer related keys
-  if (key.equalsIgnoreCase("next")) {
-    uint32_t delta;
-    String printer, formattedTime;
-    nextCompletion(printer, formattedTime, delta);
-    if (printer.isEmpty()) value += F("No print in progress");
-    else { value += printer; value += ": "; value += formattedTime; }
-    return;
+  StringPrint out(value);
+  resolveKey(key.c_str(), out, false);
+}
+
+size_t PrinterGroup::dataSupplier(const char* key, char* value, size_t size) {
+  BufferPrint out(value, size);
+  resolveKey(key, out, false);
+  return out.length();
+}
+
+void PrinterGroup::dataSupplier(uint16_t nKeys, const char* const* keys, String* values) {
+  // Start a new batch; snapshots taken during an earlier batch are now stale
+  if (++_batch == 0) _batch = 1;
+
+  for (uint16_t k = 0; k < nKeys; k++) {
+    StringPrint out(values[k]);
+    resolveKey(keys[k], out, true);
   }
+}
 
-  // Check for printer-specific keys
-  if (isDigit(key[0]) && key[1] == '.') {
-    int index = (key[0] - '0') - 1;
-    String subkey = key.substring(2);
-    mapPrinterSpecific(subkey, value, index);
+void PrinterGroup::printerInfo(String& printerInfoAsJSON) {
+  printerInfoAsJSON = "";
+  StringPrint out(printerInfoAsJSON);
+  printerInfo(out);
+}
+
+void PrinterGroup::printerInfo(Print& output) {
+  BufferedPrint out(output);
+  out.print('[');
+  for (int i = 0; i < _nPrintersInGroup; i++) {
+    if (i) out.print(F(", "));
+    writePrinterInfo(out, i);
+  }
+  out.print(']');
+}
+
+void PrinterGroup::writeSnapshot(Print& output) {
+  BufferedPrint buffered(output);
+  Crc32Print out(buffered);
+  GroupSnapshot::writeHeader(out, now(), _nPrintersInGroup);
+  for (int i = 0; i < _nPrintersInGroup; i++) {
+    GroupSnapshot::Printer record;
+    ClientSlot* p = &slot(i);
+    record.active = isActive(i);
+    if (record.active) {
+      record.state = p->getState();
+      record.pct = (uint8_t)p->getPctComplete();
+      record.elapsed = p->getElapsedTime();
+      record.timeLeft = p->getPrintTimeLeft();
+      p->getBedTemps(record.bedActual, record.bedTarget);
+      p->getToolTemps(record.toolActual, record.toolTarget);
+      GroupSnapshot::writePrinter(out, record, getDisplayName(i), p->getFilename());
+    } else {
+      memset(&record, 0, sizeof(record));
+      record.state = PrintClient::State::Offline;
+      GroupSnapshot::writePrinter(out, record, getDisplayName(i), String());
+    }
+  }
+  GroupSnapshot::writeTrailer(buffered, out.crc());
+}
+
+int8_t PrinterGroup::subscribe() {
+  for (int s = 0; s < MaxSubscribers; s++) {
+    if (_pending[s] == nullptr) {
+      _pending[s] = new uint8_t[_nPrintersInGroup];
+      memset(_pending[s], Field_All, _nPrintersInGroup);
+      return s;
+    }
+  }
+  return -1;
+}
+
+void PrinterGroup::unsubscribe(int8_t subscriber) {
+  if (subscriber < 0 || subscriber >= MaxSubscribers) return;
+  delete[] _pending[subscriber];
+  _pending[subscriber] = nullptr;
+}
+
+bool PrinterGroup::writeDeltas(int8_t subscriber, Print& output) {
+  if (subscriber < 0 || subscriber >= MaxSubscribers || !_pending[subscriber]) return false;
+  uint8_t* pending = _pending[subscriber];
+
+  BufferedPrint out(output);
+  bool wroteAny = false;
+  for (int i = 0; i < _nPrintersInGroup; i++) {
+    uint8_t changed = pending[i];
+    if (!changed) continue;
+    pending[i] = 0;
+    if (!isActive(i)) continue;
+
+    StreamedValues v;
+    streamedValues(i, v);
+    out.print(F("event: delta\ndata: {\"printer\":"));
+    out.print(i+1);
+    if (changed & Field_State) {
+      out.print(F(", \"state\":\""));
+      mapPrinterSpecific(PrinterKey::State, out, i, snapshot(i, false));
+      out.print('"');
+    }
+    if (changed & Field_Pct) { out.print(F(", \"pct\":")); out.print(v.pct); }
+    if (changed & Field_Remaining) { out.print(F(", \"remaining\":")); out.print(v.remaining); }
+    if (changed & Field_BedTemp) { out.print(F(", \"bed\":")); out.print(v.bedTemp); }
+    if (changed & Field_ToolTemp) { out.print(F(", \"tool\":")); out.print(v.toolTemp); }
+    out.print(F("}\n\n"));
+    wroteAny = true;
+  }
+  return wroteAny;
+}
+
+void PrinterGroup::setSnapshotSource(const char* type, const String& path, uint16_t port) {
+  SnapshotSource* source = snapshotSource(type);
+  if (source == nullptr) {
+    Log.warning(F("No webcam snapshots for printers of type %s"), type);
     return;
   }
+  source->path = path;
+  source->port = port;
 }
 
-void PrinterGroup::printerInfo(String& printerInfoAsJSON) {
-    bool firstTime = true;
-    printerInfoAsJSON = "[";
-    for (int i = 0; i < _nPrintersInGroup; i++) {
-      if (!firstTime) printerInfoAsJSON += ", ";
-      if (_ps[i].isActive) {
-        PrintClient* p = _printer[i];
-        printerInfoAsJSON += "{\"name\":\"" + getDisplayName(i) + "\"";
-        printerInfoAsJSON += ", \"url\":\"http://" + _ps[i].server + ':' + _ps[i].port + "\"";
-        if (p->getState() >= PrintClient::State::Complete) {
-          String completeAt;
-          uint32_t timeLeftInSeconds = p->getPrintTimeLeft();
-          if (timeLeftInSeconds) completionTime(completeAt, timeLeftInSeconds);
-
-          printerInfoAsJSON += ", \"pct\": ";
-          printerInfoAsJSON += (int)(p->getPctComplete());
-          printerInfoAsJSON += ", \"remaining\":";
-          printerInfoAsJSON += timeLeftInSeconds/60;
-          printerInfoAsJSON += ", \"completeAt\": \"";
-          printerInfoAsJSON += completeAt + "\"";
-          printerInfoAsJSON += ", \"file\": \"";
-          printerInfoAsJSON += p->getFilename();
-          printerInfoAsJSON += "\"";
-        }
-      } else { printerInfoAsJSON += "{"; }
-      printerInfoAsJSON += "}";
-      firstTime = false;
+bool PrinterGroup::requestSnapshot(uint8_t whichPrinter, Print& viewer) {
+  if (whichPrinter >= _nPrintersInGroup || !_ps[whichPrinter].isActive || _ps[whichPrinter].mock) return false;
+  SnapshotSource* source = snapshotSource(_ps[whichPrinter].type);
+  if (source == nullptr || source->path.isEmpty()) return false;
+  for (int v = 0; v < MaxSnapshotViewers; v++) {
+    if (_snapshotViewers[v].out == nullptr) {
+      _snapshotViewers[v].out = &viewer;
+      _snapshotViewers[v].printer = whichPrinter;
+      return true;
+    }
+  }
+  return false;
+}
+
+void PrinterGroup::cancelSnapshot(Print& viewer) {
+  for (int v = 0; v < MaxSnapshotViewers; v++) {
+    if (_snapshotViewers[v].out == &viewer) _snapshotViewers[v].out = nullptr;
+  }
+}
+
+bool PrinterGroup::serviceSnapshots() {
+  // Start after the viewer answered last time, so a printer whose frames are
+  // due on every call can't keep the others waiting
+  for (int k = 0; k < MaxSnapshotViewers; k++) {
+    int v = (_nextSnapshotViewer + k) % MaxSnapshotViewers;
+    if (_snapshotViewers[v].out == nullptr) continue;
+    uint8_t i = _snapshotViewers[v].printer;
+    if (_snapshotFetched[i] && (millis() - _snapshotFetched[i]) < _snapshotInterval) continue;
+
+    // Answer everyone waiting for this printer with a single fetch
+    Print* viewers[MaxSnapshotViewers];
+    uint8_t nViewers = 0;
+    for (int w = 0; w < MaxSnapshotViewers; w++) {
+      if (_snapshotViewers[w].out && _snapshotViewers[w].printer == i) {
+        viewers[nViewers++] = _snapshotViewers[w].out;
+        _snapshotViewers[w].out = nullptr;
+      }
     }
-    printerInfoAsJSON += "]";
+    streamSnapshot(i, viewers, nViewers);
+    _snapshotFetched[i] = millis();
+    if (_snapshotFetched[i] == 0) _snapshotFetched[i] = 1;
+    _nextSnapshotViewer = (v + 1) % MaxSnapshotViewers;
+    return true;      // One fetch per call bounds the time spent here
+  }
+  return false;
+}
+
+String PrinterGroup::printerInfoETag() {
+  // The completion times shown by printerInfo() move with the clock, so the
+  // current minute is part of the tag whenever any are being shown
+  bool showsTime = false;
+  for (int i = 0; i < _nPrintersInGroup; i++) {
+    checkForChanges(i, false);
+    if (_rendered[i].shown.showsTime) showsTime = true;
+  }
+  char etag[32];
+  sprintf(etag, "\"%lx-%lx-%lx\"", (unsigned long)_etagNonce,
+      (unsigned long)_groupVersion, showsTime ? (unsigned long)(now()/60) : 0UL);
+  return String(etag);
 }
 
 
@@ -218,87 +664,467 @@ void PrinterGroup::printerInfo(String& printerInfoAsJSON) {
 //
 
 void PrinterGroup::cachePrinterIP(int i) {
-  IPAddress printerIP;
-  int result = WiFi.hostByName(_ps[i].server.c_str(), printerIP) ;
-  if (result == 1) {
-    _printerIPs[i] = printerIP.toString();
+  // Resolve each server name only once. That includes keeping our own address
+  // when a printer is reactivated with the same server.
+  int resolved = -1;
+  for (int j = 0; j < _nPrintersInGroup && resolved < 0; j++) {
+    if (!_printerIPs[j].isEmpty() && _ps[j].server.equalsIgnoreCase(_ps[i].server)) resolved = j;
+  }
+  if (resolved >= 0) {
+    _printerIPs[i] = _printerIPs[resolved];
   } else {
-    _printerIPs[i] = "";
+    IPAddress printerIP;
+    int result = WiFi.hostByName(_ps[i].server.c_str(), printerIP) ;
+    if (result == 1) {
+      _printerIPs[i] = printerIP.toString();
+    } else {
+      _printerIPs[i] = "";
+    }
+  }
+
+  // Printers on the same physical host share its poll rate limit
+  _hostOf[i] = i;
+  if (_printerIPs[i].isEmpty()) return;
+  for (int j = 0; j < _nPrintersInGroup; j++) {
+    if (j != i && _printerIPs[j] == _printerIPs[i]) { _hostOf[i] = _hostOf[j]; break; }
   }
 }
 
+// Printers with the same endpoint and credentials would get identical answers.
+// Mock printers are never shared; each is meant to behave like its own printer.
+bool PrinterGroup::sameEndpoint(int i, int j) {
+  const PrinterSettings& a = _ps[i];
+  const PrinterSettings& b = _ps[j];
+  return !a.mock && !b.mock && a.type == b.type && _printerIPs[i] == _printerIPs[j] &&
+         a.port == b.port && a.apiKey == b.apiKey && a.user == b.user && a.pass == b.pass;
+}
+
+
+// Release printer i's client (unless it is shared from another printer) and
+// forget what we knew about the printer
+void PrinterGroup::deactivatePrinter(int i) {
+  if (_owner[i] == i) _slots[i].reset();
+  _owner[i] = i;
+  _printer[i] = nullptr;
+  _lastUpdateTime[i] = 0;
+  _lastState[i] = PrintClient::State::Offline;
+  _jobStart[i] = 0;
+  _history[i].clear();
+  bumpVersion(i);
+}
+
+// Where printers of a type serve webcam snapshots, or nullptr if they have no
+// address to fetch one from. This goes by the configured type rather than the
+// client, which on a gateway is a RemotePrintClient whatever the printer is.
+PrinterGroup::SnapshotSource* PrinterGroup::snapshotSource(const String& type) {
+  if (type.equals(Type_Octo)) return &_snapshotSources[0];
+  if (type.equals(Type_Duet)) return &_snapshotSources[1];
+  if (type.equals(Type_Moonraker)) return &_snapshotSources[2];
+  return nullptr;
+}
+
+// Fetch a webcam frame from printer i and copy it to every viewer as it
+// arrives. A viewer that stops accepting data is dropped; the others continue.
+void PrinterGroup::streamSnapshot(int i, Print** viewers, uint8_t nViewers) {
+  constexpr uint32_t Timeout = 5000;
+  const String& host = _printerIPs[i].isEmpty() ? _ps[i].server : _printerIPs[i];
+  WiFiClient client;
+  HTTPClient http;
+  http.useHTTP10(true);
+  http.setTimeout(Timeout);
+  const char* headers[] = {"Content-Type"};
+  http.collectHeaders(headers, 1);
+  // The printer's type may have changed since the request was queued
+  const SnapshotSource* source = snapshotSource(_ps[i].type);
+  int httpCode = -1;
+  uint16_t port = 0;
+  if (source && !source->path.isEmpty()) {
+    port = source->port ? source->port : _ps[i].port;
+    _snapshotFetches++;
+    if (http.begin(client, host, port, source->path)) httpCode = http.GET();
+  }
+  if (httpCode != HTTP_CODE_OK) {
+    Log.warning(F("Snapshot GET %s:%d failed: %d"), host.c_str(), port, httpCode);
+    http.end();
+    for (int v = 0; v < nViewers; v++) {
+      viewers[v]->print(F("HTTP/1.1 502 Bad Gateway\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"));
+    }
+    return;
+  }
+
+  int size = http.getSize();      // -1 if the server didn't say
+  String type = http.hasHeader("Content-Type") ? http.header("Content-Type") : String(F("image/jpeg"));
+  for (int v = 0; v < nViewers; v++) {
+    Print* out = viewers[v];
+    out->print(F("HTTP/1.1 200 OK\r\nContent-Type: "));
+    out->print(type);
+    if (size >= 0) { out->print(F("\r\nContent-Length: ")); out->print(size); }
+    out->print(F("\r\nCache-Control: no-cache\r\nConnection: close\r\n\r\n"));
+  }
+
+  WiFiClient* stream = http.getStreamPtr();
+  uint8_t buf[256];
+  int remaining = size;
+  uint32_t start = millis();
+  while ((http.connected() || stream->available()) && remaining != 0 && (millis() - start) < Timeout) {
+    size_t available = stream->available();
+    if (!available) { delay(1); continue; }
+    size_t n = stream->readBytes(buf, min(available, sizeof(buf)));
+    for (int v = 0; v < nViewers; v++) {
+      if (viewers[v] && viewers[v]->write(buf, n) != n) viewers[v] = nullptr;
+    }
+    if (remaining > 0) remaining -= n;
+  }
+  http.end();
+}
+
+// The slot holding printer i's client, which may be shared with another printer
+ClientSlot& PrinterGroup::slot(int i) {
+  return _slots[_owner[i]];
+}
+
+void PrinterGroup::bumpVersion(int i) {
+  _rendered[i].version++;
+  _groupVersion++;
+}
+
+// Compare what printerInfo() would show for printer i against what it showed
+// last time, and bump the printer's version if anything is different. Getting
+// the file name allocates, so the refresh path checks it but readers don't.
+void PrinterGroup::checkForChanges(int i, bool includeFile) {
+  ShownValues& shown = _rendered[i].shown;
+  ClientSlot* p = &slot(i);
+  bool active = isActive(i);
+
+  ShownValues current = shown;
+  current.active = active;
+  if (active) {
+    current.state = p->getState();
+    current.pct = (int)p->getPctComplete();
+    current.timeLeft = p->getPrintTimeLeft();
+    if (includeFile) {
+      String file = p->getFilename();
+      current.fileHash = 2166136261u;   // FNV-1a
+      for (const char* c = file.c_str(); *c; c++) current.fileHash = (current.fileHash ^ *c) * 16777619u;
+    }
+  }
+  current.showsTime = active && current.state >= PrintClient::State::Complete && current.timeLeft;
+
+  if (current.active != shown.active || current.state != shown.state ||
+      current.pct != shown.pct || current.timeLeft/60 != shown.timeLeft/60 ||
+      current.fileHash != shown.fileHash) {
+    bumpVersion(i);
+  }
+  shown = current;
+}
+
+// Printer i's entry in printerInfo()
+void PrinterGroup::writePrinterInfo(Print& out, int i) {
+  JSONStringPrint escaped(out);
+  if (isActive(i)) {
+    ClientSlot* p = &slot(i);
+    out.print(F("{\"name\":\""));
+    writeDisplayName(escaped, i);
+    out.print(F("\", \"url\":\"http://"));
+    escaped.print(_ps[i].server);
+    out.print(':'); out.print(_ps[i].port);
+    out.print('"');
+    if (p->getState() >= PrintClient::State::Complete) {
+      uint32_t timeLeftInSeconds = p->getPrintTimeLeft();
+      out.print(F(", \"pct\": "));
+      out.print((int)(p->getPctComplete()));
+      out.print(F(", \"remaining\":"));
+      out.print(timeLeftInSeconds/60);
+      out.print(F(", \"completeAt\": \""));
+      if (timeLeftInSeconds) completionTime(out, timeLeftInSeconds);
+      out.print(F("\", \"file\": \""));
+      escaped.print(p->getFilename());
+      out.print('"');
+    }
+  } else { out.print('{'); }
+  out.print('}');
+}
+
+void PrinterGroup::streamedValues(int i, StreamedValues& values) {
+  ClientSlot* p = &slot(i);
+  float actual, target;
+  values.state = p->getState();
+  values.pct = (uint8_t)p->getPctComplete();
+  values.remaining = p->getPrintTimeLeft()/60;
+  p->getBedTemps(actual, target);
+  values.bedTemp = (int16_t)(actual + 0.5f);
+  p->getToolTemps(actual, target);
+  values.toolTemp = (int16_t)(actual + 0.5f);
+}
+
+void PrinterGroup::checkForDeltas(int i) {
+  StreamedValues current;
+  streamedValues(i, current);
+  StreamedValues& last = _streamed[i];
+  uint8_t changed = 0;
+  if (current.state != last.state) changed |= Field_State;
+  if (current.pct != last.pct) changed |= Field_Pct;
+  if (current.remaining != last.remaining) changed |= Field_Remaining;
+  if (current.bedTemp != last.bedTemp) changed |= Field_BedTemp;
+  if (current.toolTemp != last.toolTemp) changed |= Field_ToolTemp;
+  last = current;
+
+  if (!changed) return;
+  for (int s = 0; s < MaxSubscribers; s++) {
+    if (_pending[s]) _pending[s][i] |= changed;
+  }
+}
+
+void PrinterGroup::notePoll(int i, uint32_t elapsed) {
+  PollStats& stats = _pollStats[i];
+  stats.polls++;
+  stats.totalMillis += elapsed;
+  stats.lastMillis = elapsed;
+  if (elapsed > stats.maxMillis) stats.maxMillis = elapsed;
+}
+
+void PrinterGroup::recordHistory(int i) {
+  ClientSlot* p = &slot(i);
+  float bedActual, bedTarget, toolActual, toolTarget;
+  p->getBedTemps(bedActual, bedTarget);
+  p->getToolTemps(toolActual, toolTarget);
+  _history[i].record(bedActual, toolActual, p->getPctComplete(), _lastUpdateTime[i]/1000L);
+}
+
+void PrinterGroup::trackJob(int i) {
+  ClientSlot* p = &slot(i);
+  PrintClient::State state = p->getState();
+  PrintClient::State lastState = _lastState[i];
+
+  // Losing contact with a printer doesn't mean the print stopped, so going
+  // Offline isn't treated as a transition. Keep waiting to see how it ends.
+  if (state == PrintClient::State::Offline) return;
+  _lastState[i] = state;
+
+  if (state == PrintClient::State::Printing) {
+    if (lastState != PrintClient::State::Printing) _jobStart[i] = now() - p->getElapsedTime();
+    return;
+  }
+  if (lastState != PrintClient::State::Printing) return;
+  if (_jobLog == nullptr && _eventLog == nullptr) return;
+
+  uint32_t end = now();
+  uint32_t duration = p->getElapsedTime();
+  if (duration == 0) duration = end - _jobStart[i];
+  JobLog::Outcome outcome =
+      (state == PrintClient::State::Complete) ? JobLog::Completed : JobLog::Failed;
+  if (_jobLog) {
+    _jobLog->append(
+        i, p->getFilename(), _jobStart[i], end, duration, p->getFilamentLength(), outcome);
+  }
+  if (_eventLog) _eventLog->record(i, EventLog::Event_JobEnd, outcome, duration, p->getFilamentLength());
+}
+
+void PrinterGroup::logPoll(int i, PrintClient::State before, uint32_t elapsed) {
+  ClientSlot* p = &slot(i);
+  PrintClient::State after = p->getState();
+  if (after != before) _eventLog->record(i, EventLog::Event_StateChange, before | (after << 8));
+  _eventLog->record(
+      i, EventLog::Event_Poll, after | ((uint8_t)p->getPctComplete() << 8),
+      elapsed, p->getPrintTimeLeft());
+}
+
 
 //
 // ----- Private Functions related to the Data Provider functionality
 //
 
-void PrinterGroup::mapPrinterSpecific(const String& key, String& value, int printerIndex) {
-  if (printerIndex > _nPrintersInGroup) return;
-  PrintClient *p = _printer[printerIndex];
-  PrinterSettings *ps = &_ps[printerIndex];
-  bool active = ps->isActive;
+// Printer-specific keys, sorted so they can be found with a binary search. The
+// position of each name must match its value in PrinterGroup::PrinterKey.
+static constexpr const char* PrinterKeyNames[] = {
+  "name", "next", "pct", "remaining", "state", "status"
+};
+static constexpr int NPrinterKeyNames = sizeof(PrinterKeyNames)/sizeof(PrinterKeyNames[0]);
 
-  if (key.equalsIgnoreCase("name")) {
-    if (!ps->nickname.isEmpty()) { value += ps->nickname; }
-    else if (!ps->server.isEmpty()) { value += ps->server; }
-    else value += "Inactive";
-    return;
+static constexpr bool keyLessThan(const char* a, const char* b) {
+  return (*a == *b) ? (*a != '\0' && keyLessThan(a+1, b+1)) : (*a < *b);
+}
+static constexpr bool keysSortedFrom(int i) {
+  return (i+1 >= NPrinterKeyNames) ||
+         (keyLessThan(PrinterKeyNames[i], PrinterKeyNames[i+1]) && keysSortedFrom(i+1));
+}
+static_assert(keysSortedFrom(0), "PrinterKeyNames must be sorted");
+
+PrinterGroup::PrinterKey PrinterGroup::lookupPrinterKey(const char* key) {
+  static_assert(NPrinterKeyNames == NPrinterKeys, "PrinterKeyNames must match PrinterKey");
+  int lo = 0, hi = NPrinterKeyNames - 1;
+  while (lo <= hi) {
+    int mid = (lo + hi) / 2;
+    int cmp = strcasecmp(key, PrinterKeyNames[mid]);
+    if (cmp == 0) return (PrinterKey)mid;
+    if (cmp < 0) hi = mid - 1;
+    else lo = mid + 1;
   }
+  return PrinterKey::Unknown;
+}
 
-  if (key.equalsIgnoreCase("pct")) {
-    if (active && p->getState() >= PrintClient::State::Complete) { value += (int)(p->getPctComplete()); }
-    return;
+// Parse keys of the form <printer number>.<subkey>, e.g. "12.pct". Printer
+// numbers start at 1. Returns false if the key isn't of that form.
+static bool parsePrinterKey(const char* key, int& index, const char*& subkey) {
+  if (!isDigit(key[0])) return false;
+  int n = 0;
+  while (isDigit(*key)) {
+    n = n*10 + (*key++ - '0');
+    if (n > UINT8_MAX) return false;
   }
+  if (*key != '.') return false;
+  index = n - 1;
+  subkey = key + 1;
+  return true;
+}
 
-  if (key.equalsIgnoreCase("state")) {
-    if (active) {
-      switch (p->getState()) {
-        case PrintClient::State::Offline: value += F("Offline"); break;
-        case PrintClient::State::Operational: value += F("Online"); break;
-        case PrintClient::State::Complete: value += F("Complete"); break;
-        case PrintClient::State::Printing: value += F("Printing"); break;
-      }
-    } else value += F("Unused");
+void PrinterGroup::resolveKey(const char* key, Print& out, bool batched) {
+  // Map printer related keys
+  if (strcasecmp_P(key, PSTR("next")) == 0) {
+    uint32_t delta;
+    int whichPrinter = nextCompletingPrinter(delta, batched);
+    if (whichPrinter < 0) out.print(F("No print in progress"));
+    else {
+      writeDisplayName(out, whichPrinter);
+      out.print(F(": "));
+      completionTime(out, delta);
+    }
     return;
   }
 
-  if (key.equalsIgnoreCase("status")) {
-    if (active) {
-      switch (p->getState()) {
-        case PrintClient::State::Offline: value += F("Offline"); break;
-        case PrintClient::State::Operational: value += F("Online"); break;
-        case PrintClient::State::Complete: value += F("Complete"); break;
-        case PrintClient::State::Printing:
-          value += F("Printing|");
-          value += ((int)p->getPctComplete());
-          break;
-      }
-    } else value += F("Unused");
-    return;
+  // Check for printer-specific keys
+  int index;
+  const char* subkey;
+  if (parsePrinterKey(key, index, subkey)) {
+    if (index < 0 || index >= _nPrintersInGroup) return;
+    mapPrinterSpecific(lookupPrinterKey(subkey), out, index, snapshot(index, batched));
   }
+}
 
-  if (key.equalsIgnoreCase("next")) {
-    if (!active) { return; }
-    if (p->isPrinting()) completionTime(value, p->getPrintTimeLeft());
-    return;
+const PrinterGroup::PrinterSnapshot& PrinterGroup::snapshot(int i, bool batched) {
+  PrinterSnapshot& snap = _snapshots[i];
+  if (batched && snap.batch == _batch) return snap;
+
+  snap.batch = batched ? _batch : 0;
+  snap.active = isActive(i);
+  if (snap.active) {
+    ClientSlot* p = &slot(i);
+    snap.state = p->getState();
+    snap.pct = p->getPctComplete();
+    snap.timeLeft = p->getPrintTimeLeft();
+  } else {
+    snap.state = PrintClient::State::Offline;
+    snap.pct = 0.0f;
+    snap.timeLeft = 0;
   }
+  return snap;
+}
 
-  if (key.equalsIgnoreCase("remaining")) {
-    if (active && p->getState() == PrintClient::State::Printing) {
-      value = Output::formattedInterval(p->getPrintTimeLeft(), true, true);
+int PrinterGroup::nextCompletingPrinter(uint32_t& delta, bool batched) {
+  uint32_t minCompletion = UINT32_MAX;
+  int printerWithNextCompletion = -1;
+  for (int i = 0; i < _nPrintersInGroup; i++) {
+    const PrinterSnapshot& snap = snapshot(i, batched);
+    if (!snap.active) continue;
+    if (snap.state == PrintClient::State::Printing) {
+      uint32_t thisCompletion = snap.timeLeft;
+      if (thisCompletion < minCompletion) {
+        minCompletion = thisCompletion;
+        printerWithNextCompletion = i;
+      }
     }
-    return;
+  }
+  delta = (printerWithNextCompletion < 0) ? 0 : minCompletion;
+  return printerWithNextCompletion;
+}
+
+void PrinterGroup::writeDisplayName(Print& out, int printerIndex) {
+  PrinterSettings *ps = &_ps[printerIndex];
+  if (!ps->nickname.isEmpty()) { out.print(ps->nickname); }
+  else if (!ps->server.isEmpty()) { out.print(ps->server); }
+  else out.print(F("Inactive"));
+}
+
+// The same text as Output::formattedInterval(seconds, true, true), hh:mm:ss,
+// written straight to `out` rather than through a String
+static void printInterval(Print& out, uint32_t seconds) {
+  uint32_t fields[3] = {seconds / 3600, (seconds / 60) % 60, seconds % 60};
+  for (int i = 0; i < 3; i++) {
+    if (i) out.print(':');
+    if (fields[i] < 10) out.print('0');
+    out.print(fields[i]);
+  }
+}
+
+void PrinterGroup::mapPrinterSpecific(
+    PrinterKey key, Print& value, int printerIndex, const PrinterSnapshot& snap)
+{
+  bool active = snap.active;
+
+  switch (key) {
+    case PrinterKey::Name:
+      writeDisplayName(value, printerIndex);
+      break;
+
+    case PrinterKey::Pct:
+      if (active && snap.state >= PrintClient::State::Complete) { value.print((int)snap.pct); }
+      break;
+
+    case PrinterKey::State:
+      if (active) {
+        switch (snap.state) {
+          case PrintClient::State::Offline: value.print(F("Offline")); break;
+          case PrintClient::State::Operational: value.print(F("Online")); break;
+          case PrintClient::State::Complete: value.print(F("Complete")); break;
+          case PrintClient::State::Printing: value.print(F("Printing")); break;
+        }
+      } else value.print(F("Unused"));
+      break;
+
+    case PrinterKey::Status:
+      if (active) {
+        switch (snap.state) {
+          case PrintClient::State::Offline: value.print(F("Offline")); break;
+          case PrintClient::State::Operational: value.print(F("Online")); break;
+          case PrintClient::State::Complete: value.print(F("Complete")); break;
+          case PrintClient::State::Printing:
+            value.print(F("Printing|"));
+            value.print((int)snap.pct);
+            break;
+        }
+      } else value.print(F("Unused"));
+      break;
+
+    case PrinterKey::Next:
+      if (active && snap.state == PrintClient::State::Printing) completionTime(value, snap.timeLeft);
+      break;
+
+    case PrinterKey::Remaining:
+      if (active && snap.state == PrintClient::State::Printing) {
+        printInterval(value, snap.timeLeft);
+      }
+      break;
+
+    default:
+      break;
   }
 }
 
 void PrinterGroup::completionTime(String &formattedTime, uint32_t timeLeft) {
+  char buf[16];
+  BufferPrint out(buf, sizeof(buf));
+  completionTime(out, timeLeft);
+  formattedTime = buf;
+}
+
+void PrinterGroup::completionTime(Print& out, uint32_t timeLeft) {
   time_t theTime = now() + timeLeft;
-  formattedTime = String(dayShortStr(weekday(theTime)));
-  formattedTime += " ";
-  formattedTime += (Output::using24HourMode()) ? hour(theTime) : hourFormat12(theTime);
-  formattedTime += ":";
+  out.print(dayShortStr(weekday(theTime)));
+  out.print(' ');
+  out.print((Output::using24HourMode()) ? hour(theTime) : hourFormat12(theTime));
+  out.print(':');
   int theMinute =  minute(theTime);
-  if (theMinute < 10) formattedTime += '0';
-  formattedTime += theMinute;
-  if (!Output::using24HourMode()) formattedTime += isAM(theTime) ? "AM" : "PM";
+  if (theMinute < 10) out.print('0');
+  out.print(theMinute);
+  if (!Output::using24HourMode()) out.print(isAM(theTime) ? F("AM") : F("PM"));
 }
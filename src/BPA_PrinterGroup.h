@@ -4,29 +4,142 @@
 #include <BPABasics.h>
 #include "BPA_PrinterSettings.h"
 #include "BPA_PrintClient.h"
+#include "BPA_PrinterHistory.h"
+#include "BPA_JobLog.h"
+#include "BPA_EventLog.h"
+
+class RemoteNode;
+class MqttFeed;
+class ClientSlot;
+struct MockEvent;
 
 class PrinterGroup {
 public:
   static constexpr char DataProviderPrefix = 'P';
 
+  struct PollStats {
+    uint32_t polls;           // Number of times the printer has been refreshed
+    uint32_t totalMillis;     // Total time spent refreshing it
+    uint32_t lastMillis;      // Time taken by the most recent refresh
+    uint32_t maxMillis;       // Time taken by the slowest refresh
+  };
+
   PrinterGroup(
         uint8_t nPrintersInGroup, PrinterSettings* ps,
         uint32_t refreshInterval, std::function<void(bool)> busyCallback);
 
   void activatePrinter(int i);
+  // Replace the settings of every printer (`settings` has one entry per
+  // printer). Only printers whose endpoint, credentials, or active state
+  // changed get new clients; the others keep their state and history. A
+  // change to just the nickname only changes how the printer is shown.
+  void applySettings(const PrinterSettings* settings);
+  void setJobLog(JobLog* jobLog) { _jobLog = jobLog; }
+  // Record polls, state changes, and finished jobs as binary events
+  void setEventLog(EventLog* eventLog) { _eventLog = eventLog; }
+  // The broker connection used by printers of type Type_OctoMQTT. Must be set
+  // before they are activated and must outlive the group. The feed's
+  // keep-alive is set to suit the refresh interval (see MqttFeed::setKeepAlive).
+  void setMqttFeed(MqttFeed* feed);
+  // Make the mock printers activated from now on reproducible (see the
+  // seeded MockPrintClient constructor). Printer i's mock is seeded with
+  // seed + i and reads the time from `clock` (millis() if null). `script`, if
+  // given, is run by every mock and must outlive the group.
+  void setMockOptions(
+      uint32_t seed, std::function<uint32_t()> clock = nullptr,
+      const MockEvent* script = nullptr, uint8_t nEvents = 0);
+
+  // ----- Federation
+  // Several devices can share a set of printers. Each node is given the same
+  // PrinterSettings and polls only the printers assigned to it. A gateway,
+  // also given the same settings, reads every printer from the snapshot
+  // (writeSnapshot()) of the node that owns it. Call these before activating
+  // any printers.
+  //   setShard:      This device is node `self` of `nNodes`
+  //   setFederation: This device is a gateway for `nNodes` nodes. `nodes` must
+  //                  outlive the group.
+  void setShard(uint8_t self, uint8_t nNodes);
+  void setFederation(RemoteNode* nodes, uint8_t nNodes);
+  // The node (0..nNodes-1) that polls a printer. Stable for a given number of
+  // nodes; adding a node moves only about 1/nNodes of the printers.
+  static uint8_t nodeForPrinter(const PrinterSettings& ps, uint8_t nNodes);
+  bool ownsPrinter(uint8_t whichPrinter);
 
   void refreshPrinterData(bool force);
 
   String getDisplayName(uint8_t whichPrinter);
   PrintClient* getPrinter(uint8_t whichPrinter);
   PrinterSettings* getSettings(uint8_t whichPrinter);
+  const PrinterHistory& getHistory(uint8_t whichPrinter) { return _history[whichPrinter]; }
+
+  // ----- Refresh statistics, useful when load testing a large group
+  const PollStats& getPollStats(uint8_t whichPrinter) { return _pollStats[whichPrinter]; }
+  uint32_t getStaleness(uint8_t whichPrinter);
+  uint32_t lastRefreshMillis() { return _lastRefreshMillis; }
+  void resetPollStats();
 
   void nextCompletion(String &printer, String &formattedTime, uint32_t &delta);
   bool nextCompletion(uint8_t& whichPrinter, String &formattedTime, uint32_t &delta);
   void dataSupplier(const String& key, String& value);
+  // Resolve a key into a caller's buffer without touching the heap. A value
+  // that doesn't fit (e.g. a long file name) is truncated. Returns its length.
+  size_t dataSupplier(const char* key, char* value, size_t size);
+  // Resolve a batch of keys (e.g. all of the keys in a template) in one call.
+  // Each printer's state is read only once per batch. Values are appended to
+  // the corresponding entry in `values`.
+  void dataSupplier(uint16_t nKeys, const char* const* keys, String* values);
   uint8_t numberOfPrinters() { return _nPrintersInGroup; }
   void completionTime(String &formattedTime, uint32_t timeLeft);
   void printerInfo(String& printerInfoAsJSON);
+  // Write the same JSON as above directly to `out` (e.g. a WiFiClient), a small
+  // chunk at a time. Nothing is held in memory between calls.
+  void printerInfo(Print& out);
+  // An ETag for the current printerInfo() output. A web server can compare it
+  // against If-None-Match and answer 304 if they are equal, which saves
+  // rendering the document at all. Tags differ from one boot to the next.
+  String printerInfoETag();
+  // Write the state of every printer as a binary GroupSnapshot (see
+  // BPA_GroupSnapshot.h). Much smaller and cheaper to consume than printerInfo().
+  void writeSnapshot(Print& out);
+  // Incremented whenever anything shown by printerInfo() for the printer changes
+  uint32_t getVersion(uint8_t whichPrinter) { return _rendered[whichPrinter].version; }
+
+  // ----- Server-Sent Events
+  // A subscriber (e.g. one browser's event stream) is told only about values that
+  // changed since it was last written to. Changes are coalesced, so a subscriber
+  // never has more than one pending event per printer. A new subscriber starts
+  // with every value pending. Returns -1 if there are already MaxSubscribers.
+  static constexpr uint8_t MaxSubscribers = 4;
+  int8_t subscribe();
+  void unsubscribe(int8_t subscriber);
+  // Write pending events for the subscriber in SSE format. Returns false if
+  // there was nothing to write.
+  bool writeDeltas(int8_t subscriber, Print& out);
+
+  // ----- Webcam snapshots
+  // Requests for a printer's webcam snapshot are queued and answered together
+  // by serviceSnapshots(), which fetches at most one frame per printer every
+  // interval (1 second by default) and streams it to every queued viewer
+  // through one small buffer. Each viewer (typically the WiFiClient of a web
+  // request) is sent a complete HTTP response, and must remain valid until it
+  // has been answered or cancelled.
+  static constexpr uint8_t MaxSnapshotViewers = 8;
+  void setSnapshotInterval(uint32_t interval) { _snapshotInterval = interval; }
+  // Where printers of a type (Type_Octo, Type_Duet or Type_Moonraker) serve
+  // snapshots: http://<printer>:<port><path>, where a port of 0 means the
+  // printer's own. By default OctoPrint is read at /webcam/?action=snapshot on
+  // its own port, and Moonraker through Mainsail or Fluidd on port 80 at the
+  // same path. Duet has no standard webcam, and an empty path means none.
+  // OctoPrint-MQTT printers have no address to fetch from.
+  void setSnapshotSource(const char* type, const String& path, uint16_t port = 0);
+  // Returns false if the printer has no webcam or the queue is full
+  bool requestSnapshot(uint8_t whichPrinter, Print& viewer);
+  void cancelSnapshot(Print& viewer);
+  // Fetch a frame for one printer whose viewers are due, so that one call
+  // takes at most one fetch's timeout. Returns false if none were due.
+  bool serviceSnapshots();
+  // Number of frames fetched from printers
+  uint32_t snapshotFetches() { return _snapshotFetches; }
 
 private:
   uint8_t _nPrintersInGroup;
@@ -34,13 +147,130 @@ private:
   uint32_t _refreshInterval;
   std::function< void(bool)> _busyCallback;
 
-  PrintClient** _printer;     // Size == _nPrintersInGroup
+  PrintClient** _printer;     // Size == _nPrintersInGroup. Points into _slots
+  ClientSlot* _slots;         // Size == _nPrintersInGroup
   uint32_t* _lastUpdateTime;  // Size == _nPrintersInGroup
   String* _printerIPs;        // Size == _nPrintersInGroup
+  PrinterHistory* _history;   // Size == _nPrintersInGroup
+  PrintClient::State* _lastState; // Size == _nPrintersInGroup
+  uint32_t* _jobStart;        // Size == _nPrintersInGroup
+  JobLog* _jobLog = nullptr;
+  EventLog* _eventLog = nullptr;
+  PollStats* _pollStats;      // Size == _nPrintersInGroup
+  uint32_t _lastRefreshMillis = 0;
+  uint8_t _shard = 0;
+  uint8_t _nShards = 1;
+  RemoteNode* _nodes = nullptr;
+  uint8_t _nNodes = 0;
+  MqttFeed* _mqttFeed = nullptr;
+  bool _mockSeeded = false;
+  uint32_t _mockSeed = 0;
+  std::function<uint32_t()> _mockClock;
+  const MockEvent* _mockScript = nullptr;
+  uint8_t _mockEvents = 0;
 
+  // Printers configured with identical endpoints share the first one's client,
+  // and printers on the same host are not polled back to back
+  static constexpr uint32_t MinHostPollInterval = 1000;
+  uint8_t* _owner;            // Size == _nPrintersInGroup. The printer that polls for this one
+  uint8_t* _hostOf;           // Size == _nPrintersInGroup. The first printer on the same host
+  uint32_t* _hostLastPoll;    // Size == _nPrintersInGroup. Indexed by _hostOf
 
+  // The state of a printer as seen by the data supplier
+  struct PrinterSnapshot {
+    uint32_t batch;           // The batch this was taken for, 0 if not batched
+    bool active;
+    PrintClient::State state;
+    float pct;
+    uint32_t timeLeft;
+  };
+  PrinterSnapshot* _snapshots;  // Size == _nPrintersInGroup
+  uint32_t _batch = 0;
+
+  // The values printerInfo() shows for a printer
+  struct ShownValues {
+    bool active = false;
+    PrintClient::State state = PrintClient::State::Offline;
+    int pct = 0;
+    uint32_t timeLeft = 0;
+    uint32_t fileHash = 0;
+    bool showsTime = false;   // Includes a completion time, which moves with the clock
+  };
+  // What printerInfo() showed for a printer when last checked, and a version
+  // that changes whenever that does
+  struct RenderedPrinter {
+    uint32_t version;
+    ShownValues shown;
+  };
+  RenderedPrinter* _rendered;   // Size == _nPrintersInGroup
+  uint32_t _groupVersion = 0;
+  // Random for each boot, so that an ETag from before a restart, when the
+  // version counted up from 0 as well, can't match one from after it
+  uint32_t _etagNonce;
+
+  // The values sent to event stream subscribers, and which of them changed
+  enum StreamedField : uint8_t {
+    Field_State = 0x01, Field_Pct = 0x02, Field_Remaining = 0x04,
+    Field_BedTemp = 0x08, Field_ToolTemp = 0x10, Field_All = 0x1f
+  };
+  struct StreamedValues {
+    PrintClient::State state;
+    uint8_t pct;
+    uint16_t remaining;         // Minutes
+    int16_t bedTemp;            // Whole degrees
+    int16_t toolTemp;           // Whole degrees
+  };
+  StreamedValues* _streamed;    // Size == _nPrintersInGroup
+  uint8_t* _pending[MaxSubscribers] = {};  // Each is nullptr or Size == _nPrintersInGroup
+
+  // Viewers waiting for a webcam snapshot
+  struct SnapshotViewer {
+    Print* out;                 // nullptr if this entry is unused
+    uint8_t printer;
+  };
+  SnapshotViewer _snapshotViewers[MaxSnapshotViewers] = {};
+  struct SnapshotSource {
+    String path;                // Empty if there is no webcam
+    uint16_t port;              // 0 for the printer's own port
+  };
+  SnapshotSource _snapshotSources[3] = {   // Indexed by snapshotSource()
+    {"/webcam/?action=snapshot", 0},       // OctoPrint
+    {"", 0},                               // Duet
+    {"/webcam/?action=snapshot", 80},      // Moonraker
+  };
+  uint32_t _snapshotInterval = 1000;
+  uint32_t* _snapshotFetched;   // Size == _nPrintersInGroup. millis() of the last fetch, 0 if none
+  uint32_t _snapshotFetches = 0;
+  uint8_t _nextSnapshotViewer = 0;     // Where serviceSnapshots() starts looking
+
+
+  // Active, and polled (or read) by this device
+  bool isActive(int i) { return _ps[i].isActive && _printer[i] != nullptr; }
+  void deactivatePrinter(int i);
   void cachePrinterIP(int i);
-  void mapPrinterSpecific(const String& key, String& value, int printerIndex);
+  bool sameEndpoint(int i, int j);
+  ClientSlot& slot(int i);
+  void notePoll(int i, uint32_t elapsed);
+  void bumpVersion(int i);
+  void checkForChanges(int i, bool includeFile);
+  void streamedValues(int i, StreamedValues& values);
+  void checkForDeltas(int i);
+  void writePrinterInfo(Print& out, int i);
+  void recordHistory(int i);
+  void trackJob(int i);
+  void logPoll(int i, PrintClient::State before, uint32_t elapsed);
+  SnapshotSource* snapshotSource(const String& type);
+  void streamSnapshot(int i, Print** viewers, uint8_t nViewers);
+
+  enum class PrinterKey : uint8_t {Name, Next, Pct, Remaining, State, Status, Unknown};
+  static constexpr uint8_t NPrinterKeys = (uint8_t)PrinterKey::Unknown;
+  static PrinterKey lookupPrinterKey(const char* key);
+  void resolveKey(const char* key, Print& out, bool batched);
+  const PrinterSnapshot& snapshot(int i, bool batched);
+  int nextCompletingPrinter(uint32_t& delta, bool batched = false);
+  void writeDisplayName(Print& out, int printerIndex);
+  void mapPrinterSpecific(PrinterKey key, Print& value, int printerIndex, const PrinterSnapshot& snap);
+  void completionTime(Print& out, uint32_t timeLeft);
 
 };
 
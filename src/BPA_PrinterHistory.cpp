@@ -0,0 +1,58 @@
+/*
+ * PrinterHistory:
+ *    A compact, fixed-size history of temperatures and progress for a single
+ *    printer. Intended for drawing sparklines of recent activity.
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+//                                  Third Party Libraries
+//                                  Local Includes
+#include "BPA_PrinterHistory.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+void PrinterHistory::record(float bedTemp, float toolTemp, float pct, uint32_t time) {
+  int16_t sample[NChannels];
+  sample[BedTemp] = toFixed(bedTemp);
+  sample[ToolTemp] = toFixed(toolTemp);
+  sample[Pct] = toFixed(pct);
+
+  // ----- Fine tier: one sample per FinePeriod
+  if (_fine.size() == 0) {
+    _fine.push(sample);
+    _fineTime = time;
+  } else {
+    uint32_t periods = (time - _fineTime) / FinePeriod;
+    if (periods) {
+      if (periods > 1) _fine.repeat(min(periods - 1, (uint32_t)FineCapacity));
+      _fine.push(sample);
+      _fineTime += periods * FinePeriod;
+    }
+  }
+
+  // ----- Coarse tier: the average of each CoarsePeriod
+  if (_coarseN == 0 && _coarse.size() == 0) {
+    _coarseTime = time;
+  } else {
+    uint32_t periods = (time - _coarseTime) / CoarsePeriod;
+    if (periods) {
+      int16_t avg[NChannels];
+      for (int c = 0; c < NChannels; c++) avg[c] = _coarseSum[c] / _coarseN;
+      _coarse.push(avg);
+      if (periods > 1) _coarse.repeat(min(periods - 1, (uint32_t)CoarseCapacity));
+      _coarseTime += periods * CoarsePeriod;
+      _coarseN = 0;
+    }
+  }
+  if (_coarseN == 0) { for (int c = 0; c < NChannels; c++) _coarseSum[c] = 0; }
+  for (int c = 0; c < NChannels; c++) _coarseSum[c] += sample[c];
+  _coarseN++;
+}
+
+void PrinterHistory::clear() {
+  _fine.clear();
+  _coarse.clear();
+  _coarseN = 0;
+}
@@ -0,0 +1,145 @@
+#ifndef BPA_PrinterHistory_h
+#define BPA_PrinterHistory_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <Arduino.h>
+//                                  Third Party Libraries
+//                                  Local Includes
+//--------------- End:    Includes ---------------------------------------------
+
+
+class PrinterHistory {
+public:
+  // ----- Types
+  enum Channel {BedTemp, ToolTemp, Pct, NChannels};
+
+  struct Sample {
+    float bedTemp;                  // Actual bed temperature (C)
+    float toolTemp;                 // Actual tool temperature (C)
+    float pct;                      // Print completion 0.0-100.0
+  };
+
+  // A fixed-capacity ring of samples taken every `period` seconds. Each channel is
+  // kept as a 16-bit fixed-point value (FixedPointScale units per C or %), but only
+  // the oldest sample is stored in full. Every other sample is an 8-bit delta from
+  // its predecessor. Deltas that don't fit are clamped and the remainder is carried
+  // into the next sample, so a sharp change is spread over a few samples rather
+  // than lost.
+  template<uint16_t Capacity>
+  class Tier {
+  public:
+    class Iterator {
+    public:
+      Iterator(const Tier* tier, uint16_t index) : _tier(tier), _index(index) {
+        for (int c = 0; c < NChannels; c++) _value[c] = tier->_base[c];
+      }
+
+      Sample operator*() const {
+        return { toFloat(_value[BedTemp]), toFloat(_value[ToolTemp]), toFloat(_value[Pct]) };
+      }
+      Iterator& operator++() {
+        if (++_index < _tier->_count) {
+          const int8_t* d = _tier->_delta[(_tier->_head + _index) % Capacity];
+          for (int c = 0; c < NChannels; c++) _value[c] += d[c];
+        }
+        return *this;
+      }
+      bool operator!=(const Iterator& other) const { return _index != other._index; }
+
+      // Age of the current sample (in seconds) relative to the newest one
+      uint32_t age() const { return (_tier->_count - 1 - _index) * _tier->period(); }
+
+    private:
+      const Tier* _tier;
+      uint16_t _index;
+      int16_t _value[NChannels];
+    };
+
+    Tier(uint32_t period) : _period(period) { }
+
+    Iterator begin() const { return Iterator(this, 0); }
+    Iterator end() const { return Iterator(this, _count); }
+    uint16_t size() const { return _count; }
+    uint16_t capacity() const { return Capacity; }
+    uint32_t period() const { return _period; }
+
+    void clear() { _head = _count = 0; }
+
+    void push(const int16_t value[NChannels]) {
+      if (_count == 0) {
+        for (int c = 0; c < NChannels; c++) _base[c] = _last[c] = value[c];
+        _count = 1;
+        return;
+      }
+
+      if (_count == Capacity) {
+        // Drop the oldest sample, moving the base value forward to its successor
+        _head = (_head + 1) % Capacity;
+        for (int c = 0; c < NChannels; c++) _base[c] += _delta[_head][c];
+        _count--;
+      }
+
+      int8_t* d = _delta[(_head + _count) % Capacity];
+      for (int c = 0; c < NChannels; c++) {
+        int16_t diff = constrain(value[c] - _last[c], INT8_MIN, INT8_MAX);
+        d[c] = diff;
+        _last[c] += diff;
+      }
+      _count++;
+    }
+
+    // Push the most recent value again to fill a gap of `n` periods
+    void repeat(uint16_t n) {
+      if (_count == 0) return;
+      if (n > Capacity) n = Capacity;
+      int16_t last[NChannels];
+      for (int c = 0; c < NChannels; c++) last[c] = _last[c];
+      while (n--) push(last);
+    }
+
+  private:
+    uint32_t _period;               // Seconds between samples
+    uint16_t _head = 0;             // Index of the oldest sample
+    uint16_t _count = 0;            // Number of valid samples
+    int16_t  _base[NChannels];      // Value of the oldest sample
+    int16_t  _last[NChannels];      // Value of the newest sample
+    int8_t   _delta[Capacity][NChannels];
+  };
+
+  // ----- Sizing
+  static constexpr uint32_t FinePeriod = 10;        // 10 seconds per sample...
+  static constexpr uint16_t FineCapacity = 60;      // ...for the last 10 minutes
+  static constexpr uint32_t CoarsePeriod = 15*60;   // 15 minute averages...
+  static constexpr uint16_t CoarseCapacity = 96;    // ...for the last 24 hours
+  static constexpr int16_t  FixedPointScale = 2;    // Resolution of 0.5 (C or %)
+
+  using FineTier = Tier<FineCapacity>;
+  using CoarseTier = Tier<CoarseCapacity>;
+
+  PrinterHistory() : _fine(FinePeriod), _coarse(CoarsePeriod) { }
+
+  // Add a sample taken at `time` (seconds). Samples may arrive at any rate; the
+  // fine tier keeps one sample per FinePeriod (repeating the last value across
+  // gaps) and the coarse tier keeps the average of each CoarsePeriod.
+  void record(float bedTemp, float toolTemp, float pct, uint32_t time);
+  void clear();
+
+  // Iterate from oldest to newest, e.g.:
+  //   for (PrinterHistory::Sample s : history.fine()) { ... }
+  const FineTier& fine() const { return _fine; }
+  const CoarseTier& coarse() const { return _coarse; }
+
+private:
+  FineTier _fine;
+  CoarseTier _coarse;
+  uint32_t _fineTime = 0;           // Time of the newest sample in _fine
+  uint32_t _coarseTime = 0;         // Start of the coarse bucket being accumulated
+  int32_t  _coarseSum[NChannels];
+  uint16_t _coarseN = 0;
+
+  static int16_t toFixed(float v) { return (int16_t)(v * FixedPointScale + (v < 0 ? -0.5f : 0.5f)); }
+  static float toFloat(int16_t v) { return ((float)v) / FixedPointScale; }
+};
+
+#endif  // BPA_PrinterHistory_h
@@ -10,6 +10,8 @@
 
 static constexpr const char* Type_Octo = "OctoPrint";
 static constexpr const char* Type_Duet = "Duet3D";
+static constexpr const char* Type_Moonraker = "Moonraker";
+static constexpr const char* Type_OctoMQTT = "OctoPrint-MQTT";   // server is the MQTT base topic
 
 class PrinterSettings {
 public:
@@ -20,7 +22,7 @@ public:
   void toJSON(JsonObject settings) const;
   void logSettings();
 
-  String type;    // Must be either "OctoPrint" or "Duet3D"
+  String type;    // Must be "OctoPrint", "Duet3D", "Moonraker", or "OctoPrint-MQTT"
   String apiKey;
   String server;
   int port;
@@ -0,0 +1,157 @@
+/*
+ * RemoteNode, RemotePrintClient:
+ *    Get printer state from another node's PrinterGroup rather than from
+ *    the printer itself.
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#if defined(ESP8266)
+  #include <ESP8266HTTPClient.h>
+#else
+  #include <HTTPClient.h>
+#endif
+//                                  Third Party Libraries
+#include <ArduinoLog.h>
+//                                  Local Includes
+#include "BPA_Config.h"
+#include "BPA_RemoteNode.h"
+//--------------- End:    Includes ---------------------------------------------
+
+#if BPA_ENABLE_REMOTE
+
+
+/*------------------------------------------------------------------------------
+ *
+ * RemoteNode
+ *
+ *----------------------------------------------------------------------------*/
+
+void RemoteNode::init(const String& server, int port, const String& path) {
+  _server = server;
+  _port = port;
+  _path = path;
+  _snapshot = GroupSnapshot(nullptr, 0);
+  _attempted = false;
+}
+
+bool RemoteNode::refresh(uint32_t maxAge) {
+  if (!_attempted || (millis() - _lastAttempt) >= maxAge) {
+    _attempted = true;
+    _lastAttempt = millis();
+    if (!fetch()) _snapshot = GroupSnapshot(nullptr, 0);
+  }
+  return _snapshot.valid();
+}
+
+bool RemoteNode::fetch() {
+  constexpr uint32_t Timeout = 5000;
+
+  WiFiClient client;
+  HTTPClient http;
+  http.useHTTP10(true);     // No chunked encoding; the body is just the snapshot
+  http.setTimeout(Timeout);
+  if (!http.begin(client, _server, _port, _path)) return false;
+  int httpCode = http.GET();
+  if (httpCode != HTTP_CODE_OK) {
+    Log.warning(F("RemoteNode: GET %s:%d%s failed: %d"), _server.c_str(), _port, _path.c_str(), httpCode);
+    http.end();
+    return false;
+  }
+
+  int size = http.getSize();
+  size_t needed = (size > 0) ? size : MaxSnapshotSize;
+  if (needed > MaxSnapshotSize) {
+    Log.warning(F("RemoteNode: snapshot too large (%d)"), size);
+    http.end();
+    return false;
+  }
+  static_assert(MaxSnapshotSize <= UINT16_MAX, "record offsets are 16 bits");
+  if (needed > _capacity) {
+    delete[] _buf;
+    _buf = new uint8_t[needed];
+    _capacity = needed;
+  }
+
+  WiFiClient* stream = http.getStreamPtr();
+  size_t length = 0;
+  uint32_t start = millis();
+  while ((http.connected() || stream->available()) && length < needed && (millis() - start) < Timeout) {
+    size_t available = stream->available();
+    if (available) length += stream->readBytes(_buf + length, min(available, needed - length));
+    else delay(1);
+  }
+  http.end();
+
+  _snapshot = GroupSnapshot(_buf, length);
+  if (!_snapshot.valid()) {
+    Log.warning(F("RemoteNode: invalid snapshot from %s"), _server.c_str());
+    return false;
+  }
+  uint8_t nPrinters = _snapshot.numberOfPrinters();
+  if (nPrinters > _offsetCapacity) {
+    delete[] _offsets;
+    _offsets = new uint16_t[nPrinters];
+    _offsetCapacity = nPrinters;
+  }
+  if (!_snapshot.index(_offsets)) {
+    Log.warning(F("RemoteNode: truncated record in snapshot from %s"), _server.c_str());
+    return false;
+  }
+  timeOfLastUpdate = millis();
+  return true;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * RemotePrintClient
+ *
+ *----------------------------------------------------------------------------*/
+
+void RemotePrintClient::init(RemoteNode* node, uint8_t remoteIndex, uint32_t maxAge) {
+  this->node = node;
+  this->remoteIndex = remoteIndex;
+  this->maxAge = maxAge;
+  state = Offline;
+}
+
+void RemotePrintClient::updateState() {
+  GroupSnapshot::PrinterView view;
+  if (!node->refresh(maxAge) || !node->printer(remoteIndex, view) || !view.active()) {
+    state = Offline;
+    return;
+  }
+
+  state = view.state();
+  pct = view.pct();
+  timeLeft = view.timeLeft();
+  elapsed = view.elapsed();
+  bedActual = view.bedActual();   bedTarget = view.bedTarget();
+  toolActual = view.toolActual(); toolTarget = view.toolTarget();
+  if (fileName.length() != view.fileLength() ||
+      strncmp(fileName.c_str(), view.file(), view.fileLength()) != 0) {
+    fileName = "";
+    fileName.concat(view.file(), view.fileLength());
+  }
+  if (state != Complete) completionAcknowledged = false;
+  timeOfLastUpdate = node->timeOfLastUpdate;
+}
+
+PrintClient::State RemotePrintClient::getState() {
+  if (state == Complete && completionAcknowledged) return Operational;
+  return state;
+}
+
+void RemotePrintClient::acknowledgeCompletion() {
+  completionAcknowledged = true;
+}
+
+void RemotePrintClient::dumpToLog() {
+#if BPA_LOG_LEVEL >= LOG_LEVEL_VERBOSE
+  Log.verbose(F("----- Remote printer %d: state %d, %d%%"), remoteIndex, state, (int)pct);
+#endif
+}
+
+#endif  // BPA_ENABLE_REMOTE
@@ -0,0 +1,101 @@
+#ifndef BPA_RemoteNode_h
+#define BPA_RemoteNode_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <Arduino.h>
+//                                  Third Party Libraries
+//                                  Local Includes
+#include "BPA_PrintClient.h"
+#include "BPA_GroupSnapshot.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+/*
+ * RemoteNode:
+ *    Another device running a PrinterGroup that serves its state as a binary
+ *    GroupSnapshot (PrinterGroup::writeSnapshot()) over HTTP. A gateway group
+ *    uses RemoteNodes as the source of data for printers that other nodes poll.
+ *    Every printer on a node shares one fetch of its snapshot.
+ */
+class RemoteNode {
+public:
+  static constexpr size_t MaxSnapshotSize = 8192;
+
+  void init(const String& server, int port, const String& path = "/snapshot");
+
+  RemoteNode() { }
+  ~RemoteNode() { delete[] _buf; delete[] _offsets; }
+  RemoteNode(const RemoteNode&) = delete;
+  RemoteNode& operator=(const RemoteNode&) = delete;
+
+  // Fetch a new snapshot unless the one we have is younger than maxAge (ms).
+  // Returns true if we have a snapshot.
+  bool refresh(uint32_t maxAge);
+  // The snapshot is checked, and where each printer's record starts is
+  // noted, once when it is fetched; these just look things up
+  const GroupSnapshot& snapshot() const { return _snapshot; }
+  bool printer(uint8_t index, GroupSnapshot::PrinterView& view) const {
+    return _snapshot.printerAt(index, _offsets, view);
+  }
+  uint32_t timeOfLastUpdate = 0;
+
+private:
+  String _server;
+  int _port;
+  String _path;
+  uint8_t* _buf = nullptr;
+  size_t _capacity = 0;
+  GroupSnapshot _snapshot{nullptr, 0};
+  uint16_t* _offsets = nullptr;     // Of each printer's record in _buf
+  uint8_t _offsetCapacity = 0;
+  uint32_t _lastAttempt = 0;
+  bool _attempted = false;
+
+  bool fetch();
+};
+
+/*
+ * RemotePrintClient:
+ *    A PrintClient for a printer that is polled by another node. Its state
+ *    comes from that node's snapshot.
+ */
+class RemotePrintClient final : public PrintClient {
+public:
+  // ----- Constructors and initialization
+  void init(RemoteNode* node, uint8_t remoteIndex, uint32_t maxAge = 5000);
+
+  // ----- Interrogate the Printer
+  void updateState();
+
+  // ----- Utility Functions
+  void acknowledgeCompletion();
+  void dumpToLog();
+
+  // ----- Getters
+  bool isPrinting() { return state == Printing; }
+  State getState();
+  float getPctComplete() { return pct; }
+  uint32_t getPrintTimeLeft() { return timeLeft; }
+  uint32_t getElapsedTime() { return elapsed; }
+  uint32_t getFilamentLength() { return 0; }
+  String getFilename() { return fileName; }
+  void getBedTemps(float &actual, float &target) { actual = bedActual; target = bedTarget; }
+  void getToolTemps(float &actual, float &target) { actual = toolActual; target = toolTarget; }
+
+private:
+  RemoteNode* node = nullptr;
+  uint8_t remoteIndex;
+  uint32_t maxAge;
+
+  State state = Offline;
+  float pct = 0.0f;
+  uint32_t timeLeft = 0;
+  uint32_t elapsed = 0;
+  String fileName;
+  float bedActual = 0.0f, bedTarget = 0.0f;
+  float toolActual = 0.0f, toolTarget = 0.0f;
+  bool completionAcknowledged = false;
+};
+
+#endif  // BPA_RemoteNode_h
@@ -0,0 +1,174 @@
+/*
+ * SettingsStore:
+ *    A fixed-layout binary image of PrinterSettings on flash
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+//                                  Third Party Libraries
+#include <ArduinoLog.h>
+//                                  Local Includes
+#include "BPA_SettingsStore.h"
+#include "BPA_Crc32.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+// Copy a String into a fixed field. Returns false if it doesn't fit.
+static bool copyField(char* field, size_t size, const String& value) {
+  memset(field, 0, size);
+  if (value.length() >= size) return false;
+  memcpy(field, value.c_str(), value.length());
+  return true;
+}
+
+// Copy a field into a String, even if it isn't NUL terminated
+static void readField(String& value, const char* field, size_t size) {
+  value = "";
+  value.concat(field, strnlen(field, size));
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Constructors and Public methods
+ *
+ *----------------------------------------------------------------------------*/
+
+SettingsStore::SettingsStore(FS& fs, const char* path) : _fs(fs), _path(path) { }
+
+bool SettingsStore::load(PrinterSettings* ps, uint8_t n) {
+  if (readImage(_path, ps, n)) return true;
+
+  // A save that was interrupted after the old image was removed (on a file
+  // system whose rename() won't replace a file) leaves only the new one
+  String tmpPath = _path + ".tmp";
+  if (_fs.exists(_path) || !readImage(tmpPath, ps, n)) return false;
+  Log.warning(F("SettingsStore: recovered %s"), tmpPath.c_str());
+  _fs.rename(tmpPath.c_str(), _path.c_str());
+  return true;
+}
+
+bool SettingsStore::save(const PrinterSettings* ps, uint8_t n) {
+  String tmpPath = _path + ".tmp";
+  File f = _fs.open(tmpPath, "w");
+  if (!f) { Log.warning(F("SettingsStore: unable to create %s"), tmpPath.c_str()); return false; }
+
+  Header h = {Magic, Version, n, sizeof(Record), 0};
+  h.crc = Crc32::of((const uint8_t*)&h, offsetof(Header, crc));
+  bool ok = f.write((const uint8_t*)&h, sizeof(h)) == sizeof(h);
+  _bytesWritten += sizeof(h);
+
+  Record r;
+  for (uint8_t i = 0; ok && i < n; i++) {
+    if (!encode(ps[i], r)) {
+      Log.warning(F("SettingsStore: settings for %s are too long"), ps[i].server.c_str());
+      ok = false;
+      break;
+    }
+    ok = f.write((const uint8_t*)&r, sizeof(r)) == sizeof(r);
+    _bytesWritten += sizeof(r);
+  }
+  f.close();
+
+  if (!ok) { _fs.remove(tmpPath); return false; }
+  // LittleFS replaces the old image in one step. Where rename() won't replace
+  // a file, load() recovers the new image if power fails before the rename.
+  if (_fs.rename(tmpPath.c_str(), _path.c_str())) return true;
+  _fs.remove(_path);
+  return _fs.rename(tmpPath.c_str(), _path.c_str());
+}
+
+bool SettingsStore::update(uint8_t index, const PrinterSettings& ps) {
+  Record r;
+  if (!encode(ps, r)) {
+    Log.warning(F("SettingsStore: settings for %s are too long"), ps.server.c_str());
+    return false;
+  }
+
+  File f = _fs.open(_path, "r+");
+  if (!f) return false;
+  Header h;
+  if (!readHeader(f, h) || index >= h.nRecords) {
+    f.close();
+    return false;
+  }
+
+  size_t offset = sizeof(Header) + index * sizeof(Record);
+  Record current;
+  bool ok = f.seek(offset) && f.read((uint8_t*)&current, sizeof(current)) == sizeof(current);
+  if (ok && memcmp(&current, &r, sizeof(r)) == 0) {
+    f.close();
+    return true;
+  }
+  ok = f.seek(offset) && f.write((const uint8_t*)&r, sizeof(r)) == sizeof(r);
+  _bytesWritten += sizeof(r);
+  f.close();
+  return ok;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Private methods
+ *
+ *----------------------------------------------------------------------------*/
+
+bool SettingsStore::encode(const PrinterSettings& ps, Record& r) {
+  bool fits =
+      copyField(r.type, sizeof(r.type), ps.type) &&
+      copyField(r.apiKey, sizeof(r.apiKey), ps.apiKey) &&
+      copyField(r.server, sizeof(r.server), ps.server) &&
+      copyField(r.user, sizeof(r.user), ps.user) &&
+      copyField(r.pass, sizeof(r.pass), ps.pass) &&
+      copyField(r.nickname, sizeof(r.nickname), ps.nickname);
+  r.port = ps.port;
+  r.flags = (ps.isActive ? Flag_Active : 0) | (ps.mock ? Flag_Mock : 0);
+  r.reserved = 0;
+  r.crc = Crc32::of((const uint8_t*)&r, offsetof(Record, crc));
+  return fits;
+}
+
+bool SettingsStore::decode(const Record& r, PrinterSettings& ps) {
+  if (r.crc != Crc32::of((const uint8_t*)&r, offsetof(Record, crc))) return false;
+  readField(ps.type, r.type, sizeof(r.type));
+  readField(ps.apiKey, r.apiKey, sizeof(r.apiKey));
+  readField(ps.server, r.server, sizeof(r.server));
+  readField(ps.user, r.user, sizeof(r.user));
+  readField(ps.pass, r.pass, sizeof(r.pass));
+  readField(ps.nickname, r.nickname, sizeof(r.nickname));
+  ps.port = r.port;
+  ps.isActive = r.flags & Flag_Active;
+  ps.mock = r.flags & Flag_Mock;
+  return true;
+}
+
+bool SettingsStore::readImage(const String& path, PrinterSettings* ps, uint8_t n) {
+  if (!_fs.exists(path)) return false;
+  File f = _fs.open(path, "r");
+  if (!f) return false;
+
+  Header h;
+  if (!readHeader(f, h) || h.nRecords != n) {
+    f.close();
+    return false;
+  }
+
+  bool allValid = true;
+  Record r;
+  for (uint8_t i = 0; i < n; i++) {
+    if (f.read((uint8_t*)&r, sizeof(r)) != sizeof(r) || !decode(r, ps[i])) {
+      Log.warning(F("SettingsStore: record %d is damaged"), i);
+      ps[i].init();
+      allValid = false;
+    }
+  }
+  f.close();
+  return allValid;
+}
+
+bool SettingsStore::readHeader(File& f, Header& h) {
+  return f.read((uint8_t*)&h, sizeof(h)) == sizeof(h) &&
+         h.magic == Magic && h.version == Version && h.recordSize == sizeof(Record) &&
+         h.crc == Crc32::of((const uint8_t*)&h, offsetof(Header, crc));
+}
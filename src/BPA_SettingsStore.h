@@ -0,0 +1,85 @@
+#ifndef BPA_SettingsStore_h
+#define BPA_SettingsStore_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <FS.h>
+//                                  Third Party Libraries
+//                                  Local Includes
+#include "BPA_PrinterSettings.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+/*
+ * A binary image of an array of PrinterSettings, kept on flash. Each printer
+ * has a fixed-size record with its own CRC, so loading is a sequence of reads
+ * into fixed buffers (no JSON parsing), and changing one printer rewrites only
+ * that printer's record. PrinterSettings::fromJSON()/toJSON() remain the way
+ * to exchange settings with a web UI.
+ *
+ * Layout (all values little-endian):
+ *   Header { uint32 magic = 'BPAS', uint8 version, uint8 nRecords,
+ *            uint16 recordSize, uint32 crc }
+ *   Record[nRecords]
+ */
+class SettingsStore {
+public:
+  // ----- Types
+  struct __attribute__((packed)) Record {
+    char     type[16];              // Strings are NUL terminated
+    char     apiKey[48];
+    char     server[64];
+    char     user[32];
+    char     pass[32];
+    char     nickname[32];
+    uint16_t port;
+    uint8_t  flags;                 // Flag_Active, Flag_Mock
+    uint8_t  reserved;
+    uint32_t crc;                   // CRC-32 of all preceding bytes
+  };
+
+  static constexpr uint32_t Magic = 0x53415042;   // "BPAS"
+  static constexpr uint8_t  Version = 1;
+  enum Flags : uint8_t {Flag_Active = 0x01, Flag_Mock = 0x02};
+
+  // ----- Constructors and initialization
+  SettingsStore(FS& fs, const char* path = "/printers.bin");
+
+  // Read every printer's settings. Returns false if there is no valid image
+  // for `n` printers, or if any record is damaged (that printer is left with
+  // its default settings). The caller can then fall back to JSON settings.
+  // If the image is missing but a complete one was left by an interrupted
+  // save(), that one is loaded and put in its place.
+  bool load(PrinterSettings* ps, uint8_t n);
+  // Write a complete image. It is written to a temporary file and then
+  // renamed over the old one, so an interrupted save leaves one image or the
+  // other intact. Fails if a value is too long for its field.
+  bool save(const PrinterSettings* ps, uint8_t n);
+  // Rewrite the record of one printer in place. Nothing is written if the
+  // record hasn't changed.
+  bool update(uint8_t index, const PrinterSettings& ps);
+
+  // Total bytes written to flash by this store, for comparing against saving
+  // the whole JSON document
+  uint32_t bytesWritten() const { return _bytesWritten; }
+
+private:
+  struct __attribute__((packed)) Header {
+    uint32_t magic;
+    uint8_t  version;
+    uint8_t  nRecords;
+    uint16_t recordSize;
+    uint32_t crc;
+  };
+
+  FS& _fs;
+  String _path;
+  uint32_t _bytesWritten = 0;
+
+  static bool encode(const PrinterSettings& ps, Record& r);
+  static bool decode(const Record& r, PrinterSettings& ps);
+  bool readImage(const String& path, PrinterSettings* ps, uint8_t n);
+  bool readHeader(File& f, Header& h);
+};
+
+#endif  // BPA_SettingsStore_h
@@ -0,0 +1,164 @@
+/*
+ * ThumbnailCache:
+ *    A least-recently-used cache of print thumbnails on flash
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+//                                  Third Party Libraries
+#include <ArduinoLog.h>
+//                                  Local Includes
+#include "BPA_ThumbnailCache.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Constructors and Public methods
+ *
+ *----------------------------------------------------------------------------*/
+
+ThumbnailCache::ThumbnailCache(FS& fs, const char* dir, uint32_t maxBytes)
+    : _fs(fs), _dir(dir), _maxBytes(maxBytes)
+{
+  memset(_entries, 0, sizeof(_entries));
+}
+
+bool ThumbnailCache::begin() {
+  if (!_fs.exists(_dir)) _fs.mkdir(_dir.c_str());
+
+  memset(_entries, 0, sizeof(_entries));
+  String indexPath = _dir + "/index";
+  if (!_fs.exists(indexPath)) return true;
+  File f = _fs.open(indexPath, "r");
+  if (!f) return false;
+  bool ok = f.read((uint8_t*)_entries, sizeof(_entries)) == sizeof(_entries);
+  f.close();
+  if (!ok) {
+    Log.warning(F("ThumbnailCache: index is damaged, starting over"));
+    memset(_entries, 0, sizeof(_entries));
+  }
+  for (int i = 0; i < MaxEntries; i++) {
+    if (_entries[i].lastUse > _useCounter) _useCounter = _entries[i].lastUse;
+  }
+  return ok;
+}
+
+bool ThumbnailCache::get(PrintClient* client, Print& out) {
+  int entry = find(client);
+  if (entry < 0) return false;
+
+  File f = _fs.open(filePath(_entries[entry].key), "r");
+  if (!f) return false;
+  uint8_t buf[128];
+  size_t n;
+  while ((n = f.read(buf, sizeof(buf))) > 0) out.write(buf, n);
+  f.close();
+  return true;
+}
+
+String ThumbnailCache::path(PrintClient* client) {
+  int entry = find(client);
+  return (entry < 0) ? String() : filePath(_entries[entry].key);
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Private methods
+ *
+ *----------------------------------------------------------------------------*/
+
+// Find the entry for the client's current thumbnail, fetching it if needed
+int ThumbnailCache::find(PrintClient* client) {
+  if (client == nullptr) return -1;
+  String thumbnailKey = client->getThumbnailKey();
+  if (thumbnailKey.isEmpty()) return -1;
+  uint32_t key = hashKey(thumbnailKey);
+
+  for (int i = 0; i < MaxEntries; i++) {
+    if (_entries[i].key == key) {
+      _entries[i].lastUse = ++_useCounter;    // Saved with the next change to the index
+      return i;
+    }
+  }
+  if (key == _failedKey && (millis() - _failedAt) < RetryInterval) return -1;
+  return fetch(key, client);
+}
+
+int ThumbnailCache::fetch(uint32_t key, PrintClient* client) {
+  // Fetch into a temporary file, so that a failed fetch costs no entry
+  String tempPath = _dir + "/fetch.tmp";
+  File f = _fs.open(tempPath, "w");
+  if (!f) { Log.warning(F("ThumbnailCache: unable to create %s"), tempPath.c_str()); return -1; }
+  bool ok = client->streamThumbnail(f);
+  uint32_t size = f.size();
+  f.close();
+  if (!ok || size == 0) {
+    _fs.remove(tempPath);
+    _failedKey = key;
+    _failedAt = millis();
+    return -1;
+  }
+
+  // Use a free entry or, failing that, the least recently used one
+  int slot = 0;
+  for (int i = 0; i < MaxEntries; i++) {
+    if (_entries[i].key == 0) { slot = i; break; }
+    if (_entries[i].lastUse < _entries[slot].lastUse) slot = i;
+  }
+  if (_entries[slot].key) evict(slot);
+
+  String path = filePath(key);
+  if (_fs.exists(path)) _fs.remove(path);     // Left over from an index that was lost
+  if (!_fs.rename(tempPath.c_str(), path.c_str())) {
+    Log.warning(F("ThumbnailCache: unable to create %s"), path.c_str());
+    _fs.remove(tempPath);
+    saveIndex();
+    return -1;
+  }
+
+  _entries[slot].key = key;
+  _entries[slot].lastUse = ++_useCounter;
+  _entries[slot].size = size;
+
+  // Stay within the space budget, never evicting the thumbnail just fetched
+  for (;;) {
+    uint32_t total = 0;
+    int oldest = -1;
+    for (int i = 0; i < MaxEntries; i++) {
+      if (_entries[i].key == 0) continue;
+      total += _entries[i].size;
+      if (i != slot && (oldest < 0 || _entries[i].lastUse < _entries[oldest].lastUse)) oldest = i;
+    }
+    if (total <= _maxBytes || oldest < 0) break;
+    evict(oldest);
+  }
+  saveIndex();
+  return slot;
+}
+
+void ThumbnailCache::evict(int entry) {
+  _fs.remove(filePath(_entries[entry].key));
+  memset(&_entries[entry], 0, sizeof(Entry));
+}
+
+String ThumbnailCache::filePath(uint32_t key) {
+  char name[16];
+  sprintf(name, "/%08lx.img", (unsigned long)key);
+  return _dir + name;
+}
+
+void ThumbnailCache::saveIndex() {
+  File f = _fs.open(_dir + "/index", "w");
+  if (!f) return;
+  f.write((const uint8_t*)_entries, sizeof(_entries));
+  f.close();
+}
+
+uint32_t ThumbnailCache::hashKey(const String& key) {
+  uint32_t hash = 2166136261u;    // FNV-1a
+  for (const char* c = key.c_str(); *c; c++) hash = (hash ^ (uint8_t)*c) * 16777619u;
+  return hash ? hash : 1;         // 0 marks an unused entry
+}
@@ -0,0 +1,66 @@
+#ifndef BPA_ThumbnailCache_h
+#define BPA_ThumbnailCache_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#include <FS.h>
+//                                  Third Party Libraries
+//                                  Local Includes
+#include "BPA_PrintClient.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+/*
+ * A cache of print thumbnails on flash. A thumbnail is fetched from the
+ * printer (PrintClient::streamThumbnail()) straight into a file the first time
+ * it is asked for, and is read from flash after that. Entries are keyed by
+ * PrintClient::getThumbnailKey() (the file and its modification time), so a
+ * re-sliced file gets a new thumbnail. When the cache is full, the least
+ * recently used thumbnail is removed, but only once a new thumbnail has been
+ * fetched successfully to take its place.
+ *
+ * Files are <dir>/<key hash>.img, plus <dir>/index which records the entries.
+ * A thumbnail is fetched into <dir>/fetch.tmp, so flash briefly holds one
+ * thumbnail more than the budget allows.
+ */
+class ThumbnailCache {
+public:
+  static constexpr uint8_t MaxEntries = 16;
+
+  ThumbnailCache(FS& fs, const char* dir = "/thumbs", uint32_t maxBytes = 128*1024);
+  bool begin();
+
+  // Write the thumbnail of the client's current file to `out`, fetching it
+  // from the printer first if it isn't cached. Returns false if there is no
+  // thumbnail.
+  bool get(PrintClient* client, Print& out);
+  // The path of the cached thumbnail of the client's current file, fetching it
+  // first if needed, for code that reads images from the file system
+  // directly. Empty if there is no thumbnail.
+  String path(PrintClient* client);
+
+private:
+  struct __attribute__((packed)) Entry {
+    uint32_t key;                   // Hash of the thumbnail key, 0 if unused
+    uint32_t lastUse;
+    uint32_t size;
+  };
+  static constexpr uint32_t RetryInterval = 5 * 60 * 1000L;
+
+  FS& _fs;
+  String _dir;
+  uint32_t _maxBytes;
+  Entry _entries[MaxEntries];
+  uint32_t _useCounter = 0;
+  uint32_t _failedKey = 0;          // Don't keep retrying a thumbnail that failed
+  uint32_t _failedAt = 0;
+
+  int find(PrintClient* client);
+  int fetch(uint32_t key, PrintClient* client);
+  void evict(int entry);
+  String filePath(uint32_t key);
+  void saveIndex();
+  static uint32_t hashKey(const String& key);
+};
+
+#endif  // BPA_ThumbnailCache_h
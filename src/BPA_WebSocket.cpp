@@ -0,0 +1,205 @@
+/*
+ * WebSocket:
+ *    A minimal client for text messages over a WebSocket connection
+ *
+ */
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+//                                  Third Party Libraries
+#include <ArduinoLog.h>
+//                                  Local Includes
+#include "BPA_WebSocket.h"
+//--------------- End:    Includes ---------------------------------------------
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Constructors and Public methods
+ *
+ *----------------------------------------------------------------------------*/
+
+bool WebSocket::connect(const String& host, uint16_t port, const String& path, const String& extraHeaders) {
+  close();
+  if (!_client.connect(host.c_str(), port)) {
+    Log.warning(F("WebSocket: unable to connect to %s:%d"), host.c_str(), port);
+    return false;
+  }
+  _client.setNoDelay(true);
+
+  // The key only has to be 16 random bytes, base64 encoded
+  static const char Base64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  char key[25];
+  for (int i = 0; i < 21; i++) key[i] = Base64[random(64)];
+  key[21] = Base64[random(4) << 4];   // 16 bytes use only 2 bits of the last character
+  key[22] = '='; key[23] = '='; key[24] = '\0';
+
+  String request = "GET " + path + " HTTP/1.1\r\nHost: " + host + ':' + port +
+                   "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: " + key +
+                   "\r\nSec-WebSocket-Version: 13\r\n" + extraHeaders + "\r\n";
+  _client.print(request);
+
+  String line;
+  if (!readLine(line) || !line.startsWith("HTTP/1.1 101")) {
+    Log.warning(F("WebSocket: upgrade refused by %s: %s"), host.c_str(), line.c_str());
+    _client.stop();
+    return false;
+  }
+  do {                                  // Skip the rest of the response headers
+    if (!readLine(line)) { _client.stop(); return false; }
+  } while (!line.isEmpty());
+
+  _open = true;
+  return true;
+}
+
+void WebSocket::close() {
+  if (_open) sendFrame(Op_Close, nullptr, 0);
+  _open = false;
+  _client.stop();
+}
+
+bool WebSocket::connected() {
+  if (_open && !_client.connected() && !_client.available()) _open = false;
+  return _open;
+}
+
+bool WebSocket::sendText(const String& message) {
+  return sendFrame(Op_Text, (const uint8_t*)message.c_str(), message.length());
+}
+
+bool WebSocket::receive(String& message, uint32_t timeout) {
+  message = "";
+  bool inMessage = false;
+  bool tooLarge = false;
+  uint32_t start = millis();
+  while (connected()) {
+    if (!inMessage && _client.available() < 2) {
+      if ((millis() - start) >= timeout) return false;
+      delay(1);
+      continue;
+    }
+
+    uint8_t header[2];
+    if (!readFully(header, 2)) break;
+    bool fin = header[0] & 0x80;
+    uint8_t opcode = header[0] & 0x0f;
+    bool masked = header[1] & 0x80;
+    uint64_t length = header[1] & 0x7f;
+    if (length >= 126) {
+      uint8_t ext[8];
+      size_t extLength = (length == 126) ? 2 : 8;
+      if (!readFully(ext, extLength)) break;
+      length = 0;
+      for (size_t i = 0; i < extLength; i++) length = (length << 8) | ext[i];
+    }
+    uint8_t mask[4] = {0, 0, 0, 0};
+    if (masked && !readFully(mask, 4)) break;
+
+    if (opcode & 0x08) {
+      // A control frame; its payload is at most 125 bytes
+      uint8_t payload[125];
+      if (length > sizeof(payload) || !readFully(payload, length)) break;
+      for (size_t i = 0; i < length; i++) payload[i] ^= mask[i & 3];
+      if (opcode == Op_Ping) sendFrame(Op_Pong, payload, length);
+      else if (opcode == Op_Close) { close(); return false; }
+      continue;
+    }
+
+    if (opcode != Op_Continuation) {
+      inMessage = true;
+      tooLarge = (opcode != Op_Text);   // Binary messages are skipped, too
+      message = "";
+    }
+    if (message.length() + length > MaxMessageSize) tooLarge = true;
+
+    // Read the payload a piece at a time, keeping it only if it fits
+    uint8_t buf[128];
+    size_t offset = 0;
+    while (length) {
+      size_t n = (length < sizeof(buf)) ? length : sizeof(buf);
+      if (!readFully(buf, n)) { close(); return false; }
+      if (!tooLarge) {
+        for (size_t i = 0; i < n; i++) buf[i] ^= mask[(offset + i) & 3];
+        message.concat((const char*)buf, n);
+      }
+      offset += n;
+      length -= n;
+    }
+
+    if (fin) {
+      if (!tooLarge) return true;
+      Log.warning(F("WebSocket: skipped a message that was too large"));
+      inMessage = false;
+      message = "";
+    }
+  }
+  close();
+  return false;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Private methods
+ *
+ *----------------------------------------------------------------------------*/
+
+// Frames sent by a client must be masked
+bool WebSocket::sendFrame(Opcode opcode, const uint8_t* payload, size_t length) {
+  uint8_t header[14];
+  size_t headerLength = 2;
+  header[0] = 0x80 | opcode;
+  if (length < 126) {
+    header[1] = 0x80 | length;
+  } else if (length <= 0xffff) {
+    header[1] = 0x80 | 126;
+    header[2] = length >> 8;
+    header[3] = length;
+    headerLength = 4;
+  } else {
+    return false;
+  }
+  uint8_t* mask = header + headerLength;
+  for (int i = 0; i < 4; i++) mask[i] = random(256);
+  headerLength += 4;
+  if (_client.write(header, headerLength) != headerLength) return false;
+
+  uint8_t buf[128];
+  for (size_t offset = 0; offset < length; ) {
+    size_t n = (length - offset < sizeof(buf)) ? length - offset : sizeof(buf);
+    for (size_t i = 0; i < n; i++) buf[i] = payload[offset + i] ^ mask[(offset + i) & 3];
+    if (_client.write(buf, n) != n) return false;
+    offset += n;
+  }
+  return true;
+}
+
+bool WebSocket::readFully(uint8_t* buf, size_t length) {
+  uint32_t start = millis();
+  while (length) {
+    if (_client.available()) {
+      int n = _client.read(buf, length);
+      if (n <= 0) continue;
+      buf += n;
+      length -= n;
+    } else if (!_client.connected() || (millis() - start) >= Timeout) {
+      return false;
+    } else {
+      delay(1);
+    }
+  }
+  return true;
+}
+
+// Read a line of the handshake response, without its CRLF
+bool WebSocket::readLine(String& line) {
+  line = "";
+  uint8_t c;
+  while (readFully(&c, 1)) {
+    if (c == '\n') return true;
+    if (c != '\r') line += (char)c;
+    if (line.length() > 256) return false;
+  }
+  return false;
+}
@@ -0,0 +1,50 @@
+#ifndef BPA_WebSocket_h
+#define BPA_WebSocket_h
+
+//--------------- Begin:  Includes ---------------------------------------------
+//                                  Core Libraries
+#if defined(ESP8266)
+  #include <ESP8266WiFi.h>
+#else
+  #include <WiFi.h>
+#endif
+//                                  Third Party Libraries
+//                                  Local Includes
+//--------------- End:    Includes ---------------------------------------------
+
+
+/*
+ * A minimal WebSocket (RFC 6455) client for exchanging text messages with a
+ * printer server. Pings are answered, fragmented messages are reassembled,
+ * and messages larger than MaxMessageSize are skipped. There is no TLS and no
+ * extension support.
+ */
+class WebSocket {
+public:
+  static constexpr size_t MaxMessageSize = 4096;
+
+  // Connect and perform the opening handshake. `extraHeaders` are added to
+  // the upgrade request verbatim; each must end with "\r\n".
+  bool connect(const String& host, uint16_t port, const String& path, const String& extraHeaders = String());
+  void close();
+  bool connected();
+
+  bool sendText(const String& message);
+  // Read the next complete text message into `message`, waiting up to
+  // `timeout` ms for one to start arriving. Returns false if there is none,
+  // or if the connection was closed.
+  bool receive(String& message, uint32_t timeout = 0);
+
+private:
+  enum Opcode : uint8_t {Op_Continuation = 0x0, Op_Text = 0x1, Op_Binary = 0x2, Op_Close = 0x8, Op_Ping = 0x9, Op_Pong = 0xA};
+  static constexpr uint32_t Timeout = 5000;
+
+  WiFiClient _client;
+  bool _open = false;
+
+  bool sendFrame(Opcode opcode, const uint8_t* payload, size_t length);
+  bool readFully(uint8_t* buf, size_t length);
+  bool readLine(String& line);
+};
+
+#endif  // BPA_WebSocket_h